@@ -38,6 +38,7 @@
 #include "g10lib.h"
 #include "cipher.h"
 #include "bufhelp.h"
+#include "./cipher-internal.h"
 
 
 #define CHACHA20_MIN_KEY_SIZE 16        /* Bytes.  */
@@ -48,6 +49,10 @@
 #define CHACHA20_CTR_SIZE     16        /* Bytes.  */
 #define CHACHA20_INPUT_LENGTH (CHACHA20_BLOCK_SIZE / 4)
 
+/* Chunk size for ChaCha20-Poly1305.  The chunk is authenticated right
+   after its encryption while it is still in the L1 cache.  */
+#define CHACHA20_POLY1305_CHUNK_SIZE (4 * 1024)      /* Bytes.  */
+
 /* USE_SSE2 indicates whether to compile with Intel SSE2 code. */
 #undef USE_SSE2
 #if defined(__x86_64__) && (defined(HAVE_COMPATIBLE_GCC_AMD64_PLATFORM_AS) || \
@@ -71,6 +76,12 @@
 # define USE_AVX2 1
 #endif
 
+/* USE_AVX512 indicates whether to compile with Intel AVX512 code. */
+#undef USE_AVX512
+#if defined(USE_AVX2) && defined(HAVE_GCC_INLINE_ASM_AVX512)
+# define USE_AVX512 1
+#endif
+
 /* USE_NEON indicates whether to enable ARM NEON assembly code. */
 #undef USE_NEON
 #ifdef ENABLE_NEON_SUPPORT
@@ -136,6 +147,14 @@ unsigned int _gcry_chacha20_amd64_avx2_blocks(u32 *state, const byte *in,
 
 #endif /* USE_AVX2 */
 
+#ifdef USE_AVX512
+
+unsigned int _gcry_chacha20_amd64_avx512_blocks(u32 *state, const byte *in,
+                                                byte *out,
+                                                size_t bytes) ASM_FUNC_ABI;
+
+#endif /* USE_AVX512 */
+
 #ifdef USE_NEON
 
 unsigned int _gcry_chacha20_armv7_neon_blocks(u32 *state, const byte *in,
@@ -288,6 +307,32 @@ chacha20_blocks (u32 *state, const byte *src, byte *dst, size_t bytes)
 #undef QOUT
 
 
+#ifdef USE_AVX512
+/* The AVX512 code handles only input of multiples of sixteen blocks;
+   the remaining blocks and the key stream generation without input
+   are passed on to the AVX2 code.  */
+ASM_FUNC_ABI static unsigned int
+chacha20_blocks_avx512 (u32 *state, const byte *src, byte *dst, size_t bytes)
+{
+  size_t nbytes = bytes & ~(size_t)(16 * CHACHA20_BLOCK_SIZE - 1);
+  unsigned int burn = 0;
+
+  if (src && nbytes)
+    {
+      burn = _gcry_chacha20_amd64_avx512_blocks (state, src, dst, nbytes);
+      src += nbytes;
+      dst += nbytes;
+      bytes -= nbytes;
+    }
+
+  if (bytes)
+    burn = _gcry_chacha20_amd64_avx2_blocks (state, src, dst, bytes);
+
+  return burn;
+}
+#endif /*USE_AVX512*/
+
+
 static unsigned int
 chacha20_core(u32 *dst, struct CHACHA20_context_s *ctx)
 {
@@ -402,6 +447,10 @@ chacha20_do_setkey (CHACHA20_context_t * ctx,
   if (features & HWF_INTEL_AVX2)
     ctx->blocks = _gcry_chacha20_amd64_avx2_blocks;
 #endif
+#ifdef USE_AVX512
+  if ((features & HWF_INTEL_AVX512) && (features & HWF_INTEL_AVX2))
+    ctx->blocks = chacha20_blocks_avx512;
+#endif
 #ifdef USE_NEON
   if (features & HWF_ARM_NEON)
     ctx->blocks = _gcry_chacha20_armv7_neon_blocks;
@@ -511,6 +560,108 @@ chacha20_encrypt_stream (void *context, byte * outbuf, const byte * inbuf,
 }
 
 
+/* Encrypt or decrypt LENGTH bytes for the cipher handle C in
+   ChaCha20-Poly1305 AEAD mode and feed the ciphertext into its
+   Poly1305 context.  The full blocks are processed in chunks: each
+   chunk is encrypted with the AVX2 (or AVX512) ChaCha20 code and
+   authenticated with _gcry_poly1305_amd64_avx2_blocks while it is
+   still in the L1 cache.  The chunk is authenticated before its
+   decryption.  Returns false without doing anything if this code
+   can't be used; the caller then encrypts and authenticates in two
+   passes.  */
+int
+_gcry_chacha20_poly1305_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                               const void *inbuf_arg, size_t length,
+                               int encrypt)
+{
+#if defined(USE_AVX2) && defined(POLY1305_USE_AVX2)
+  CHACHA20_context_t *ctx = (void *) &c->context.c;
+  poly1305_context_t *pctx = &c->u_mode.poly1305.ctx;
+  byte *outbuf = outbuf_arg;
+  const byte *inbuf = inbuf_arg;
+  unsigned int nburn, burn = 0;
+  size_t n;
+
+  if (!_gcry_poly1305_use_avx2 (pctx))
+    return 0;
+  if (ctx->blocks != _gcry_chacha20_amd64_avx2_blocks
+# ifdef USE_AVX512
+      && ctx->blocks != chacha20_blocks_avx512
+# endif
+      )
+    return 0;
+
+  /* Use up the key stream left over from the previous call.  */
+  n = ctx->unused;
+  if (n > length)
+    n = length;
+  if (n)
+    {
+      if (!encrypt)
+        burn = _gcry_poly1305_update_avx2 (pctx, inbuf, n);
+      chacha20_do_encrypt_stream (ctx, outbuf, inbuf, n);
+      if (encrypt)
+        burn = _gcry_poly1305_update_avx2 (pctx, outbuf, n);
+      length -= n;
+      outbuf += n;
+      inbuf += n;
+    }
+
+  while (length >= CHACHA20_BLOCK_SIZE)
+    {
+      n = length;
+      if (n > CHACHA20_POLY1305_CHUNK_SIZE)
+        n = CHACHA20_POLY1305_CHUNK_SIZE;
+      n -= n % CHACHA20_BLOCK_SIZE;
+
+      if (!encrypt)
+        {
+          nburn = _gcry_poly1305_update_avx2 (pctx, inbuf, n);
+          burn = nburn > burn ? nburn : burn;
+        }
+
+      nburn = ctx->blocks (ctx->input, inbuf, outbuf, n) + ASM_EXTRA_STACK;
+      burn = nburn > burn ? nburn : burn;
+
+      if (encrypt)
+        {
+          nburn = _gcry_poly1305_update_avx2 (pctx, outbuf, n);
+          burn = nburn > burn ? nburn : burn;
+        }
+
+      length -= n;
+      outbuf += n;
+      inbuf += n;
+    }
+
+  if (length)
+    {
+      if (!encrypt)
+        {
+          nburn = _gcry_poly1305_update_avx2 (pctx, inbuf, length);
+          burn = nburn > burn ? nburn : burn;
+        }
+      chacha20_do_encrypt_stream (ctx, outbuf, inbuf, length);
+      if (encrypt)
+        {
+          nburn = _gcry_poly1305_update_avx2 (pctx, outbuf, length);
+          burn = nburn > burn ? nburn : burn;
+        }
+    }
+
+  _gcry_burn_stack (burn);
+  return 1;
+#else
+  (void)c;
+  (void)outbuf_arg;
+  (void)inbuf_arg;
+  (void)length;
+  (void)encrypt;
+  return 0;
+#endif
+}
+
+
 static const char *
 selftest (void)
 {
@@ -121,6 +121,91 @@ _gcry_cipher_cbc_encrypt (gcry_cipher_hd_t c,
 }
 
 
+/* Maximum number of streams passed to the bulk.cbc_enc_multi function
+   at once.  */
+#define CBC_MULTI_LANES 8
+
+/* Encrypt the N independent buffers INBUFS[i] of length INBUFLENS[i]
+   into OUTBUFS[i] using the IVs of the handles HDS[i].  The handles
+   need to be distinct and to share the same cipher and
+   bulk.cbc_enc_multi function.  The lengths need to be non-zero
+   multiples of the block length; the caller is responsible to check
+   this and the sizes of the output buffers.  With CBC_MAC set only the
+   last block is written to OUTBUFS[i]; if OUTBUFS is NULL only the IVs
+   are updated.  Up to CBC_MULTI_LANES streams are encrypted side by
+   side; whenever one of them is done, the next buffer takes over its
+   lane.  */
+void
+_gcry_cipher_cbc_encrypt_multi (gcry_cipher_hd_t *hds,
+                                unsigned char **outbufs,
+                                const unsigned char **inbufs,
+                                const size_t *inbuflens, size_t n,
+                                int cbc_mac)
+{
+  void *contexts[CBC_MULTI_LANES];
+  unsigned char *ivs[CBC_MULTI_LANES];
+  unsigned char *outs[CBC_MULTI_LANES];
+  const unsigned char *ins[CBC_MULTI_LANES];
+  size_t left[CBC_MULTI_LANES];
+  byte scratch[MAX_BLOCKSIZE];
+  size_t blocksize;
+  size_t next, nlanes, nblocks, l;
+
+  if (!n)
+    return;
+
+  blocksize = hds[0]->spec->blocksize;
+  if (!outbufs)
+    cbc_mac = 1;
+
+  for (next = nlanes = 0; ; )
+    {
+      /* Give idle lanes to the next buffers.  */
+      for (; nlanes < CBC_MULTI_LANES && next < n; nlanes++, next++)
+        {
+          contexts[nlanes] = &hds[next]->context.c;
+          ivs[nlanes] = hds[next]->u_iv.iv;
+          outs[nlanes] = outbufs ? outbufs[next] : scratch;
+          ins[nlanes] = inbufs[next];
+          left[nlanes] = inbuflens[next] / blocksize;
+        }
+      if (!nlanes)
+        break;
+
+      nblocks = left[0];
+      for (l = 1; l < nlanes; l++)
+        if (left[l] < nblocks)
+          nblocks = left[l];
+
+      hds[0]->bulk.cbc_enc_multi (contexts, ivs, outs, ins, nlanes, nblocks,
+                                  cbc_mac);
+
+      for (l = 0; l < nlanes; )
+        {
+          left[l] -= nblocks;
+          if (!left[l])
+            {
+              /* Move the last lane into the finished one.  */
+              nlanes--;
+              contexts[l] = contexts[nlanes];
+              ivs[l] = ivs[nlanes];
+              outs[l] = outs[nlanes];
+              ins[l] = ins[nlanes];
+              left[l] = left[nlanes];
+              continue;
+            }
+          ins[l] += nblocks * blocksize;
+          if (!cbc_mac)
+            outs[l] += nblocks * blocksize;
+          l++;
+        }
+    }
+
+  if (!outbufs)
+    wipememory (scratch, sizeof (scratch));
+}
+
+
 gcry_err_code_t
 _gcry_cipher_cbc_decrypt (gcry_cipher_hd_t c,
                           unsigned char *outbuf, size_t outbuflen,
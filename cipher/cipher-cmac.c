@@ -33,24 +33,29 @@
   (burn) = (burn) > __nburn ? (burn) : __nburn; } while (0)
 
 
-static void
-cmac_write (gcry_cipher_hd_t c, const byte * inbuf, size_t inlen)
+/* Start to process the INLEN bytes at INBUF.  Data completing a
+   buffered partial block is consumed and *INBUF_P and *INLEN_P are
+   advanced accordingly.  Returns the number of complete blocks at
+   *INBUF_P which need to be chained into the IV next.  The remaining
+   bytes are then passed to cmac_write_tail.  */
+static size_t
+cmac_write_head (gcry_cipher_hd_t c, const byte **inbuf_p, size_t *inlen_p,
+                 unsigned int *burn)
 {
   gcry_cipher_encrypt_t enc_fn = c->spec->encrypt;
   const unsigned int blocksize = c->spec->blocksize;
-  byte outbuf[MAX_BLOCKSIZE];
-  unsigned int burn = 0;
-  unsigned int nblocks;
-
-  if (!inlen || !inbuf)
-    return;
+  const byte *inbuf = *inbuf_p;
+  size_t inlen = *inlen_p;
+  size_t nblocks;
 
   /* Last block is needed for cmac_final.  */
   if (c->unused + inlen <= blocksize)
     {
       for (; inlen && c->unused < blocksize; inlen--)
         c->lastiv[c->unused++] = *inbuf++;
-      return;
+      *inbuf_p = inbuf;
+      *inlen_p = inlen;
+      return 0;
     }
 
   if (c->unused)
@@ -59,16 +64,54 @@ cmac_write (gcry_cipher_hd_t c, const byte * inbuf, size_t inlen)
         c->lastiv[c->unused++] = *inbuf++;
 
       buf_xor (c->u_iv.iv, c->u_iv.iv, c->lastiv, blocksize);
-      set_burn (burn, enc_fn (&c->context.c, c->u_iv.iv, c->u_iv.iv));
+      set_burn (*burn, enc_fn (&c->context.c, c->u_iv.iv, c->u_iv.iv));
 
       c->unused = 0;
     }
 
-  if (c->bulk.cbc_enc && inlen > blocksize)
-    {
-      nblocks = inlen / blocksize;
-      nblocks -= (nblocks * blocksize == inlen);
+  nblocks = inlen / blocksize;
+  nblocks -= (nblocks * blocksize == inlen);
+
+  *inbuf_p = inbuf;
+  *inlen_p = inlen;
+  return nblocks;
+}
+
 
+/* Keep the INLEN bytes at INBUF which remain after the complete blocks
+   for cmac_final.  */
+static void
+cmac_write_tail (gcry_cipher_hd_t c, const byte *inbuf, size_t inlen)
+{
+  const unsigned int blocksize = c->spec->blocksize;
+
+  /* Make sure that last block is passed to cmac_final.  */
+  if (inlen == 0)
+    BUG ();
+
+  for (; inlen && c->unused < blocksize; inlen--)
+    c->lastiv[c->unused++] = *inbuf++;
+}
+
+
+static void
+cmac_write (gcry_cipher_hd_t c, const byte * inbuf, size_t inlen)
+{
+  gcry_cipher_encrypt_t enc_fn = c->spec->encrypt;
+  const unsigned int blocksize = c->spec->blocksize;
+  byte outbuf[MAX_BLOCKSIZE];
+  unsigned int burn = 0;
+  size_t nblocks;
+
+  if (!inlen || !inbuf)
+    return;
+
+  nblocks = cmac_write_head (c, &inbuf, &inlen, &burn);
+  if (!inlen)
+    return;
+
+  if (c->bulk.cbc_enc && nblocks)
+    {
       c->bulk.cbc_enc (&c->context.c, c->u_iv.iv, outbuf, inbuf, nblocks, 1);
       inbuf += nblocks * blocksize;
       inlen -= nblocks * blocksize;
@@ -76,7 +119,7 @@ cmac_write (gcry_cipher_hd_t c, const byte * inbuf, size_t inlen)
       wipememory (outbuf, sizeof (outbuf));
     }
   else
-    while (inlen > blocksize)
+    for (; nblocks; nblocks--)
       {
         buf_xor (c->u_iv.iv, c->u_iv.iv, inbuf, blocksize);
         set_burn (burn, enc_fn (&c->context.c, c->u_iv.iv, c->u_iv.iv));
@@ -84,12 +127,7 @@ cmac_write (gcry_cipher_hd_t c, const byte * inbuf, size_t inlen)
         inbuf += blocksize;
       }
 
-  /* Make sure that last block is passed to cmac_final.  */
-  if (inlen == 0)
-    BUG ();
-
-  for (; inlen && c->unused < blocksize; inlen--)
-    c->lastiv[c->unused++] = *inbuf++;
+  cmac_write_tail (c, inbuf, inlen);
 
   if (burn)
     _gcry_burn_stack (burn + 4 * sizeof (void *));
@@ -195,9 +233,9 @@ cmac_tag (gcry_cipher_hd_t c, unsigned char *tag, size_t taglen, int check)
 }
 
 
-gcry_err_code_t
-_gcry_cipher_cmac_authenticate (gcry_cipher_hd_t c,
-                                const unsigned char *abuf, size_t abuflen)
+static gcry_err_code_t
+cmac_check_authenticate (gcry_cipher_hd_t c,
+                         const unsigned char *abuf, size_t abuflen)
 {
   if (abuflen > 0 && !abuf)
     return GPG_ERR_INV_ARG;
@@ -208,12 +246,108 @@ _gcry_cipher_cmac_authenticate (gcry_cipher_hd_t c,
   if (c->spec->blocksize != 16 && c->spec->blocksize != 8)
     return GPG_ERR_INV_CIPHER_MODE;
 
+  return GPG_ERR_NO_ERROR;
+}
+
+
+gcry_err_code_t
+_gcry_cipher_cmac_authenticate (gcry_cipher_hd_t c,
+                                const unsigned char *abuf, size_t abuflen)
+{
+  gcry_err_code_t rc;
+
+  rc = cmac_check_authenticate (c, abuf, abuflen);
+  if (rc)
+    return rc;
+
   cmac_write (c, abuf, abuflen);
 
   return GPG_ERR_NO_ERROR;
 }
 
 
+/* Feed the N buffers ABUFS[i] of length ABUFLENS[i] into the distinct
+   CMAC handles HDS[i], which all use the same cipher, and store the
+   result for each at RCS[i].  The complete blocks of all buffers are
+   chained with the bulk.cbc_enc_multi function of the cipher, which
+   processes several messages side by side.  */
+void
+_gcry_cipher_cmac_authenticate_multi (gcry_cipher_hd_t *hds,
+                                      const unsigned char **abufs,
+                                      const size_t *abuflens, size_t n,
+                                      gcry_err_code_t *rcs)
+{
+  gcry_cipher_hd_t *sub_hds;
+  const unsigned char **sub_bufs;
+  size_t *sub_lens;
+  gcry_cipher_hd_t c;
+  const unsigned char *inbuf;
+  size_t inlen, nblocks, nsub, i;
+  unsigned int burn = 0;
+
+  if (!n)
+    return;
+
+  /* One allocation for the three arrays; they all have pointer sized
+     elements.  Without it the buffers are processed one by one.  */
+  sub_hds = NULL;
+  sub_bufs = NULL;
+  sub_lens = NULL;
+  if (hds[0]->bulk.cbc_enc_multi)
+    sub_hds = xtrycalloc (n, (sizeof *sub_hds + sizeof *sub_bufs
+                              + sizeof *sub_lens));
+  if (sub_hds)
+    {
+      sub_bufs = (const unsigned char **)(sub_hds + n);
+      sub_lens = (size_t *)(sub_bufs + n);
+    }
+
+  for (nsub = i = 0; i < n; i++)
+    {
+      c = hds[i];
+      inbuf = abufs[i];
+      inlen = abuflens[i];
+
+      rcs[i] = cmac_check_authenticate (c, inbuf, inlen);
+      if (rcs[i] || !inlen)
+        continue;
+
+      if (!sub_hds)
+        {
+          cmac_write (c, inbuf, inlen);
+          continue;
+        }
+
+      nblocks = cmac_write_head (c, &inbuf, &inlen, &burn);
+      if (!inlen)
+        continue;
+
+      if (nblocks)
+        {
+          sub_hds[nsub] = c;
+          sub_bufs[nsub] = inbuf;
+          sub_lens[nsub] = nblocks * c->spec->blocksize;
+          nsub++;
+          inbuf += nblocks * c->spec->blocksize;
+          inlen -= nblocks * c->spec->blocksize;
+        }
+
+      /* LASTIV is not touched by the block chaining; thus the tail can
+         be stored right away.  */
+      cmac_write_tail (c, inbuf, inlen);
+    }
+
+  if (nsub)
+    _gcry_cipher_cbc_encrypt_multi (sub_hds, NULL, sub_bufs, sub_lens, nsub,
+                                    1);
+
+  xfree (sub_hds);
+
+  if (burn)
+    _gcry_burn_stack (burn + 4 * sizeof (void *));
+}
+
+
 gcry_err_code_t
 _gcry_cipher_cmac_get_tag (gcry_cipher_hd_t c,
                            unsigned char *outtag, size_t taglen)
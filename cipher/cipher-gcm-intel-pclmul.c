@@ -242,6 +242,132 @@ static inline void gfmul_pclmul_aggr4(void)
                 "pxor %%xmm3, %%xmm1\n\t" /* the result is in xmm1 */
                 :::"cc");
 }
+
+/* Multiply one input block with a power of H and add the product in
+   Karatsuba form to the accumulators XMM3 (a0*b0), XMM6 (a1*b1) and
+   XMM4 ((a0+a1)*(b0+b1)).  H_MEM addresses the power of H and MID_OFF
+   the pre-computed a0+a1 for it in the table.  XMM2, XMM5 and XMM7 are
+   clobbered.  */
+#define aggr8_step(idx, h_mem, mid_off)                                 \
+                "movdqu " #idx "*16(%[buf]), %%xmm2\n\t"                \
+                "pshufb %%xmm15, %%xmm2\n\t" /* be => le */             \
+                aggr8_step_add_hash_##idx                               \
+                "pshufd $78, %%xmm2, %%xmm5\n\t"                        \
+                "pxor %%xmm2, %%xmm5\n\t" /* xmm5 holds b0+b1 */         \
+                "movq " mid_off "(%[h_table]), %%xmm7\n\t"              \
+                "pclmulqdq $0, %%xmm7, %%xmm5\n\t"                      \
+                "pxor %%xmm5, %%xmm4\n\t"                               \
+                "movdqu " h_mem ", %%xmm7\n\t"                          \
+                "movdqa %%xmm2, %%xmm5\n\t"                             \
+                "pclmulqdq $0, %%xmm7, %%xmm5\n\t"                      \
+                "pclmulqdq $17, %%xmm7, %%xmm2\n\t"                     \
+                "pxor %%xmm5, %%xmm3\n\t"                               \
+                "pxor %%xmm2, %%xmm6\n\t"
+/* Y_(i-8) is added to the first block.  */
+#define aggr8_step_add_hash_0 "pxor %%xmm1, %%xmm2\n\t"
+#define aggr8_step_add_hash_1
+#define aggr8_step_add_hash_2
+#define aggr8_step_add_hash_3
+#define aggr8_step_add_hash_4
+#define aggr8_step_add_hash_5
+#define aggr8_step_add_hash_6
+#define aggr8_step_add_hash_7
+
+static inline void gfmul_pclmul_aggr8(const void *buf, const void *h_table,
+                                      const void *h_1, const void *be_mask)
+{
+  /* Input:
+      H¹: [h_1]         H² to H⁸ and the a0+a1 terms of H¹ to H⁸: [h_table]
+      X_(i-7) to X_i: [buf], big-endian
+      Y_(i-8): XMM1
+     Output:
+      Y_i: XMM1
+     Inputs XMM0 stays unmodified.
+   */
+  asm volatile ("movdqa %[be_mask], %%xmm15\n\t"
+                "pxor %%xmm3, %%xmm3\n\t"
+                "pxor %%xmm4, %%xmm4\n\t"
+                "pxor %%xmm6, %%xmm6\n\t"
+                aggr8_step(0, "6*16(%[h_table])", "0x70+7*8") /* H⁸ */
+                aggr8_step(1, "5*16(%[h_table])", "0x70+6*8") /* H⁷ */
+                aggr8_step(2, "4*16(%[h_table])", "0x70+5*8") /* H⁶ */
+                aggr8_step(3, "3*16(%[h_table])", "0x70+4*8") /* H⁵ */
+                aggr8_step(4, "2*16(%[h_table])", "0x70+3*8") /* H⁴ */
+                aggr8_step(5, "1*16(%[h_table])", "0x70+2*8") /* H³ */
+                aggr8_step(6, "0*16(%[h_table])", "0x70+1*8") /* H² */
+                aggr8_step(7, "(%[h_1])",         "0x70+0*8") /* H¹ */
+
+                /* aggregated reduction... */
+                "movdqa %%xmm3, %%xmm5\n\t"
+                "pxor %%xmm6, %%xmm5\n\t" /* xmm5 holds a0*b0+a1*b1 */
+                "pxor %%xmm5, %%xmm4\n\t" /* xmm4 holds a0*b0+a1*b1+(a0+a1)*(b0+b1) */
+                "movdqa %%xmm4, %%xmm5\n\t"
+                "psrldq $8, %%xmm4\n\t"
+                "pslldq $8, %%xmm5\n\t"
+                "pxor %%xmm5, %%xmm3\n\t"
+                "pxor %%xmm4, %%xmm6\n\t" /* <xmm6:xmm3> holds the result of the
+                                             carry-less multiplication */
+
+                /* shift the result by one bit position to the left cope for
+                   the fact that bits are reversed */
+                "movdqa %%xmm3, %%xmm4\n\t"
+                "movdqa %%xmm6, %%xmm5\n\t"
+                "pslld $1, %%xmm3\n\t"
+                "pslld $1, %%xmm6\n\t"
+                "psrld $31, %%xmm4\n\t"
+                "psrld $31, %%xmm5\n\t"
+                "movdqa %%xmm4, %%xmm1\n\t"
+                "pslldq $4, %%xmm5\n\t"
+                "pslldq $4, %%xmm4\n\t"
+                "psrldq $12, %%xmm1\n\t"
+                "por %%xmm4, %%xmm3\n\t"
+                "por %%xmm5, %%xmm6\n\t"
+                "por %%xmm6, %%xmm1\n\t"
+
+                /* first phase of the reduction */
+                "movdqa %%xmm3, %%xmm6\n\t"
+                "movdqa %%xmm3, %%xmm7\n\t"
+                "pslld $31, %%xmm6\n\t"  /* packed right shifting << 31 */
+                "movdqa %%xmm3, %%xmm5\n\t"
+                "pslld $30, %%xmm7\n\t"  /* packed right shifting shift << 30 */
+                "pslld $25, %%xmm5\n\t"  /* packed right shifting shift << 25 */
+                "pxor %%xmm7, %%xmm6\n\t" /* xor the shifted versions */
+                "pxor %%xmm5, %%xmm6\n\t"
+                "movdqa %%xmm6, %%xmm7\n\t"
+                "pslldq $12, %%xmm6\n\t"
+                "psrldq $4, %%xmm7\n\t"
+                "pxor %%xmm6, %%xmm3\n\t" /* first phase of the reduction
+                                             complete */
+
+                /* second phase of the reduction */
+                "movdqa %%xmm3, %%xmm2\n\t"
+                "movdqa %%xmm3, %%xmm4\n\t"
+                "psrld $1, %%xmm2\n\t"    /* packed left shifting >> 1 */
+                "movdqa %%xmm3, %%xmm5\n\t"
+                "psrld $2, %%xmm4\n\t"    /* packed left shifting >> 2 */
+                "psrld $7, %%xmm5\n\t"    /* packed left shifting >> 7 */
+                "pxor %%xmm4, %%xmm2\n\t" /* xor the shifted versions */
+                "pxor %%xmm5, %%xmm2\n\t"
+                "pxor %%xmm7, %%xmm2\n\t"
+                "pxor %%xmm2, %%xmm3\n\t"
+                "pxor %%xmm3, %%xmm1\n\t" /* the result is in xmm1 */
+                :
+                : [buf] "r" (buf),
+                  [h_table] "r" (h_table),
+                  [h_1] "r" (h_1),
+                  [be_mask] "m" (*(const unsigned char *)be_mask)
+                : "cc", "memory");
+}
+
+#undef aggr8_step
+#undef aggr8_step_add_hash_0
+#undef aggr8_step_add_hash_1
+#undef aggr8_step_add_hash_2
+#undef aggr8_step_add_hash_3
+#undef aggr8_step_add_hash_4
+#undef aggr8_step_add_hash_5
+#undef aggr8_step_add_hash_6
+#undef aggr8_step_add_hash_7
 #endif
 
 
@@ -249,6 +375,9 @@ void
 _gcry_ghash_setup_intel_pclmul (gcry_cipher_hd_t c)
 {
   u64 tmp[2];
+#ifdef __x86_64__
+  int i;
+#endif
 #if defined(__x86_64__) && defined(__WIN64__)
   char win64tmp[3 * 16];
 
@@ -292,10 +421,48 @@ _gcry_ghash_setup_intel_pclmul (gcry_cipher_hd_t c)
   gfmul_pclmul (); /* H²•H² => H⁴ */
 
   asm volatile ("movdqu %%xmm1, 2*16(%[h_234])\n\t"
+                "movdqu %[h_1], %%xmm0\n\t"
                 :
-                : [h_234] "r" (c->u_mode.gcm.gcm_table)
+                : [h_234] "r" (c->u_mode.gcm.gcm_table),
+                  [h_1] "m" (*tmp)
+                : "memory");
+
+  /* H⁵ to H⁸ and the Karatsuba middle terms of H¹ to H⁸ are used by
+     the eight block aggregated GHASH and the stitched AES-GCM code.  */
+  gfmul_pclmul (); /* H•H⁴ => H⁵ */
+
+  asm volatile ("movdqu %%xmm1, 3*16(%[h_5678])\n\t"
+                :
+                : [h_5678] "r" (c->u_mode.gcm.gcm_table)
+                : "memory");
+
+  gfmul_pclmul (); /* H•H⁵ => H⁶ */
+
+  asm volatile ("movdqu %%xmm1, 4*16(%[h_5678])\n\t"
+                :
+                : [h_5678] "r" (c->u_mode.gcm.gcm_table)
+                : "memory");
+
+  gfmul_pclmul (); /* H•H⁶ => H⁷ */
+
+  asm volatile ("movdqu %%xmm1, 5*16(%[h_5678])\n\t"
+                :
+                : [h_5678] "r" (c->u_mode.gcm.gcm_table)
+                : "memory");
+
+  gfmul_pclmul (); /* H•H⁷ => H⁸ */
+
+  asm volatile ("movdqu %%xmm1, 6*16(%[h_5678])\n\t"
+                :
+                : [h_5678] "r" (c->u_mode.gcm.gcm_table)
                 : "memory");
 
+  c->u_mode.gcm.gcm_table[14] = tmp[0] ^ tmp[1];
+  for (i = 2; i <= 8; i++)
+    c->u_mode.gcm.gcm_table[14 + i - 1] =
+      c->u_mode.gcm.gcm_table[2 * (i - 2) + 0] ^
+      c->u_mode.gcm.gcm_table[2 * (i - 2) + 1];
+
 #ifdef __WIN64__
   /* Clear/restore used registers. */
   asm volatile( "pxor %%xmm0, %%xmm0\n\t"
@@ -371,7 +538,15 @@ _gcry_ghash_intel_pclmul (gcry_cipher_hd_t c, byte *result, const byte *buf,
 #ifdef __x86_64__
   if (nblocks >= 4)
     {
-      do
+      for (; nblocks >= 8; nblocks -= 8)
+        {
+          gfmul_pclmul_aggr8 (buf, c->u_mode.gcm.gcm_table,
+                              c->u_mode.gcm.u_ghash_key.key, be_mask);
+
+          buf += 8 * blocksize;
+        }
+
+      if (nblocks >= 4)
         {
           asm volatile ("movdqa %[be_mask], %%xmm4\n\t"
                         "movdqu 0*16(%[buf]), %%xmm5\n\t"
@@ -398,7 +573,6 @@ _gcry_ghash_intel_pclmul (gcry_cipher_hd_t c, byte *result, const byte *buf,
           buf += 4 * blocksize;
           nblocks -= 4;
         }
-      while (nblocks >= 4);
 
 #ifndef __WIN64__
       /* Clear used x86-64/XMM registers. */
@@ -30,14 +30,6 @@
 #include "./cipher-internal.h"
 
 
-#ifdef GCM_USE_INTEL_PCLMUL
-extern void _gcry_ghash_setup_intel_pclmul (gcry_cipher_hd_t c);
-
-extern unsigned int _gcry_ghash_intel_pclmul (gcry_cipher_hd_t c, byte *result,
-                                              const byte *buf, size_t nblocks);
-#endif
-
-
 #ifdef GCM_USE_TABLES
 static const u16 gcmR[256] = {
   0x0000, 0x01c2, 0x0384, 0x0246, 0x0708, 0x06ca, 0x048c, 0x054e,
@@ -114,6 +106,15 @@ do_fillM (unsigned char *h, u64 *M)
         M[(i + j) + 0] = M[i + 0] ^ M[j + 0];
         M[(i + j) + 16] = M[i + 16] ^ M[j + 16];
       }
+
+  /* The second half of the table holds the entries of the first half
+     multiplied by x^4.  This saves do_ghash the shift and reduction for
+     the low nibble of each byte.  */
+  for (i = 0; i < 16; i++)
+    {
+      M[i + 32] = (M[i + 0] >> 4) ^ ((u64) gcmR[(M[i + 16] & 0xf) << 4] << 48);
+      M[i + 48] = (M[i + 16] >> 4) ^ (M[i + 0] << 60);
+    }
 }
 
 static inline unsigned int
@@ -121,54 +122,44 @@ do_ghash (unsigned char *result, const unsigned char *buf, const u64 *gcmM)
 {
   u64 V[2];
   u64 tmp[2];
-  const u64 *M;
   u64 T;
   u32 A;
+  unsigned int hi, lo;
   int i;
 
   buf_xor (V, result, buf, 16);
   V[0] = be_bswap64 (V[0]);
   V[1] = be_bswap64 (V[1]);
 
-  /* First round can be manually tweaked based on fact that 'tmp' is zero. */
-  i = 15;
-
-  M = &gcmM[(V[1] & 0xf)];
-  V[1] >>= 4;
-  tmp[0] = (M[0] >> 4) ^ ((u64) gcmR[(M[16] & 0xf) << 4] << 48);
-  tmp[1] = (M[16] >> 4) ^ (M[0] << 60);
-  tmp[0] ^= gcmM[(V[1] & 0xf) + 0];
-  tmp[1] ^= gcmM[(V[1] & 0xf) + 16];
-  V[1] >>= 4;
+  /* Each byte is processed with one table lookup for its high nibble
+     and one in the x^4 table for its low nibble.  The first round can
+     be manually tweaked based on fact that 'tmp' is zero. */
+  lo = V[1] & 0xf;
+  hi = (V[1] >> 4) & 0xf;
+  tmp[0] = gcmM[hi + 0] ^ gcmM[lo + 32];
+  tmp[1] = gcmM[hi + 16] ^ gcmM[lo + 48];
+  V[1] >>= 8;
 
-  --i;
-  while (1)
+  for (i = 14; i >= 0; i--)
     {
-      M = &gcmM[(V[1] & 0xf)];
-      V[1] >>= 4;
+      if (i == 7)
+        V[1] = V[0];
+
+      lo = V[1] & 0xf;
+      hi = (V[1] >> 4) & 0xf;
+      V[1] >>= 8;
 
       A = tmp[1] & 0xff;
       T = tmp[0];
-      tmp[0] = (T >> 8) ^ ((u64) gcmR[A] << 48) ^ gcmM[(V[1] & 0xf) + 0];
-      tmp[1] = (T << 56) ^ (tmp[1] >> 8) ^ gcmM[(V[1] & 0xf) + 16];
-
-      tmp[0] ^= (M[0] >> 4) ^ ((u64) gcmR[(M[16] & 0xf) << 4] << 48);
-      tmp[1] ^= (M[16] >> 4) ^ (M[0] << 60);
-
-      if (i == 0)
-        break;
-      else if (i == 8)
-        V[1] = V[0];
-      else
-        V[1] >>= 4;
-      --i;
+      tmp[0] = (T >> 8) ^ ((u64) gcmR[A] << 48) ^ gcmM[hi + 0] ^ gcmM[lo + 32];
+      tmp[1] = (T << 56) ^ (tmp[1] >> 8) ^ gcmM[hi + 16] ^ gcmM[lo + 48];
     }
 
   buf_put_be64 (result + 0, tmp[0]);
   buf_put_be64 (result + 8, tmp[1]);
 
   return (sizeof(V) + sizeof(T) + sizeof(tmp) +
-          sizeof(int)*2 + sizeof(void*)*5);
+          sizeof(int)*4 + sizeof(void*)*5);
 }
 
 #else /*!GCM_TABLES_USE_U64*/
@@ -521,6 +512,29 @@ do_ghash_buf(gcry_cipher_hd_t c, byte *hash, const byte *buf,
 }
 
 
+/* Process complete blocks with the bulk GCM function of the cipher,
+   which does the CTR encryption and the GHASH in a single pass.
+   Returns the number of bytes processed.  */
+static size_t
+gcm_crypt_bulk (gcry_cipher_hd_t c, byte *outbuf, const byte *inbuf,
+                size_t inbuflen, int encrypt)
+{
+  size_t nblocks, nleft;
+
+  /* Partial blocks left over from previous calls are not supported.  */
+  if (!c->bulk.gcm_crypt || c->unused || c->u_mode.gcm.mac_unused)
+    return 0;
+
+  nblocks = inbuflen / GCRY_GCM_BLOCK_LEN;
+  if (!nblocks)
+    return 0;
+
+  nleft = c->bulk.gcm_crypt (c, outbuf, inbuf, nblocks, encrypt);
+
+  return (nblocks - nleft) * GCRY_GCM_BLOCK_LEN;
+}
+
+
 gcry_err_code_t
 _gcry_cipher_gcm_encrypt (gcry_cipher_hd_t c,
                           byte *outbuf, size_t outbuflen,
@@ -528,6 +542,7 @@ _gcry_cipher_gcm_encrypt (gcry_cipher_hd_t c,
 {
   static const unsigned char zerobuf[MAX_BLOCKSIZE];
   gcry_err_code_t err;
+  size_t n;
 
   if (c->spec->blocksize != GCRY_GCM_BLOCK_LEN)
     return GPG_ERR_CIPHER_ALGO;
@@ -558,6 +573,12 @@ _gcry_cipher_gcm_encrypt (gcry_cipher_hd_t c,
       return GPG_ERR_INV_LENGTH;
     }
 
+  n = gcm_crypt_bulk (c, outbuf, inbuf, inbuflen, 1);
+  outbuf += n;
+  outbuflen -= n;
+  inbuf += n;
+  inbuflen -= n;
+
   err = _gcry_cipher_ctr_encrypt(c, outbuf, outbuflen, inbuf, inbuflen);
   if (err != 0)
     return err;
@@ -574,6 +595,7 @@ _gcry_cipher_gcm_decrypt (gcry_cipher_hd_t c,
                           const byte *inbuf, size_t inbuflen)
 {
   static const unsigned char zerobuf[MAX_BLOCKSIZE];
+  size_t n;
 
   if (c->spec->blocksize != GCRY_GCM_BLOCK_LEN)
     return GPG_ERR_CIPHER_ALGO;
@@ -601,6 +623,12 @@ _gcry_cipher_gcm_decrypt (gcry_cipher_hd_t c,
       return GPG_ERR_INV_LENGTH;
     }
 
+  n = gcm_crypt_bulk (c, outbuf, inbuf, inbuflen, 0);
+  outbuf += n;
+  outbuflen -= n;
+  inbuf += n;
+  inbuflen -= n;
+
   do_ghash_buf(c, c->u_mode.gcm.u_tag.tag, inbuf, inbuflen, 0);
 
   return _gcry_cipher_ctr_encrypt(c, outbuf, outbuflen, inbuf, inbuflen);
@@ -57,7 +57,8 @@
 # define NEED_16BYTE_ALIGNED_CONTEXT 1
 #endif
 
-/* Undef this symbol to trade GCM speed for 256 bytes of memory per context */
+/* Undef this symbol to trade GCM speed for 256 bytes (512 bytes on 64-bit
+   platforms) of memory per context */
 #define GCM_USE_TABLES 1
 
 
@@ -125,6 +126,10 @@ struct gcry_cipher_handle
     void (*cbc_dec)(void *context, unsigned char *iv,
                     void *outbuf_arg, const void *inbuf_arg,
                     size_t nblocks);
+    void (*cbc_enc_multi)(void **contexts, unsigned char **ivs,
+                          unsigned char **outbufs,
+                          const unsigned char **inbufs,
+                          size_t nlanes, size_t nblocks, int cbc_mac);
     void (*ctr_enc)(void *context, unsigned char *iv,
                     void *outbuf_arg, const void *inbuf_arg,
                     size_t nblocks);
@@ -132,6 +137,14 @@ struct gcry_cipher_handle
 			const void *inbuf_arg, size_t nblocks, int encrypt);
     size_t (*ocb_auth)(gcry_cipher_hd_t c, const void *abuf_arg,
 		       size_t nblocks);
+    size_t (*gcm_crypt)(gcry_cipher_hd_t c, void *outbuf_arg,
+                        const void *inbuf_arg, size_t nblocks, int encrypt);
+    void (*xts_crypt)(void *context, unsigned char *tweak,
+                      void *outbuf_arg, const void *inbuf_arg,
+                      size_t nblocks, int encrypt);
+    int (*poly1305_crypt)(gcry_cipher_hd_t c, void *outbuf_arg,
+                          const void *inbuf_arg, size_t length,
+                          int encrypt);
   } bulk;
 
 
@@ -149,7 +162,8 @@ struct gcry_cipher_handle
      that it is properly aligned.  In particular some implementations
      of bulk operations expect an 16 byte aligned IV.  IV is also used
      to store CBC-MAC in CCM mode; counter IV is stored in U_CTR.  For
-     OCB mode it is used for the offset value.  */
+     OCB mode it is used for the offset value.  For XTS mode it holds
+     the data unit sequence number.  */
   union {
     cipher_context_alignment_t iv_align;
     unsigned char iv[MAX_BLOCKSIZE];
@@ -157,7 +171,7 @@ struct gcry_cipher_handle
 
   /* The counter for CTR mode.  This field is also used by AESWRAP and
      thus we can't use the U_IV union.  For OCB mode it is used for
-     the checksum.  */
+     the checksum.  For XTS mode it holds the current tweak.  */
   union {
     cipher_context_alignment_t iv_align;
     unsigned char ctr[MAX_BLOCKSIZE];
@@ -244,11 +258,12 @@ struct gcry_cipher_handle
       /* GHASH implementation in use. */
       ghash_fn_t ghash_fn;
 
-      /* Pre-calculated table for GCM. */
+      /* Pre-calculated table for GCM.  With PCLMUL on x86-64 it holds
+         H² to H⁸ followed by the Karatsuba terms of H¹ to H⁸.  */
 #ifdef GCM_USE_TABLES
  #if (SIZEOF_UNSIGNED_LONG == 8 || defined(__x86_64__))
       #define GCM_TABLES_USE_U64 1
-      u64 gcm_table[2 * 16];
+      u64 gcm_table[4 * 16];
  #else
       #undef GCM_TABLES_USE_U64
       u32 gcm_table[4 * 16];
@@ -289,6 +304,13 @@ struct gcry_cipher_handle
 
     } ocb;
 
+    /* Mode specific storage for XTS mode. */
+    struct {
+      /* Pointer to tweak cipher context, allocated after actual
+       * cipher context. */
+      char *tweak_context;
+    } xts;
+
   } u_mode;
 
   /* What follows are two contexts of the cipher in use.  The first
@@ -309,6 +331,10 @@ gcry_err_code_t _gcry_cipher_cbc_decrypt
 /*           */ (gcry_cipher_hd_t c,
                  unsigned char *outbuf, size_t outbuflen,
                  const unsigned char *inbuf, size_t inbuflen);
+void _gcry_cipher_cbc_encrypt_multi
+/*           */ (gcry_cipher_hd_t *hds, unsigned char **outbufs,
+                 const unsigned char **inbufs, const size_t *inbuflens,
+                 size_t n, int cbc_mac);
 
 /*-- cipher-cfb.c --*/
 gcry_err_code_t _gcry_cipher_cfb_encrypt
@@ -393,6 +419,15 @@ gcry_err_code_t _gcry_cipher_gcm_check_tag
 void _gcry_cipher_gcm_setkey
 /*           */   (gcry_cipher_hd_t c);
 
+/*-- cipher-gcm-intel-pclmul.c --*/
+#ifdef GCM_USE_INTEL_PCLMUL
+void _gcry_ghash_setup_intel_pclmul
+/*           */   (gcry_cipher_hd_t c);
+unsigned int _gcry_ghash_intel_pclmul
+/*           */   (gcry_cipher_hd_t c, byte *result,
+                   const byte *buf, size_t nblocks);
+#endif
+
 
 /*-- cipher-poly1305.c --*/
 gcry_err_code_t _gcry_cipher_poly1305_encrypt
@@ -443,6 +478,12 @@ const unsigned char *_gcry_cipher_ocb_get_l
 /*           */ (gcry_cipher_hd_t c, unsigned char *l_tmp, u64 n);
 
 
+/*-- cipher-xts.c --*/
+gcry_err_code_t _gcry_cipher_xts_crypt
+/*           */ (gcry_cipher_hd_t c, unsigned char *outbuf, size_t outbuflen,
+		 const unsigned char *inbuf, size_t inbuflen, int encrypt);
+
+
 /* Inline version of _gcry_cipher_ocb_get_l, with hard-coded fast paths for
    most common cases.  */
 static inline const unsigned char *
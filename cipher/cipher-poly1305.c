@@ -164,6 +164,10 @@ _gcry_cipher_poly1305_encrypt (gcry_cipher_hd_t c,
       return GPG_ERR_INV_LENGTH;
     }
 
+  if (c->bulk.poly1305_crypt
+      && c->bulk.poly1305_crypt (c, outbuf, inbuf, inbuflen, 1))
+    return 0;
+
   c->spec->stencrypt(&c->context.c, outbuf, (byte*)inbuf, inbuflen);
 
   _gcry_poly1305_update (&c->u_mode.poly1305.ctx, outbuf, inbuflen);
@@ -202,6 +206,10 @@ _gcry_cipher_poly1305_decrypt (gcry_cipher_hd_t c,
       return GPG_ERR_INV_LENGTH;
     }
 
+  if (c->bulk.poly1305_crypt
+      && c->bulk.poly1305_crypt (c, outbuf, inbuf, inbuflen, 0))
+    return 0;
+
   _gcry_poly1305_update (&c->u_mode.poly1305.ctx, inbuf, inbuflen);
 
   c->spec->stdecrypt(&c->context.c, outbuf, (byte*)inbuf, inbuflen);
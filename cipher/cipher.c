@@ -29,6 +29,7 @@
 #include "../src/gcrypt-testapi.h"
 #include "cipher.h"
 #include "./cipher-internal.h"
+#include "bufhelp.h"
 
 
 /* This is the list of the default ciphers, which are included in
@@ -433,6 +434,13 @@ _gcry_cipher_open_internal (gcry_cipher_hd_t *handle,
 	  err = GPG_ERR_INV_CIPHER_MODE;
 	break;
 
+      case GCRY_CIPHER_MODE_XTS:
+	if (spec->blocksize != GCRY_XTS_BLOCK_LEN)
+	  err = GPG_ERR_INV_CIPHER_MODE;
+	if (!spec->encrypt || !spec->decrypt)
+	  err = GPG_ERR_INV_CIPHER_MODE;
+	break;
+
       case GCRY_CIPHER_MODE_STREAM:
 	if (!spec->stencrypt || !spec->stdecrypt)
 	  err = GPG_ERR_INV_CIPHER_MODE;
@@ -466,6 +474,19 @@ _gcry_cipher_open_internal (gcry_cipher_hd_t *handle,
 #endif /*NEED_16BYTE_ALIGNED_CONTEXT*/
                      );
 
+      /* Space needed per mode.  */
+      switch (mode)
+        {
+        case GCRY_CIPHER_MODE_XTS:
+          /* Additional cipher context and its reset copy for the tweak
+             key, plus space for aligning it.  */
+          size += 2 * spec->contextsize + 15;
+          break;
+
+        default:
+          break;
+        }
+
       if (secure)
 	h = xtrycalloc_secure (1, size);
       else
@@ -506,9 +527,12 @@ _gcry_cipher_open_internal (gcry_cipher_hd_t *handle,
               h->bulk.cfb_dec = _gcry_aes_cfb_dec;
               h->bulk.cbc_enc = _gcry_aes_cbc_enc;
               h->bulk.cbc_dec = _gcry_aes_cbc_dec;
+              h->bulk.cbc_enc_multi = _gcry_aes_cbc_enc_multi;
               h->bulk.ctr_enc = _gcry_aes_ctr_enc;
               h->bulk.ocb_crypt = _gcry_aes_ocb_crypt;
               h->bulk.ocb_auth  = _gcry_aes_ocb_auth;
+              h->bulk.gcm_crypt = _gcry_aes_gcm_crypt;
+              h->bulk.xts_crypt = _gcry_aes_xts_crypt;
               break;
 #endif /*USE_AES*/
 #ifdef USE_BLOWFISH
@@ -564,6 +588,11 @@ _gcry_cipher_open_internal (gcry_cipher_hd_t *handle,
               h->bulk.ocb_auth  = _gcry_twofish_ocb_auth;
               break;
 #endif /*USE_TWOFISH*/
+#ifdef USE_CHACHA20
+	    case GCRY_CIPHER_CHACHA20:
+              h->bulk.poly1305_crypt = _gcry_chacha20_poly1305_crypt;
+              break;
+#endif /*USE_CHACHA20*/
 
             default:
               break;
@@ -576,6 +605,15 @@ _gcry_cipher_open_internal (gcry_cipher_hd_t *handle,
               h->u_mode.ocb.taglen = 16; /* Bytes.  */
               break;
 
+            case GCRY_CIPHER_MODE_XTS:
+              {
+                char *tc = (char *)&h->context.c + 2 * spec->contextsize;
+
+                tc += (16 - (uintptr_t)tc % 16) % 16;
+                h->u_mode.xts.tweak_context = tc;
+              }
+              break;
+
             default:
               break;
             }
@@ -628,6 +666,24 @@ cipher_setkey (gcry_cipher_hd_t c, byte *key, size_t keylen)
 {
   gcry_err_code_t rc;
 
+  if (c->mode == GCRY_CIPHER_MODE_XTS)
+    {
+      /* XTS uses two keys of equal length: the first half of KEY is
+         the data key and the second half the tweak key.  */
+      if (keylen % 2)
+        return GPG_ERR_INV_KEYLEN;
+      keylen /= 2;
+
+      if (fips_mode ())
+        {
+          /* Reject the key if both halves are equal; see the XTS-AES
+             key generation requirements in the FIPS 140-2
+             implementation guidance.  */
+          if (buf_eq_const (key, key + keylen, keylen))
+            return GPG_ERR_WEAK_KEY;
+        }
+    }
+
   rc = c->spec->setkey (&c->context.c, key, keylen);
   if (!rc)
     {
@@ -651,6 +707,20 @@ cipher_setkey (gcry_cipher_hd_t c, byte *key, size_t keylen)
           _gcry_cipher_poly1305_setkey (c);
           break;
 
+        case GCRY_CIPHER_MODE_XTS:
+          /* Setup the tweak cipher with the second half of the key.  */
+          rc = c->spec->setkey (c->u_mode.xts.tweak_context, key + keylen,
+                                keylen);
+          if (!rc)
+            {
+              /* Duplicate initial tweak context.  */
+              memcpy (c->u_mode.xts.tweak_context + c->spec->contextsize,
+                      c->u_mode.xts.tweak_context, c->spec->contextsize);
+            }
+          else
+            c->marks.key = 0;
+          break;
+
         default:
           break;
         };
@@ -749,6 +819,12 @@ cipher_reset (gcry_cipher_hd_t c)
       c->u_mode.ocb.taglen = 16;
       break;
 
+    case GCRY_CIPHER_MODE_XTS:
+      memcpy (c->u_mode.xts.tweak_context,
+              c->u_mode.xts.tweak_context + c->spec->contextsize,
+              c->spec->contextsize);
+      break;
+
     default:
       break; /* u_mode unused by other modes. */
     }
@@ -864,6 +940,10 @@ cipher_encrypt (gcry_cipher_hd_t c, byte *outbuf, size_t outbuflen,
       rc = _gcry_cipher_ocb_encrypt (c, outbuf, outbuflen, inbuf, inbuflen);
       break;
 
+    case GCRY_CIPHER_MODE_XTS:
+      rc = _gcry_cipher_xts_crypt (c, outbuf, outbuflen, inbuf, inbuflen, 1);
+      break;
+
     case GCRY_CIPHER_MODE_STREAM:
       c->spec->stencrypt (&c->context.c,
                           outbuf, (byte*)/*arggg*/inbuf, inbuflen);
@@ -922,6 +1002,144 @@ _gcry_cipher_encrypt (gcry_cipher_hd_t h, void *out, size_t outsize,
 
 
 
+/* qsort helper to find duplicate handles.  */
+static int
+compare_handles (const void *a, const void *b)
+{
+  gcry_cipher_hd_t ha = *(const gcry_cipher_hd_t *)a;
+  gcry_cipher_hd_t hb = *(const gcry_cipher_hd_t *)b;
+
+  return ha < hb ? -1 : ha > hb;
+}
+
+
+/* Return true if INLEN bytes can be encrypted into an OUTSIZE byte
+   buffer with handle H using the multi-stream CBC code.  Everything
+   else, including invalid arguments, is left to _gcry_cipher_encrypt.  */
+static int
+cbc_multi_usable (gcry_cipher_hd_t h, size_t outsize, size_t inlen)
+{
+  size_t blocksize = h->spec->blocksize;
+
+  return (h->mode == GCRY_CIPHER_MODE_CBC
+          && h->bulk.cbc_enc_multi
+          && !(h->flags & GCRY_CIPHER_CBC_CTS)
+          && inlen && !(inlen % blocksize)
+          && outsize >= ((h->flags & GCRY_CIPHER_CBC_MAC)? blocksize : inlen));
+}
+
+
+/****************
+ * Encrypt the N buffers IN[i] of length INLEN[i] into the buffers OUT[i]
+ * of size OUTSIZE[i] using the handles HDS[i].  If IN or IN[i] is NULL,
+ * in-place encryption has been requested.  The result is the same as
+ * calling _gcry_cipher_encrypt for each buffer in turn, but CBC
+ * encryption with distinct handles is done on several streams at once.
+ * The result for each buffer is stored at R_RESULTS if that is not
+ * NULL; the return value is the error of the first failed buffer.
+ */
+gcry_err_code_t
+_gcry_cipher_encrypt_batch (gcry_cipher_hd_t *hds,
+                            void **out, const size_t *outsize,
+                            const void **in, const size_t *inlen,
+                            size_t n, gcry_error_t *r_results)
+{
+  gcry_err_code_t rc;
+  gcry_err_code_t *rcs = NULL;
+  gcry_cipher_hd_t *sorted = NULL;
+  gcry_cipher_hd_t *sub_hds = NULL;
+  unsigned char **sub_outs = NULL;
+  const unsigned char **sub_ins = NULL;
+  size_t *sub_lens = NULL;
+  unsigned char *todo = NULL;
+  gcry_cipher_hd_t h;
+  size_t i, j, nsub, len;
+  int distinct;
+
+  if (!n)
+    return 0;
+
+  rcs = xtrycalloc (n, sizeof *rcs);
+  sorted = xtrymalloc (n * sizeof *sorted);
+  sub_hds = xtrymalloc (n * sizeof *sub_hds);
+  sub_outs = xtrymalloc (n * sizeof *sub_outs);
+  sub_ins = xtrymalloc (n * sizeof *sub_ins);
+  sub_lens = xtrymalloc (n * sizeof *sub_lens);
+  todo = xtrycalloc (n, 1);
+  if (!rcs || !sorted || !sub_hds || !sub_outs || !sub_ins || !sub_lens
+      || !todo)
+    {
+      rc = gpg_err_code_from_syserror ();
+      goto leave;
+    }
+
+  /* The streams of one handle depend on each other; process everything
+     in order if a handle is used more than once.  */
+  memcpy (sorted, hds, n * sizeof *sorted);
+  qsort (sorted, n, sizeof *sorted, compare_handles);
+  for (distinct = 1, i = 1; i < n; i++)
+    if (sorted[i] == sorted[i-1])
+      distinct = 0;
+
+  for (i = 0; i < n; i++)
+    {
+      len = (in && in[i])? inlen[i] : outsize[i];
+      todo[i] = distinct && cbc_multi_usable (hds[i], outsize[i], len);
+      if (!todo[i])
+        rcs[i] = _gcry_cipher_encrypt (hds[i], out[i], outsize[i],
+                                       in? in[i] : NULL, len);
+    }
+
+  /* Gather the buffers which may share the lanes of one
+     bulk.cbc_enc_multi call.  TODO[i] is cleared once buffer I has been
+     processed.  */
+  for (i = 0; i < n; i++)
+    {
+      if (!todo[i])
+        continue;
+
+      h = hds[i];
+      for (nsub = 0, j = i; j < n; j++)
+        if (todo[j]
+            && hds[j]->spec == h->spec
+            && hds[j]->bulk.cbc_enc_multi == h->bulk.cbc_enc_multi
+            && (!(hds[j]->flags & GCRY_CIPHER_CBC_MAC)
+                == !(h->flags & GCRY_CIPHER_CBC_MAC)))
+          {
+            sub_hds[nsub] = hds[j];
+            sub_outs[nsub] = out[j];
+            sub_ins[nsub] = (in && in[j])? in[j] : out[j];
+            sub_lens[nsub] = (in && in[j])? inlen[j] : outsize[j];
+            nsub++;
+            todo[j] = 0;
+          }
+      _gcry_cipher_cbc_encrypt_multi (sub_hds, sub_outs, sub_ins, sub_lens,
+                                      nsub,
+                                      !!(h->flags & GCRY_CIPHER_CBC_MAC));
+    }
+
+  rc = 0;
+  for (i = 0; i < n; i++)
+    {
+      if (r_results)
+        r_results[i] = gpg_error (rcs[i]);
+      if (rcs[i] && !rc)
+        rc = rcs[i];
+    }
+
+ leave:
+  xfree (todo);
+  xfree (sub_lens);
+  xfree (sub_ins);
+  xfree (sub_outs);
+  xfree (sub_hds);
+  xfree (sorted);
+  xfree (rcs);
+  return rc;
+}
+
+
+
 /****************
  * Decrypt INBUF to OUTBUF with the mode selected at open.
  * inbuf and outbuf may overlap or be the same.
@@ -981,6 +1199,10 @@ cipher_decrypt (gcry_cipher_hd_t c, byte *outbuf, size_t outbuflen,
       rc = _gcry_cipher_ocb_decrypt (c, outbuf, outbuflen, inbuf, inbuflen);
       break;
 
+    case GCRY_CIPHER_MODE_XTS:
+      rc = _gcry_cipher_xts_crypt (c, outbuf, outbuflen, inbuf, inbuflen, 0);
+      break;
+
     case GCRY_CIPHER_MODE_STREAM:
       c->spec->stdecrypt (&c->context.c,
                           outbuf, (byte*)/*arggg*/inbuf, inbuflen);
@@ -1025,6 +1247,250 @@ _gcry_cipher_decrypt (gcry_cipher_hd_t h, void *out, size_t outsize,
 }
 
 
+/* A position in an array of buffer descriptions.  */
+struct buffer_cursor
+{
+  const gcry_buffer_t *iov;
+  int iovcnt;
+  size_t pos;   /* Offset into IOV[0].  */
+};
+
+
+/* Skip empty buffers and return the number of bytes which are
+   contiguous at the position of CUR.  Returns 0 at the end.  */
+static size_t
+cursor_avail (struct buffer_cursor *cur)
+{
+  while (cur->iovcnt && cur->pos == cur->iov->len)
+    {
+      cur->iov++;
+      cur->iovcnt--;
+      cur->pos = 0;
+    }
+  return cur->iovcnt ? cur->iov->len - cur->pos : 0;
+}
+
+
+static byte *
+cursor_ptr (struct buffer_cursor *cur)
+{
+  return (byte *)cur->iov->data + cur->iov->off + cur->pos;
+}
+
+
+/* Copy N bytes from the buffers at CUR to BUF and advance CUR.  */
+static void
+cursor_gather (struct buffer_cursor *cur, byte *buf, size_t n)
+{
+  size_t len;
+
+  while (n)
+    {
+      len = cursor_avail (cur);
+      if (len > n)
+        len = n;
+      memcpy (buf, cursor_ptr (cur), len);
+      cur->pos += len;
+      buf += len;
+      n -= len;
+    }
+}
+
+
+/* Copy N bytes from BUF to the buffers at CUR and advance CUR.  */
+static void
+cursor_scatter (struct buffer_cursor *cur, const byte *buf, size_t n)
+{
+  size_t len;
+
+  while (n)
+    {
+      len = cursor_avail (cur);
+      if (len > n)
+        len = n;
+      memcpy (cursor_ptr (cur), buf, len);
+      cur->pos += len;
+      buf += len;
+      n -= len;
+    }
+}
+
+
+static size_t
+buffers_length (const gcry_buffer_t *iov, int iovcnt)
+{
+  size_t len = 0;
+
+  for (; iovcnt > 0; iov++, iovcnt--)
+    len += iov->len;
+  return len;
+}
+
+
+/* Size of the buffer used by cipher_crypt_buffers and
+   _gcry_cipher_authenticate_buffers to collect short runs of data.
+   This is a multiple of all block sizes.  */
+#define CIPHER_STAGE_SIZE 2048  /* Bytes.  */
+
+
+/* Encrypt (ENCRYPT set) or decrypt the data described by IN and
+   INCNT to the buffers described by OUT and OUTCNT.  Long runs of
+   whole blocks which are contiguous in the input and the output are
+   passed on as they are.  Shorter runs and blocks straddling buffer
+   boundaries are collected in a staging buffer.  Thus the mode sees
+   the same sequence of full blocks as with one contiguous buffer, in
+   chunks long enough for its bulk functions.  */
+static gcry_err_code_t
+cipher_crypt_buffers (gcry_cipher_hd_t c,
+                      const gcry_buffer_t *out, int outcnt,
+                      const gcry_buffer_t *in, int incnt, int encrypt)
+{
+  gcry_err_code_t (*crypt_fn) (gcry_cipher_hd_t c, byte *outbuf,
+                               size_t outbuflen, const byte *inbuf,
+                               size_t inbuflen);
+  struct buffer_cursor icur, ocur;
+  unsigned char stage[CIPHER_STAGE_SIZE];
+  size_t staged = 0;
+  size_t blocksize = c->spec->blocksize;
+  size_t left, n;
+  int finalize = c->marks.finalize;
+  gcry_err_code_t rc = 0;
+
+  crypt_fn = encrypt ? cipher_encrypt : cipher_decrypt;
+
+  left = buffers_length (in, incnt);
+  if (buffers_length (out, outcnt) < left)
+    return GPG_ERR_BUFFER_TOO_SHORT;
+
+  icur.iov = in;
+  icur.iovcnt = incnt;
+  icur.pos = 0;
+  ocur.iov = out;
+  ocur.iovcnt = outcnt;
+  ocur.pos = 0;
+
+  /* These modes process each call as a whole message; they get a
+     linear copy of the data.  */
+  if ((c->mode == GCRY_CIPHER_MODE_XTS
+       || c->mode == GCRY_CIPHER_MODE_AESWRAP
+       || (c->mode == GCRY_CIPHER_MODE_CBC
+           && (c->flags & GCRY_CIPHER_CBC_CTS)))
+      && (cursor_avail (&icur) < left || cursor_avail (&ocur) < left))
+    {
+      byte *buf;
+
+      buf = (c->flags & GCRY_CIPHER_SECURE) ? xtrymalloc_secure (left)
+                                            : xtrymalloc (left);
+      if (!buf)
+        return gpg_err_code_from_syserror ();
+
+      cursor_gather (&icur, buf, left);
+      rc = crypt_fn (c, buf, left, buf, left);
+      if (!rc)
+        cursor_scatter (&ocur, buf, left);
+      wipememory (buf, left);
+      xfree (buf);
+      return rc;
+    }
+
+  if (!left)
+    return crypt_fn (c, NULL, 0, NULL, 0);
+
+  while (left && !rc)
+    {
+      n = cursor_avail (&icur);
+      if (n > cursor_avail (&ocur))
+        n = cursor_avail (&ocur);
+      if (n >= left)
+        n = left;
+      else if (n >= sizeof stage)
+        n -= n % blocksize;
+      else
+        n = 0;
+
+      if (n)
+        {
+          /* Only the last call may be the final one for OCB.  */
+          c->marks.finalize = finalize && n == left;
+          rc = crypt_fn (c, cursor_ptr (&ocur), n, cursor_ptr (&icur), n);
+          icur.pos += n;
+          ocur.pos += n;
+        }
+      else
+        {
+          n = left < sizeof stage ? left : sizeof stage;
+          if (n > staged)
+            staged = n;
+          c->marks.finalize = finalize && n == left;
+          cursor_gather (&icur, stage, n);
+          rc = crypt_fn (c, stage, n, stage, n);
+          if (!rc)
+            cursor_scatter (&ocur, stage, n);
+        }
+
+      left -= n;
+    }
+
+  c->marks.finalize = finalize;
+  if (staged)
+    wipememory (stage, staged);
+
+  return rc;
+}
+
+
+/****************
+ * Encrypt the data described by IN and INCNT and write it to the
+ * buffers described by OUT and OUTCNT.  If IN is NULL, in-place
+ * encryption has been requested.
+ */
+gcry_err_code_t
+_gcry_cipher_encrypt_buffers (gcry_cipher_hd_t h,
+                              const gcry_buffer_t *out, int outcnt,
+                              const gcry_buffer_t *in, int incnt)
+{
+  gcry_err_code_t rc;
+
+  if (!in)  /* Caller requested in-place encryption.  */
+    {
+      in = out;
+      incnt = outcnt;
+    }
+
+  if (outcnt < 0 || incnt < 0)
+    rc = GPG_ERR_INV_ARG;
+  else
+    rc = cipher_crypt_buffers (h, out, outcnt, in, incnt, 1);
+
+  /* Failsafe: Make sure that the plaintext will never make it into
+     OUT if the encryption returned an error.  */
+  if (rc)
+    for (; outcnt > 0; out++, outcnt--)
+      if (out->data)
+        memset ((byte *)out->data + out->off, 0x42, out->len);
+
+  return rc;
+}
+
+
+gcry_err_code_t
+_gcry_cipher_decrypt_buffers (gcry_cipher_hd_t h,
+                              const gcry_buffer_t *out, int outcnt,
+                              const gcry_buffer_t *in, int incnt)
+{
+  if (!in) /* Caller requested in-place decryption. */
+    {
+      in = out;
+      incnt = outcnt;
+    }
+
+  if (outcnt < 0 || incnt < 0)
+    return GPG_ERR_INV_ARG;
+
+  return cipher_crypt_buffers (h, out, outcnt, in, incnt, 0);
+}
+
+
 
 /****************
  * Used for PGP's somewhat strange CFB mode. Only works if
@@ -1142,6 +1608,65 @@ _gcry_cipher_authenticate (gcry_cipher_hd_t hd, const void *abuf,
 }
 
 
+/* Feed the additional authenticated data described by IOV and IOVCNT
+   to the handle HD.  As with encryption, short runs of data are
+   collected in a staging buffer.  */
+gcry_err_code_t
+_gcry_cipher_authenticate_buffers (gcry_cipher_hd_t hd,
+                                   const gcry_buffer_t *iov, int iovcnt)
+{
+  struct buffer_cursor cur;
+  unsigned char stage[CIPHER_STAGE_SIZE];
+  size_t staged = 0;
+  size_t blocksize = hd->spec->blocksize;
+  size_t left, n;
+  gcry_err_code_t rc = 0;
+
+  if (iovcnt < 0)
+    return GPG_ERR_INV_ARG;
+
+  cur.iov = iov;
+  cur.iovcnt = iovcnt;
+  cur.pos = 0;
+
+  left = buffers_length (iov, iovcnt);
+  if (!left)
+    return _gcry_cipher_authenticate (hd, NULL, 0);
+
+  while (left && !rc)
+    {
+      n = cursor_avail (&cur);
+      if (n >= left)
+        n = left;
+      else if (n >= sizeof stage)
+        n -= n % blocksize;
+      else
+        n = 0;
+
+      if (n)
+        {
+          rc = _gcry_cipher_authenticate (hd, cursor_ptr (&cur), n);
+          cur.pos += n;
+        }
+      else
+        {
+          n = left < sizeof stage ? left : sizeof stage;
+          if (n > staged)
+            staged = n;
+          cursor_gather (&cur, stage, n);
+          rc = _gcry_cipher_authenticate (hd, stage, n);
+        }
+
+      left -= n;
+    }
+
+  if (staged)
+    wipememory (stage, staged);
+
+  return rc;
+}
+
+
 gcry_err_code_t
 _gcry_cipher_gettag (gcry_cipher_hd_t hd, void *outtag, size_t taglen)
 {
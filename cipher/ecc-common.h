@@ -82,6 +82,10 @@ const char *_gcry_ecc_get_curve (gcry_sexp_t keyparms,
                                  int iterator,
                                  unsigned int *r_nbits);
 gcry_sexp_t _gcry_ecc_get_param_sexp (const char *name);
+mpi_ec_t _gcry_ecc_acquire_ec_ctx (elliptic_curve_t *E);
+void _gcry_ecc_release_ec_ctx (mpi_ec_t ec);
+void _gcry_ecc_mul_base (mpi_point_t result, gcry_mpi_t scalar,
+                         elliptic_curve_t *E, mpi_ec_t ec);
 
 /*-- ecc-misc.c --*/
 void _gcry_ecc_curve_free (elliptic_curve_t *E);
@@ -131,6 +135,16 @@ gpg_err_code_t _gcry_ecc_eddsa_verify (gcry_mpi_t input,
                                        gcry_mpi_t r, gcry_mpi_t s,
                                        int hashalgo, gcry_mpi_t pkmpi);
 
+typedef struct eddsa_batch_s *eddsa_batch_t;
+eddsa_batch_t _gcry_ecc_eddsa_batch_new (size_t maxitems);
+void _gcry_ecc_eddsa_batch_release (eddsa_batch_t batch);
+gpg_err_code_t _gcry_ecc_eddsa_batch_add (eddsa_batch_t batch,
+                                          gcry_mpi_t input,
+                                          ECC_public_key *pk,
+                                          gcry_mpi_t r, gcry_mpi_t s,
+                                          int hashalgo, gcry_mpi_t pkmpi);
+int _gcry_ecc_eddsa_batch_check (eddsa_batch_t batch);
+
 /*-- ecc-gost.c --*/
 gpg_err_code_t _gcry_ecc_gost_sign (gcry_mpi_t input, ECC_secret_key *skey,
                                     gcry_mpi_t r, gcry_mpi_t s);
@@ -441,6 +441,34 @@ static const ecc_domain_parms_t domain_parms[] =
 
 
 
+/* The curve cache keeps the scanned parameters of named curves and a
+   small pool of unused EC contexts for them.  This saves the parsing
+   of the parameters and the setup of a new context for each
+   operation.  The list holds one reference to an item and each
+   context handed out by _gcry_ecc_acquire_ec_ctx holds another one.
+   All fields are protected by CURVE_CACHE_LOCK; the parameters in E
+   are never changed after an item has been created.  */
+#define CURVE_CACHE_MAX_CTX 4
+
+struct ecc_curve_cache_item_s
+{
+  struct ecc_curve_cache_item_s *next;
+  int idx;                  /* Index into DOMAIN_PARMS.  */
+  unsigned int refcount;
+  unsigned int flushed:1;   /* The item is not anymore in the list.  */
+  elliptic_curve_t E;       /* The curve parameters.  */
+  mpi_ec_base_table_t base_table; /* Multiples of G or NULL.  */
+  unsigned int base_table_failed:1; /* Creating BASE_TABLE failed.  */
+  unsigned int nctx;        /* Number of unused contexts in CTX.  */
+  mpi_ec_t ctx[CURVE_CACHE_MAX_CTX];
+};
+typedef struct ecc_curve_cache_item_s *curve_cache_item_t;
+
+static curve_cache_item_t curve_cache;
+GPGRT_LOCK_DEFINE (curve_cache_lock);
+
+
+
 /* Return a copy of POINT.  */
 static gcry_mpi_point_t
 point_copy (gcry_mpi_point_t point)
@@ -472,6 +500,82 @@ scanval (const char *string)
 }
 
 
+static void
+lock_curve_cache (void)
+{
+  gpg_err_code_t rc;
+
+  rc = gpgrt_lock_lock (&curve_cache_lock);
+  if (rc)
+    log_fatal ("failed to acquire the ECC curve cache lock: %s\n",
+               gpg_strerror (rc));
+}
+
+
+static void
+unlock_curve_cache (void)
+{
+  gpg_err_code_t rc;
+
+  rc = gpgrt_lock_unlock (&curve_cache_lock);
+  if (rc)
+    log_fatal ("failed to release the ECC curve cache lock: %s\n",
+               gpg_strerror (rc));
+}
+
+
+/* Return the cache item for the curve at IDX of the domain_parms
+   table.  The item is created if needed; NULL is returned if that is
+   not possible.  Must be called with the cache locked.  */
+static curve_cache_item_t
+get_curve_cache_item (int idx)
+{
+  curve_cache_item_t item;
+
+  for (item = curve_cache; item; item = item->next)
+    if (item->idx == idx)
+      return item;
+
+  item = xtrycalloc (1, sizeof *item);
+  if (!item)
+    return NULL;
+  item->idx = idx;
+  item->refcount = 1;
+  item->E.model = domain_parms[idx].model;
+  item->E.dialect = domain_parms[idx].dialect;
+  item->E.p = scanval (domain_parms[idx].p);
+  item->E.a = scanval (domain_parms[idx].a);
+  item->E.b = scanval (domain_parms[idx].b);
+  item->E.n = scanval (domain_parms[idx].n);
+  item->E.h = scanval (domain_parms[idx].h);
+  item->E.G.x = scanval (domain_parms[idx].g_x);
+  item->E.G.y = scanval (domain_parms[idx].g_y);
+  item->E.G.z = mpi_alloc_set_ui (1);
+  item->E.name = domain_parms[idx].desc;
+
+  item->next = curve_cache;
+  curve_cache = item;
+  return item;
+}
+
+
+/* Drop a reference to ITEM and release it if this has been the last
+   one.  Must be called with the cache locked.  */
+static void
+unref_curve_cache_item (curve_cache_item_t item)
+{
+  gcry_assert (item->refcount);
+  if (--item->refcount)
+    return;
+
+  while (item->nctx)
+    _gcry_mpi_ec_free (item->ctx[--item->nctx]);
+  _gcry_mpi_ec_base_table_release (item->base_table);
+  _gcry_ecc_curve_free (&item->E);
+  xfree (item);
+}
+
+
 /* Return the index of the domain_parms table for a curve with NAME.
    Return -1 if not found.  */
 static int
@@ -555,32 +659,208 @@ _gcry_ecc_fill_in_curve (unsigned int nbits, const char *name,
 
   if (curve)
     {
+      curve_cache_item_t item;
+
+      /* Take the parameters from the cache to avoid scanning them
+         again.  */
+      lock_curve_cache ();
+      item = get_curve_cache_item (idx);
+
       curve->model = domain_parms[idx].model;
       curve->dialect = domain_parms[idx].dialect;
       if (!curve->p)
-        curve->p = scanval (domain_parms[idx].p);
+        curve->p = item? mpi_copy (item->E.p) : scanval (domain_parms[idx].p);
       if (!curve->a)
-        curve->a = scanval (domain_parms[idx].a);
+        curve->a = item? mpi_copy (item->E.a) : scanval (domain_parms[idx].a);
       if (!curve->b)
-        curve->b = scanval (domain_parms[idx].b);
+        curve->b = item? mpi_copy (item->E.b) : scanval (domain_parms[idx].b);
       if (!curve->n)
-        curve->n = scanval (domain_parms[idx].n);
+        curve->n = item? mpi_copy (item->E.n) : scanval (domain_parms[idx].n);
       if (!curve->h)
-        curve->h = scanval (domain_parms[idx].h);
+        curve->h = item? mpi_copy (item->E.h) : scanval (domain_parms[idx].h);
       if (!curve->G.x)
-        curve->G.x = scanval (domain_parms[idx].g_x);
+        curve->G.x = (item? mpi_copy (item->E.G.x)
+                      : scanval (domain_parms[idx].g_x));
       if (!curve->G.y)
-        curve->G.y = scanval (domain_parms[idx].g_y);
+        curve->G.y = (item? mpi_copy (item->E.G.y)
+                      : scanval (domain_parms[idx].g_y));
       if (!curve->G.z)
         curve->G.z = mpi_alloc_set_ui (1);
       if (!curve->name)
         curve->name = resname;
+
+      unlock_curve_cache ();
     }
 
   return 0;
 }
 
 
+/* Return an EC context for the curve E.  If E is a named curve with
+   unmodified parameters the context is taken from the curve cache.
+   The returned context must be released using
+   _gcry_ecc_release_ec_ctx.  */
+mpi_ec_t
+_gcry_ecc_acquire_ec_ctx (elliptic_curve_t *E)
+{
+  curve_cache_item_t item;
+  mpi_ec_t ec = NULL;
+  int idx;
+
+  idx = E->name? find_domain_parms_idx (E->name) : -1;
+  if (idx >= 0)
+    {
+      lock_curve_cache ();
+      item = get_curve_cache_item (idx);
+      if (item
+          && item->E.model == E->model
+          && item->E.dialect == E->dialect
+          && !mpi_cmp (item->E.p, E->p)
+          && !mpi_cmp (item->E.a, E->a)
+          && !mpi_cmp (item->E.b, E->b))
+        {
+          if (item->nctx)
+            ec = item->ctx[--item->nctx];
+          else
+            ec = _gcry_mpi_ec_p_internal_new (item->E.model,
+                                              item->E.dialect, 0,
+                                              item->E.p, item->E.a, item->E.b);
+          ec->cache_item = item;
+          item->refcount++;
+        }
+      unlock_curve_cache ();
+    }
+
+  if (!ec)
+    ec = _gcry_mpi_ec_p_internal_new (E->model, E->dialect, 0,
+                                      E->p, E->a, E->b);
+  return ec;
+}
+
+
+/* Release an EC context returned by _gcry_ecc_acquire_ec_ctx.  EC
+   may be NULL.  */
+void
+_gcry_ecc_release_ec_ctx (mpi_ec_t ec)
+{
+  curve_cache_item_t item;
+  int i;
+
+  if (!ec)
+    return;
+
+  item = ec->cache_item;
+  if (!item)
+    {
+      _gcry_mpi_ec_free (ec);
+      return;
+    }
+
+  /* The scratch variables may hold intermediate values of a secret
+     key operation.  */
+  for (i=0; i < DIM (ec->t.scratch); i++)
+    {
+      gcry_mpi_t a = ec->t.scratch[i];
+
+      wipememory (a->d, a->alloced * BYTES_PER_MPI_LIMB);
+      a->nlimbs = 0;
+    }
+
+  lock_curve_cache ();
+  if (!item->flushed && item->nctx < DIM (item->ctx))
+    {
+      item->ctx[item->nctx++] = ec;
+      ec = NULL;
+    }
+  unref_curve_cache_item (item);
+  unlock_curve_cache ();
+
+  if (ec)
+    {
+      ec->cache_item = NULL;
+      _gcry_mpi_ec_free (ec);
+    }
+}
+
+
+/* Compute RESULT = SCALAR * E->G using the context EC.  If EC has
+   been taken from the curve cache and G is the generator of the named
+   curve, a table with precomputed multiples of G is used.  That table
+   is created on first use.  */
+void
+_gcry_ecc_mul_base (mpi_point_t result, gcry_mpi_t scalar,
+                    elliptic_curve_t *E, mpi_ec_t ec)
+{
+  curve_cache_item_t item = ec->cache_item;
+  mpi_ec_base_table_t tbl = NULL;
+  mpi_ec_base_table_t newtbl;
+  int build;
+
+  if (item
+      && !mpi_cmp (item->E.G.x, E->G.x)
+      && !mpi_cmp (item->E.G.y, E->G.y)
+      && !mpi_cmp (item->E.G.z, E->G.z)
+      && !mpi_cmp (item->E.n, E->n))
+    {
+      lock_curve_cache ();
+      tbl = item->base_table;
+      build = !tbl && !item->base_table_failed;
+      unlock_curve_cache ();
+
+      if (build)
+        {
+          /* Building the table takes a while; do it without holding
+             the lock so that other ECC users are not blocked.  If
+             another thread published a table in the meantime, ours
+             is released.  ITEM->E is not modified after creation.  */
+          newtbl = _gcry_mpi_ec_base_table_new (&item->E.G, item->E.n, ec);
+
+          lock_curve_cache ();
+          if (!item->base_table && newtbl)
+            {
+              item->base_table = newtbl;
+              newtbl = NULL;
+            }
+          else if (!item->base_table)
+            item->base_table_failed = 1;
+          tbl = item->base_table;
+          unlock_curve_cache ();
+
+          /* Another thread won the race; drop our table.  */
+          if (newtbl)
+            _gcry_mpi_ec_base_table_release (newtbl);
+        }
+    }
+
+  /* The table is not modified after its creation and it is kept
+     alive by our reference to ITEM.  */
+  if (tbl)
+    _gcry_mpi_ec_mul_base (result, scalar, tbl, ec);
+  else
+    _gcry_mpi_ec_mul_point (result, scalar, &E->G, ec);
+}
+
+
+/* Remove all items from the curve cache.  Items which are still in
+   use are released as soon as their last context is released.  */
+void
+_gcry_ecc_flush_cache (void)
+{
+  curve_cache_item_t item, next;
+
+  lock_curve_cache ();
+  for (item = curve_cache; item; item = next)
+    {
+      next = item->next;
+      item->next = NULL;
+      item->flushed = 1;
+      unref_curve_cache_item (item);
+    }
+  curve_cache = NULL;
+  unlock_curve_cache ();
+}
+
+
 /* Give the name of the curve NAME, store the curve parameters into P,
    A, B, G, N, and H if they point to NULL value.  Note that G is returned
    in standard uncompressed format.  Also update MODEL and DIALECT if
@@ -68,8 +68,7 @@ _gcry_ecc_ecdsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
   x = mpi_alloc (0);
   point_init (&I);
 
-  ctx = _gcry_mpi_ec_p_internal_new (skey->E.model, skey->E.dialect, 0,
-                                     skey->E.p, skey->E.a, skey->E.b);
+  ctx = _gcry_ecc_acquire_ec_ctx (&skey->E);
 
   /* Two loops to avoid R or S are zero.  This is more of a joke than
      a real demand because the probability of them being zero is less
@@ -103,7 +102,7 @@ _gcry_ecc_ecdsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
           else
             k = _gcry_dsa_gen_k (skey->E.n, GCRY_STRONG_RANDOM);
 
-          _gcry_mpi_ec_mul_point (&I, k, &skey->E.G, ctx);
+          _gcry_ecc_mul_base (&I, k, &skey->E, ctx);
           if (_gcry_mpi_ec_get_affine (x, NULL, &I, ctx))
             {
               if (DBG_CIPHER)
@@ -129,7 +128,7 @@ _gcry_ecc_ecdsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
     }
 
  leave:
-  _gcry_mpi_ec_free (ctx);
+  _gcry_ecc_release_ec_ctx (ctx);
   point_free (&I);
   mpi_free (x);
   mpi_free (k_1);
@@ -153,7 +152,7 @@ _gcry_ecc_ecdsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
 {
   gpg_err_code_t err = 0;
   gcry_mpi_t hash, h, h1, h2, x;
-  mpi_point_struct Q, Q1, Q2;
+  mpi_point_struct Q;
   mpi_ec_t ctx;
   unsigned int nbits;
 
@@ -172,24 +171,17 @@ _gcry_ecc_ecdsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
   h2 = mpi_alloc (0);
   x = mpi_alloc (0);
   point_init (&Q);
-  point_init (&Q1);
-  point_init (&Q2);
 
-  ctx = _gcry_mpi_ec_p_internal_new (pkey->E.model, pkey->E.dialect, 0,
-                                     pkey->E.p, pkey->E.a, pkey->E.b);
+  ctx = _gcry_ecc_acquire_ec_ctx (&pkey->E);
 
   /* h  = s^(-1) (mod n) */
   mpi_invm (h, s, pkey->E.n);
   /* h1 = hash * s^(-1) (mod n) */
   mpi_mulm (h1, hash, h, pkey->E.n);
-  /* Q1 = [ hash * s^(-1) ]G  */
-  _gcry_mpi_ec_mul_point (&Q1, h1, &pkey->E.G, ctx);
   /* h2 = r * s^(-1) (mod n) */
   mpi_mulm (h2, r, h, pkey->E.n);
-  /* Q2 = [ r * s^(-1) ]Q */
-  _gcry_mpi_ec_mul_point (&Q2, h2, &pkey->Q, ctx);
   /* Q  = ([hash * s^(-1)]G) + ([r * s^(-1)]Q) */
-  _gcry_mpi_ec_add_points (&Q, &Q1, &Q2, ctx);
+  _gcry_mpi_ec_mul_point_dual (&Q, h1, &pkey->E.G, h2, &pkey->Q, ctx);
 
   if (!mpi_cmp_ui (Q.z, 0))
     {
@@ -219,9 +211,7 @@ _gcry_ecc_ecdsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
     }
 
  leave:
-  _gcry_mpi_ec_free (ctx);
-  point_free (&Q2);
-  point_free (&Q1);
+  _gcry_ecc_release_ec_ctx (ctx);
   point_free (&Q);
   mpi_free (x);
   mpi_free (h2);
@@ -530,7 +530,7 @@ _gcry_ecc_eddsa_genkey (ECC_secret_key *sk, elliptic_curve_t *E, mpi_ec_t ctx,
   /* log_printmpi ("ecgen         a", a); */
 
   /* Compute Q.  */
-  _gcry_mpi_ec_mul_point (&Q, a, &E->G, ctx);
+  _gcry_ecc_mul_base (&Q, a, E, ctx);
   if (DBG_CIPHER)
     log_printpnt ("ecgen      pk", &Q, ctx);
 
@@ -604,8 +604,7 @@ _gcry_ecc_eddsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
   x = mpi_new (0);
   y = mpi_new (0);
   r = mpi_new (0);
-  ctx = _gcry_mpi_ec_p_internal_new (skey->E.model, skey->E.dialect, 0,
-                                     skey->E.p, skey->E.a, skey->E.b);
+  ctx = _gcry_ecc_acquire_ec_ctx (&skey->E);
   b = (ctx->nbits+7)/8;
   if (b != 256/8) {
     rc = GPG_ERR_INTERNAL; /* We only support 256 bit. */
@@ -634,7 +633,7 @@ _gcry_ecc_eddsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
     }
   else
     {
-      _gcry_mpi_ec_mul_point (&Q, a, &skey->E.G, ctx);
+      _gcry_ecc_mul_base (&Q, a, &skey->E, ctx);
       rc = _gcry_ecc_eddsa_encodepoint (&Q, ctx, x, y, 0, &encpk, &encpklen);
       if (rc)
         goto leave;
@@ -660,7 +659,7 @@ _gcry_ecc_eddsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
   if (DBG_CIPHER)
     log_printhex ("     r", digest, 64);
   _gcry_mpi_set_buffer (r, digest, 64, 0);
-  _gcry_mpi_ec_mul_point (&I, r, &skey->E.G, ctx);
+  _gcry_ecc_mul_base (&I, r, &skey->E, ctx);
   if (DBG_CIPHER)
     log_printpnt ("   r", &I, ctx);
 
@@ -711,7 +710,7 @@ _gcry_ecc_eddsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
   _gcry_mpi_release (y);
   _gcry_mpi_release (r);
   xfree (digest);
-  _gcry_mpi_ec_free (ctx);
+  _gcry_ecc_release_ec_ctx (ctx);
   point_free (&I);
   point_free (&Q);
   xfree (encpk);
@@ -720,53 +719,35 @@ _gcry_ecc_eddsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
 }
 
 
-/* Verify an EdDSA signature.  See sign_eddsa for the reference.
- * Check if R_IN and S_IN verifies INPUT.  PKEY has the curve
- * parameters and PK is the EdDSA style encoded public key.
+/* Decode the EdDSA public key PK into Q and compute the scalars H
+ * and S of the signature (R_IN,S_IN) over INPUT.  CTX is the curve
+ * context.  On success a pointer to the encoded R is stored at RBUF.
  */
-gpg_err_code_t
-_gcry_ecc_eddsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
-                        gcry_mpi_t r_in, gcry_mpi_t s_in, int hashalgo,
-                        gcry_mpi_t pk)
+static gpg_err_code_t
+eddsa_verify_prepare (gcry_mpi_t input, gcry_mpi_t r_in, gcry_mpi_t s_in,
+                      int hashalgo, gcry_mpi_t pk, mpi_ec_t ctx,
+                      mpi_point_t Q, gcry_mpi_t h, gcry_mpi_t s,
+                      const void **r_rbuf)
 {
-  int rc;
-  mpi_ec_t ctx = NULL;
+  gpg_err_code_t rc;
   int b;
   unsigned int tmp;
-  mpi_point_struct Q;          /* Public key.  */
   unsigned char *encpk = NULL; /* Encoded public key.  */
   unsigned int encpklen;
   const void *mbuf, *rbuf;
-  unsigned char *tbuf = NULL;
   size_t mlen, rlen;
-  unsigned int tlen;
   unsigned char digest[64];
   gcry_buffer_t hvec[3];
-  gcry_mpi_t h, s;
-  mpi_point_struct Ia, Ib;
-
-  if (!mpi_is_opaque (input) || !mpi_is_opaque (r_in) || !mpi_is_opaque (s_in))
-    return GPG_ERR_INV_DATA;
-  if (hashalgo != GCRY_MD_SHA512)
-    return GPG_ERR_DIGEST_ALGO;
-
-  point_init (&Q);
-  point_init (&Ia);
-  point_init (&Ib);
-  h = mpi_new (0);
-  s = mpi_new (0);
 
-  ctx = _gcry_mpi_ec_p_internal_new (pkey->E.model, pkey->E.dialect, 0,
-                                     pkey->E.p, pkey->E.a, pkey->E.b);
   b = ctx->nbits/8;
   if (b != 256/8)
     return GPG_ERR_INTERNAL; /* We only support 256 bit. */
 
   /* Decode and check the public key.  */
-  rc = _gcry_ecc_eddsa_decodepoint (pk, ctx, &Q, &encpk, &encpklen);
+  rc = _gcry_ecc_eddsa_decodepoint (pk, ctx, Q, &encpk, &encpklen);
   if (rc)
     goto leave;
-  if (!_gcry_mpi_ec_curve_point (&Q, ctx))
+  if (!_gcry_mpi_ec_curve_point (Q, ctx))
     {
       rc = GPG_ERR_BROKEN_PUBKEY;
       goto leave;
@@ -812,9 +793,6 @@ _gcry_ecc_eddsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
     log_printhex (" H(R+)", digest, 64);
   _gcry_mpi_set_buffer (h, digest, 64, 0);
 
-  /* According to the paper the best way for verification is:
-         encodepoint(sG - h·Q) = encodepoint(r)
-     because we don't need to decode R. */
   {
     void *sbuf;
     unsigned int slen;
@@ -833,29 +811,302 @@ _gcry_ecc_eddsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
       }
   }
 
-  _gcry_mpi_ec_mul_point (&Ia, s, &pkey->E.G, ctx);
-  _gcry_mpi_ec_mul_point (&Ib, h, &Q, ctx);
-  _gcry_mpi_neg (Ib.x, Ib.x);
-  _gcry_mpi_ec_add_points (&Ia, &Ia, &Ib, ctx);
+  *r_rbuf = rbuf;
+
+ leave:
+  xfree (encpk);
+  return rc;
+}
+
+
+/* Check that encodepoint(S·G - H·Q) equals the encoded R at RBUF.
+ * E are the curve parameters and CTX the curve context.  Q and H are
+ * modified.
+ */
+static gpg_err_code_t
+eddsa_verify_finish (elliptic_curve_t *E, mpi_ec_t ctx, mpi_point_t Q,
+                     gcry_mpi_t h, gcry_mpi_t s, const void *rbuf)
+{
+  gpg_err_code_t rc;
+  unsigned char *tbuf = NULL;
+  unsigned int tlen;
+  gcry_mpi_t hn;
+  mpi_point_struct Ia;
+
+  point_init (&Ia);
+  hn = mpi_new (0);
+
+  /* According to the paper the best way for verification is:
+         encodepoint(sG - h·Q) = encodepoint(r)
+     because we don't need to decode R. */
+
+  /* Compute sG + h·(-Q) with shared doublings.  The order of the
+     curve group is the cofactor times N; reducing H modulo that value
+     does not change h·Q for any point Q on the curve.  */
+  if (E->h)
+    {
+      mpi_mul (hn, E->h, E->n);
+      mpi_mod (h, h, hn);
+    }
+  if (mpi_cmp_ui (Q->x, 0))
+    mpi_sub (Q->x, ctx->p, Q->x);
+  _gcry_mpi_ec_mul_point_dual (&Ia, s, &E->G, h, Q, ctx);
   rc = _gcry_ecc_eddsa_encodepoint (&Ia, ctx, s, h, 0, &tbuf, &tlen);
   if (rc)
     goto leave;
-  if (tlen != rlen || memcmp (tbuf, rbuf, tlen))
+  if (tlen != 256/8 || memcmp (tbuf, rbuf, tlen))
+    rc = GPG_ERR_BAD_SIGNATURE;
+
+ leave:
+  xfree (tbuf);
+  _gcry_mpi_release (hn);
+  point_free (&Ia);
+  return rc;
+}
+
+
+/* Verify an EdDSA signature.  See sign_eddsa for the reference.
+ * Check if R_IN and S_IN verifies INPUT.  PKEY has the curve
+ * parameters and PK is the EdDSA style encoded public key.
+ */
+gpg_err_code_t
+_gcry_ecc_eddsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
+                        gcry_mpi_t r_in, gcry_mpi_t s_in, int hashalgo,
+                        gcry_mpi_t pk)
+{
+  int rc;
+  mpi_ec_t ctx = NULL;
+  mpi_point_struct Q;          /* Public key.  */
+  const void *rbuf;
+  gcry_mpi_t h, s;
+
+  if (!mpi_is_opaque (input) || !mpi_is_opaque (r_in) || !mpi_is_opaque (s_in))
+    return GPG_ERR_INV_DATA;
+  if (hashalgo != GCRY_MD_SHA512)
+    return GPG_ERR_DIGEST_ALGO;
+
+  point_init (&Q);
+  h = mpi_new (0);
+  s = mpi_new (0);
+
+  ctx = _gcry_ecc_acquire_ec_ctx (&pkey->E);
+
+  rc = eddsa_verify_prepare (input, r_in, s_in, hashalgo, pk, ctx,
+                             &Q, h, s, &rbuf);
+  if (!rc)
+    rc = eddsa_verify_finish (&pkey->E, ctx, &Q, h, s, rbuf);
+
+  _gcry_ecc_release_ec_ctx (ctx);
+  _gcry_mpi_release (s);
+  _gcry_mpi_release (h);
+  point_free (&Q);
+  return rc;
+}
+
+
+/* State for the batch verification of Ed25519 signatures.  For
+   signature i with the random 128 bit factor z_i the equation
+
+     8 * (SUM z_i*s_i * G - SUM z_i * R_i - SUM z_i*h_i * A_i) = 0
+
+   is checked with a single multi-scalar multiplication.  This is the
+   cofactored equation of RFC-8032; unlike _gcry_ecc_eddsa_verify it
+   ignores small order components of R_i and A_i.  The scalars and
+   points are stored in the order G, -R_0, -A_0, -R_1, -A_1, ...  */
+struct eddsa_batch_s
+{
+  mpi_ec_t ctx;             /* Curve context or NULL.  */
+  gcry_mpi_t n;             /* Order of G.  */
+  size_t maxitems;          /* Allocated number of signatures.  */
+  size_t nitems;            /* Number of added signatures.  */
+  gcry_mpi_t *scalars;      /* 2 * MAXITEMS + 1 scalars.  */
+  mpi_point_struct *points; /* 2 * MAXITEMS + 1 points.  */
+};
+
+
+/* Create a batch for up to MAXITEMS signatures.  Returns NULL on
+   error.  */
+eddsa_batch_t
+_gcry_ecc_eddsa_batch_new (size_t maxitems)
+{
+  eddsa_batch_t batch;
+  size_t i;
+
+  batch = xtrycalloc (1, sizeof *batch);
+  if (!batch)
+    return NULL;
+  batch->maxitems = maxitems;
+  batch->scalars = xtrycalloc (2 * maxitems + 1, sizeof *batch->scalars);
+  batch->points = xtrycalloc (2 * maxitems + 1, sizeof *batch->points);
+  if (!batch->scalars || !batch->points)
+    {
+      xfree (batch->scalars);
+      xfree (batch->points);
+      xfree (batch);
+      return NULL;
+    }
+  for (i = 0; i < 2 * maxitems + 1; i++)
+    {
+      batch->scalars[i] = mpi_new (0);
+      point_init (&batch->points[i]);
+    }
+  return batch;
+}
+
+
+/* Release BATCH.  BATCH may be NULL.  */
+void
+_gcry_ecc_eddsa_batch_release (eddsa_batch_t batch)
+{
+  size_t i;
+
+  if (!batch)
+    return;
+  for (i = 0; i < 2 * batch->maxitems + 1; i++)
+    {
+      mpi_free (batch->scalars[i]);
+      point_free (&batch->points[i]);
+    }
+  xfree (batch->scalars);
+  xfree (batch->points);
+  mpi_free (batch->n);
+  _gcry_ecc_release_ec_ctx (batch->ctx);
+  xfree (batch);
+}
+
+
+/* Add an Ed25519 signature to BATCH.  The arguments are the same as
+ * for _gcry_ecc_eddsa_verify; all signatures in a batch must use the
+ * same curve.  An error is returned if the signature is already
+ * known to be invalid.  A signature whose R can't be decoded is
+ * verified right away.  Otherwise the result is deferred to
+ * _gcry_ecc_eddsa_batch_check.
+ */
+gpg_err_code_t
+_gcry_ecc_eddsa_batch_add (eddsa_batch_t batch, gcry_mpi_t input,
+                           ECC_public_key *pkey,
+                           gcry_mpi_t r_in, gcry_mpi_t s_in, int hashalgo,
+                           gcry_mpi_t pk)
+{
+  gpg_err_code_t rc;
+  mpi_point_struct Q, R;
+  const void *rbuf;
+  unsigned char *tbuf = NULL;
+  unsigned int tlen;
+  unsigned char zbuf[16];
+  gcry_mpi_t h, s, z;
+  gcry_mpi_t *scalars;
+  mpi_point_t points;
+
+  if (!mpi_is_opaque (input) || !mpi_is_opaque (r_in) || !mpi_is_opaque (s_in))
+    return GPG_ERR_INV_DATA;
+  if (hashalgo != GCRY_MD_SHA512)
+    return GPG_ERR_DIGEST_ALGO;
+  if (batch->nitems == batch->maxitems)
+    return GPG_ERR_TOO_LARGE;
+
+  if (!batch->ctx)
+    {
+      batch->ctx = _gcry_ecc_acquire_ec_ctx (&pkey->E);
+      batch->n = mpi_copy (pkey->E.n);
+      point_set (&batch->points[0], &pkey->E.G);
+    }
+
+  point_init (&Q);
+  point_init (&R);
+  h = mpi_new (0);
+  s = mpi_new (0);
+  z = mpi_new (0);
+
+  rc = eddsa_verify_prepare (input, r_in, s_in, hashalgo, pk, batch->ctx,
+                             &Q, h, s, &rbuf);
+  if (rc)
+    goto leave;
+
+  /* R must be the canonical encoding of a point because the single
+     verification compares the encodings.  The decoder rejects points
+     with x = 0, which the single verification accepts as R; thus
+     leave any R which can't be decoded to it.  */
+  if (_gcry_ecc_eddsa_decodepoint (r_in, batch->ctx, &R, NULL, NULL))
+    {
+      rc = eddsa_verify_finish (&pkey->E, batch->ctx, &Q, h, s, rbuf);
+      goto leave;
+    }
+  if (_gcry_ecc_eddsa_encodepoint (&R, batch->ctx, NULL, NULL, 0,
+                                   &tbuf, &tlen)
+      || tlen != 256/8 || memcmp (tbuf, rbuf, tlen))
     {
       rc = GPG_ERR_BAD_SIGNATURE;
       goto leave;
     }
 
-  rc = 0;
+  _gcry_create_nonce (zbuf, sizeof zbuf);
+  _gcry_mpi_set_buffer (z, zbuf, sizeof zbuf, 0);
+
+  scalars = batch->scalars + 1 + 2 * batch->nitems;
+  points = batch->points + 1 + 2 * batch->nitems;
+
+  mpi_mulm (s, s, z, batch->n);
+  mpi_addm (batch->scalars[0], batch->scalars[0], s, batch->n);
+  mpi_set (scalars[0], z);
+  mpi_mulm (scalars[1], h, z, batch->n);
+  if (mpi_cmp_ui (R.x, 0))
+    mpi_sub (R.x, batch->ctx->p, R.x);
+  if (mpi_cmp_ui (Q.x, 0))
+    mpi_sub (Q.x, batch->ctx->p, Q.x);
+  point_set (&points[0], &R);
+  point_set (&points[1], &Q);
+  batch->nitems++;
 
  leave:
-  xfree (encpk);
   xfree (tbuf);
-  _gcry_mpi_ec_free (ctx);
+  _gcry_mpi_release (z);
   _gcry_mpi_release (s);
   _gcry_mpi_release (h);
-  point_free (&Ia);
-  point_free (&Ib);
+  point_free (&R);
   point_free (&Q);
   return rc;
 }
+
+
+/* Return true if all signatures added to BATCH are valid.  The
+ * check multiplies by the cofactor as permitted by RFC-8032 and may
+ * thus accept a signature with a small order component which
+ * _gcry_ecc_eddsa_verify rejects.  A false result means that at least
+ * one signature is invalid.
+ */
+int
+_gcry_ecc_eddsa_batch_check (eddsa_batch_t batch)
+{
+  mpi_point_struct S;
+  gcry_mpi_t x, y;
+  mpi_point_t *points;
+  size_t i, npoints;
+  int okay;
+
+  if (!batch->nitems)
+    return 1;
+
+  npoints = 2 * batch->nitems + 1;
+  points = xmalloc (npoints * sizeof *points);
+  for (i = 0; i < npoints; i++)
+    points[i] = &batch->points[i];
+
+  point_init (&S);
+  x = mpi_new (0);
+  y = mpi_new (0);
+  _gcry_mpi_ec_mul_multi (&S, npoints, batch->scalars, points, batch->ctx);
+  for (i = 0; i < 3; i++)
+    _gcry_mpi_ec_dup_point (&S, &S, batch->ctx);
+  okay = (!_gcry_mpi_ec_get_affine (x, y, &S, batch->ctx)
+          && !mpi_cmp_ui (x, 0) && !mpi_cmp_ui (y, 1));
+
+  if (DBG_CIPHER)
+    log_debug ("eddsa batch of %u: %s\n",
+               (unsigned int)batch->nitems, okay? "Good":"Bad");
+  mpi_free (y);
+  mpi_free (x);
+  point_free (&S);
+  xfree (points);
+  return okay;
+}
@@ -178,7 +178,7 @@ nist_generate_key (ECC_secret_key *sk, elliptic_curve_t *E, mpi_ec_t ctx,
 
 
   /* Compute Q.  */
-  _gcry_mpi_ec_mul_point (&Q, sk->d, &E->G, ctx);
+  _gcry_ecc_mul_base (&Q, sk->d, E, ctx);
 
   /* Copy the stuff to the key structures. */
   sk->E.model = E->model;
@@ -592,7 +592,7 @@ ecc_generate (const gcry_sexp_t genparms, gcry_sexp_t *r_skey)
       log_printpnt ("ecgen curve G", &E.G, NULL);
     }
 
-  ctx = _gcry_mpi_ec_p_internal_new (E.model, E.dialect, 0, E.p, E.a, E.b);
+  ctx = _gcry_ecc_acquire_ec_ctx (&E);
 
   if (E.model == MPI_EC_MONTGOMERY)
     rc = nist_generate_key (&sk, &E, ctx, flags, nbits, &Qx, NULL);
@@ -733,7 +733,7 @@ ecc_generate (const gcry_sexp_t genparms, gcry_sexp_t *r_skey)
   mpi_free (Gy);
   mpi_free (Qx);
   mpi_free (Qy);
-  _gcry_mpi_ec_free (ctx);
+  _gcry_ecc_release_ec_ctx (ctx);
   xfree (curve_name);
   sexp_release (curve_flags);
   sexp_release (curve_info);
@@ -1020,8 +1020,12 @@ ecc_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 }
 
 
+/* Verify the signature S_SIG over S_DATA.  If BATCH is not NULL,
+   Ed25519 signatures are added to BATCH instead of being verified; in
+   this case true is stored at R_DEFERRED.  */
 static gcry_err_code_t
-ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
+verify_one (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms,
+            eddsa_batch_t batch, int *r_deferred)
 {
   gcry_err_code_t rc;
   struct pk_encoding_ctx ctx;
@@ -1140,8 +1144,17 @@ ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
    */
   if ((sigflags & PUBKEY_FLAG_EDDSA))
     {
-      rc = _gcry_ecc_eddsa_verify (data, &pk, sig_r, sig_s,
-                                   ctx.hash_algo, mpi_q);
+      if (batch && !(ctx.flags & PUBKEY_FLAG_PARAM)
+          && pk.E.name && !strcmp (pk.E.name, "Ed25519"))
+        {
+          rc = _gcry_ecc_eddsa_batch_add (batch, data, &pk, sig_r, sig_s,
+                                          ctx.hash_algo, mpi_q);
+          if (!rc)
+            *r_deferred = 1;
+        }
+      else
+        rc = _gcry_ecc_eddsa_verify (data, &pk, sig_r, sig_s,
+                                     ctx.hash_algo, mpi_q);
     }
   else if ((sigflags & PUBKEY_FLAG_GOST))
     {
@@ -1161,11 +1174,9 @@ ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
 
           /* Fixme: Factor the curve context setup out of eddsa_verify
              and ecdsa_verify. So that we don't do it twice.  */
-          ec = _gcry_mpi_ec_p_internal_new (pk.E.model, pk.E.dialect, 0,
-                                            pk.E.p, pk.E.a, pk.E.b);
-
+          ec = _gcry_ecc_acquire_ec_ctx (&pk.E);
           rc = _gcry_ecc_eddsa_decodepoint (mpi_q, ec, &pk.Q, NULL, NULL);
-          _gcry_mpi_ec_free (ec);
+          _gcry_ecc_release_ec_ctx (ec);
         }
       else
         {
@@ -1214,11 +1225,62 @@ ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
   sexp_release (l1);
   _gcry_pk_util_free_encoding_ctx (&ctx);
   if (DBG_CIPHER)
-    log_debug ("ecc_verify    => %s\n", rc?gpg_strerror (rc):"Good");
+    log_debug ("ecc_verify    => %s\n",
+               rc? gpg_strerror (rc)
+               : (r_deferred && *r_deferred)? "Deferred" : "Good");
   return rc;
 }
 
 
+static gcry_err_code_t
+ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
+{
+  return verify_one (s_sig, s_data, s_keyparms, NULL, NULL);
+}
+
+
+/* Verify the N signatures S_SIGS[i] over S_DATA[i] with the keys
+   S_KEYPARMS[i] and store the results at R_RC.  Ed25519 signatures
+   are checked together; if that check fails they are verified one by
+   one to find the bad ones.  */
+static gcry_err_code_t
+ecc_verify_batch (gcry_sexp_t *s_sigs, gcry_sexp_t *s_data,
+                  gcry_sexp_t *s_keyparms, size_t n, gcry_err_code_t *r_rc)
+{
+  eddsa_batch_t batch;
+  char *deferred;
+  size_t i, ndeferred;
+  int flag;
+
+  deferred = xtrycalloc (n, 1);
+  if (!deferred)
+    return gpg_err_code_from_syserror ();
+  batch = _gcry_ecc_eddsa_batch_new (n);
+
+  ndeferred = 0;
+  for (i = 0; i < n; i++)
+    {
+      flag = 0;
+      r_rc[i] = verify_one (s_sigs[i], s_data[i], s_keyparms[i], batch, &flag);
+      deferred[i] = flag;
+      if (flag)
+        ndeferred++;
+    }
+
+  if (ndeferred && !_gcry_ecc_eddsa_batch_check (batch))
+    {
+      for (i = 0; i < n; i++)
+        if (deferred[i])
+          r_rc[i] = verify_one (s_sigs[i], s_data[i], s_keyparms[i],
+                                NULL, NULL);
+    }
+
+  _gcry_ecc_eddsa_batch_release (batch);
+  xfree (deferred);
+  return 0;
+}
+
+
 /* ecdh raw is classic 2-round DH protocol published in 1976.
  *
  * Overview of ecc_encrypt_raw and ecc_decrypt_raw.
@@ -1352,8 +1414,7 @@ ecc_encrypt_raw (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
     }
 
   /* Compute the encrypted value.  */
-  ec = _gcry_mpi_ec_p_internal_new (pk.E.model, pk.E.dialect, 0,
-                                    pk.E.p, pk.E.a, pk.E.b);
+  ec = _gcry_ecc_acquire_ec_ctx (&pk.E);
 
   /* Convert the public key.  */
   if (mpi_q)
@@ -1449,7 +1510,7 @@ ecc_encrypt_raw (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   _gcry_mpi_release (mpi_e);
   xfree (curvename);
   sexp_release (l1);
-  _gcry_mpi_ec_free (ec);
+  _gcry_ecc_release_ec_ctx (ec);
   _gcry_pk_util_free_encoding_ctx (&ctx);
   if (DBG_CIPHER)
     log_debug ("ecc_encrypt    => %s\n", gpg_strerror (rc));
@@ -1573,8 +1634,7 @@ ecc_decrypt_raw (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
     }
 
 
-  ec = _gcry_mpi_ec_p_internal_new (sk.E.model, sk.E.dialect, 0,
-                                    sk.E.p, sk.E.a, sk.E.b);
+  ec = _gcry_ecc_acquire_ec_ctx (&sk.E);
 
   /*
    * Compute the plaintext.
@@ -1663,7 +1723,7 @@ ecc_decrypt_raw (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   _gcry_mpi_release (data_e);
   xfree (curvename);
   sexp_release (l1);
-  _gcry_mpi_ec_free (ec);
+  _gcry_ecc_release_ec_ctx (ec);
   _gcry_pk_util_free_encoding_ctx (&ctx);
   if (DBG_CIPHER)
     log_debug ("ecc_decrypt    => %s\n", gpg_strerror (rc));
@@ -2171,5 +2231,6 @@ gcry_pk_spec_t _gcry_pubkey_spec_ecc =
     run_selftests,
     compute_keygrip,
     _gcry_ecc_get_curve,
-    _gcry_ecc_get_param_sexp
+    _gcry_ecc_get_param_sexp,
+    ecc_verify_batch
   };
@@ -26,6 +26,7 @@
 #endif
 
 #include "g10lib.h"
+#include "bufhelp.h"
 #include "hash-common.h"
 
 
@@ -165,3 +166,469 @@ _gcry_md_block_write (void *context, const void *inbuf_arg, size_t inlen)
   for (; inlen && hd->count < blocksize; inlen--)
     hd->buf[hd->count++] = *inbuf++;
 }
+
+
+/* State of one lane of _gcry_md_block_hash_multi.  */
+struct md_multi_lane
+{
+  const unsigned char *data;    /* Next block of the current segment.  */
+  size_t nblks;                 /* Remaining blocks of the segment.  */
+  size_t job;                   /* Index of the message in this lane.  */
+  unsigned int busy:1;
+  unsigned int in_tail:1;       /* Segment is TAIL.  */
+  unsigned int tailblks;
+  unsigned char tail[128];      /* Last partial block and padding.  */
+};
+
+
+/* Start hashing message JOB of LENGTH bytes at BUFFER in lane J.  */
+static void
+md_multi_start_lane (const gcry_md_multi_spec_t *spec, u32 *state,
+                     struct md_multi_lane *lane, unsigned int j, size_t job,
+                     const unsigned char *buffer, size_t length)
+{
+  size_t rest = length % 64;
+  unsigned int i;
+
+  for (i = 0; i < spec->nwords; i++)
+    state[i * spec->nlanes + j] = spec->iv[i];
+
+  /* Pad the last partial block with 0x80, zeroes and the 64 bit
+     big-endian bit count.  */
+  lane->tailblks = rest < 56 ? 1 : 2;
+  if (rest)
+    memcpy (lane->tail, buffer + length - rest, rest);
+  lane->tail[rest] = 0x80;
+  memset (lane->tail + rest + 1, 0, lane->tailblks * 64 - rest - 1 - 8);
+  buf_put_be64 (lane->tail + lane->tailblks * 64 - 8, (u64)length << 3);
+
+  lane->job = job;
+  lane->busy = 1;
+  lane->data = buffer;
+  lane->nblks = length / 64;
+  lane->in_tail = 0;
+  if (!lane->nblks)
+    {
+      lane->data = lane->tail;
+      lane->nblks = lane->tailblks;
+      lane->in_tail = 1;
+    }
+}
+
+
+/* Write the digest of lane J to DIGEST.  */
+static void
+md_multi_put_digest (const gcry_md_multi_spec_t *spec, const u32 *state,
+                     unsigned int j, unsigned char *digest)
+{
+  unsigned int i;
+
+  for (i = 0; i < spec->digestlen / 4; i++)
+    buf_put_be32 (digest + i * 4, state[i * spec->nlanes + j]);
+}
+
+
+/* Compute the digests of the N messages BUFFERS[I] of LENGTHS[I]
+   bytes and store them at DIGESTS[I] using the multi-lane block
+   function of SPEC.  Lanes whose message is done are refilled with the
+   next message; once less than half of the lanes remain busy, the rest
+   is finished with the single lane block function.  */
+void
+_gcry_md_block_hash_multi (const gcry_md_multi_spec_t *spec, void **digests,
+                           const void **buffers, const size_t *lengths,
+                           size_t n)
+{
+  struct md_multi_lane lanes[MD_MULTI_MAX_LANES];
+  const unsigned char *ptrs[MD_MULTI_MAX_LANES];
+  u32 state[8 * MD_MULTI_MAX_LANES];
+  u32 lstate[8];
+  unsigned int nlanes = spec->nlanes;
+  unsigned int nbusy = 0;
+  unsigned int burn = 0, nburn;
+  unsigned int i, j;
+  size_t next = 0;
+  size_t nblks;
+
+  gcry_assert (nlanes <= MD_MULTI_MAX_LANES && spec->nwords <= 8);
+
+  memset (lanes, 0, sizeof (lanes));
+
+  for (;;)
+    {
+      for (j = 0; j < nlanes && next < n; j++)
+        if (!lanes[j].busy)
+          {
+            md_multi_start_lane (spec, state, &lanes[j], j, next,
+                                 buffers[next], lengths[next]);
+            next++;
+            nbusy++;
+          }
+
+      if (next == n && nbusy < nlanes / 2)
+        break;
+
+      /* Process the blocks all busy lanes have left in their current
+         segment.  Idle lanes hash the data of a busy lane.  */
+      nblks = 0;
+      i = 0;
+      for (j = 0; j < nlanes; j++)
+        if (lanes[j].busy && (!nblks || lanes[j].nblks < nblks))
+          {
+            nblks = lanes[j].nblks;
+            i = j;
+          }
+      for (j = 0; j < nlanes; j++)
+        ptrs[j] = lanes[j].busy ? lanes[j].data : lanes[i].data;
+
+      nburn = spec->multi_blocks (state, ptrs, nblks);
+      burn = nburn > burn ? nburn : burn;
+
+      for (j = 0; j < nlanes; j++)
+        {
+          if (!lanes[j].busy)
+            continue;
+
+          lanes[j].data += nblks * 64;
+          lanes[j].nblks -= nblks;
+          if (lanes[j].nblks)
+            continue;
+
+          if (!lanes[j].in_tail)
+            {
+              lanes[j].data = lanes[j].tail;
+              lanes[j].nblks = lanes[j].tailblks;
+              lanes[j].in_tail = 1;
+            }
+          else
+            {
+              md_multi_put_digest (spec, state, j, digests[lanes[j].job]);
+              lanes[j].busy = 0;
+              nbusy--;
+            }
+        }
+    }
+
+  /* Finish the remaining lanes one by one.  */
+  for (j = 0; j < nlanes; j++)
+    {
+      if (!lanes[j].busy)
+        continue;
+
+      for (i = 0; i < spec->nwords; i++)
+        lstate[i] = state[i * nlanes + j];
+
+      nburn = spec->blocks (lstate, lanes[j].data, lanes[j].nblks);
+      burn = nburn > burn ? nburn : burn;
+      if (!lanes[j].in_tail)
+        {
+          nburn = spec->blocks (lstate, lanes[j].tail, lanes[j].tailblks);
+          burn = nburn > burn ? nburn : burn;
+        }
+
+      for (i = 0; i < spec->nwords; i++)
+        state[i * nlanes + j] = lstate[i];
+      md_multi_put_digest (spec, state, j, digests[lanes[j].job]);
+    }
+
+  wipememory (lanes, sizeof (lanes));
+  wipememory (state, sizeof (state));
+  wipememory (lstate, sizeof (lstate));
+  _gcry_burn_stack (burn);
+}
+
+
+/* Process NBLKS blocks at DATA with the block function of SPEC,
+   starting from and updating the state words at STATE.  */
+static unsigned int
+md_pbkdf2_blocks (const gcry_md_pbkdf2_spec_t *spec, u32 *state,
+                  const unsigned char *data, size_t nblks)
+{
+  unsigned int burn;
+
+  if (!nblks)
+    return 0;
+
+  memcpy (spec->state, state, spec->nwords * sizeof (u32));
+  burn = spec->bwrite (spec->ctx, data, nblks);
+  memcpy (state, spec->state, spec->nwords * sizeof (u32));
+  return burn;
+}
+
+
+/* Hash the LENGTH bytes at DATA and the SUFFIXLEN (at most 8) bytes at
+   SUFFIX into STATE, which has already absorbed PREFIXLEN bytes, and
+   finish the hash with the padding.  */
+static unsigned int
+md_pbkdf2_final (const gcry_md_pbkdf2_spec_t *spec, u32 *state,
+                 size_t prefixlen, const unsigned char *data, size_t length,
+                 const unsigned char *suffix, size_t suffixlen)
+{
+  unsigned char tail[128];
+  size_t nblks = length / 64;
+  size_t rest = length % 64;
+  size_t tlen;
+  unsigned int burn, nburn;
+
+  burn = md_pbkdf2_blocks (spec, state, data, nblks);
+
+  if (rest)
+    memcpy (tail, data + nblks * 64, rest);
+  if (suffixlen)
+    memcpy (tail + rest, suffix, suffixlen);
+  rest += suffixlen;
+  tlen = rest < 56 ? 64 : 128;
+  tail[rest] = 0x80;
+  memset (tail + rest + 1, 0, tlen - rest - 1 - 8);
+  buf_put_be64 (tail + tlen - 8, (u64)(prefixlen + length + suffixlen) << 3);
+
+  nburn = md_pbkdf2_blocks (spec, state, tail, tlen / 64);
+  wipememory (tail, sizeof (tail));
+  return nburn > burn ? nburn : burn;
+}
+
+
+/* Prepare BLOCK for hashing a message of one digest after the HMAC pad;
+   only the digest at the start of the block changes between the
+   messages.  */
+static void
+md_pbkdf2_pad_block (const gcry_md_pbkdf2_spec_t *spec, unsigned char *block)
+{
+  block[spec->digestlen] = 0x80;
+  memset (block + spec->digestlen + 1, 0, 56 - spec->digestlen - 1);
+  buf_put_be64 (block + 56, (u64)(64 + spec->digestlen) << 3);
+}
+
+
+/* Compute block LIDX of the derived key as state words at T.  ISTATE
+   and OSTATE are the states after hashing the inner and the outer
+   HMAC pad.  */
+static unsigned int
+md_pbkdf2_one (const gcry_md_pbkdf2_spec_t *spec,
+               const u32 *istate, const u32 *ostate,
+               const unsigned char *salt, size_t saltlen, u32 lidx,
+               unsigned long iterations, u32 *t)
+{
+  unsigned int nwords = spec->nwords;
+  unsigned int dwords = spec->digestlen / 4;
+  u32 *state = spec->state;
+  unsigned char block[64];
+  unsigned char cnt[4];
+  unsigned long iter;
+  unsigned int burn, nburn;
+  unsigned int i;
+
+  /* U_1 = PRF (P, S || INT (i)).  */
+  memcpy (t, istate, nwords * sizeof (u32));
+  buf_put_be32 (cnt, lidx);
+  burn = md_pbkdf2_final (spec, t, 64, salt, saltlen, cnt, 4);
+
+  md_pbkdf2_pad_block (spec, block);
+  for (i = 0; i < dwords; i++)
+    buf_put_be32 (block + i * 4, t[i]);
+  memcpy (state, ostate, nwords * sizeof (u32));
+  nburn = spec->bwrite (spec->ctx, block, 1);
+  burn = nburn > burn ? nburn : burn;
+  for (i = 0; i < dwords; i++)
+    t[i] = state[i];
+
+  /* U_j = PRF (P, U_(j-1)) as one inner and one outer block.  */
+  for (iter = 1; iter < iterations; iter++)
+    {
+      for (i = 0; i < dwords; i++)
+        buf_put_be32 (block + i * 4, state[i]);
+      memcpy (state, istate, nwords * sizeof (u32));
+      spec->bwrite (spec->ctx, block, 1);
+
+      for (i = 0; i < dwords; i++)
+        buf_put_be32 (block + i * 4, state[i]);
+      memcpy (state, ostate, nwords * sizeof (u32));
+      spec->bwrite (spec->ctx, block, 1);
+
+      for (i = 0; i < dwords; i++)
+        t[i] ^= state[i];
+    }
+
+  wipememory (block, sizeof (block));
+  return burn;
+}
+
+
+/* Hash one block of each of the NLANES lanes of SPEC, starting all
+   lanes from the state words at START.  The first N lanes hash the
+   blocks at BLOCKS and receive the resulting digest there.  */
+static unsigned int
+md_pbkdf2_multi_step (const gcry_md_pbkdf2_spec_t *spec, u32 *state,
+                      const u32 *start, const unsigned char **ptrs,
+                      unsigned char (*blocks)[64], unsigned int n)
+{
+  unsigned int nlanes = spec->nlanes;
+  unsigned int burn;
+  unsigned int i, j;
+
+  for (i = 0; i < spec->nwords; i++)
+    for (j = 0; j < nlanes; j++)
+      state[i * nlanes + j] = start[i];
+
+  burn = spec->multi_blocks (state, ptrs, 1);
+
+  for (j = 0; j < n; j++)
+    for (i = 0; i < spec->digestlen / 4; i++)
+      buf_put_be32 (blocks[j] + i * 4, state[i * nlanes + j]);
+
+  return burn;
+}
+
+
+/* Compute the N blocks starting at block LIDX of the derived key in
+   the lanes of the multi-lane block function of SPEC.  The state words
+   of block LIDX + J are stored at T + 8 * J.  */
+static unsigned int
+md_pbkdf2_multi (const gcry_md_pbkdf2_spec_t *spec,
+                 const u32 *istate, const u32 *ostate,
+                 const unsigned char *salt, size_t saltlen, u32 lidx,
+                 unsigned int n, unsigned long iterations, u32 *t)
+{
+  unsigned char blocks[MD_MULTI_MAX_LANES][64];
+  const unsigned char *ptrs[MD_MULTI_MAX_LANES];
+  u32 state[8 * MD_MULTI_MAX_LANES];
+  unsigned int nlanes = spec->nlanes;
+  unsigned int dwords = spec->digestlen / 4;
+  unsigned char cnt[4];
+  unsigned long iter;
+  unsigned int burn = 0, nburn;
+  unsigned int i, j;
+
+  /* The inner hashes of U_1 depend on the salt; do them one by one.
+     Idle lanes hash the block of the first lane.  */
+  for (j = 0; j < n; j++)
+    {
+      memcpy (t + 8 * j, istate, spec->nwords * sizeof (u32));
+      buf_put_be32 (cnt, lidx + j);
+      nburn = md_pbkdf2_final (spec, t + 8 * j, 64, salt, saltlen, cnt, 4);
+      burn = nburn > burn ? nburn : burn;
+
+      md_pbkdf2_pad_block (spec, blocks[j]);
+      for (i = 0; i < dwords; i++)
+        buf_put_be32 (blocks[j] + i * 4, t[8 * j + i]);
+    }
+  for (j = 0; j < nlanes; j++)
+    ptrs[j] = blocks[j < n ? j : 0];
+
+  nburn = md_pbkdf2_multi_step (spec, state, ostate, ptrs, blocks, n);
+  burn = nburn > burn ? nburn : burn;
+  for (j = 0; j < n; j++)
+    for (i = 0; i < dwords; i++)
+      t[8 * j + i] = state[i * nlanes + j];
+
+  for (iter = 1; iter < iterations; iter++)
+    {
+      md_pbkdf2_multi_step (spec, state, istate, ptrs, blocks, n);
+      md_pbkdf2_multi_step (spec, state, ostate, ptrs, blocks, n);
+      for (j = 0; j < n; j++)
+        for (i = 0; i < dwords; i++)
+          t[8 * j + i] ^= state[i * nlanes + j];
+    }
+
+  wipememory (blocks, sizeof (blocks));
+  wipememory (state, sizeof (state));
+  return burn;
+}
+
+
+/* Derive KEYSIZE bytes to KEYBUFFER with PBKDF2 using HMAC with the
+   hash of SPEC.  The HMAC is computed directly with the block function
+   on the states after the inner and outer pads, so that each iteration
+   costs two blocks.  If SPEC has a multi-lane block function and the
+   derived key has enough blocks, they are computed in parallel.  */
+void
+_gcry_md_block_pbkdf2 (const gcry_md_pbkdf2_spec_t *spec,
+                       const void *passphrase, size_t passphraselen,
+                       const void *salt, size_t saltlen,
+                       unsigned long iterations,
+                       size_t keysize, void *keybuffer)
+{
+  unsigned int hlen = spec->digestlen;
+  unsigned int nwords = spec->nwords;
+  unsigned char key[64];
+  unsigned char pad[64];
+  unsigned char out[32];
+  u32 iv[8], istate[8], ostate[8];
+  u32 t[8 * MD_MULTI_MAX_LANES];
+  unsigned char *dk = keybuffer;
+  size_t keylen, l, lidx, n, len;
+  unsigned int burn = 0, nburn;
+  unsigned int i, j;
+
+  gcry_assert (nwords <= 8 && hlen <= 32
+               && spec->nlanes <= MD_MULTI_MAX_LANES);
+
+  memcpy (iv, spec->state, nwords * sizeof (u32));
+
+  /* Keys longer than a block are replaced by their hash.  */
+  if (passphraselen > 64)
+    {
+      memcpy (istate, iv, nwords * sizeof (u32));
+      burn = md_pbkdf2_final (spec, istate, 0, passphrase, passphraselen,
+                              NULL, 0);
+      for (i = 0; i < hlen / 4; i++)
+        buf_put_be32 (key + i * 4, istate[i]);
+      keylen = hlen;
+    }
+  else
+    {
+      memcpy (key, passphrase, passphraselen);
+      keylen = passphraselen;
+    }
+
+  for (i = 0; i < 64; i++)
+    pad[i] = (i < keylen ? key[i] : 0) ^ 0x36;
+  memcpy (istate, iv, nwords * sizeof (u32));
+  nburn = md_pbkdf2_blocks (spec, istate, pad, 1);
+  burn = nburn > burn ? nburn : burn;
+
+  for (i = 0; i < 64; i++)
+    pad[i] = (i < keylen ? key[i] : 0) ^ 0x5c;
+  memcpy (ostate, iv, nwords * sizeof (u32));
+  nburn = md_pbkdf2_blocks (spec, ostate, pad, 1);
+  burn = nburn > burn ? nburn : burn;
+
+  /* The lanes pay off only if at least half of them are used.  */
+  l = (keysize - 1) / hlen + 1;
+  for (lidx = 0; lidx < l; lidx += n)
+    {
+      n = l - lidx;
+      if (spec->nlanes && n * 2 >= spec->nlanes)
+        {
+          if (n > spec->nlanes)
+            n = spec->nlanes;
+          nburn = md_pbkdf2_multi (spec, istate, ostate, salt, saltlen,
+                                   lidx + 1, n, iterations, t);
+        }
+      else
+        {
+          n = 1;
+          nburn = md_pbkdf2_one (spec, istate, ostate, salt, saltlen,
+                                 lidx + 1, iterations, t);
+        }
+      burn = nburn > burn ? nburn : burn;
+
+      for (j = 0; j < n; j++)
+        {
+          for (i = 0; i < hlen / 4; i++)
+            buf_put_be32 (out + i * 4, t[8 * j + i]);
+          len = keysize - (lidx + j) * hlen;
+          if (len > hlen)
+            len = hlen;
+          memcpy (dk, out, len);
+          dk += len;
+        }
+    }
+
+  wipememory (key, sizeof (key));
+  wipememory (pad, sizeof (pad));
+  wipememory (out, sizeof (out));
+  wipememory (istate, sizeof (istate));
+  wipememory (ostate, sizeof (ostate));
+  wipememory (t, sizeof (t));
+  _gcry_burn_stack (burn);
+}
@@ -56,4 +56,61 @@ typedef struct gcry_md_block_ctx
 void
 _gcry_md_block_write( void *context, const void *inbuf_arg, size_t inlen);
 
+
+/* Maximum number of lanes of a multi-lane block function.  */
+#define MD_MULTI_MAX_LANES 16
+
+/* Type for the multi-lane block functions of 64 byte block hashes
+   with 32 bit words.  Word I of the state of lane J is at
+   STATE[I * NLANES + J]; the blocks of lane J are at DATA[J].  */
+typedef unsigned int (*_gcry_md_multi_blocks_t) (u32 *state,
+                                                 const unsigned char **data,
+                                                 size_t nblks);
+
+/* Type for the single lane block function with the state at STATE.  */
+typedef unsigned int (*_gcry_md_state_blocks_t) (u32 *state,
+                                                 const unsigned char *data,
+                                                 size_t nblks);
+
+/* Description of a multi-lane implementation of a Merkle-Damgard hash
+   with 64 byte blocks and a big-endian length and digest, like SHA-1
+   and SHA-256.  */
+typedef struct gcry_md_multi_spec
+{
+  unsigned int nlanes;
+  unsigned int nwords;          /* Number of state words.  */
+  unsigned int digestlen;
+  const u32 *iv;
+  _gcry_md_multi_blocks_t multi_blocks;
+  _gcry_md_state_blocks_t blocks;
+} gcry_md_multi_spec_t;
+
+void
+_gcry_md_block_hash_multi (const gcry_md_multi_spec_t *spec, void **digests,
+                           const void **buffers, const size_t *lengths,
+                           size_t n);
+
+/* Description of a hash of the above kind for the PBKDF2 code.  CTX is
+   a freshly initialized context of the hash with the state words at
+   STATE; BWRITE is its block function.  NLANES and MULTI_BLOCKS
+   optionally give a multi-lane block function; NLANES is 0 if there is
+   none.  */
+typedef struct gcry_md_pbkdf2_spec
+{
+  unsigned int nwords;          /* Number of state words.  */
+  unsigned int digestlen;
+  void *ctx;
+  u32 *state;
+  _gcry_md_block_write_t bwrite;
+  unsigned int nlanes;
+  _gcry_md_multi_blocks_t multi_blocks;
+} gcry_md_pbkdf2_spec_t;
+
+void
+_gcry_md_block_pbkdf2 (const gcry_md_pbkdf2_spec_t *spec,
+                       const void *passphrase, size_t passphraselen,
+                       const void *salt, size_t saltlen,
+                       unsigned long iterations,
+                       size_t keysize, void *keybuffer);
+
 #endif /*GCRY_HASH_COMMON_H*/
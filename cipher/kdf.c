@@ -160,6 +160,29 @@ _gcry_kdf_pkdf2 (const void *passphrase, size_t passphraselen,
     return GPG_ERR_INV_VALUE;
 #endif
 
+  /* HMAC with SHA-1 and SHA-2/256 is computed directly on the hash
+     blocks, see _gcry_md_block_pbkdf2.  */
+  if (!_gcry_md_test_algo (hashalgo))
+    switch (hashalgo)
+      {
+      case GCRY_MD_SHA1:
+        _gcry_sha1_pbkdf2 (passphrase, passphraselen, salt, saltlen,
+                           iterations, dklen, keybuffer);
+        return 0;
+#ifdef USE_SHA256
+      case GCRY_MD_SHA224:
+        _gcry_sha224_pbkdf2 (passphrase, passphraselen, salt, saltlen,
+                             iterations, dklen, keybuffer);
+        return 0;
+      case GCRY_MD_SHA256:
+        _gcry_sha256_pbkdf2 (passphrase, passphraselen, salt, saltlen,
+                             iterations, dklen, keybuffer);
+        return 0;
+#endif
+      default:
+        break;
+      }
+
 
   /* Step 2 */
   l = ((dklen - 1)/ hlen) + 1;
@@ -71,6 +71,17 @@
 #endif /*ENABLE_NEON_SUPPORT*/
 
 
+/* USE_64BIT_AVX2 indicates whether to compile with the four-way Intel AVX2
+ * code for processing several states in parallel. */
+#undef USE_64BIT_AVX2
+#if defined(USE_64BIT) && defined(__x86_64__) && \
+    defined(HAVE_GCC_INLINE_ASM_AVX2) && defined(ENABLE_AVX2_SUPPORT) && \
+    (defined(HAVE_COMPATIBLE_GCC_AMD64_PLATFORM_AS) || \
+     defined(HAVE_COMPATIBLE_GCC_WIN64_PLATFORM_AS))
+# define USE_64BIT_AVX2 1
+#endif
+
+
 #if defined(USE_64BIT) || defined(USE_64BIT_ARM_NEON)
 # define NEED_COMMON64 1
 #endif
@@ -998,6 +1009,366 @@ keccak_extract (void *context, void *out, size_t outlen)
 }
 
 
+/*
+     Processing of several states in parallel.
+ */
+
+#ifdef USE_64BIT_AVX2
+
+/* Assembly implementations use SystemV ABI, ABI conversion and additional
+ * stack to store XMM6-XMM15 needed on Win64. */
+#ifdef HAVE_COMPATIBLE_GCC_WIN64_PLATFORM_AS
+# define ASM_FUNC_ABI __attribute__((sysv_abi))
+# define ASM_EXTRA_STACK (10 * 16)
+#else
+# define ASM_FUNC_ABI
+# define ASM_EXTRA_STACK 0
+#endif
+
+/* Permute four interleaved states; lane I of state J is at
+ * STATE4[4 * I + J]. */
+unsigned int _gcry_keccak_f1600_permute4_avx2 (u64 *state4) ASM_FUNC_ABI;
+
+/* The four-way code is faster than the single state code only if at
+ * least three of the states are in use. */
+#define KECCAK_PAR4_MIN 3
+
+/* Interleaved states for _gcry_keccak_f1600_permute4_avx2. */
+typedef struct
+{
+  u64 lanes[25 * 4] __attribute__ ((aligned (32)));
+} KECCAK_STATE4;
+
+/* State of one message of keccak_hash_buffers_par4. */
+typedef struct
+{
+  const byte *data;             /* Next block of the current segment.  */
+  size_t nblks;                 /* Remaining blocks of the segment.  */
+  size_t job;                   /* Index of the message.  */
+  unsigned int busy:1;
+  unsigned int in_tail:1;       /* Segment is TAIL.  */
+  byte tail[1152 / 8];          /* Last partial block and padding.  */
+} KECCAK_PAR4_LANE;
+
+
+static unsigned int
+keccak_permute4 (KECCAK_STATE4 *hd4)
+{
+  return _gcry_keccak_f1600_permute4_avx2 (hd4->lanes)
+         + 4 * sizeof(void*) + ASM_EXTRA_STACK;
+}
+
+/* XOR the NLANES lanes at IN into state J of HD4. */
+static void
+keccak_absorb4 (KECCAK_STATE4 *hd4, unsigned int j, const byte *in,
+                unsigned int nlanes)
+{
+  unsigned int i;
+
+  for (i = 0; i < nlanes; i++)
+    hd4->lanes[4 * i + j] ^= buf_get_le64 (in + 8 * i);
+}
+
+/* Store the first OUTLEN bytes of state J of HD4 at OUT. */
+static void
+keccak_squeeze4 (const KECCAK_STATE4 *hd4, unsigned int j, byte *out,
+                 size_t outlen)
+{
+  byte lane[8];
+  unsigned int i;
+
+  for (i = 0; i < outlen / 8; i++)
+    buf_put_le64 (out + 8 * i, hd4->lanes[4 * i + j]);
+
+  if (outlen % 8)
+    {
+      buf_put_le64 (lane, hd4->lanes[4 * i + j]);
+      memcpy (out + 8 * i, lane, outlen % 8);
+      wipememory (lane, sizeof(lane));
+    }
+}
+
+static void
+keccak_get_state4 (KECCAK_STATE4 *hd4, unsigned int j, const KECCAK_STATE *hd)
+{
+  unsigned int i;
+
+  for (i = 0; i < 25; i++)
+    hd4->lanes[4 * i + j] = hd->u.state64[i];
+}
+
+static void
+keccak_put_state4 (const KECCAK_STATE4 *hd4, unsigned int j, KECCAK_STATE *hd)
+{
+  unsigned int i;
+
+  for (i = 0; i < 25; i++)
+    hd->u.state64[i] = hd4->lanes[4 * i + j];
+}
+
+
+/* Start hashing message JOB of LENGTH bytes at BUFFER with the
+ * parameters of CTX in lane J.  */
+static void
+keccak_par4_start_lane (const KECCAK_CONTEXT *ctx, KECCAK_STATE4 *hd4,
+                        KECCAK_PAR4_LANE *lane, unsigned int j, size_t job,
+                        const byte *buffer, size_t length)
+{
+  const size_t bsize = ctx->blocksize;
+  size_t rest = length % bsize;
+  unsigned int i;
+
+  for (i = 0; i < 25; i++)
+    hd4->lanes[4 * i + j] = 0;
+
+  /* The padding always fits into the last block. */
+  memset (lane->tail, 0, bsize);
+  if (rest)
+    memcpy (lane->tail, buffer + length - rest, rest);
+  lane->tail[rest] ^= ctx->suffix;
+  lane->tail[bsize - 1] ^= 0x80;
+
+  lane->job = job;
+  lane->busy = 1;
+  lane->data = buffer;
+  lane->nblks = length / bsize;
+  lane->in_tail = 0;
+  if (!lane->nblks)
+    {
+      lane->data = lane->tail;
+      lane->nblks = 1;
+      lane->in_tail = 1;
+    }
+}
+
+
+/* Hash the N messages BUFFERS[I] of LENGTHS[I] bytes with the SHA3
+ * variant ALGO and store the digests at DIGESTS[I].  Four messages are
+ * absorbed in parallel; a lane whose message is done is refilled with
+ * the next message.  */
+static void
+keccak_hash_buffers_par4 (int algo, void **digests, const void **buffers,
+                          const size_t *lengths, size_t n)
+{
+  KECCAK_CONTEXT ctx;
+  KECCAK_STATE4 hd4;
+  KECCAK_PAR4_LANE lanes[4];
+  unsigned int blocklanes;
+  unsigned int nbusy = 0;
+  unsigned int nburn, burn = 0;
+  unsigned int j;
+  size_t next = 0;
+  byte digest[64];
+
+  keccak_init (algo, &ctx, 0);
+  blocklanes = ctx.blocksize / 8;
+
+  memset (lanes, 0, sizeof(lanes));
+
+  for (;;)
+    {
+      for (j = 0; j < 4 && next < n; j++)
+        if (!lanes[j].busy)
+          {
+            keccak_par4_start_lane (&ctx, &hd4, &lanes[j], j, next,
+                                    buffers[next], lengths[next]);
+            next++;
+            nbusy++;
+          }
+
+      if (nbusy < KECCAK_PAR4_MIN)
+        break;
+
+      for (j = 0; j < 4; j++)
+        if (lanes[j].busy)
+          keccak_absorb4 (&hd4, j, lanes[j].data, blocklanes);
+
+      nburn = keccak_permute4 (&hd4);
+      burn = nburn > burn ? nburn : burn;
+
+      for (j = 0; j < 4; j++)
+        {
+          if (!lanes[j].busy)
+            continue;
+
+          lanes[j].data += ctx.blocksize;
+          if (--lanes[j].nblks)
+            continue;
+
+          if (!lanes[j].in_tail)
+            {
+              lanes[j].data = lanes[j].tail;
+              lanes[j].nblks = 1;
+              lanes[j].in_tail = 1;
+            }
+          else
+            {
+              keccak_squeeze4 (&hd4, j, digests[lanes[j].job], ctx.outlen);
+              lanes[j].busy = 0;
+              nbusy--;
+            }
+        }
+    }
+
+  /* Finish the remaining messages one by one.  */
+  for (j = 0; j < 4; j++)
+    {
+      if (!lanes[j].busy)
+        continue;
+
+      keccak_put_state4 (&hd4, j, &ctx.state);
+      nburn = ctx.ops->absorb (&ctx.state, 0, lanes[j].data,
+                               lanes[j].nblks * blocklanes, blocklanes);
+      burn = nburn > burn ? nburn : burn;
+      if (!lanes[j].in_tail)
+        {
+          nburn = ctx.ops->absorb (&ctx.state, 0, lanes[j].tail, blocklanes,
+                                   blocklanes);
+          burn = nburn > burn ? nburn : burn;
+        }
+
+      nburn = ctx.ops->extract (&ctx.state, 0, digest, ctx.outlen);
+      burn = nburn > burn ? nburn : burn;
+      memcpy (digests[lanes[j].job], digest, ctx.outlen);
+    }
+
+  wipememory (&ctx, sizeof(ctx));
+  wipememory (&hd4, sizeof(hd4));
+  wipememory (lanes, sizeof(lanes));
+  wipememory (digest, sizeof(digest));
+  _gcry_burn_stack (burn);
+}
+
+
+/* Extract OUTLEN bytes from each of the M (at most four) finalized
+ * SHAKE contexts CTXS to OUTBUFS.  */
+static void
+keccak_extract_par4 (KECCAK_CONTEXT **ctxs, void **outbufs, size_t outlen,
+                     unsigned int m)
+{
+  KECCAK_STATE4 hd4;
+  const size_t bsize = ctxs[0]->blocksize;
+  byte *out[4];
+  size_t left[4];
+  size_t nbytes;
+  unsigned int nburn, burn = 0;
+  unsigned int nbusy = 0;
+  unsigned int j;
+
+  memset (&hd4, 0, sizeof(hd4));
+
+  for (j = 0; j < m; j++)
+    {
+      out[j] = outbufs[j];
+      left[j] = outlen;
+
+      /* Use up the current block first. */
+      if (ctxs[j]->count)
+        {
+          nbytes = bsize - ctxs[j]->count;
+          nbytes = nbytes < outlen ? nbytes : outlen;
+          keccak_extract (ctxs[j], out[j], nbytes);
+          out[j] += nbytes;
+          left[j] -= nbytes;
+        }
+
+      if (left[j])
+        {
+          keccak_get_state4 (&hd4, j, &ctxs[j]->state);
+          nbusy++;
+        }
+    }
+
+  while (nbusy)
+    {
+      nburn = keccak_permute4 (&hd4);
+      burn = nburn > burn ? nburn : burn;
+
+      for (j = 0; j < m; j++)
+        {
+          if (!left[j])
+            continue;
+
+          nbytes = left[j] < bsize ? left[j] : bsize;
+          keccak_squeeze4 (&hd4, j, out[j], nbytes);
+          out[j] += nbytes;
+          left[j] -= nbytes;
+
+          if (!left[j])
+            {
+              keccak_put_state4 (&hd4, j, &ctxs[j]->state);
+              ctxs[j]->count = nbytes % bsize;
+              nbusy--;
+            }
+        }
+    }
+
+  wipememory (&hd4, sizeof(hd4));
+  _gcry_burn_stack (burn);
+}
+
+#endif /* USE_64BIT_AVX2 */
+
+
+/* Hash the N messages BUFFERS[I] of LENGTHS[I] bytes with the SHA3
+ * variant ALGO and store the digests at DIGESTS[I].  Returns
+ * GPG_ERR_NOT_SUPPORTED if there is no parallel implementation.  */
+gcry_err_code_t
+_gcry_sha3_hash_buffer_batch (int algo, void **digests, const void **buffers,
+                              const size_t *lengths, size_t n)
+{
+#ifdef USE_64BIT_AVX2
+  if ((_gcry_get_hw_features () & HWF_INTEL_AVX2) && n >= KECCAK_PAR4_MIN)
+    {
+      keccak_hash_buffers_par4 (algo, digests, buffers, lengths, n);
+      return 0;
+    }
+#else
+  (void)algo;
+  (void)digests;
+  (void)buffers;
+  (void)lengths;
+  (void)n;
+#endif
+
+  return GPG_ERR_NOT_SUPPORTED;
+}
+
+
+/* Extract OUTLEN bytes from each of the N finalized SHAKE contexts
+ * CONTEXTS to OUTBUFS.  All contexts need to be of the same algorithm.
+ * Returns GPG_ERR_NOT_SUPPORTED if there is no parallel
+ * implementation.  */
+gcry_err_code_t
+_gcry_shake_extract_batch (void **contexts, void **outbufs, size_t outlen,
+                           size_t n)
+{
+#ifdef USE_64BIT_AVX2
+  size_t i, m;
+
+  if ((_gcry_get_hw_features () & HWF_INTEL_AVX2) && n >= KECCAK_PAR4_MIN)
+    {
+      for (i = 0; i + KECCAK_PAR4_MIN <= n; i += m)
+        {
+          m = n - i < 4 ? n - i : 4;
+          keccak_extract_par4 ((KECCAK_CONTEXT **)contexts + i,
+                               outbufs + i, outlen, m);
+        }
+      for (; i < n; i++)
+        keccak_extract (contexts[i], outbufs[i], outlen);
+      return 0;
+    }
+#else
+  (void)contexts;
+  (void)outbufs;
+  (void)outlen;
+  (void)n;
+#endif
+
+  return GPG_ERR_NOT_SUPPORTED;
+}
+
+
 
 /*
      Self-test section.
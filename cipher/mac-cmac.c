@@ -114,6 +114,26 @@ cmac_write (gcry_mac_hd_t h, const unsigned char *buf, size_t buflen)
 }
 
 
+static gcry_err_code_t
+cmac_write_batch (gcry_mac_hd_t *hds, const unsigned char **bufs,
+                  const size_t *buflens, size_t n, gcry_err_code_t *rcs)
+{
+  gcry_cipher_hd_t *ctxs;
+  size_t i;
+
+  ctxs = xtrymalloc (n * sizeof *ctxs);
+  if (!ctxs)
+    return gpg_err_code_from_syserror ();
+
+  for (i = 0; i < n; i++)
+    ctxs[i] = hds[i]->u.cmac.ctx;
+  _gcry_cipher_cmac_authenticate_multi (ctxs, bufs, buflens, n, rcs);
+
+  xfree (ctxs);
+  return 0;
+}
+
+
 static gcry_err_code_t
 cmac_read (gcry_mac_hd_t h, unsigned char *outbuf, size_t * outlen)
 {
@@ -154,7 +174,8 @@ static gcry_mac_spec_ops_t cmac_ops = {
   cmac_read,
   cmac_verify,
   cmac_get_maclen,
-  cmac_get_keylen
+  cmac_get_keylen,
+  cmac_write_batch
 };
 
 
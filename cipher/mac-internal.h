@@ -62,6 +62,11 @@ typedef gcry_err_code_t (*gcry_mac_verify_func_t)(gcry_mac_hd_t h,
 						  size_t inlen);
 typedef unsigned int (*gcry_mac_get_maclen_func_t)(int algo);
 typedef unsigned int (*gcry_mac_get_keylen_func_t)(int algo);
+typedef gcry_err_code_t (*gcry_mac_write_batch_func_t)(gcry_mac_hd_t *hds,
+                                                       const unsigned char **bufs,
+                                                       const size_t *buflens,
+                                                       size_t n,
+                                                       gcry_err_code_t *rcs);
 
 
 typedef struct gcry_mac_spec_ops
@@ -76,6 +81,8 @@ typedef struct gcry_mac_spec_ops
   gcry_mac_verify_func_t verify;
   gcry_mac_get_maclen_func_t get_maclen;
   gcry_mac_get_keylen_func_t get_keylen;
+  gcry_mac_write_batch_func_t write_batch;  /* Optional.  On error no
+                                               handle may be modified.  */
 } gcry_mac_spec_ops_t;
 
 
@@ -385,6 +385,129 @@ _gcry_mac_write (gcry_mac_hd_t hd, const void *inbuf, size_t inlen)
 }
 
 
+/* qsort helper to find duplicate handles.  */
+static int
+compare_handles (const void *a, const void *b)
+{
+  gcry_mac_hd_t ha = *(const gcry_mac_hd_t *)a;
+  gcry_mac_hd_t hb = *(const gcry_mac_hd_t *)b;
+
+  return ha < hb ? -1 : ha > hb;
+}
+
+
+/* Write the N buffers BUFS[i] of length BUFLENS[i] to the MAC handles
+   HDS[i].  The result is the same as calling _gcry_mac_write for each
+   buffer in turn, but algorithms with a write_batch function process
+   the buffers of distinct handles together.  The result for each
+   buffer is stored at R_RESULTS if that is not NULL; it is always set
+   for all N buffers.  The return value is the error of the first
+   failed buffer.  */
+gcry_err_code_t
+_gcry_mac_write_batch (gcry_mac_hd_t *hds, const void **bufs,
+                       const size_t *buflens, size_t n,
+                       gcry_error_t *r_results)
+{
+  gcry_err_code_t rc;
+  const gcry_mac_spec_t *spec;
+  gcry_err_code_t *rcs, *sub_rcs;
+  gcry_mac_hd_t *sorted, *sub_hds;
+  const unsigned char **sub_bufs;
+  size_t *sub_lens, *sub_idx;
+  unsigned char *todo;
+  size_t i, j, nsub;
+  int distinct;
+
+  if (!n)
+    return 0;
+
+  /* Carve all arrays out of one allocation; the arrays with the larger
+     elements come first to keep them aligned.  */
+  sorted = xtrycalloc (n, (sizeof *sorted + sizeof *sub_hds
+                           + sizeof *sub_bufs + sizeof *sub_lens
+                           + sizeof *sub_idx + sizeof *rcs
+                           + sizeof *sub_rcs + sizeof *todo));
+  if (!sorted)
+    {
+      /* Without the work arrays write the buffers one by one.  */
+      rc = 0;
+      for (i = 0; i < n; i++)
+        {
+          gcry_err_code_t ec = mac_write (hds[i], bufs[i], buflens[i]);
+          if (r_results)
+            r_results[i] = gpg_error (ec);
+          if (ec && !rc)
+            rc = ec;
+        }
+      return rc;
+    }
+  sub_hds = (gcry_mac_hd_t *)(sorted + n);
+  sub_bufs = (const unsigned char **)(sub_hds + n);
+  sub_lens = (size_t *)(sub_bufs + n);
+  sub_idx = sub_lens + n;
+  rcs = (gcry_err_code_t *)(sub_idx + n);
+  sub_rcs = rcs + n;
+  todo = (unsigned char *)(sub_rcs + n);
+
+  /* The buffers for one handle depend on each other; process everything
+     in order if a handle is used more than once.  */
+  memcpy (sorted, hds, n * sizeof *sorted);
+  qsort (sorted, n, sizeof *sorted, compare_handles);
+  for (distinct = 1, i = 1; i < n; i++)
+    if (sorted[i] == sorted[i-1])
+      distinct = 0;
+
+  for (i = 0; i < n; i++)
+    {
+      todo[i] = (distinct && hds[i]->spec->ops->write_batch
+                 && !(buflens[i] > 0 && !bufs[i]));
+      if (!todo[i])
+        rcs[i] = mac_write (hds[i], bufs[i], buflens[i]);
+    }
+
+  /* TODO[i] is cleared once buffer I has been processed.  */
+  for (i = 0; i < n; i++)
+    {
+      if (!todo[i])
+        continue;
+
+      spec = hds[i]->spec;
+      for (nsub = 0, j = i; j < n; j++)
+        if (todo[j] && hds[j]->spec == spec)
+          {
+            sub_hds[nsub] = hds[j];
+            sub_bufs[nsub] = bufs[j];
+            sub_lens[nsub] = buflens[j];
+            sub_idx[nsub++] = j;
+            todo[j] = 0;
+          }
+      rc = spec->ops->write_batch (sub_hds, sub_bufs, sub_lens, nsub,
+                                   sub_rcs);
+      for (j = 0; j < nsub; j++)
+        {
+          /* A failed write_batch has not touched any handle (for
+             example it could not allocate memory); fall back to
+             writing each buffer on its own.  */
+          if (rc)
+            sub_rcs[j] = mac_write (sub_hds[j], sub_bufs[j], sub_lens[j]);
+          rcs[sub_idx[j]] = sub_rcs[j];
+        }
+    }
+
+  rc = 0;
+  for (i = 0; i < n; i++)
+    {
+      if (r_results)
+        r_results[i] = gpg_error (rcs[i]);
+      if (rcs[i] && !rc)
+        rc = rcs[i];
+    }
+
+  xfree (sorted);
+  return rc;
+}
+
+
 gcry_err_code_t
 _gcry_mac_read (gcry_mac_hd_t hd, void *outbuf, size_t * outlen)
 {
@@ -111,6 +111,7 @@ struct gcry_md_context
     unsigned int finalized:1;
     unsigned int bugemu1:1;
     unsigned int hmac:1;
+    unsigned int keyed:1;       /* An HMAC key has been set.  */
   } flags;
   GcryDigestEntry *list;
 };
@@ -119,6 +120,9 @@ struct gcry_md_context
 #define CTX_MAGIC_NORMAL 0x11071961
 #define CTX_MAGIC_SECURE 0x16917011
 
+/* The largest digest length of the algorithms usable with HMAC.  */
+#define MD_HMAC_MAX_DIGEST_LEN 64
+
 static gcry_err_code_t md_enable (gcry_md_hd_t hd, int algo);
 static void md_close (gcry_md_hd_t a);
 static void md_write (gcry_md_hd_t a, const void *inbuf, size_t inlen);
@@ -646,32 +650,21 @@ md_final (gcry_md_hd_t a)
 
   for (r = a->ctx->list; r; r = r->next)
     {
-      byte *p;
+      /* The inner hash is kept on the stack; all digests usable with
+         HMAC fit into it.  */
+      byte hash[MD_HMAC_MAX_DIGEST_LEN];
       size_t dlen = r->spec->mdlen;
-      byte *hash;
-      gcry_err_code_t err;
 
       if (r->spec->read == NULL)
         continue;
 
-      p = r->spec->read (&r->context.c);
-
-      if (a->ctx->flags.secure)
-        hash = xtrymalloc_secure (dlen);
-      else
-        hash = xtrymalloc (dlen);
-      if (!hash)
-        {
-          err = gpg_err_code_from_errno (errno);
-          _gcry_fatal_error (err, NULL);
-        }
-
-      memcpy (hash, p, dlen);
+      gcry_assert (dlen <= sizeof hash);
+      memcpy (hash, r->spec->read (&r->context.c), dlen);
       memcpy (r->context.c, r->context.c + r->spec->contextsize * 2,
               r->spec->contextsize);
       (*r->spec->write) (&r->context.c, hash, dlen);
       (*r->spec->final) (&r->context.c);
-      xfree (hash);
+      wipememory (hash, dlen);
     }
 }
 
@@ -799,12 +792,71 @@ _gcry_md_setkey (gcry_md_hd_t hd, const void *key, size_t keylen)
 
   rc = prepare_macpads (hd, key, keylen);
   if (!rc)
-    _gcry_md_reset (hd);
+    {
+      hd->ctx->flags.keyed = 1;
+      _gcry_md_reset (hd);
+    }
 
   return rc;
 }
 
 
+/* Load the HMAC key set in KEYHD into handle A and reset A.  KEYHD is
+   only read, so that a single keyed handle may be shared as
+   precomputed key by many handles, also from several threads.  */
+static gcry_err_code_t
+md_setkey_from (gcry_md_hd_t a, gcry_md_hd_t keyhd)
+{
+  GcryDigestEntry *r, *kr;
+  size_t csize;
+
+  if (!keyhd)
+    return GPG_ERR_INV_ARG;
+
+  if (!a->ctx->list)
+    return GPG_ERR_DIGEST_ALGO; /* Might happen if no algo is enabled.  */
+
+  if (!a->ctx->flags.hmac || !keyhd->ctx->flags.hmac)
+    return GPG_ERR_DIGEST_ALGO;
+
+  if (!keyhd->ctx->flags.keyed)
+    return GPG_ERR_MISSING_KEY;
+
+  /* Do not move key material out of secure memory.  */
+  if (keyhd->ctx->flags.secure && !a->ctx->flags.secure)
+    return GPG_ERR_INV_ARG;
+
+  /* Check all algorithms first so that A is not partly changed.  */
+  for (r = a->ctx->list; r; r = r->next)
+    {
+      for (kr = keyhd->ctx->list; kr; kr = kr->next)
+        if (kr->spec == r->spec)
+          break;
+      if (!kr)
+        return GPG_ERR_DIGEST_ALGO;
+    }
+
+  for (r = a->ctx->list; r; r = r->next)
+    {
+      for (kr = keyhd->ctx->list; kr->spec != r->spec; kr = kr->next)
+        ;
+      csize = r->spec->contextsize;
+      memcpy (r->context.c + csize, kr->context.c + csize, csize * 2);
+    }
+  a->ctx->flags.keyed = 1;
+
+  _gcry_md_reset (a);
+  return 0;
+}
+
+
+gcry_err_code_t
+_gcry_md_setkey_from (gcry_md_hd_t hd, gcry_md_hd_t keyhd)
+{
+  return md_setkey_from (hd, keyhd);
+}
+
+
 /* The new debug interface.  If SUFFIX is a string it creates an debug
    file for the context HD.  IF suffix is NULL, the file is closed and
    debugging is stopped.  */
@@ -870,11 +922,11 @@ _gcry_md_read (gcry_md_hd_t hd, int algo)
 
 
 /****************
- * If ALGO is null get the digest for the used algo (which should be
- * only one)
+ * Return the entry of the XOF algorithm ALGO.  If ALGO is null get the
+ * entry of the used algo (which should be only one)
  */
-static gcry_err_code_t
-md_extract(gcry_md_hd_t a, int algo, void *out, size_t outlen)
+static GcryDigestEntry *
+md_extract_entry (gcry_md_hd_t a, int algo)
 {
   GcryDigestEntry *r = a->ctx->list;
 
@@ -885,21 +937,30 @@ md_extract(gcry_md_hd_t a, int algo, void *out, size_t outlen)
 	{
 	  if (r->next)
 	    log_debug ("more than one algorithm in md_extract(0)\n");
-	  r->spec->extract (&r->context.c, out, outlen);
-	  return 0;
+	  return r;
 	}
     }
   else
     {
       for (r = a->ctx->list; r; r = r->next)
 	if (r->spec->algo == algo && r->spec->extract)
-	  {
-	    r->spec->extract (&r->context.c, out, outlen);
-	    return 0;
-	  }
+	  return r;
     }
 
-  return GPG_ERR_DIGEST_ALGO;
+  return NULL;
+}
+
+
+static gcry_err_code_t
+md_extract(gcry_md_hd_t a, int algo, void *out, size_t outlen)
+{
+  GcryDigestEntry *r = md_extract_entry (a, algo);
+
+  if (!r)
+    return GPG_ERR_DIGEST_ALGO;
+
+  r->spec->extract (&r->context.c, out, outlen);
+  return 0;
 }
 
 
@@ -915,6 +976,87 @@ _gcry_md_extract (gcry_md_hd_t hd, int algo, void *out, size_t outlen)
 }
 
 
+static int
+compare_handles (const void *a, const void *b)
+{
+  gcry_md_hd_t ha = *(const gcry_md_hd_t *)a;
+  gcry_md_hd_t hb = *(const gcry_md_hd_t *)b;
+
+  return ha < hb ? -1 : ha > hb;
+}
+
+
+/*
+ * Expand OUTLEN bytes of output of the XOF algorithm ALGO from each of
+ * the N handles HDS to OUTBUFS.  The handles are implicitly finalized.
+ * Several SHAKE handles are processed in parallel if the CPU supports
+ * it.
+ */
+gcry_err_code_t
+_gcry_md_extract_batch (gcry_md_hd_t *hds, int algo, void **outbufs,
+                        size_t outlen, size_t n)
+{
+  GcryDigestEntry *r;
+  gcry_md_spec_t *spec = NULL;
+  gcry_md_hd_t *sorted;
+  void **contexts;
+  gcry_err_code_t rc;
+  size_t i;
+  int parallel = 1;
+
+  if (!n)
+    return 0;
+  if (!hds || !outbufs)
+    return GPG_ERR_INV_ARG;
+
+  contexts = xtrymalloc (n * (sizeof *contexts + sizeof *sorted));
+  if (!contexts)
+    return gpg_err_code_from_syserror ();
+  sorted = (gcry_md_hd_t *)(contexts + n);
+
+  for (i = 0; i < n; i++)
+    {
+      r = md_extract_entry (hds[i], algo);
+      if (!r)
+        {
+          rc = GPG_ERR_DIGEST_ALGO;
+          goto leave;
+        }
+      if (spec && r->spec != spec)
+        parallel = 0;
+      spec = r->spec;
+      contexts[i] = &r->context.c;
+    }
+
+  /* The output of a handle used twice depends on the first use.  */
+  memcpy (sorted, hds, n * sizeof *sorted);
+  qsort (sorted, n, sizeof *sorted, compare_handles);
+  for (i = 1; i < n; i++)
+    if (sorted[i] == sorted[i-1])
+      parallel = 0;
+
+  for (i = 0; i < n; i++)
+    md_final (hds[i]);
+
+  rc = GPG_ERR_NOT_SUPPORTED;
+#ifdef USE_SHA3
+  if (parallel && (spec->algo == GCRY_MD_SHAKE128
+                   || spec->algo == GCRY_MD_SHAKE256))
+    rc = _gcry_shake_extract_batch (contexts, outbufs, outlen, n);
+#endif
+  if (rc == GPG_ERR_NOT_SUPPORTED)
+    {
+      for (i = 0; i < n; i++)
+        md_extract (hds[i], algo, outbufs[i], outlen);
+      rc = 0;
+    }
+
+ leave:
+  xfree (contexts);
+  return rc;
+}
+
+
 /*
  * Read out an intermediate digest.  Not yet functional.
  */
@@ -1052,6 +1194,80 @@ _gcry_md_hash_buffers (int algo, unsigned int flags, void *digest,
 }
 
 
+/* Shortcut function to hash the N independent messages BUFFERS[I] of
+   LENGTHS[I] bytes with algorithm ALGO.  The digest of message I is
+   stored at DIGESTS[I] which must have been provided by the caller
+   with an appropriate length.  For SHA-1, SHA-224, SHA-256 and SHA-3
+   several messages are hashed in parallel if the CPU supports it; the
+   other algorithms hash the messages one after the other.  */
+gpg_err_code_t
+_gcry_md_hash_buffer_batch (int algo, void **digests, const void **buffers,
+                            const size_t *lengths, size_t n)
+{
+  gcry_md_hd_t h;
+  gpg_err_code_t rc;
+  size_t dlen;
+  size_t i;
+
+  if (n && (!digests || !buffers || !lengths))
+    return GPG_ERR_INV_ARG;
+
+  rc = check_digest_algo (algo);
+  if (rc)
+    return rc;
+  dlen = md_digest_length (algo);
+  if (!dlen)
+    return GPG_ERR_DIGEST_ALGO;  /* Extendable-output functions.  */
+  if (!n)
+    return 0;
+
+  rc = GPG_ERR_NOT_SUPPORTED;
+  if (algo == GCRY_MD_SHA1)
+    rc = _gcry_sha1_hash_buffer_batch (digests, buffers, lengths, n);
+#ifdef USE_SHA256
+  else if (algo == GCRY_MD_SHA224)
+    rc = _gcry_sha224_hash_buffer_batch (digests, buffers, lengths, n);
+  else if (algo == GCRY_MD_SHA256)
+    rc = _gcry_sha256_hash_buffer_batch (digests, buffers, lengths, n);
+#endif
+#ifdef USE_SHA3
+  else if (algo == GCRY_MD_SHA3_224 || algo == GCRY_MD_SHA3_256
+           || algo == GCRY_MD_SHA3_384 || algo == GCRY_MD_SHA3_512)
+    rc = _gcry_sha3_hash_buffer_batch (algo, digests, buffers, lengths, n);
+#endif
+  if (rc != GPG_ERR_NOT_SUPPORTED)
+    return rc;
+
+  /* No parallel implementation; hash the messages one by one.  */
+  if (algo == GCRY_MD_MD5 && fips_mode ())
+    {
+      _gcry_inactivate_fips_mode ("MD5 used");
+      if (_gcry_enforced_fips_mode () )
+        {
+          /* We should never get to here because we do not register
+             MD5 in enforced fips mode.  */
+          _gcry_fips_noreturn ();
+        }
+    }
+
+  rc = md_open (&h, algo, 0);
+  if (rc)
+    return rc;
+
+  for (i = 0; i < n; i++)
+    {
+      if (i)
+        _gcry_md_reset (h);
+      md_write (h, buffers[i], lengths[i]);
+      md_final (h);
+      memcpy (digests[i], md_read (h, algo), dlen);
+    }
+  md_close (h);
+
+  return 0;
+}
+
+
 static int
 md_get_algo (gcry_md_hd_t a)
 {
@@ -163,5 +163,12 @@ void _gcry_poly1305_finish (poly1305_context_t * ctx,
 void _gcry_poly1305_update (poly1305_context_t * ctx, const byte * buf,
 			    size_t buflen);
 
+#ifdef POLY1305_USE_AVX2
+int _gcry_poly1305_use_avx2 (poly1305_context_t * ctx);
+
+unsigned int _gcry_poly1305_update_avx2 (poly1305_context_t * ctx,
+					 const byte * buf, size_t buflen);
+#endif
+
 
 #endif /* G10_POLY1305_INTERNAL_H */
@@ -380,12 +380,16 @@ poly1305_init (poly1305_context_t * ctx, const poly1305_key_t * key)
 }
 
 
-void
-_gcry_poly1305_update (poly1305_context_t * ctx, const byte * m, size_t bytes)
+/* Feed BYTES bytes at M into CTX using BLOCKS, which processes
+   multiples of BLOCK_SIZE bytes.  Returns the stack depth to burn.  */
+static inline unsigned int
+poly1305_do_update (poly1305_context_t * ctx, const byte * m, size_t bytes,
+		    unsigned int (*blocks) (void *ctx, const byte * m,
+					    size_t bytes) OPS_FUNC_ABI,
+		    size_t block_size)
 {
   void *state = poly1305_get_state (ctx);
   unsigned int burn = 0;
-  size_t block_size = ctx->ops->block_size;
 
   /* handle leftover */
   if (ctx->leftover)
@@ -398,8 +402,8 @@ _gcry_poly1305_update (poly1305_context_t * ctx, const byte * m, size_t bytes)
       m += want;
       ctx->leftover += want;
       if (ctx->leftover < block_size)
-	return;
-      burn = ctx->ops->blocks (state, ctx->buffer, block_size);
+	return 0;
+      burn = blocks (state, ctx->buffer, block_size);
       ctx->leftover = 0;
     }
 
@@ -407,7 +411,7 @@ _gcry_poly1305_update (poly1305_context_t * ctx, const byte * m, size_t bytes)
   if (bytes >= block_size)
     {
       size_t want = (bytes & ~(block_size - 1));
-      burn = ctx->ops->blocks (state, m, want);
+      burn = blocks (state, m, want);
       m += want;
       bytes -= want;
     }
@@ -419,11 +423,44 @@ _gcry_poly1305_update (poly1305_context_t * ctx, const byte * m, size_t bytes)
       ctx->leftover += bytes;
     }
 
+  return burn;
+}
+
+
+void
+_gcry_poly1305_update (poly1305_context_t * ctx, const byte * m, size_t bytes)
+{
+  unsigned int burn;
+
+  burn = poly1305_do_update (ctx, m, bytes, ctx->ops->blocks,
+			     ctx->ops->block_size);
   if (burn)
     _gcry_burn_stack (burn);
 }
 
 
+#ifdef POLY1305_USE_AVX2
+/* Return true if CTX uses the AVX2 code.  */
+int
+_gcry_poly1305_use_avx2 (poly1305_context_t * ctx)
+{
+  return ctx->ops == &poly1305_amd64_avx2_ops;
+}
+
+
+/* Same as _gcry_poly1305_update for a CTX using the AVX2 code but
+   instead of burning the stack return the stack depth to burn.  This
+   allows the caller to burn the stack once after several calls.  */
+unsigned int
+_gcry_poly1305_update_avx2 (poly1305_context_t * ctx, const byte * m,
+			    size_t bytes)
+{
+  return poly1305_do_update (ctx, m, bytes, _gcry_poly1305_amd64_avx2_blocks,
+			     POLY1305_AVX2_BLOCKSIZE);
+}
+#endif /*POLY1305_USE_AVX2*/
+
+
 void
 _gcry_poly1305_finish (poly1305_context_t * ctx, byte mac[POLY1305_TAGLEN])
 {
@@ -466,6 +466,126 @@ _gcry_pk_verify (gcry_sexp_t s_sig, gcry_sexp_t s_hash, gcry_sexp_t s_pkey)
 }
 
 
+/*
+   Verify N signatures at once.
+
+   The arguments are arrays of N items as used with _gcry_pk_verify.
+   The result for each signature is stored at R_RESULTS which may be
+   NULL.  Algorithms providing a batch function verify all their
+   signatures together; the others are verified one by one.  If the
+   batch function fails, for example due to a lack of memory, the
+   signatures are verified one by one so that a result is always
+   stored for each of them.  Returns GPG_ERR_BAD_SIGNATURE if any of
+   the signatures did not verify.  */
+gcry_err_code_t
+_gcry_pk_verify_batch (gcry_sexp_t *s_sigs, gcry_sexp_t *s_hashes,
+                       gcry_sexp_t *s_pkeys, size_t n,
+                       gcry_error_t *r_results)
+{
+  gcry_err_code_t rc, rc2;
+  gcry_pk_spec_t *spec;
+  gcry_pk_spec_t **specs = NULL;
+  gcry_sexp_t *keyparms = NULL;
+  gcry_err_code_t *rcs = NULL;
+  gcry_sexp_t *sub_sigs = NULL;
+  gcry_sexp_t *sub_hashes = NULL;
+  gcry_sexp_t *sub_keyparms = NULL;
+  gcry_err_code_t *sub_rcs = NULL;
+  size_t *sub_idx = NULL;
+  size_t i, j, nsub;
+
+  if (!n)
+    return 0;
+
+  specs = xtrycalloc (n, sizeof *specs);
+  keyparms = xtrycalloc (n, sizeof *keyparms);
+  rcs = xtrycalloc (n, sizeof *rcs);
+  sub_sigs = xtrycalloc (n, sizeof *sub_sigs);
+  sub_hashes = xtrycalloc (n, sizeof *sub_hashes);
+  sub_keyparms = xtrycalloc (n, sizeof *sub_keyparms);
+  sub_rcs = xtrycalloc (n, sizeof *sub_rcs);
+  sub_idx = xtrycalloc (n, sizeof *sub_idx);
+  if (!specs || !keyparms || !rcs || !sub_sigs || !sub_hashes
+      || !sub_keyparms || !sub_rcs || !sub_idx)
+    {
+      /* Without the work arrays verify the signatures one by one.  */
+      rc = 0;
+      for (i = 0; i < n; i++)
+        {
+          rc2 = _gcry_pk_verify (s_sigs[i], s_hashes[i], s_pkeys[i]);
+          if (r_results)
+            r_results[i] = gpg_error (rc2);
+          if (rc2)
+            rc = GPG_ERR_BAD_SIGNATURE;
+        }
+      goto leave;
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      rcs[i] = spec_from_sexp (s_pkeys[i], 0, &specs[i], &keyparms[i]);
+      if (!rcs[i] && !specs[i]->verify)
+        rcs[i] = GPG_ERR_NOT_IMPLEMENTED;
+      if (rcs[i])
+        specs[i] = NULL;
+    }
+
+  /* SPECS[i] is set to NULL once signature I has been processed.  */
+  for (i = 0; i < n; i++)
+    {
+      spec = specs[i];
+      if (!spec)
+        continue;
+      if (!spec->verify_batch)
+        {
+          rcs[i] = spec->verify (s_sigs[i], s_hashes[i], keyparms[i]);
+          specs[i] = NULL;
+          continue;
+        }
+
+      for (nsub = 0, j = i; j < n; j++)
+        if (specs[j] == spec)
+          {
+            sub_sigs[nsub] = s_sigs[j];
+            sub_hashes[nsub] = s_hashes[j];
+            sub_keyparms[nsub] = keyparms[j];
+            sub_idx[nsub++] = j;
+            specs[j] = NULL;
+          }
+      if (spec->verify_batch (sub_sigs, sub_hashes, sub_keyparms,
+                              nsub, sub_rcs))
+        for (j = 0; j < nsub; j++)
+          sub_rcs[j] = spec->verify (sub_sigs[j], sub_hashes[j],
+                                     sub_keyparms[j]);
+      for (j = 0; j < nsub; j++)
+        rcs[sub_idx[j]] = sub_rcs[j];
+    }
+
+  rc = 0;
+  for (i = 0; i < n; i++)
+    {
+      if (r_results)
+        r_results[i] = gpg_error (rcs[i]);
+      if (rcs[i])
+        rc = GPG_ERR_BAD_SIGNATURE;
+    }
+
+ leave:
+  if (keyparms)
+    for (i = 0; i < n; i++)
+      sexp_release (keyparms[i]);
+  xfree (sub_idx);
+  xfree (sub_rcs);
+  xfree (sub_keyparms);
+  xfree (sub_hashes);
+  xfree (sub_sigs);
+  xfree (rcs);
+  xfree (keyparms);
+  xfree (specs);
+  return rc;
+}
+
+
 /*
    Test a key.
 
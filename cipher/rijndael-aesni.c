@@ -90,6 +90,21 @@ typedef struct u128_s { u32 a, b, c, d; } u128_t;
    } while (0)
 #endif
 
+/* On AMD64 the registers XMM8 to XMM15 allow processing eight blocks
+   in parallel.  They are callee-saved on WIN64, thus the eight block
+   code is not used there.  */
+#if defined(__x86_64__) && !defined(__WIN64__)
+# define USE_AESNI_VEC8 1
+# define aesni_cleanup_8_11()                                           \
+   do { asm volatile ("pxor %%xmm8, %%xmm8\n\t"                         \
+                      "pxor %%xmm9, %%xmm9\n\t"                         \
+                      "pxor %%xmm10, %%xmm10\n\t"                       \
+                      "pxor %%xmm11, %%xmm11\n":: );                    \
+   } while (0)
+#else
+# define aesni_cleanup_8_11() do { } while (0)
+#endif
+
 void
 _gcry_aes_aesni_do_setkey (RIJNDAEL_context *ctx, const byte *key)
 {
@@ -701,6 +716,422 @@ do_aesni_dec_vec4 (const RIJNDAEL_context *ctx)
 }
 
 
+#ifdef USE_AESNI_VEC8
+#define aesenc_xmm0_xmm1      ".byte 0x66, 0x0f, 0x38, 0xdc, 0xc8\n\t"
+#define aesenc_xmm0_xmm2      ".byte 0x66, 0x0f, 0x38, 0xdc, 0xd0\n\t"
+#define aesenc_xmm0_xmm3      ".byte 0x66, 0x0f, 0x38, 0xdc, 0xd8\n\t"
+#define aesenc_xmm0_xmm4      ".byte 0x66, 0x0f, 0x38, 0xdc, 0xe0\n\t"
+#define aesenc_xmm0_xmm8      ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xc0\n\t"
+#define aesenc_xmm0_xmm9      ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xc8\n\t"
+#define aesenc_xmm0_xmm10     ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xd0\n\t"
+#define aesenc_xmm0_xmm11     ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xd8\n\t"
+#define aesenclast_xmm0_xmm1  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xc8\n\t"
+#define aesenclast_xmm0_xmm2  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xd0\n\t"
+#define aesenclast_xmm0_xmm3  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xd8\n\t"
+#define aesenclast_xmm0_xmm4  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xe0\n\t"
+#define aesenclast_xmm0_xmm8  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xc0\n\t"
+#define aesenclast_xmm0_xmm9  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xc8\n\t"
+#define aesenclast_xmm0_xmm10 ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xd0\n\t"
+#define aesenclast_xmm0_xmm11 ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xd8\n\t"
+#define aesenc_round(key_off)                                   \
+                "movdqa " key_off "(%[key]), %%xmm0\n\t"        \
+                aesenc_xmm0_xmm1                                \
+                aesenc_xmm0_xmm2                                \
+                aesenc_xmm0_xmm3                                \
+                aesenc_xmm0_xmm4                                \
+                aesenc_xmm0_xmm8                                \
+                aesenc_xmm0_xmm9                                \
+                aesenc_xmm0_xmm10                               \
+                aesenc_xmm0_xmm11
+
+/* Encrypt eight blocks using the Intel AES-NI instructions.  Blocks are
+ * input and output through SSE registers xmm1 to xmm4 and xmm8 to
+ * xmm11.  */
+static inline void
+do_aesni_enc_vec8 (const RIJNDAEL_context *ctx)
+{
+  asm volatile ("movdqa (%[key]), %%xmm0\n\t"
+                "pxor   %%xmm0, %%xmm1\n\t"     /* xmm1 ^= key[0] */
+                "pxor   %%xmm0, %%xmm2\n\t"     /* xmm2 ^= key[0] */
+                "pxor   %%xmm0, %%xmm3\n\t"     /* xmm3 ^= key[0] */
+                "pxor   %%xmm0, %%xmm4\n\t"     /* xmm4 ^= key[0] */
+                "pxor   %%xmm0, %%xmm8\n\t"     /* xmm8 ^= key[0] */
+                "pxor   %%xmm0, %%xmm9\n\t"     /* xmm9 ^= key[0] */
+                "pxor   %%xmm0, %%xmm10\n\t"    /* xmm10 ^= key[0] */
+                "pxor   %%xmm0, %%xmm11\n\t"    /* xmm11 ^= key[0] */
+                aesenc_round("0x10")
+                aesenc_round("0x20")
+                aesenc_round("0x30")
+                aesenc_round("0x40")
+                aesenc_round("0x50")
+                aesenc_round("0x60")
+                aesenc_round("0x70")
+                aesenc_round("0x80")
+                aesenc_round("0x90")
+                "movdqa 0xa0(%[key]), %%xmm0\n\t"
+                "cmpl $10, %[rounds]\n\t"
+                "jz .Lenclast%=\n\t"
+                aesenc_round("0xa0")
+                aesenc_round("0xb0")
+                "movdqa 0xc0(%[key]), %%xmm0\n\t"
+                "cmpl $12, %[rounds]\n\t"
+                "jz .Lenclast%=\n\t"
+                aesenc_round("0xc0")
+                aesenc_round("0xd0")
+                "movdqa 0xe0(%[key]), %%xmm0\n"
+
+                ".Lenclast%=:\n\t"
+                aesenclast_xmm0_xmm1
+                aesenclast_xmm0_xmm2
+                aesenclast_xmm0_xmm3
+                aesenclast_xmm0_xmm4
+                aesenclast_xmm0_xmm8
+                aesenclast_xmm0_xmm9
+                aesenclast_xmm0_xmm10
+                aesenclast_xmm0_xmm11
+                : /* no output */
+                : [key] "r" (ctx->keyschenc),
+                  [rounds] "r" (ctx->rounds)
+                : "cc", "memory");
+}
+
+
+#ifdef GCM_USE_INTEL_PCLMUL
+/* Multiply one GHASH input block with a power of H and add the 256-bit
+ * product in Karatsuba form to the accumulators xmm12 (low), xmm13
+ * (high) and xmm14 (middle).  H_MEM addresses the little-endian power of
+ * H and MID_OFF the pre-computed H_low^H_high for it in the table at
+ * HTAB.  XMM0, XMM6 and XMM15 are clobbered.  */
+#define ghash_step(idx, h_mem, mid_off)                                 \
+                "movdqu " #idx "*16(%[hbuf]), %%xmm6\n\t"               \
+                "pshufb %[be_mask], %%xmm6\n\t" /* be => le */          \
+                ghash_step_add_hash_##idx                               \
+                "pshufd $78, %%xmm6, %%xmm15\n\t"                       \
+                "pxor %%xmm6, %%xmm15\n\t"                              \
+                "movq " mid_off "(%[htab]), %%xmm0\n\t"                 \
+                "pclmulqdq $0, %%xmm0, %%xmm15\n\t"                     \
+                "pxor %%xmm15, %%xmm14\n\t"                             \
+                "movdqu " h_mem ", %%xmm0\n\t"                          \
+                "movdqa %%xmm6, %%xmm15\n\t"                            \
+                "pclmulqdq $0, %%xmm0, %%xmm15\n\t"                     \
+                "pclmulqdq $17, %%xmm0, %%xmm6\n\t"                     \
+                "pxor %%xmm15, %%xmm12\n\t"                             \
+                "pxor %%xmm6, %%xmm13\n\t"
+/* The current hash value in xmm7 is added to the first block.  */
+#define ghash_step_add_hash_0 "pxor %%xmm7, %%xmm6\n\t"
+#define ghash_step_add_hash_1
+#define ghash_step_add_hash_2
+#define ghash_step_add_hash_3
+#define ghash_step_add_hash_4
+#define ghash_step_add_hash_5
+#define ghash_step_add_hash_6
+#define ghash_step_add_hash_7
+#define ghash_init                                                      \
+                "pxor %%xmm12, %%xmm12\n\t"                             \
+                "pxor %%xmm13, %%xmm13\n\t"                             \
+                "pxor %%xmm14, %%xmm14\n\t"
+#define ghash_step_0 ghash_step(0, "6*16(%[htab])", "0x70+7*8") /* H⁸ */
+#define ghash_step_1 ghash_step(1, "5*16(%[htab])", "0x70+6*8") /* H⁷ */
+#define ghash_step_2 ghash_step(2, "4*16(%[htab])", "0x70+5*8") /* H⁶ */
+#define ghash_step_3 ghash_step(3, "3*16(%[htab])", "0x70+4*8") /* H⁵ */
+#define ghash_step_4 ghash_step(4, "2*16(%[htab])", "0x70+3*8") /* H⁴ */
+#define ghash_step_5 ghash_step(5, "1*16(%[htab])", "0x70+2*8") /* H³ */
+#define ghash_step_6 ghash_step(6, "0*16(%[htab])", "0x70+1*8") /* H² */
+#define ghash_step_7 ghash_step(7, "(%[h1])",       "0x70+0*8") /* H¹ */
+
+/* Encrypt eight blocks like do_aesni_enc_vec8 and, interleaved with the
+ * AES rounds, feed the eight blocks at HBUF into GHASH.  The unreduced
+ * result is left in xmm12 to xmm14 for gcm_reduce_ghash8.  */
+static inline void
+do_aesni_enc_vec8_ghash8 (const RIJNDAEL_context *ctx, gcry_cipher_hd_t c,
+                          const unsigned char *hbuf,
+                          const unsigned char *be_mask)
+{
+  asm volatile ("movdqa (%[key]), %%xmm0\n\t"
+                "pxor   %%xmm0, %%xmm1\n\t"     /* xmm1 ^= key[0] */
+                "pxor   %%xmm0, %%xmm2\n\t"     /* xmm2 ^= key[0] */
+                "pxor   %%xmm0, %%xmm3\n\t"     /* xmm3 ^= key[0] */
+                "pxor   %%xmm0, %%xmm4\n\t"     /* xmm4 ^= key[0] */
+                "pxor   %%xmm0, %%xmm8\n\t"     /* xmm8 ^= key[0] */
+                "pxor   %%xmm0, %%xmm9\n\t"     /* xmm9 ^= key[0] */
+                "pxor   %%xmm0, %%xmm10\n\t"    /* xmm10 ^= key[0] */
+                "pxor   %%xmm0, %%xmm11\n\t"    /* xmm11 ^= key[0] */
+                ghash_init
+                aesenc_round("0x10")
+                ghash_step_0
+                aesenc_round("0x20")
+                ghash_step_1
+                aesenc_round("0x30")
+                ghash_step_2
+                aesenc_round("0x40")
+                ghash_step_3
+                aesenc_round("0x50")
+                ghash_step_4
+                aesenc_round("0x60")
+                ghash_step_5
+                aesenc_round("0x70")
+                ghash_step_6
+                aesenc_round("0x80")
+                ghash_step_7
+                aesenc_round("0x90")
+                "movdqa 0xa0(%[key]), %%xmm0\n\t"
+                "cmpl $10, %[rounds]\n\t"
+                "jz .Lenclast%=\n\t"
+                aesenc_round("0xa0")
+                aesenc_round("0xb0")
+                "movdqa 0xc0(%[key]), %%xmm0\n\t"
+                "cmpl $12, %[rounds]\n\t"
+                "jz .Lenclast%=\n\t"
+                aesenc_round("0xc0")
+                aesenc_round("0xd0")
+                "movdqa 0xe0(%[key]), %%xmm0\n"
+
+                ".Lenclast%=:\n\t"
+                aesenclast_xmm0_xmm1
+                aesenclast_xmm0_xmm2
+                aesenclast_xmm0_xmm3
+                aesenclast_xmm0_xmm4
+                aesenclast_xmm0_xmm8
+                aesenclast_xmm0_xmm9
+                aesenclast_xmm0_xmm10
+                aesenclast_xmm0_xmm11
+                : /* no output */
+                : [key] "r" (ctx->keyschenc),
+                  [rounds] "r" (ctx->rounds),
+                  [hbuf] "r" (hbuf),
+                  [htab] "r" (c->u_mode.gcm.gcm_table),
+                  [h1] "r" (c->u_mode.gcm.u_ghash_key.key),
+                  [be_mask] "m" (*be_mask)
+                : "cc", "memory");
+}
+
+
+/* Feed the eight blocks at HBUF into GHASH without encrypting anything.
+ * The unreduced result is left in xmm12 to xmm14.  */
+static inline void
+do_ghash8 (gcry_cipher_hd_t c, const unsigned char *hbuf,
+           const unsigned char *be_mask)
+{
+  asm volatile (ghash_init
+                ghash_step_0
+                ghash_step_1
+                ghash_step_2
+                ghash_step_3
+                ghash_step_4
+                ghash_step_5
+                ghash_step_6
+                ghash_step_7
+                : /* no output */
+                : [hbuf] "r" (hbuf),
+                  [htab] "r" (c->u_mode.gcm.gcm_table),
+                  [h1] "r" (c->u_mode.gcm.u_ghash_key.key),
+                  [be_mask] "m" (*be_mask)
+                : "memory");
+}
+
+#undef ghash_step
+#undef ghash_step_add_hash_0
+#undef ghash_step_add_hash_1
+#undef ghash_step_add_hash_2
+#undef ghash_step_add_hash_3
+#undef ghash_step_add_hash_4
+#undef ghash_step_add_hash_5
+#undef ghash_step_add_hash_6
+#undef ghash_step_add_hash_7
+#undef ghash_init
+#undef ghash_step_0
+#undef ghash_step_1
+#undef ghash_step_2
+#undef ghash_step_3
+#undef ghash_step_4
+#undef ghash_step_5
+#undef ghash_step_6
+#undef ghash_step_7
+
+
+/* Reduce the sum of products left in xmm12 to xmm14 by
+ * do_aesni_enc_vec8_ghash8 or do_ghash8 and store the new hash value
+ * into xmm7.  Uses the same reduction as gfmul_pclmul_aggr4 in
+ * cipher-gcm-intel-pclmul.c.  XMM1 to XMM4, XMM6, XMM8 and XMM9 are
+ * clobbered.  */
+static inline void
+gcm_reduce_ghash8 (void)
+{
+  asm volatile ("movdqa %%xmm12, %%xmm3\n\t"
+                "movdqa %%xmm13, %%xmm6\n\t"
+                "pxor %%xmm12, %%xmm14\n\t"
+                "pxor %%xmm13, %%xmm14\n\t" /* xmm14 holds a0*b1+a1*b0 */
+                "movdqa %%xmm14, %%xmm4\n\t"
+                "psrldq $8, %%xmm14\n\t"
+                "pslldq $8, %%xmm4\n\t"
+                "pxor %%xmm4, %%xmm3\n\t"
+                "pxor %%xmm14, %%xmm6\n\t" /* <xmm6:xmm3> holds the result
+                                              of the carry-less
+                                              multiplication */
+
+                /* shift the result by one bit position to the left cope for
+                   the fact that bits are reversed */
+                "movdqa %%xmm3, %%xmm4\n\t"
+                "movdqa %%xmm6, %%xmm8\n\t"
+                "pslld $1, %%xmm3\n\t"
+                "pslld $1, %%xmm6\n\t"
+                "psrld $31, %%xmm4\n\t"
+                "psrld $31, %%xmm8\n\t"
+                "movdqa %%xmm4, %%xmm1\n\t"
+                "pslldq $4, %%xmm8\n\t"
+                "pslldq $4, %%xmm4\n\t"
+                "psrldq $12, %%xmm1\n\t"
+                "por %%xmm4, %%xmm3\n\t"
+                "por %%xmm8, %%xmm6\n\t"
+                "por %%xmm6, %%xmm1\n\t"
+
+                /* first phase of the reduction */
+                "movdqa %%xmm3, %%xmm6\n\t"
+                "movdqa %%xmm3, %%xmm9\n\t"
+                "pslld $31, %%xmm6\n\t"  /* packed right shifting << 31 */
+                "movdqa %%xmm3, %%xmm8\n\t"
+                "pslld $30, %%xmm9\n\t"  /* packed right shifting shift << 30 */
+                "pslld $25, %%xmm8\n\t"  /* packed right shifting shift << 25 */
+                "pxor %%xmm9, %%xmm6\n\t" /* xor the shifted versions */
+                "pxor %%xmm8, %%xmm6\n\t"
+                "movdqa %%xmm6, %%xmm9\n\t"
+                "pslldq $12, %%xmm6\n\t"
+                "psrldq $4, %%xmm9\n\t"
+                "pxor %%xmm6, %%xmm3\n\t" /* first phase of the reduction
+                                             complete */
+
+                /* second phase of the reduction */
+                "movdqa %%xmm3, %%xmm2\n\t"
+                "movdqa %%xmm3, %%xmm4\n\t"
+                "psrld $1, %%xmm2\n\t"    /* packed left shifting >> 1 */
+                "movdqa %%xmm3, %%xmm8\n\t"
+                "psrld $2, %%xmm4\n\t"    /* packed left shifting >> 2 */
+                "psrld $7, %%xmm8\n\t"    /* packed left shifting >> 7 */
+                "pxor %%xmm4, %%xmm2\n\t" /* xor the shifted versions */
+                "pxor %%xmm8, %%xmm2\n\t"
+                "pxor %%xmm9, %%xmm2\n\t"
+                "pxor %%xmm2, %%xmm3\n\t"
+                "pxor %%xmm3, %%xmm1\n\t"
+                "movdqa %%xmm1, %%xmm7\n\t" /* the result is in xmm7 */
+                ::: "cc" );
+}
+#endif /*GCM_USE_INTEL_PCLMUL*/
+
+#undef aesenc_round
+#undef aesenc_xmm0_xmm1
+#undef aesenc_xmm0_xmm2
+#undef aesenc_xmm0_xmm3
+#undef aesenc_xmm0_xmm4
+#undef aesenc_xmm0_xmm8
+#undef aesenc_xmm0_xmm9
+#undef aesenc_xmm0_xmm10
+#undef aesenc_xmm0_xmm11
+#undef aesenclast_xmm0_xmm1
+#undef aesenclast_xmm0_xmm2
+#undef aesenclast_xmm0_xmm3
+#undef aesenclast_xmm0_xmm4
+#undef aesenclast_xmm0_xmm8
+#undef aesenclast_xmm0_xmm9
+#undef aesenclast_xmm0_xmm10
+#undef aesenclast_xmm0_xmm11
+
+
+/* Decrypt eight blocks using the Intel AES-NI instructions.  Blocks are
+ * input and output through SSE registers xmm1 to xmm4 and xmm8 to
+ * xmm11.  */
+static inline void
+do_aesni_dec_vec8 (const RIJNDAEL_context *ctx)
+{
+#define aesdec_xmm0_xmm1      ".byte 0x66, 0x0f, 0x38, 0xde, 0xc8\n\t"
+#define aesdec_xmm0_xmm2      ".byte 0x66, 0x0f, 0x38, 0xde, 0xd0\n\t"
+#define aesdec_xmm0_xmm3      ".byte 0x66, 0x0f, 0x38, 0xde, 0xd8\n\t"
+#define aesdec_xmm0_xmm4      ".byte 0x66, 0x0f, 0x38, 0xde, 0xe0\n\t"
+#define aesdec_xmm0_xmm8      ".byte 0x66, 0x44, 0x0f, 0x38, 0xde, 0xc0\n\t"
+#define aesdec_xmm0_xmm9      ".byte 0x66, 0x44, 0x0f, 0x38, 0xde, 0xc8\n\t"
+#define aesdec_xmm0_xmm10     ".byte 0x66, 0x44, 0x0f, 0x38, 0xde, 0xd0\n\t"
+#define aesdec_xmm0_xmm11     ".byte 0x66, 0x44, 0x0f, 0x38, 0xde, 0xd8\n\t"
+#define aesdeclast_xmm0_xmm1  ".byte 0x66, 0x0f, 0x38, 0xdf, 0xc8\n\t"
+#define aesdeclast_xmm0_xmm2  ".byte 0x66, 0x0f, 0x38, 0xdf, 0xd0\n\t"
+#define aesdeclast_xmm0_xmm3  ".byte 0x66, 0x0f, 0x38, 0xdf, 0xd8\n\t"
+#define aesdeclast_xmm0_xmm4  ".byte 0x66, 0x0f, 0x38, 0xdf, 0xe0\n\t"
+#define aesdeclast_xmm0_xmm8  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdf, 0xc0\n\t"
+#define aesdeclast_xmm0_xmm9  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdf, 0xc8\n\t"
+#define aesdeclast_xmm0_xmm10 ".byte 0x66, 0x44, 0x0f, 0x38, 0xdf, 0xd0\n\t"
+#define aesdeclast_xmm0_xmm11 ".byte 0x66, 0x44, 0x0f, 0x38, 0xdf, 0xd8\n\t"
+#define aesdec_round(key_off)                                   \
+                "movdqa " key_off "(%[key]), %%xmm0\n\t"        \
+                aesdec_xmm0_xmm1                                \
+                aesdec_xmm0_xmm2                                \
+                aesdec_xmm0_xmm3                                \
+                aesdec_xmm0_xmm4                                \
+                aesdec_xmm0_xmm8                                \
+                aesdec_xmm0_xmm9                                \
+                aesdec_xmm0_xmm10                               \
+                aesdec_xmm0_xmm11
+  asm volatile ("movdqa (%[key]), %%xmm0\n\t"
+                "pxor   %%xmm0, %%xmm1\n\t"     /* xmm1 ^= key[0] */
+                "pxor   %%xmm0, %%xmm2\n\t"     /* xmm2 ^= key[0] */
+                "pxor   %%xmm0, %%xmm3\n\t"     /* xmm3 ^= key[0] */
+                "pxor   %%xmm0, %%xmm4\n\t"     /* xmm4 ^= key[0] */
+                "pxor   %%xmm0, %%xmm8\n\t"     /* xmm8 ^= key[0] */
+                "pxor   %%xmm0, %%xmm9\n\t"     /* xmm9 ^= key[0] */
+                "pxor   %%xmm0, %%xmm10\n\t"    /* xmm10 ^= key[0] */
+                "pxor   %%xmm0, %%xmm11\n\t"    /* xmm11 ^= key[0] */
+                aesdec_round("0x10")
+                aesdec_round("0x20")
+                aesdec_round("0x30")
+                aesdec_round("0x40")
+                aesdec_round("0x50")
+                aesdec_round("0x60")
+                aesdec_round("0x70")
+                aesdec_round("0x80")
+                aesdec_round("0x90")
+                "movdqa 0xa0(%[key]), %%xmm0\n\t"
+                "cmpl $10, %[rounds]\n\t"
+                "jz .Ldeclast%=\n\t"
+                aesdec_round("0xa0")
+                aesdec_round("0xb0")
+                "movdqa 0xc0(%[key]), %%xmm0\n\t"
+                "cmpl $12, %[rounds]\n\t"
+                "jz .Ldeclast%=\n\t"
+                aesdec_round("0xc0")
+                aesdec_round("0xd0")
+                "movdqa 0xe0(%[key]), %%xmm0\n"
+
+                ".Ldeclast%=:\n\t"
+                aesdeclast_xmm0_xmm1
+                aesdeclast_xmm0_xmm2
+                aesdeclast_xmm0_xmm3
+                aesdeclast_xmm0_xmm4
+                aesdeclast_xmm0_xmm8
+                aesdeclast_xmm0_xmm9
+                aesdeclast_xmm0_xmm10
+                aesdeclast_xmm0_xmm11
+                : /* no output */
+                : [key] "r" (ctx->keyschdec),
+                  [rounds] "r" (ctx->rounds)
+                : "cc", "memory");
+#undef aesdec_round
+#undef aesdec_xmm0_xmm1
+#undef aesdec_xmm0_xmm2
+#undef aesdec_xmm0_xmm3
+#undef aesdec_xmm0_xmm4
+#undef aesdec_xmm0_xmm8
+#undef aesdec_xmm0_xmm9
+#undef aesdec_xmm0_xmm10
+#undef aesdec_xmm0_xmm11
+#undef aesdeclast_xmm0_xmm1
+#undef aesdeclast_xmm0_xmm2
+#undef aesdeclast_xmm0_xmm3
+#undef aesdeclast_xmm0_xmm4
+#undef aesdeclast_xmm0_xmm8
+#undef aesdeclast_xmm0_xmm9
+#undef aesdeclast_xmm0_xmm10
+#undef aesdeclast_xmm0_xmm11
+}
+#endif /*USE_AESNI_VEC8*/
+
+
 /* Perform a CTR encryption round using the counter CTR and the input
    block A.  Write the result to the output block B and update CTR.
    CTR needs to be a 16 byte aligned little-endian value.  */
@@ -1001,6 +1432,143 @@ do_aesni_ctr_4 (const RIJNDAEL_context *ctx,
 }
 
 
+#ifdef USE_AESNI_VEC8
+/* Load the eight counter blocks CTR+0 to CTR+7 into xmm1 to xmm4 and
+   xmm8 to xmm11, where CTR is taken from xmm5.  The counter in xmm5 is
+   advanced by eight and also stored to CTR.  */
+static inline void
+do_aesni_ctr_8_prepare (unsigned char *ctr)
+{
+  static const byte bige_addb_const[8][16] __attribute__ ((aligned (16))) =
+    {
+      { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+      { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2 },
+      { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3 },
+      { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4 },
+      { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5 },
+      { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6 },
+      { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 7 },
+      { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 8 }
+    };
+
+  /* Register usage:
+      xmm1-xmm4, xmm8-xmm11  CTR-0 to CTR-7
+      xmm5  copy of *ctr
+   */
+
+  asm volatile ("movdqa %%xmm5, %%xmm1\n\t"     /* xmm1 := CTR (xmm5) */
+                "movdqa %[addb_1], %%xmm2\n\t"  /* xmm2 := be(1) */
+                "movdqa %[addb_2], %%xmm3\n\t"  /* xmm3 := be(2) */
+                "movdqa %[addb_3], %%xmm4\n\t"  /* xmm4 := be(3) */
+                "movdqa %[addb_4], %%xmm8\n\t"  /* xmm8 := be(4) */
+                "movdqa %[addb_5], %%xmm9\n\t"  /* xmm9 := be(5) */
+                "movdqa %[addb_6], %%xmm10\n\t" /* xmm10 := be(6) */
+                "movdqa %[addb_7], %%xmm11\n\t" /* xmm11 := be(7) */
+                "paddb  %%xmm1, %%xmm2\n\t"     /* xmm2 := be(1) + CTR */
+                "paddb  %%xmm1, %%xmm3\n\t"     /* xmm3 := be(2) + CTR */
+                "paddb  %%xmm1, %%xmm4\n\t"     /* xmm4 := be(3) + CTR */
+                "paddb  %%xmm1, %%xmm8\n\t"     /* xmm8 := be(4) + CTR */
+                "paddb  %%xmm1, %%xmm9\n\t"     /* xmm9 := be(5) + CTR */
+                "paddb  %%xmm1, %%xmm10\n\t"    /* xmm10 := be(6) + CTR */
+                "paddb  %%xmm1, %%xmm11\n\t"    /* xmm11 := be(7) + CTR */
+                "paddb  %[addb_8], %%xmm5\n\t"  /* xmm5 := be(8) + CTR */
+                "movdqa %%xmm5, (%[ctr])\n\t"   /* Update CTR (mem).  */
+                :
+                : [ctr] "r" (ctr),
+                  [addb_1] "m" (bige_addb_const[0][0]),
+                  [addb_2] "m" (bige_addb_const[1][0]),
+                  [addb_3] "m" (bige_addb_const[2][0]),
+                  [addb_4] "m" (bige_addb_const[3][0]),
+                  [addb_5] "m" (bige_addb_const[4][0]),
+                  [addb_6] "m" (bige_addb_const[5][0]),
+                  [addb_7] "m" (bige_addb_const[6][0]),
+                  [addb_8] "m" (bige_addb_const[7][0])
+                : "memory");
+}
+
+
+/* Same as do_aesni_ctr_8_prepare for the rare case that the least
+   significant byte of CTR overflows.  */
+static void
+do_aesni_ctr_8_prepare_carry (unsigned char *ctr)
+{
+  byte ctrs[8][BLOCKSIZE] __attribute__ ((aligned (16)));
+  int i, j;
+
+  for (i = 0; i < 8; i++)
+    {
+      memcpy (ctrs[i], ctr, BLOCKSIZE);
+      for (j = BLOCKSIZE; j > 0; j--)
+        if (++ctr[j - 1])
+          break;
+    }
+
+  asm volatile ("movdqa 0*16(%[ctrs]), %%xmm1\n\t"
+                "movdqa 1*16(%[ctrs]), %%xmm2\n\t"
+                "movdqa 2*16(%[ctrs]), %%xmm3\n\t"
+                "movdqa 3*16(%[ctrs]), %%xmm4\n\t"
+                "movdqa 4*16(%[ctrs]), %%xmm8\n\t"
+                "movdqa 5*16(%[ctrs]), %%xmm9\n\t"
+                "movdqa 6*16(%[ctrs]), %%xmm10\n\t"
+                "movdqa 7*16(%[ctrs]), %%xmm11\n\t"
+                "movdqu (%[ctr]), %%xmm5\n\t"
+                :
+                : [ctrs] "r" (ctrs),
+                  [ctr] "r" (ctr)
+                : "memory");
+}
+
+
+/* XOR the eight encrypted counter blocks in xmm1 to xmm4 and xmm8 to
+   xmm11 with the input A and store them to B.  */
+static inline void
+do_aesni_ctr_8_xor (unsigned char *b, const unsigned char *a)
+{
+  asm volatile ("movdqu 0*16(%[src]), %%xmm0\n\t"  /* Get block 1.      */
+                "pxor %%xmm0, %%xmm1\n\t"          /* EncCTR-1 ^= input */
+                "movdqu %%xmm1, 0*16(%[dst])\n\t"  /* Store block 1     */
+                "movdqu 1*16(%[src]), %%xmm0\n\t"
+                "pxor %%xmm0, %%xmm2\n\t"
+                "movdqu %%xmm2, 1*16(%[dst])\n\t"
+                "movdqu 2*16(%[src]), %%xmm0\n\t"
+                "pxor %%xmm0, %%xmm3\n\t"
+                "movdqu %%xmm3, 2*16(%[dst])\n\t"
+                "movdqu 3*16(%[src]), %%xmm0\n\t"
+                "pxor %%xmm0, %%xmm4\n\t"
+                "movdqu %%xmm4, 3*16(%[dst])\n\t"
+                "movdqu 4*16(%[src]), %%xmm0\n\t"
+                "pxor %%xmm0, %%xmm8\n\t"
+                "movdqu %%xmm8, 4*16(%[dst])\n\t"
+                "movdqu 5*16(%[src]), %%xmm0\n\t"
+                "pxor %%xmm0, %%xmm9\n\t"
+                "movdqu %%xmm9, 5*16(%[dst])\n\t"
+                "movdqu 6*16(%[src]), %%xmm0\n\t"
+                "pxor %%xmm0, %%xmm10\n\t"
+                "movdqu %%xmm10, 6*16(%[dst])\n\t"
+                "movdqu 7*16(%[src]), %%xmm0\n\t"
+                "pxor %%xmm0, %%xmm11\n\t"
+                "movdqu %%xmm11, 7*16(%[dst])"      /* Store block 8.    */
+                :
+                : [src] "r" (a),
+                  [dst] "r" (b)
+                : "memory");
+}
+
+
+/* Eight blocks at a time variant of do_aesni_ctr.  The caller needs
+   to make sure that the least significant byte of CTR does not
+   overflow, i.e. that it is not larger than 0xf7.  */
+static void
+do_aesni_ctr_8 (const RIJNDAEL_context *ctx,
+                unsigned char *ctr, unsigned char *b, const unsigned char *a)
+{
+  do_aesni_ctr_8_prepare (ctr);
+  do_aesni_enc_vec8 (ctx);
+  do_aesni_ctr_8_xor (b, a);
+}
+#endif /*USE_AESNI_VEC8*/
+
+
 unsigned int
 _gcry_aes_aesni_encrypt (const RIJNDAEL_context *ctx, unsigned char *dst,
                          const unsigned char *src)
@@ -1102,65 +1670,561 @@ _gcry_aes_aesni_cbc_enc (RIJNDAEL_context *ctx, unsigned char *outbuf,
 }
 
 
-void
-_gcry_aes_aesni_ctr_enc (RIJNDAEL_context *ctx, unsigned char *outbuf,
-                         const unsigned char *inbuf, unsigned char *ctr,
-                         size_t nblocks)
+/* Encrypt four blocks with four different key schedules using the Intel
+ * AES-NI instructions.  Blocks are input and output through SSE
+ * registers xmm1 to xmm4; block L is encrypted with the key schedule at
+ * KEYS[L].  All key schedules have ROUNDS rounds.  */
+static inline void
+do_aesni_enc_multi4 (const unsigned char **keys, int rounds)
 {
-  static const unsigned char be_mask[16] __attribute__ ((aligned (16))) =
-    { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+#define aesenc_xmm0_xmm1      ".byte 0x66, 0x0f, 0x38, 0xdc, 0xc8\n\t"
+#define aesenc_xmm0_xmm2      ".byte 0x66, 0x0f, 0x38, 0xdc, 0xd0\n\t"
+#define aesenc_xmm0_xmm3      ".byte 0x66, 0x0f, 0x38, 0xdc, 0xd8\n\t"
+#define aesenc_xmm0_xmm4      ".byte 0x66, 0x0f, 0x38, 0xdc, 0xe0\n\t"
+#define aesenclast_xmm0_xmm1  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xc8\n\t"
+#define aesenclast_xmm0_xmm2  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xd0\n\t"
+#define aesenclast_xmm0_xmm3  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xd8\n\t"
+#define aesenclast_xmm0_xmm4  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xe0\n\t"
+#define aesenc_lanes4(op, key_off)                              \
+                "movdqa " key_off "(%[key0]), %%xmm0\n\t"       \
+                op##_xmm0_xmm1                                  \
+                "movdqa " key_off "(%[key1]), %%xmm0\n\t"       \
+                op##_xmm0_xmm2                                  \
+                "movdqa " key_off "(%[key2]), %%xmm0\n\t"       \
+                op##_xmm0_xmm3                                  \
+                "movdqa " key_off "(%[key3]), %%xmm0\n\t"       \
+                op##_xmm0_xmm4
+#define pxor_xmm0_xmm1        "pxor %%xmm0, %%xmm1\n\t"
+#define pxor_xmm0_xmm2        "pxor %%xmm0, %%xmm2\n\t"
+#define pxor_xmm0_xmm3        "pxor %%xmm0, %%xmm3\n\t"
+#define pxor_xmm0_xmm4        "pxor %%xmm0, %%xmm4\n\t"
+  asm volatile (aesenc_lanes4(pxor, "0x00")     /* xmmL ^= keyL[0] */
+                aesenc_lanes4(aesenc, "0x10")
+                aesenc_lanes4(aesenc, "0x20")
+                aesenc_lanes4(aesenc, "0x30")
+                aesenc_lanes4(aesenc, "0x40")
+                aesenc_lanes4(aesenc, "0x50")
+                aesenc_lanes4(aesenc, "0x60")
+                aesenc_lanes4(aesenc, "0x70")
+                aesenc_lanes4(aesenc, "0x80")
+                aesenc_lanes4(aesenc, "0x90")
+                "cmpl $10, %[rounds]\n\t"
+                "jz .Lenclast10%=\n\t"
+                aesenc_lanes4(aesenc, "0xa0")
+                aesenc_lanes4(aesenc, "0xb0")
+                "cmpl $12, %[rounds]\n\t"
+                "jz .Lenclast12%=\n\t"
+                aesenc_lanes4(aesenc, "0xc0")
+                aesenc_lanes4(aesenc, "0xd0")
+                aesenc_lanes4(aesenclast, "0xe0")
+                "jmp .Lencdone%=\n"
+
+                ".Lenclast12%=:\n\t"
+                aesenc_lanes4(aesenclast, "0xc0")
+                "jmp .Lencdone%=\n"
+
+                ".Lenclast10%=:\n\t"
+                aesenc_lanes4(aesenclast, "0xa0")
+
+                ".Lencdone%=:\n\t"
+                : /* no output */
+                : [key0] "r" (keys[0]),
+                  [key1] "r" (keys[1]),
+                  [key2] "r" (keys[2]),
+                  [key3] "r" (keys[3]),
+                  [rounds] "rm" (rounds)
+                : "cc", "memory");
+#undef aesenc_lanes4
+#undef pxor_xmm0_xmm1
+#undef pxor_xmm0_xmm2
+#undef pxor_xmm0_xmm3
+#undef pxor_xmm0_xmm4
+#undef aesenc_xmm0_xmm1
+#undef aesenc_xmm0_xmm2
+#undef aesenc_xmm0_xmm3
+#undef aesenc_xmm0_xmm4
+#undef aesenclast_xmm0_xmm1
+#undef aesenclast_xmm0_xmm2
+#undef aesenclast_xmm0_xmm3
+#undef aesenclast_xmm0_xmm4
+}
+
+
+/* CBC encrypt NBLOCKS blocks of up to four streams in parallel.  The
+   arguments are as for _gcry_aes_aesni_cbc_enc_multi with NLANES in
+   the range 1 to 4.  */
+static void
+aesni_cbc_enc_lanes4 (void **contexts, unsigned char **ivs,
+                      unsigned char **outbufs,
+                      const unsigned char **inbufs,
+                      size_t nlanes, size_t nblocks, int cbc_mac)
+{
+  const RIJNDAEL_context *ctx;
+  const unsigned char *keys[4];
+  const unsigned char *in[4];
+  unsigned char *out[4];
+  unsigned char *iv[4];
+  int rounds = ((const RIJNDAEL_context *)contexts[0])->rounds;
+  size_t outstep = cbc_mac ? 0 : BLOCKSIZE;
+  size_t inoff, outoff, k;
+  int l;
   aesni_prepare_2_6_variable;
 
+  /* Unused lanes repeat the last stream.  They compute the same data and
+     store it to the same place, which is cheaper than special casing
+     them.  */
+  for (l = 0; l < 4; l++)
+    {
+      k = l < nlanes ? l : nlanes - 1;
+      ctx = contexts[k];
+      keys[l] = ctx->keyschenc[0][0];
+      in[l] = inbufs[k];
+      out[l] = outbufs[k];
+      iv[l] = ivs[k];
+    }
+
   aesni_prepare ();
   aesni_prepare_2_6();
 
-  asm volatile ("movdqa %[mask], %%xmm6\n\t" /* Preload mask */
-                "movdqa %[ctr], %%xmm5\n\t"  /* Preload CTR */
+  asm volatile ("movdqu %[iv0], %%xmm1\n\t"
+                "movdqu %[iv1], %%xmm2\n\t"
+                "movdqu %[iv2], %%xmm3\n\t"
+                "movdqu %[iv3], %%xmm4\n\t"
                 : /* No output */
-                : [mask] "m" (*be_mask),
-                  [ctr] "m" (*ctr)
-                : "memory");
+                : [iv0] "m" (*iv[0]),
+                  [iv1] "m" (*iv[1]),
+                  [iv2] "m" (*iv[2]),
+                  [iv3] "m" (*iv[3])
+                : "memory" );
 
-  for ( ;nblocks > 3 ; nblocks -= 4 )
+  for (inoff = outoff = 0; nblocks; nblocks--)
     {
-      do_aesni_ctr_4 (ctx, ctr, outbuf, inbuf);
-      outbuf += 4*BLOCKSIZE;
-      inbuf  += 4*BLOCKSIZE;
-    }
-  for ( ;nblocks; nblocks-- )
-    {
-      do_aesni_ctr (ctx, ctr, outbuf, inbuf);
-      outbuf += BLOCKSIZE;
-      inbuf  += BLOCKSIZE;
-    }
-  aesni_cleanup ();
-  aesni_cleanup_2_6 ();
-}
+      asm volatile ("movdqu %[in0], %%xmm0\n\t"
+                    "pxor %%xmm0, %%xmm1\n\t"
+                    "movdqu %[in1], %%xmm0\n\t"
+                    "pxor %%xmm0, %%xmm2\n\t"
+                    "movdqu %[in2], %%xmm0\n\t"
+                    "pxor %%xmm0, %%xmm3\n\t"
+                    "movdqu %[in3], %%xmm0\n\t"
+                    "pxor %%xmm0, %%xmm4\n\t"
+                    : /* No output */
+                    : [in0] "m" (in[0][inoff]),
+                      [in1] "m" (in[1][inoff]),
+                      [in2] "m" (in[2][inoff]),
+                      [in3] "m" (in[3][inoff])
+                    : "memory" );
 
+      do_aesni_enc_multi4 (keys, rounds);
 
-unsigned int
-_gcry_aes_aesni_decrypt (const RIJNDAEL_context *ctx, unsigned char *dst,
-                         const unsigned char *src)
-{
-  aesni_prepare ();
-  asm volatile ("movdqu %[src], %%xmm0\n\t"
-                :
-                : [src] "m" (*src)
-                : "memory" );
-  do_aesni_dec (ctx);
-  asm volatile ("movdqu %%xmm0, %[dst]\n\t"
-                : [dst] "=m" (*dst)
+      asm volatile ("movdqu %%xmm1, %[out0]\n\t"
+                    "movdqu %%xmm2, %[out1]\n\t"
+                    "movdqu %%xmm3, %[out2]\n\t"
+                    "movdqu %%xmm4, %[out3]\n\t"
+                    : [out0] "=m" (out[0][outoff]),
+                      [out1] "=m" (out[1][outoff]),
+                      [out2] "=m" (out[2][outoff]),
+                      [out3] "=m" (out[3][outoff])
+                    :
+                    : "memory" );
+
+      inoff += BLOCKSIZE;
+      outoff += outstep;
+    }
+
+  asm volatile ("movdqu %%xmm1, %[iv0]\n\t"
+                "movdqu %%xmm2, %[iv1]\n\t"
+                "movdqu %%xmm3, %[iv2]\n\t"
+                "movdqu %%xmm4, %[iv3]\n\t"
+                : [iv0] "=m" (*iv[0]),
+                  [iv1] "=m" (*iv[1]),
+                  [iv2] "=m" (*iv[2]),
+                  [iv3] "=m" (*iv[3])
                 :
                 : "memory" );
+
   aesni_cleanup ();
-  return 0;
+  aesni_cleanup_2_6 ();
 }
 
 
-void
-_gcry_aes_aesni_cfb_dec (RIJNDAEL_context *ctx, unsigned char *outbuf,
-                         const unsigned char *inbuf, unsigned char *iv,
-                         size_t nblocks)
+#ifdef USE_AESNI_VEC8
+/* Encrypt eight blocks with eight different key schedules using the
+ * Intel AES-NI instructions.  Blocks are input and output through SSE
+ * registers xmm1 to xmm4 and xmm8 to xmm11; block L is encrypted with
+ * the key schedule at KEYS[L].  All key schedules have ROUNDS
+ * rounds.  */
+static inline void
+do_aesni_enc_multi8 (const unsigned char **keys, int rounds)
+{
+#define aesenc_xmm0_xmm1      ".byte 0x66, 0x0f, 0x38, 0xdc, 0xc8\n\t"
+#define aesenc_xmm0_xmm2      ".byte 0x66, 0x0f, 0x38, 0xdc, 0xd0\n\t"
+#define aesenc_xmm0_xmm3      ".byte 0x66, 0x0f, 0x38, 0xdc, 0xd8\n\t"
+#define aesenc_xmm0_xmm4      ".byte 0x66, 0x0f, 0x38, 0xdc, 0xe0\n\t"
+#define aesenc_xmm0_xmm8      ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xc0\n\t"
+#define aesenc_xmm0_xmm9      ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xc8\n\t"
+#define aesenc_xmm0_xmm10     ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xd0\n\t"
+#define aesenc_xmm0_xmm11     ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xd8\n\t"
+#define aesenclast_xmm0_xmm1  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xc8\n\t"
+#define aesenclast_xmm0_xmm2  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xd0\n\t"
+#define aesenclast_xmm0_xmm3  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xd8\n\t"
+#define aesenclast_xmm0_xmm4  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xe0\n\t"
+#define aesenclast_xmm0_xmm8  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xc0\n\t"
+#define aesenclast_xmm0_xmm9  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xc8\n\t"
+#define aesenclast_xmm0_xmm10 ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xd0\n\t"
+#define aesenclast_xmm0_xmm11 ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xd8\n\t"
+#define aesenc_lanes8(op, key_off)                              \
+                "movdqa " key_off "(%[key0]), %%xmm0\n\t"       \
+                op##_xmm0_xmm1                                  \
+                "movdqa " key_off "(%[key1]), %%xmm0\n\t"       \
+                op##_xmm0_xmm2                                  \
+                "movdqa " key_off "(%[key2]), %%xmm0\n\t"       \
+                op##_xmm0_xmm3                                  \
+                "movdqa " key_off "(%[key3]), %%xmm0\n\t"       \
+                op##_xmm0_xmm4                                  \
+                "movdqa " key_off "(%[key4]), %%xmm0\n\t"       \
+                op##_xmm0_xmm8                                  \
+                "movdqa " key_off "(%[key5]), %%xmm0\n\t"       \
+                op##_xmm0_xmm9                                  \
+                "movdqa " key_off "(%[key6]), %%xmm0\n\t"       \
+                op##_xmm0_xmm10                                 \
+                "movdqa " key_off "(%[key7]), %%xmm0\n\t"       \
+                op##_xmm0_xmm11
+#define pxor_xmm0_xmm1        "pxor %%xmm0, %%xmm1\n\t"
+#define pxor_xmm0_xmm2        "pxor %%xmm0, %%xmm2\n\t"
+#define pxor_xmm0_xmm3        "pxor %%xmm0, %%xmm3\n\t"
+#define pxor_xmm0_xmm4        "pxor %%xmm0, %%xmm4\n\t"
+#define pxor_xmm0_xmm8        "pxor %%xmm0, %%xmm8\n\t"
+#define pxor_xmm0_xmm9        "pxor %%xmm0, %%xmm9\n\t"
+#define pxor_xmm0_xmm10       "pxor %%xmm0, %%xmm10\n\t"
+#define pxor_xmm0_xmm11       "pxor %%xmm0, %%xmm11\n\t"
+  asm volatile (aesenc_lanes8(pxor, "0x00")     /* xmmL ^= keyL[0] */
+                aesenc_lanes8(aesenc, "0x10")
+                aesenc_lanes8(aesenc, "0x20")
+                aesenc_lanes8(aesenc, "0x30")
+                aesenc_lanes8(aesenc, "0x40")
+                aesenc_lanes8(aesenc, "0x50")
+                aesenc_lanes8(aesenc, "0x60")
+                aesenc_lanes8(aesenc, "0x70")
+                aesenc_lanes8(aesenc, "0x80")
+                aesenc_lanes8(aesenc, "0x90")
+                "cmpl $10, %[rounds]\n\t"
+                "jz .Lenclast10%=\n\t"
+                aesenc_lanes8(aesenc, "0xa0")
+                aesenc_lanes8(aesenc, "0xb0")
+                "cmpl $12, %[rounds]\n\t"
+                "jz .Lenclast12%=\n\t"
+                aesenc_lanes8(aesenc, "0xc0")
+                aesenc_lanes8(aesenc, "0xd0")
+                aesenc_lanes8(aesenclast, "0xe0")
+                "jmp .Lencdone%=\n"
+
+                ".Lenclast12%=:\n\t"
+                aesenc_lanes8(aesenclast, "0xc0")
+                "jmp .Lencdone%=\n"
+
+                ".Lenclast10%=:\n\t"
+                aesenc_lanes8(aesenclast, "0xa0")
+
+                ".Lencdone%=:\n\t"
+                : /* no output */
+                : [key0] "r" (keys[0]),
+                  [key1] "r" (keys[1]),
+                  [key2] "r" (keys[2]),
+                  [key3] "r" (keys[3]),
+                  [key4] "r" (keys[4]),
+                  [key5] "r" (keys[5]),
+                  [key6] "r" (keys[6]),
+                  [key7] "r" (keys[7]),
+                  [rounds] "rm" (rounds)
+                : "cc", "memory");
+#undef aesenc_lanes8
+#undef pxor_xmm0_xmm1
+#undef pxor_xmm0_xmm2
+#undef pxor_xmm0_xmm3
+#undef pxor_xmm0_xmm4
+#undef pxor_xmm0_xmm8
+#undef pxor_xmm0_xmm9
+#undef pxor_xmm0_xmm10
+#undef pxor_xmm0_xmm11
+#undef aesenc_xmm0_xmm1
+#undef aesenc_xmm0_xmm2
+#undef aesenc_xmm0_xmm3
+#undef aesenc_xmm0_xmm4
+#undef aesenc_xmm0_xmm8
+#undef aesenc_xmm0_xmm9
+#undef aesenc_xmm0_xmm10
+#undef aesenc_xmm0_xmm11
+#undef aesenclast_xmm0_xmm1
+#undef aesenclast_xmm0_xmm2
+#undef aesenclast_xmm0_xmm3
+#undef aesenclast_xmm0_xmm4
+#undef aesenclast_xmm0_xmm8
+#undef aesenclast_xmm0_xmm9
+#undef aesenclast_xmm0_xmm10
+#undef aesenclast_xmm0_xmm11
+}
+
+
+/* CBC encrypt NBLOCKS blocks of up to eight streams in parallel.  The
+   arguments are as for _gcry_aes_aesni_cbc_enc_multi with NLANES in
+   the range 1 to 8.  */
+static void
+aesni_cbc_enc_lanes8 (void **contexts, unsigned char **ivs,
+                      unsigned char **outbufs,
+                      const unsigned char **inbufs,
+                      size_t nlanes, size_t nblocks, int cbc_mac)
+{
+  const RIJNDAEL_context *ctx;
+  const unsigned char *keys[8];
+  const unsigned char *in[8];
+  unsigned char *out[8];
+  unsigned char *iv[8];
+  int rounds = ((const RIJNDAEL_context *)contexts[0])->rounds;
+  size_t outstep = cbc_mac ? 0 : BLOCKSIZE;
+  size_t inoff, outoff, k;
+  int l;
+  aesni_prepare_2_6_variable;
+
+  /* Unused lanes repeat the last stream; see aesni_cbc_enc_lanes4.  */
+  for (l = 0; l < 8; l++)
+    {
+      k = l < nlanes ? l : nlanes - 1;
+      ctx = contexts[k];
+      keys[l] = ctx->keyschenc[0][0];
+      in[l] = inbufs[k];
+      out[l] = outbufs[k];
+      iv[l] = ivs[k];
+    }
+
+  aesni_prepare ();
+  aesni_prepare_2_6();
+
+  asm volatile ("movdqu %[iv0], %%xmm1\n\t"
+                "movdqu %[iv1], %%xmm2\n\t"
+                "movdqu %[iv2], %%xmm3\n\t"
+                "movdqu %[iv3], %%xmm4\n\t"
+                : /* No output */
+                : [iv0] "m" (*iv[0]),
+                  [iv1] "m" (*iv[1]),
+                  [iv2] "m" (*iv[2]),
+                  [iv3] "m" (*iv[3])
+                : "memory" );
+  asm volatile ("movdqu %[iv4], %%xmm8\n\t"
+                "movdqu %[iv5], %%xmm9\n\t"
+                "movdqu %[iv6], %%xmm10\n\t"
+                "movdqu %[iv7], %%xmm11\n\t"
+                : /* No output */
+                : [iv4] "m" (*iv[4]),
+                  [iv5] "m" (*iv[5]),
+                  [iv6] "m" (*iv[6]),
+                  [iv7] "m" (*iv[7])
+                : "memory" );
+
+  for (inoff = outoff = 0; nblocks; nblocks--)
+    {
+      asm volatile ("movdqu %[in0], %%xmm0\n\t"
+                    "pxor %%xmm0, %%xmm1\n\t"
+                    "movdqu %[in1], %%xmm0\n\t"
+                    "pxor %%xmm0, %%xmm2\n\t"
+                    "movdqu %[in2], %%xmm0\n\t"
+                    "pxor %%xmm0, %%xmm3\n\t"
+                    "movdqu %[in3], %%xmm0\n\t"
+                    "pxor %%xmm0, %%xmm4\n\t"
+                    : /* No output */
+                    : [in0] "m" (in[0][inoff]),
+                      [in1] "m" (in[1][inoff]),
+                      [in2] "m" (in[2][inoff]),
+                      [in3] "m" (in[3][inoff])
+                    : "memory" );
+      asm volatile ("movdqu %[in4], %%xmm0\n\t"
+                    "pxor %%xmm0, %%xmm8\n\t"
+                    "movdqu %[in5], %%xmm0\n\t"
+                    "pxor %%xmm0, %%xmm9\n\t"
+                    "movdqu %[in6], %%xmm0\n\t"
+                    "pxor %%xmm0, %%xmm10\n\t"
+                    "movdqu %[in7], %%xmm0\n\t"
+                    "pxor %%xmm0, %%xmm11\n\t"
+                    : /* No output */
+                    : [in4] "m" (in[4][inoff]),
+                      [in5] "m" (in[5][inoff]),
+                      [in6] "m" (in[6][inoff]),
+                      [in7] "m" (in[7][inoff])
+                    : "memory" );
+
+      do_aesni_enc_multi8 (keys, rounds);
+
+      asm volatile ("movdqu %%xmm1, %[out0]\n\t"
+                    "movdqu %%xmm2, %[out1]\n\t"
+                    "movdqu %%xmm3, %[out2]\n\t"
+                    "movdqu %%xmm4, %[out3]\n\t"
+                    : [out0] "=m" (out[0][outoff]),
+                      [out1] "=m" (out[1][outoff]),
+                      [out2] "=m" (out[2][outoff]),
+                      [out3] "=m" (out[3][outoff])
+                    :
+                    : "memory" );
+      asm volatile ("movdqu %%xmm8, %[out4]\n\t"
+                    "movdqu %%xmm9, %[out5]\n\t"
+                    "movdqu %%xmm10, %[out6]\n\t"
+                    "movdqu %%xmm11, %[out7]\n\t"
+                    : [out4] "=m" (out[4][outoff]),
+                      [out5] "=m" (out[5][outoff]),
+                      [out6] "=m" (out[6][outoff]),
+                      [out7] "=m" (out[7][outoff])
+                    :
+                    : "memory" );
+
+      inoff += BLOCKSIZE;
+      outoff += outstep;
+    }
+
+  asm volatile ("movdqu %%xmm1, %[iv0]\n\t"
+                "movdqu %%xmm2, %[iv1]\n\t"
+                "movdqu %%xmm3, %[iv2]\n\t"
+                "movdqu %%xmm4, %[iv3]\n\t"
+                : [iv0] "=m" (*iv[0]),
+                  [iv1] "=m" (*iv[1]),
+                  [iv2] "=m" (*iv[2]),
+                  [iv3] "=m" (*iv[3])
+                :
+                : "memory" );
+  asm volatile ("movdqu %%xmm8, %[iv4]\n\t"
+                "movdqu %%xmm9, %[iv5]\n\t"
+                "movdqu %%xmm10, %[iv6]\n\t"
+                "movdqu %%xmm11, %[iv7]\n\t"
+                : [iv4] "=m" (*iv[4]),
+                  [iv5] "=m" (*iv[5]),
+                  [iv6] "=m" (*iv[6]),
+                  [iv7] "=m" (*iv[7])
+                :
+                : "memory" );
+
+  aesni_cleanup ();
+  aesni_cleanup_2_6 ();
+  aesni_cleanup_8_11 ();
+}
+#endif /*USE_AESNI_VEC8*/
+
+
+/* CBC encrypt NBLOCKS blocks for each of the NLANES independent streams
+   with the contexts CONTEXTS[I], the IVs at IVS[I] and the buffers
+   INBUFS[I] and OUTBUFS[I].  All contexts need to use the same number
+   of rounds.  The streams are interleaved so that the serial chaining
+   of CBC does not leave the AES unit idle.  */
+void
+_gcry_aes_aesni_cbc_enc_multi (void **contexts, unsigned char **ivs,
+                               unsigned char **outbufs,
+                               const unsigned char **inbufs,
+                               size_t nlanes, size_t nblocks, int cbc_mac)
+{
+  size_t n;
+
+  for (; nlanes > 1; nlanes -= n)
+    {
+#ifdef USE_AESNI_VEC8
+      if (nlanes > 4)
+        {
+          n = nlanes < 8 ? nlanes : 8;
+          aesni_cbc_enc_lanes8 (contexts, ivs, outbufs, inbufs, n, nblocks,
+                                cbc_mac);
+        }
+      else
+#endif
+        {
+          n = nlanes < 4 ? nlanes : 4;
+          aesni_cbc_enc_lanes4 (contexts, ivs, outbufs, inbufs, n, nblocks,
+                                cbc_mac);
+        }
+
+      contexts += n;
+      ivs += n;
+      outbufs += n;
+      inbufs += n;
+    }
+
+  if (nlanes)
+    _gcry_aes_aesni_cbc_enc (contexts[0], outbufs[0], inbufs[0], ivs[0],
+                             nblocks, cbc_mac);
+}
+
+
+void
+_gcry_aes_aesni_ctr_enc (RIJNDAEL_context *ctx, unsigned char *outbuf,
+                         const unsigned char *inbuf, unsigned char *ctr,
+                         size_t nblocks)
+{
+  static const unsigned char be_mask[16] __attribute__ ((aligned (16))) =
+    { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+  aesni_prepare_2_6_variable;
+
+  aesni_prepare ();
+  aesni_prepare_2_6();
+
+  asm volatile ("movdqa %[mask], %%xmm6\n\t" /* Preload mask */
+                "movdqa %[ctr], %%xmm5\n\t"  /* Preload CTR */
+                : /* No output */
+                : [mask] "m" (*be_mask),
+                  [ctr] "m" (*ctr)
+                : "memory");
+
+#ifdef USE_AESNI_VEC8
+  for ( ;nblocks > 7 ; nblocks -= 8 )
+    {
+      if (ctr[15] <= 0xf7)
+        do_aesni_ctr_8 (ctx, ctr, outbuf, inbuf);
+      else
+        {
+          /* The 8-bit counter addition would overflow.  */
+          do_aesni_ctr_4 (ctx, ctr, outbuf, inbuf);
+          do_aesni_ctr_4 (ctx, ctr, outbuf + 4*BLOCKSIZE,
+                          inbuf + 4*BLOCKSIZE);
+        }
+      outbuf += 8*BLOCKSIZE;
+      inbuf  += 8*BLOCKSIZE;
+    }
+  aesni_cleanup_8_11 ();
+#endif
+
+  for ( ;nblocks > 3 ; nblocks -= 4 )
+    {
+      do_aesni_ctr_4 (ctx, ctr, outbuf, inbuf);
+      outbuf += 4*BLOCKSIZE;
+      inbuf  += 4*BLOCKSIZE;
+    }
+  for ( ;nblocks; nblocks-- )
+    {
+      do_aesni_ctr (ctx, ctr, outbuf, inbuf);
+      outbuf += BLOCKSIZE;
+      inbuf  += BLOCKSIZE;
+    }
+  aesni_cleanup ();
+  aesni_cleanup_2_6 ();
+}
+
+
+unsigned int
+_gcry_aes_aesni_decrypt (const RIJNDAEL_context *ctx, unsigned char *dst,
+                         const unsigned char *src)
+{
+  aesni_prepare ();
+  asm volatile ("movdqu %[src], %%xmm0\n\t"
+                :
+                : [src] "m" (*src)
+                : "memory" );
+  do_aesni_dec (ctx);
+  asm volatile ("movdqu %%xmm0, %[dst]\n\t"
+                : [dst] "=m" (*dst)
+                :
+                : "memory" );
+  aesni_cleanup ();
+  return 0;
+}
+
+
+void
+_gcry_aes_aesni_cfb_dec (RIJNDAEL_context *ctx, unsigned char *outbuf,
+                         const unsigned char *inbuf, unsigned char *iv,
+                         size_t nblocks)
 {
   aesni_prepare_2_6_variable;
 
@@ -1173,6 +2237,70 @@ _gcry_aes_aesni_cfb_dec (RIJNDAEL_context *ctx, unsigned char *outbuf,
                 : "memory" );
 
   /* CFB decryption can be parallelized */
+#ifdef USE_AESNI_VEC8
+  for ( ;nblocks >= 8; nblocks -= 8)
+    {
+      asm volatile
+        ("movdqu %%xmm6,         %%xmm1\n\t" /* load input blocks */
+         "movdqu 0*16(%[inbuf]), %%xmm2\n\t"
+         "movdqu 1*16(%[inbuf]), %%xmm3\n\t"
+         "movdqu 2*16(%[inbuf]), %%xmm4\n\t"
+         "movdqu 3*16(%[inbuf]), %%xmm8\n\t"
+         "movdqu 4*16(%[inbuf]), %%xmm9\n\t"
+         "movdqu 5*16(%[inbuf]), %%xmm10\n\t"
+         "movdqu 6*16(%[inbuf]), %%xmm11\n\t"
+
+         "movdqu 7*16(%[inbuf]), %%xmm6\n\t" /* update IV */
+         : /* No output */
+         : [inbuf] "r" (inbuf)
+         : "memory");
+
+      do_aesni_enc_vec8 (ctx);
+
+      asm volatile
+        ("movdqu 0*16(%[inbuf]), %%xmm5\n\t"
+         "pxor %%xmm5, %%xmm1\n\t"
+         "movdqu %%xmm1, 0*16(%[outbuf])\n\t"
+
+         "movdqu 1*16(%[inbuf]), %%xmm5\n\t"
+         "pxor %%xmm5, %%xmm2\n\t"
+         "movdqu %%xmm2, 1*16(%[outbuf])\n\t"
+
+         "movdqu 2*16(%[inbuf]), %%xmm5\n\t"
+         "pxor %%xmm5, %%xmm3\n\t"
+         "movdqu %%xmm3, 2*16(%[outbuf])\n\t"
+
+         "movdqu 3*16(%[inbuf]), %%xmm5\n\t"
+         "pxor %%xmm5, %%xmm4\n\t"
+         "movdqu %%xmm4, 3*16(%[outbuf])\n\t"
+
+         "movdqu 4*16(%[inbuf]), %%xmm5\n\t"
+         "pxor %%xmm5, %%xmm8\n\t"
+         "movdqu %%xmm8, 4*16(%[outbuf])\n\t"
+
+         "movdqu 5*16(%[inbuf]), %%xmm5\n\t"
+         "pxor %%xmm5, %%xmm9\n\t"
+         "movdqu %%xmm9, 5*16(%[outbuf])\n\t"
+
+         "movdqu 6*16(%[inbuf]), %%xmm5\n\t"
+         "pxor %%xmm5, %%xmm10\n\t"
+         "movdqu %%xmm10, 6*16(%[outbuf])\n\t"
+
+         "movdqu 7*16(%[inbuf]), %%xmm5\n\t"
+         "pxor %%xmm5, %%xmm11\n\t"
+         "movdqu %%xmm11, 7*16(%[outbuf])\n\t"
+
+         : /* No output */
+         : [inbuf] "r" (inbuf),
+           [outbuf] "r" (outbuf)
+         : "memory");
+
+      outbuf += 8*BLOCKSIZE;
+      inbuf  += 8*BLOCKSIZE;
+    }
+  aesni_cleanup_8_11 ();
+#endif
+
   for ( ;nblocks >= 4; nblocks -= 4)
     {
       asm volatile
@@ -1258,6 +2386,68 @@ _gcry_aes_aesni_cbc_dec (RIJNDAEL_context *ctx, unsigned char *outbuf,
      : [iv] "m" (*iv)
      : "memory");
 
+#ifdef USE_AESNI_VEC8
+  for ( ;nblocks > 7 ; nblocks -= 8 )
+    {
+      asm volatile
+        ("movdqu 0*16(%[inbuf]), %%xmm1\n\t"	/* load input blocks */
+         "movdqu 1*16(%[inbuf]), %%xmm2\n\t"
+         "movdqu 2*16(%[inbuf]), %%xmm3\n\t"
+         "movdqu 3*16(%[inbuf]), %%xmm4\n\t"
+         "movdqu 4*16(%[inbuf]), %%xmm8\n\t"
+         "movdqu 5*16(%[inbuf]), %%xmm9\n\t"
+         "movdqu 6*16(%[inbuf]), %%xmm10\n\t"
+         "movdqu 7*16(%[inbuf]), %%xmm11\n\t"
+         : /* No output */
+         : [inbuf] "r" (inbuf)
+         : "memory");
+
+      do_aesni_dec_vec8 (ctx);
+
+      asm volatile
+        ("pxor %%xmm5, %%xmm1\n\t"		/* xor IV with output */
+         "movdqu 0*16(%[inbuf]), %%xmm5\n\t"	/* load new IV */
+         "movdqu %%xmm1, 0*16(%[outbuf])\n\t"
+
+         "pxor %%xmm5, %%xmm2\n\t"
+         "movdqu 1*16(%[inbuf]), %%xmm5\n\t"
+         "movdqu %%xmm2, 1*16(%[outbuf])\n\t"
+
+         "pxor %%xmm5, %%xmm3\n\t"
+         "movdqu 2*16(%[inbuf]), %%xmm5\n\t"
+         "movdqu %%xmm3, 2*16(%[outbuf])\n\t"
+
+         "pxor %%xmm5, %%xmm4\n\t"
+         "movdqu 3*16(%[inbuf]), %%xmm5\n\t"
+         "movdqu %%xmm4, 3*16(%[outbuf])\n\t"
+
+         "pxor %%xmm5, %%xmm8\n\t"
+         "movdqu 4*16(%[inbuf]), %%xmm5\n\t"
+         "movdqu %%xmm8, 4*16(%[outbuf])\n\t"
+
+         "pxor %%xmm5, %%xmm9\n\t"
+         "movdqu 5*16(%[inbuf]), %%xmm5\n\t"
+         "movdqu %%xmm9, 5*16(%[outbuf])\n\t"
+
+         "pxor %%xmm5, %%xmm10\n\t"
+         "movdqu 6*16(%[inbuf]), %%xmm5\n\t"
+         "movdqu %%xmm10, 6*16(%[outbuf])\n\t"
+
+         "pxor %%xmm5, %%xmm11\n\t"
+         "movdqu 7*16(%[inbuf]), %%xmm5\n\t"
+         "movdqu %%xmm11, 7*16(%[outbuf])\n\t"
+
+         : /* No output */
+         : [inbuf] "r" (inbuf),
+           [outbuf] "r" (outbuf)
+         : "memory");
+
+      outbuf += 8*BLOCKSIZE;
+      inbuf  += 8*BLOCKSIZE;
+    }
+  aesni_cleanup_8_11 ();
+#endif
+
   for ( ;nblocks > 3 ; nblocks -= 4 )
     {
       asm volatile
@@ -1448,6 +2638,111 @@ aesni_ocb_enc (gcry_cipher_hd_t c, void *outbuf_arg,
       outbuf += BLOCKSIZE;
     }
 
+#ifdef USE_AESNI_VEC8
+  for ( ;nblocks > 7 ; nblocks -= 8 )
+    {
+      const unsigned char *l4;
+
+      /* l_tmp will be used only every 65536-th block.  Only one of
+         blocks N+4 and N+8 can hit that case.  */
+      l4 = get_l(c, l_tmp.x1, n + 4, c->u_iv.iv, c->u_ctr.ctr);
+      n += 8;
+      l = get_l(c, l_tmp.x1, n, c->u_iv.iv, c->u_ctr.ctr);
+
+      /* Offset_i = Offset_{i-1} xor L_{ntz(i)} */
+      /* Checksum_i = Checksum_{i-1} xor P_i  */
+      /* C_i = Offset_i xor ENCIPHER(K, P_i xor Offset_i)  */
+      asm volatile ("movdqu (%[l0]), %%xmm0\n\t"
+                    "movdqu 0*16(%[inbuf]), %%xmm1\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm1, %%xmm6\n\t"
+                    "pxor   %%xmm5, %%xmm1\n\t"
+                    "movdqu %%xmm5, 0*16(%[outbuf])\n\t"
+                    "movdqu (%[l1]), %%xmm0\n\t"
+                    "movdqu 1*16(%[inbuf]), %%xmm2\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm2, %%xmm6\n\t"
+                    "pxor   %%xmm5, %%xmm2\n\t"
+                    "movdqu %%xmm5, 1*16(%[outbuf])\n\t"
+                    "movdqu (%[l0]), %%xmm0\n\t"
+                    "movdqu 2*16(%[inbuf]), %%xmm3\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm3, %%xmm6\n\t"
+                    "pxor   %%xmm5, %%xmm3\n\t"
+                    "movdqu %%xmm5, 2*16(%[outbuf])\n\t"
+                    "movdqu (%[l4]), %%xmm0\n\t"
+                    "movdqu 3*16(%[inbuf]), %%xmm4\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm4, %%xmm6\n\t"
+                    "pxor   %%xmm5, %%xmm4\n\t"
+                    "movdqu %%xmm5, 3*16(%[outbuf])\n\t"
+                    "movdqu (%[l0]), %%xmm0\n\t"
+                    "movdqu 4*16(%[inbuf]), %%xmm8\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm8, %%xmm6\n\t"
+                    "pxor   %%xmm5, %%xmm8\n\t"
+                    "movdqu %%xmm5, 4*16(%[outbuf])\n\t"
+                    "movdqu (%[l1]), %%xmm0\n\t"
+                    "movdqu 5*16(%[inbuf]), %%xmm9\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm9, %%xmm6\n\t"
+                    "pxor   %%xmm5, %%xmm9\n\t"
+                    "movdqu %%xmm5, 5*16(%[outbuf])\n\t"
+                    "movdqu (%[l0]), %%xmm0\n\t"
+                    "movdqu 6*16(%[inbuf]), %%xmm10\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm10, %%xmm6\n\t"
+                    "pxor   %%xmm5, %%xmm10\n\t"
+                    "movdqu %%xmm5, 6*16(%[outbuf])\n\t"
+                    "movdqu (%[l8]), %%xmm0\n\t"
+                    "movdqu 7*16(%[inbuf]), %%xmm11\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm11, %%xmm6\n\t"
+                    "pxor   %%xmm5, %%xmm11\n\t"
+                    :
+                    : [l0] "r" (c->u_mode.ocb.L[0]),
+                      [l1] "r" (c->u_mode.ocb.L[1]),
+                      [l4] "r" (l4),
+                      [l8] "r" (l),
+                      [inbuf] "r" (inbuf),
+                      [outbuf] "r" (outbuf)
+                    : "memory" );
+
+      do_aesni_enc_vec8 (ctx);
+
+      asm volatile ("movdqu 0*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm1\n\t"
+                    "movdqu %%xmm1, 0*16(%[outbuf])\n\t"
+                    "movdqu 1*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm2\n\t"
+                    "movdqu %%xmm2, 1*16(%[outbuf])\n\t"
+                    "movdqu 2*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm3\n\t"
+                    "movdqu %%xmm3, 2*16(%[outbuf])\n\t"
+                    "movdqu 3*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm4\n\t"
+                    "movdqu %%xmm4, 3*16(%[outbuf])\n\t"
+                    "movdqu 4*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm8\n\t"
+                    "movdqu %%xmm8, 4*16(%[outbuf])\n\t"
+                    "movdqu 5*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm9\n\t"
+                    "movdqu %%xmm9, 5*16(%[outbuf])\n\t"
+                    "movdqu 6*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm10\n\t"
+                    "movdqu %%xmm10, 6*16(%[outbuf])\n\t"
+                    "pxor   %%xmm5, %%xmm11\n\t"
+                    "movdqu %%xmm11, 7*16(%[outbuf])\n\t"
+                    :
+                    : [outbuf] "r" (outbuf)
+                    : "memory" );
+
+      outbuf += 8*BLOCKSIZE;
+      inbuf  += 8*BLOCKSIZE;
+    }
+  aesni_cleanup_8_11 ();
+#endif
+
   for ( ;nblocks > 3 ; nblocks -= 4 )
     {
       /* l_tmp will be used only every 65536-th block. */
@@ -1617,6 +2912,111 @@ aesni_ocb_dec (gcry_cipher_hd_t c, void *outbuf_arg,
       outbuf += BLOCKSIZE;
     }
 
+#ifdef USE_AESNI_VEC8
+  for ( ;nblocks > 7 ; nblocks -= 8 )
+    {
+      const unsigned char *l4;
+
+      /* l_tmp will be used only every 65536-th block.  Only one of
+         blocks N+4 and N+8 can hit that case.  */
+      l4 = get_l(c, l_tmp.x1, n + 4, c->u_iv.iv, c->u_ctr.ctr);
+      n += 8;
+      l = get_l(c, l_tmp.x1, n, c->u_iv.iv, c->u_ctr.ctr);
+
+      /* Offset_i = Offset_{i-1} xor L_{ntz(i)} */
+      /* P_i = Offset_i xor DECIPHER(K, C_i xor Offset_i)  */
+      /* Checksum_i = Checksum_{i-1} xor P_i  */
+      asm volatile ("movdqu (%[l0]), %%xmm0\n\t"
+                    "movdqu 0*16(%[inbuf]), %%xmm1\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm1\n\t"
+                    "movdqu %%xmm5, 0*16(%[outbuf])\n\t"
+                    "movdqu (%[l1]), %%xmm0\n\t"
+                    "movdqu 1*16(%[inbuf]), %%xmm2\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm2\n\t"
+                    "movdqu %%xmm5, 1*16(%[outbuf])\n\t"
+                    "movdqu (%[l0]), %%xmm0\n\t"
+                    "movdqu 2*16(%[inbuf]), %%xmm3\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm3\n\t"
+                    "movdqu %%xmm5, 2*16(%[outbuf])\n\t"
+                    "movdqu (%[l4]), %%xmm0\n\t"
+                    "movdqu 3*16(%[inbuf]), %%xmm4\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm4\n\t"
+                    "movdqu %%xmm5, 3*16(%[outbuf])\n\t"
+                    "movdqu (%[l0]), %%xmm0\n\t"
+                    "movdqu 4*16(%[inbuf]), %%xmm8\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm8\n\t"
+                    "movdqu %%xmm5, 4*16(%[outbuf])\n\t"
+                    "movdqu (%[l1]), %%xmm0\n\t"
+                    "movdqu 5*16(%[inbuf]), %%xmm9\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm9\n\t"
+                    "movdqu %%xmm5, 5*16(%[outbuf])\n\t"
+                    "movdqu (%[l0]), %%xmm0\n\t"
+                    "movdqu 6*16(%[inbuf]), %%xmm10\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm10\n\t"
+                    "movdqu %%xmm5, 6*16(%[outbuf])\n\t"
+                    "movdqu (%[l8]), %%xmm0\n\t"
+                    "movdqu 7*16(%[inbuf]), %%xmm11\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm11\n\t"
+                    :
+                    : [l0] "r" (c->u_mode.ocb.L[0]),
+                      [l1] "r" (c->u_mode.ocb.L[1]),
+                      [l4] "r" (l4),
+                      [l8] "r" (l),
+                      [inbuf] "r" (inbuf),
+                      [outbuf] "r" (outbuf)
+                    : "memory" );
+
+      do_aesni_dec_vec8 (ctx);
+
+      asm volatile ("movdqu 0*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm1\n\t"
+                    "movdqu %%xmm1, 0*16(%[outbuf])\n\t"
+                    "movdqu 1*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm2\n\t"
+                    "movdqu %%xmm2, 1*16(%[outbuf])\n\t"
+                    "movdqu 2*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm3\n\t"
+                    "movdqu %%xmm3, 2*16(%[outbuf])\n\t"
+                    "movdqu 3*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm4\n\t"
+                    "movdqu %%xmm4, 3*16(%[outbuf])\n\t"
+                    "movdqu 4*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm8\n\t"
+                    "movdqu %%xmm8, 4*16(%[outbuf])\n\t"
+                    "movdqu 5*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm9\n\t"
+                    "movdqu %%xmm9, 5*16(%[outbuf])\n\t"
+                    "movdqu 6*16(%[outbuf]), %%xmm0\n\t"
+                    "pxor   %%xmm0, %%xmm10\n\t"
+                    "movdqu %%xmm10, 6*16(%[outbuf])\n\t"
+                    "pxor   %%xmm5, %%xmm11\n\t"
+                    "movdqu %%xmm11, 7*16(%[outbuf])\n\t"
+                    "pxor   %%xmm1, %%xmm6\n\t"
+                    "pxor   %%xmm2, %%xmm6\n\t"
+                    "pxor   %%xmm3, %%xmm6\n\t"
+                    "pxor   %%xmm4, %%xmm6\n\t"
+                    "pxor   %%xmm8, %%xmm6\n\t"
+                    "pxor   %%xmm9, %%xmm6\n\t"
+                    "pxor   %%xmm10, %%xmm6\n\t"
+                    "pxor   %%xmm11, %%xmm6\n\t"
+                    :
+                    : [outbuf] "r" (outbuf)
+                    : "memory" );
+
+      outbuf += 8*BLOCKSIZE;
+      inbuf  += 8*BLOCKSIZE;
+    }
+  aesni_cleanup_8_11 ();
+#endif
+
   for ( ;nblocks > 3 ; nblocks -= 4 )
     {
       /* l_tmp will be used only every 65536-th block. */
@@ -1793,6 +3193,80 @@ _gcry_aes_aesni_ocb_auth (gcry_cipher_hd_t c, const void *abuf_arg,
       abuf += BLOCKSIZE;
     }
 
+#ifdef USE_AESNI_VEC8
+  for ( ;nblocks > 7 ; nblocks -= 8 )
+    {
+      const unsigned char *l4;
+
+      /* l_tmp will be used only every 65536-th block.  Only one of
+         blocks N+4 and N+8 can hit that case.  */
+      l4 = get_l(c, l_tmp.x1, n + 4, c->u_mode.ocb.aad_offset,
+                   c->u_mode.ocb.aad_sum);
+      n += 8;
+      l = get_l(c, l_tmp.x1, n, c->u_mode.ocb.aad_offset,
+                   c->u_mode.ocb.aad_sum);
+
+      /* Offset_i = Offset_{i-1} xor L_{ntz(i)} */
+      /* Sum_i = Sum_{i-1} xor ENCIPHER(K, A_i xor Offset_i)  */
+      asm volatile ("movdqu (%[l0]), %%xmm0\n\t"
+                    "movdqu 0*16(%[abuf]), %%xmm1\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm1\n\t"
+                    "movdqu (%[l1]), %%xmm0\n\t"
+                    "movdqu 1*16(%[abuf]), %%xmm2\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm2\n\t"
+                    "movdqu (%[l0]), %%xmm0\n\t"
+                    "movdqu 2*16(%[abuf]), %%xmm3\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm3\n\t"
+                    "movdqu (%[l4]), %%xmm0\n\t"
+                    "movdqu 3*16(%[abuf]), %%xmm4\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm4\n\t"
+                    "movdqu (%[l0]), %%xmm0\n\t"
+                    "movdqu 4*16(%[abuf]), %%xmm8\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm8\n\t"
+                    "movdqu (%[l1]), %%xmm0\n\t"
+                    "movdqu 5*16(%[abuf]), %%xmm9\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm9\n\t"
+                    "movdqu (%[l0]), %%xmm0\n\t"
+                    "movdqu 6*16(%[abuf]), %%xmm10\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm10\n\t"
+                    "movdqu (%[l8]), %%xmm0\n\t"
+                    "movdqu 7*16(%[abuf]), %%xmm11\n\t"
+                    "pxor   %%xmm0, %%xmm5\n\t"
+                    "pxor   %%xmm5, %%xmm11\n\t"
+                    :
+                    : [l0] "r" (c->u_mode.ocb.L[0]),
+                      [l1] "r" (c->u_mode.ocb.L[1]),
+                      [l4] "r" (l4),
+                      [l8] "r" (l),
+                      [abuf] "r" (abuf)
+                    : "memory" );
+
+      do_aesni_enc_vec8 (ctx);
+
+      asm volatile ("pxor   %%xmm1, %%xmm6\n\t"
+                    "pxor   %%xmm2, %%xmm6\n\t"
+                    "pxor   %%xmm3, %%xmm6\n\t"
+                    "pxor   %%xmm4, %%xmm6\n\t"
+                    "pxor   %%xmm8, %%xmm6\n\t"
+                    "pxor   %%xmm9, %%xmm6\n\t"
+                    "pxor   %%xmm10, %%xmm6\n\t"
+                    "pxor   %%xmm11, %%xmm6\n\t"
+                    :
+                    :
+                    : "memory" );
+
+      abuf += 8*BLOCKSIZE;
+    }
+  aesni_cleanup_8_11 ();
+#endif
+
   for ( ;nblocks > 3 ; nblocks -= 4 )
     {
       /* l_tmp will be used only every 65536-th block. */
@@ -1889,4 +3363,260 @@ _gcry_aes_aesni_ocb_auth (gcry_cipher_hd_t c, const void *abuf_arg,
 }
 
 
+
+/* Multiply the XTS tweak in xmm5 by alpha.  xmm6 holds the reduction
+   constant and TMP is clobbered.  */
+#define xts_gfmul_xmm5(tmp)                                             \
+                "pshufd $0x13, %%xmm5, %%" tmp "\n\t"                   \
+                "psrad $31, %%" tmp "\n\t"                              \
+                "paddq %%xmm5, %%xmm5\n\t"                              \
+                "pand %%xmm6, %%" tmp "\n\t"                            \
+                "pxor %%" tmp ", %%xmm5\n\t"
+
+/* Load input block IDX into XMM, xor it with the current tweak and
+   store the tweak at output block IDX for the final xor.  The tweak is
+   then advanced for the next block.  */
+#define xts_load_block(idx, xmm)                                        \
+                "movdqu " #idx "*16(%[inbuf]), %%" xmm "\n\t"           \
+                "pxor %%xmm5, %%" xmm "\n\t"                            \
+                "movdqu %%xmm5, " #idx "*16(%[outbuf])\n\t"             \
+                xts_gfmul_xmm5("xmm0")
+
+/* Xor the processed block in XMM with the tweak stored at output block
+   IDX and write the result there.  */
+#define xts_store_block(idx, xmm)                                       \
+                "movdqu " #idx "*16(%[outbuf]), %%xmm0\n\t"             \
+                "pxor %%xmm0, %%" xmm "\n\t"                            \
+                "movdqu %%" xmm ", " #idx "*16(%[outbuf])\n\t"
+
+void
+_gcry_aes_aesni_xts_crypt (RIJNDAEL_context *ctx, unsigned char *tweak,
+                           unsigned char *outbuf, const unsigned char *inbuf,
+                           size_t nblocks, int encrypt)
+{
+  static const unsigned char xts_gfmul_const[16] __attribute__ ((aligned (16))) =
+    { 0x87, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0 };
+  aesni_prepare_2_6_variable;
+
+  aesni_prepare ();
+  aesni_prepare_2_6 ();
+
+  /* Preload tweak and the constant for tweak multiplication.  */
+  asm volatile ("movdqu %[tweak], %%xmm5\n\t"
+                "movdqa %[gfmul], %%xmm6\n\t"
+                :
+                : [tweak] "m" (*tweak),
+                  [gfmul] "m" (*xts_gfmul_const)
+                : "memory" );
+
+#ifdef USE_AESNI_VEC8
+  for ( ;nblocks > 7 ; nblocks -= 8 )
+    {
+      /* The tweaks for the eight blocks are computed while the input
+         blocks are loaded and parked in the output buffer until the
+         blocks have been processed.  */
+      asm volatile (xts_load_block(0, "xmm1")
+                    xts_load_block(1, "xmm2")
+                    xts_load_block(2, "xmm3")
+                    xts_load_block(3, "xmm4")
+                    xts_load_block(4, "xmm8")
+                    xts_load_block(5, "xmm9")
+                    xts_load_block(6, "xmm10")
+                    xts_load_block(7, "xmm11")
+                    :
+                    : [inbuf] "r" (inbuf),
+                      [outbuf] "r" (outbuf)
+                    : "memory" );
+
+      if (encrypt)
+        do_aesni_enc_vec8 (ctx);
+      else
+        do_aesni_dec_vec8 (ctx);
+
+      asm volatile (xts_store_block(0, "xmm1")
+                    xts_store_block(1, "xmm2")
+                    xts_store_block(2, "xmm3")
+                    xts_store_block(3, "xmm4")
+                    xts_store_block(4, "xmm8")
+                    xts_store_block(5, "xmm9")
+                    xts_store_block(6, "xmm10")
+                    xts_store_block(7, "xmm11")
+                    :
+                    : [outbuf] "r" (outbuf)
+                    : "memory" );
+
+      outbuf += 8*BLOCKSIZE;
+      inbuf  += 8*BLOCKSIZE;
+    }
+  aesni_cleanup_8_11 ();
+#endif
+
+  for ( ;nblocks > 3 ; nblocks -= 4 )
+    {
+      asm volatile (xts_load_block(0, "xmm1")
+                    xts_load_block(1, "xmm2")
+                    xts_load_block(2, "xmm3")
+                    xts_load_block(3, "xmm4")
+                    :
+                    : [inbuf] "r" (inbuf),
+                      [outbuf] "r" (outbuf)
+                    : "memory" );
+
+      if (encrypt)
+        do_aesni_enc_vec4 (ctx);
+      else
+        do_aesni_dec_vec4 (ctx);
+
+      asm volatile (xts_store_block(0, "xmm1")
+                    xts_store_block(1, "xmm2")
+                    xts_store_block(2, "xmm3")
+                    xts_store_block(3, "xmm4")
+                    :
+                    : [outbuf] "r" (outbuf)
+                    : "memory" );
+
+      outbuf += 4*BLOCKSIZE;
+      inbuf  += 4*BLOCKSIZE;
+    }
+
+  for ( ;nblocks; nblocks-- )
+    {
+      asm volatile ("movdqu %[inbuf], %%xmm0\n\t"
+                    "pxor %%xmm5, %%xmm0\n\t"
+                    "movdqa %%xmm5, %%xmm4\n\t"
+                    xts_gfmul_xmm5("xmm1")
+                    :
+                    : [inbuf] "m" (*inbuf)
+                    : "memory" );
+
+      /* uses only xmm0 and xmm1 */
+      if (encrypt)
+        do_aesni_enc (ctx);
+      else
+        do_aesni_dec (ctx);
+
+      asm volatile ("pxor %%xmm4, %%xmm0\n\t"
+                    "movdqu %%xmm0, %[outbuf]\n\t"
+                    : [outbuf] "=m" (*outbuf)
+                    :
+                    : "memory" );
+
+      outbuf += BLOCKSIZE;
+      inbuf  += BLOCKSIZE;
+    }
+
+  asm volatile ("movdqu %%xmm5, %[tweak]\n\t"
+                : [tweak] "=m" (*tweak)
+                :
+                : "memory" );
+
+  aesni_cleanup ();
+  aesni_cleanup_2_6 ();
+}
+
+#undef xts_gfmul_xmm5
+#undef xts_load_block
+#undef xts_store_block
+
+
+/* Bulk encryption/decryption of complete blocks in GCM mode.  Eight
+   counter blocks are encrypted at a time while GHASH is computed over
+   eight ciphertext blocks in the same pass.  Returns the number of
+   blocks not processed.  */
+size_t
+_gcry_aes_aesni_gcm_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                           const void *inbuf_arg, size_t nblocks,
+                           int encrypt)
+{
+#if defined(USE_AESNI_VEC8) && defined(GCM_USE_INTEL_PCLMUL)
+  static const unsigned char be_mask[16] __attribute__ ((aligned (16))) =
+    { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+  RIJNDAEL_context *ctx = (void *)&c->context.c;
+  unsigned char *outbuf = outbuf_arg;
+  const unsigned char *inbuf = inbuf_arg;
+  unsigned char *ctr = c->u_ctr.ctr;
+  const unsigned char *hbuf = NULL;
+  aesni_prepare_2_6_variable;
+
+  /* The powers of H are only available with the PCLMUL GHASH.  */
+  if (nblocks < 8 || c->u_mode.gcm.ghash_fn != _gcry_ghash_intel_pclmul)
+    return nblocks;
+
+  aesni_prepare ();
+  aesni_prepare_2_6 ();
+
+  /* Preload counter and hash. */
+  asm volatile ("movdqu %[ctr], %%xmm5\n\t"
+                "movdqu %[hash], %%xmm7\n\t"
+                "pshufb %[be_mask], %%xmm7\n\t" /* be => le */
+                : /* No output */
+                : [ctr] "m" (*ctr),
+                  [hash] "m" (*c->u_mode.gcm.u_tag.tag),
+                  [be_mask] "m" (*be_mask)
+                : "memory");
+
+  for ( ;nblocks > 7 ; nblocks -= 8 )
+    {
+      /* GHASH is computed over the ciphertext.  When encrypting, the
+         output of the previous iteration is hashed.  */
+      if (!encrypt)
+        hbuf = inbuf;
+
+      if (ctr[15] <= 0xf7)
+        do_aesni_ctr_8_prepare (ctr);
+      else
+        do_aesni_ctr_8_prepare_carry (ctr);
+
+      if (hbuf)
+        do_aesni_enc_vec8_ghash8 (ctx, c, hbuf, be_mask);
+      else
+        do_aesni_enc_vec8 (ctx);
+
+      do_aesni_ctr_8_xor (outbuf, inbuf);
+
+      if (hbuf)
+        gcm_reduce_ghash8 ();
+
+      if (encrypt)
+        hbuf = outbuf;
+
+      outbuf += 8*BLOCKSIZE;
+      inbuf  += 8*BLOCKSIZE;
+    }
+
+  if (encrypt)
+    {
+      do_ghash8 (c, hbuf, be_mask);
+      gcm_reduce_ghash8 ();
+    }
+
+  /* Store hash. */
+  asm volatile ("pshufb %[be_mask], %%xmm7\n\t" /* le => be */
+                "movdqu %%xmm7, %[hash]\n\t"
+                : [hash] "=m" (*c->u_mode.gcm.u_tag.tag)
+                : [be_mask] "m" (*be_mask)
+                : "memory");
+
+  aesni_cleanup ();
+  aesni_cleanup_2_6 ();
+  aesni_cleanup_8_11 ();
+  asm volatile ("pxor %%xmm7, %%xmm7\n\t"
+                "pxor %%xmm12, %%xmm12\n\t"
+                "pxor %%xmm13, %%xmm13\n\t"
+                "pxor %%xmm14, %%xmm14\n\t"
+                "pxor %%xmm15, %%xmm15\n\t"
+                ::: "cc" );
+
+  return nblocks;
+#else
+  (void)c;
+  (void)outbuf_arg;
+  (void)inbuf_arg;
+  (void)encrypt;
+
+  return nblocks;
+#endif
+}
+
+
 #endif /* USE_AESNI */
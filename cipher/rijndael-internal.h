@@ -82,6 +82,16 @@
 # endif
 #endif /* ENABLE_AESNI_SUPPORT */
 
+/* USE_VAES indicates whether to compile with the VAES/VPCLMUL code
+   working on the AVX2 registers.  It extends the AES-NI code.  The
+   registers YMM6 to YMM15 are callee-saved on WIN64, thus this code is
+   not used there.  */
+#undef USE_VAES
+#if defined(USE_AESNI) && defined(__x86_64__) && !defined(__WIN64__) && \
+    defined(ENABLE_AVX2_SUPPORT) && defined(HAVE_GCC_INLINE_ASM_VAES_VPCLMUL)
+# define USE_VAES 1
+#endif
+
 struct RIJNDAEL_context_s;
 
 typedef unsigned int (*rijndael_cryptfn_t)(const struct RIJNDAEL_context_s *ctx,
@@ -124,6 +134,9 @@ typedef struct RIJNDAEL_context_s
 #ifdef USE_AESNI
   unsigned int use_aesni:1;           /* AES-NI shall be used.  */
 #endif /*USE_AESNI*/
+#ifdef USE_VAES
+  unsigned int use_vaes:1;            /* VAES shall be used.  */
+#endif /*USE_VAES*/
 #ifdef USE_SSSE3
   unsigned int use_ssse3:1;           /* SSSE3 shall be used.  */
 #endif /*USE_SSSE3*/
@@ -0,0 +1,983 @@
+/* VAES/VPCLMUL accelerated AES for Libgcrypt
+ * Copyright (C) 2016 Free Software Foundation, Inc.
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The functions in this file process sixteen blocks at a time, two
+ * blocks in each of the YMM registers ymm0 to ymm7.  The VAES
+ * instructions run the AES rounds on both 128-bit lanes of a register
+ * and VPCLMULQDQ does the same for the carry-less multiplications of
+ * GHASH and the XTS tweak computation.  Whatever does not fill sixteen
+ * blocks is passed on to the AES-NI code in rijndael-aesni.c.  */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"  /* for byte and u32 typedefs */
+#include "g10lib.h"
+#include "cipher.h"
+#include "bufhelp.h"
+#include "rijndael-internal.h"
+#include "./cipher-internal.h"
+
+
+#ifdef USE_VAES
+
+
+#if _GCRY_GCC_VERSION >= 40400 /* 4.4 */
+/* Prevent compiler from issuing SSE instructions between asm blocks. */
+#  pragma GCC target("no-sse")
+#endif
+
+
+extern void _gcry_aes_aesni_ctr_enc (RIJNDAEL_context *ctx,
+                                     unsigned char *outbuf,
+                                     const unsigned char *inbuf,
+                                     unsigned char *ctr, size_t nblocks);
+extern void _gcry_aes_aesni_ocb_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                                       const void *inbuf_arg, size_t nblocks,
+                                       int encrypt);
+extern void _gcry_aes_aesni_ocb_auth (gcry_cipher_hd_t c,
+                                      const void *abuf_arg, size_t nblocks);
+extern size_t _gcry_aes_aesni_gcm_crypt (gcry_cipher_hd_t c,
+                                         void *outbuf_arg,
+                                         const void *inbuf_arg,
+                                         size_t nblocks, int encrypt);
+extern void _gcry_aes_aesni_xts_crypt (RIJNDAEL_context *ctx,
+                                       unsigned char *tweak,
+                                       unsigned char *outbuf,
+                                       const unsigned char *inbuf,
+                                       size_t nblocks, int encrypt);
+
+
+/* Byte swap mask for both lanes of a YMM register.  */
+static const unsigned char be_mask[32] __attribute__ ((aligned (32))) =
+  { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+
+
+/* All YMM registers are cleared after use.  This also avoids the
+   penalty for SSE code following AVX code with dirty upper halves,
+   which is the case for the AES-NI fallbacks.  */
+#define vaes_cleanup()                                                  \
+   do { asm volatile ("vzeroall\n\t" ::: "memory"); } while (0)
+
+
+/* Run the AES rounds with the instruction OP on the sixteen blocks in
+   ymm0 to ymm7, using the round key at offset KEY_OFF.  */
+#define vaes_round(op, key_off)                                         \
+                "vbroadcasti128 " key_off "(%[key]), %%ymm8\n\t"        \
+                op " %%ymm8, %%ymm0, %%ymm0\n\t"                        \
+                op " %%ymm8, %%ymm1, %%ymm1\n\t"                        \
+                op " %%ymm8, %%ymm2, %%ymm2\n\t"                        \
+                op " %%ymm8, %%ymm3, %%ymm3\n\t"                        \
+                op " %%ymm8, %%ymm4, %%ymm4\n\t"                        \
+                op " %%ymm8, %%ymm5, %%ymm5\n\t"                        \
+                op " %%ymm8, %%ymm6, %%ymm6\n\t"                        \
+                op " %%ymm8, %%ymm7, %%ymm7\n\t"
+
+/* The last round with the round key already loaded into ymm8.  */
+#define vaes_last_round(op)                                             \
+                op " %%ymm8, %%ymm0, %%ymm0\n\t"                        \
+                op " %%ymm8, %%ymm1, %%ymm1\n\t"                        \
+                op " %%ymm8, %%ymm2, %%ymm2\n\t"                        \
+                op " %%ymm8, %%ymm3, %%ymm3\n\t"                        \
+                op " %%ymm8, %%ymm4, %%ymm4\n\t"                        \
+                op " %%ymm8, %%ymm5, %%ymm5\n\t"                        \
+                op " %%ymm8, %%ymm6, %%ymm6\n\t"                        \
+                op " %%ymm8, %%ymm7, %%ymm7\n\t"
+
+/* Complete AES encryption or decryption of the sixteen blocks in ymm0
+   to ymm7.  Between the rounds the string STEP_N is inserted, which
+   allows stitching other computations into the AES rounds.  */
+#define vaes_crypt16(op, oplast, step_1, step_2, step_3, step_4,        \
+                     step_5, step_6, step_7, step_8)                    \
+                vaes_round ("vpxor", "0x00")                            \
+                vaes_round (op, "0x10")                                 \
+                step_1                                                  \
+                vaes_round (op, "0x20")                                 \
+                step_2                                                  \
+                vaes_round (op, "0x30")                                 \
+                step_3                                                  \
+                vaes_round (op, "0x40")                                 \
+                step_4                                                  \
+                vaes_round (op, "0x50")                                 \
+                step_5                                                  \
+                vaes_round (op, "0x60")                                 \
+                step_6                                                  \
+                vaes_round (op, "0x70")                                 \
+                step_7                                                  \
+                vaes_round (op, "0x80")                                 \
+                step_8                                                  \
+                vaes_round (op, "0x90")                                 \
+                "vbroadcasti128 0xa0(%[key]), %%ymm8\n\t"               \
+                "cmpl $10, %[rounds]\n\t"                               \
+                "jz .Llast%=\n\t"                                       \
+                vaes_round (op, "0xa0")                                 \
+                vaes_round (op, "0xb0")                                 \
+                "vbroadcasti128 0xc0(%[key]), %%ymm8\n\t"               \
+                "cmpl $12, %[rounds]\n\t"                               \
+                "jz .Llast%=\n\t"                                       \
+                vaes_round (op, "0xc0")                                 \
+                vaes_round (op, "0xd0")                                 \
+                "vbroadcasti128 0xe0(%[key]), %%ymm8\n"                 \
+                                                                        \
+                ".Llast%=:\n\t"                                         \
+                vaes_last_round (oplast)
+
+/* Encrypt the sixteen blocks in ymm0 to ymm7 with the key schedule
+   KEY.  ymm8 is clobbered.  */
+static inline void
+do_vaes_enc16 (const void *key, int rounds)
+{
+  asm volatile (vaes_crypt16 ("vaesenc", "vaesenclast", , , , , , , , )
+                : /* no output */
+                : [key] "r" (key),
+                  [rounds] "r" (rounds)
+                : "cc", "memory");
+}
+
+
+/* Decrypt the sixteen blocks in ymm0 to ymm7 with the decryption key
+   schedule KEY.  ymm8 is clobbered.  */
+static inline void
+do_vaes_dec16 (const void *key, int rounds)
+{
+  asm volatile (vaes_crypt16 ("vaesdec", "vaesdeclast", , , , , , , , )
+                : /* no output */
+                : [key] "r" (key),
+                  [rounds] "r" (rounds)
+                : "cc", "memory");
+}
+
+
+/* Xor the sixteen blocks at INBUF to the key streams in ymm0 to ymm7
+   and write the result to OUTBUF.  */
+static inline void
+do_vaes_xor16 (unsigned char *outbuf, const unsigned char *inbuf)
+{
+  asm volatile ("vpxor 0*32(%[inbuf]), %%ymm0, %%ymm0\n\t"
+                "vpxor 1*32(%[inbuf]), %%ymm1, %%ymm1\n\t"
+                "vpxor 2*32(%[inbuf]), %%ymm2, %%ymm2\n\t"
+                "vpxor 3*32(%[inbuf]), %%ymm3, %%ymm3\n\t"
+                "vpxor 4*32(%[inbuf]), %%ymm4, %%ymm4\n\t"
+                "vpxor 5*32(%[inbuf]), %%ymm5, %%ymm5\n\t"
+                "vpxor 6*32(%[inbuf]), %%ymm6, %%ymm6\n\t"
+                "vpxor 7*32(%[inbuf]), %%ymm7, %%ymm7\n\t"
+                "vmovdqu %%ymm0, 0*32(%[outbuf])\n\t"
+                "vmovdqu %%ymm1, 1*32(%[outbuf])\n\t"
+                "vmovdqu %%ymm2, 2*32(%[outbuf])\n\t"
+                "vmovdqu %%ymm3, 3*32(%[outbuf])\n\t"
+                "vmovdqu %%ymm4, 4*32(%[outbuf])\n\t"
+                "vmovdqu %%ymm5, 5*32(%[outbuf])\n\t"
+                "vmovdqu %%ymm6, 6*32(%[outbuf])\n\t"
+                "vmovdqu %%ymm7, 7*32(%[outbuf])\n\t"
+                : /* no output */
+                : [inbuf] "r" (inbuf),
+                  [outbuf] "r" (outbuf)
+                : "memory");
+}
+
+
+/* Load the sixteen big-endian counter blocks CTR to CTR+15 into ymm0
+   to ymm7 and advance CTR by sixteen.  The caller makes sure that the
+   low 64 bits of the counter do not overflow.  */
+static inline void
+do_vaes_ctr16_prepare (unsigned char *ctr)
+{
+  static const u64 add_0_1[4] __attribute__ ((aligned (32))) =
+    { 0, 0, 1, 0 };
+  static const u64 add_2_2[4] __attribute__ ((aligned (32))) =
+    { 2, 0, 2, 0 };
+
+  asm volatile ("vbroadcasti128 %[ctr], %%ymm15\n\t"
+                "vpshufb %[be_mask], %%ymm15, %%ymm15\n\t" /* be => le */
+                "vpaddq %[add01], %%ymm15, %%ymm0\n\t"  /* ctr+0 : ctr+1 */
+                "vmovdqa %[add22], %%ymm14\n\t"
+                "vpaddq %%ymm14, %%ymm0, %%ymm1\n\t"   /* ctr+2 : ctr+3 */
+                "vpaddq %%ymm14, %%ymm1, %%ymm2\n\t"
+                "vpaddq %%ymm14, %%ymm2, %%ymm3\n\t"
+                "vpaddq %%ymm14, %%ymm3, %%ymm4\n\t"
+                "vpaddq %%ymm14, %%ymm4, %%ymm5\n\t"
+                "vpaddq %%ymm14, %%ymm5, %%ymm6\n\t"
+                "vpaddq %%ymm14, %%ymm6, %%ymm7\n\t"   /* ctr+14 : ctr+15 */
+                "vpaddq %%ymm14, %%ymm7, %%ymm15\n\t"  /* ctr+16 */
+                "vmovdqa %[be_mask], %%ymm14\n\t"
+                "vpshufb %%ymm14, %%ymm15, %%ymm15\n\t" /* le => be */
+                "vmovdqu %%xmm15, %[ctr]\n\t"
+                "vpshufb %%ymm14, %%ymm0, %%ymm0\n\t"
+                "vpshufb %%ymm14, %%ymm1, %%ymm1\n\t"
+                "vpshufb %%ymm14, %%ymm2, %%ymm2\n\t"
+                "vpshufb %%ymm14, %%ymm3, %%ymm3\n\t"
+                "vpshufb %%ymm14, %%ymm4, %%ymm4\n\t"
+                "vpshufb %%ymm14, %%ymm5, %%ymm5\n\t"
+                "vpshufb %%ymm14, %%ymm6, %%ymm6\n\t"
+                "vpshufb %%ymm14, %%ymm7, %%ymm7\n\t"
+                : [ctr] "+m" (*(unsigned char (*)[16])ctr)
+                : [be_mask] "m" (*be_mask),
+                  [add01] "m" (*add_0_1),
+                  [add22] "m" (*add_2_2)
+                : "memory");
+}
+
+
+/* Returns true if the sixteen counter values starting at CTR can be
+   computed without a carry out of the low 64 bits.  */
+static inline int
+ctr16_no_carry (const unsigned char *ctr)
+{
+  return buf_get_be64 (ctr + 8) < (u64)-16;
+}
+
+
+void
+_gcry_aes_vaes_ctr_enc (RIJNDAEL_context *ctx, unsigned char *outbuf,
+                        const unsigned char *inbuf, unsigned char *ctr,
+                        size_t nblocks)
+{
+  for ( ;nblocks > 15 ; nblocks -= 16 )
+    {
+      if (ctr16_no_carry (ctr))
+        {
+          do_vaes_ctr16_prepare (ctr);
+          do_vaes_enc16 (ctx->keyschenc, ctx->rounds);
+          do_vaes_xor16 (outbuf, inbuf);
+        }
+      else
+        {
+          vaes_cleanup ();
+          _gcry_aes_aesni_ctr_enc (ctx, outbuf, inbuf, ctr, 16);
+        }
+      outbuf += 16*BLOCKSIZE;
+      inbuf  += 16*BLOCKSIZE;
+    }
+
+  vaes_cleanup ();
+
+  if (nblocks)
+    _gcry_aes_aesni_ctr_enc (ctx, outbuf, inbuf, ctr, nblocks);
+}
+
+
+
+/* Multiply the tweaks in both lanes of SRC by x^K and store the result
+   in DST.  K is at most 16 so that the bits shifted out of the high
+   half times the reduction constant in ymm14 fit into 64 bits.  ymm10
+   and ymm11 are clobbered.  */
+#define xts_mul_xk(k, src, dst)                                         \
+                "vpsrlq $(64-" #k "), " src ", %%ymm10\n\t"             \
+                "vpsllq $" #k ", " src ", " dst "\n\t"                  \
+                "vpslldq $8, %%ymm10, %%ymm11\n\t"                      \
+                "vpsrldq $8, %%ymm10, %%ymm10\n\t"                      \
+                "vpclmulqdq $0, %%ymm14, %%ymm10, %%ymm10\n\t"          \
+                "vpxor %%ymm11, " dst ", " dst "\n\t"                   \
+                "vpxor %%ymm10, " dst ", " dst "\n\t"
+
+/* Compute the two tweaks for blocks 2*IDX and 2*IDX+1 from the tweaks
+   of blocks 0 and 1 in ymm15, xor them to input block pair IDX in YMM
+   and store them at output block pair IDX for the final xor.  The input
+   is read first to allow in-place operation.  */
+#define xts_load_pair(idx, k, ymm)                                      \
+                xts_mul_xk (k, "%%ymm15", "%%ymm9")                     \
+                "vpxor " #idx "*32(%[inbuf]), %%ymm9, %%" ymm "\n\t"    \
+                "vmovdqu %%ymm9, " #idx "*32(%[outbuf])\n\t"
+
+/* Xor the processed block pair in YMM with the tweaks stored at output
+   block pair IDX and write the result there.  */
+#define xts_store_pair(idx, ymm)                                        \
+                "vpxor " #idx "*32(%[outbuf]), %%" ymm ", %%" ymm "\n\t" \
+                "vmovdqu %%" ymm ", " #idx "*32(%[outbuf])\n\t"
+
+void
+_gcry_aes_vaes_xts_crypt (RIJNDAEL_context *ctx, unsigned char *tweak,
+                          unsigned char *outbuf, const unsigned char *inbuf,
+                          size_t nblocks, int encrypt)
+{
+  static const u64 xts_gfmul_const[4] __attribute__ ((aligned (32))) =
+    { 0x87, 1, 0x87, 1 };
+
+  if (nblocks > 15)
+    {
+      /* Tweaks of blocks 0 and 1 to ymm15.  The constant in ymm14 is
+         used by xts_mul_xk with its low half and by the single
+         multiplication by x here with both halves.  */
+      asm volatile ("vmovdqu %[tweak], %%xmm15\n\t"
+                    "vmovdqa %[gfmul], %%ymm14\n\t"
+                    "vpshufd $0x13, %%xmm15, %%xmm10\n\t"
+                    "vpsrad $31, %%xmm10, %%xmm10\n\t"
+                    "vpaddq %%xmm15, %%xmm15, %%xmm11\n\t"
+                    "vpand %%xmm14, %%xmm10, %%xmm10\n\t"
+                    "vpxor %%xmm10, %%xmm11, %%xmm11\n\t"
+                    "vinserti128 $1, %%xmm11, %%ymm15, %%ymm15\n\t"
+                    :
+                    : [tweak] "m" (*(const unsigned char (*)[16])tweak),
+                      [gfmul] "m" (*xts_gfmul_const)
+                    : "memory");
+    }
+
+  for ( ;nblocks > 15 ; nblocks -= 16 )
+    {
+      asm volatile ("vpxor 0*32(%[inbuf]), %%ymm15, %%ymm0\n\t"
+                    "vmovdqu %%ymm15, 0*32(%[outbuf])\n\t"
+                    xts_load_pair (1, 2, "ymm1")
+                    xts_load_pair (2, 4, "ymm2")
+                    xts_load_pair (3, 6, "ymm3")
+                    xts_load_pair (4, 8, "ymm4")
+                    xts_load_pair (5, 10, "ymm5")
+                    xts_load_pair (6, 12, "ymm6")
+                    xts_load_pair (7, 14, "ymm7")
+                    xts_mul_xk (16, "%%ymm15", "%%ymm15")
+                    :
+                    : [inbuf] "r" (inbuf),
+                      [outbuf] "r" (outbuf)
+                    : "memory");
+
+      if (encrypt)
+        do_vaes_enc16 (ctx->keyschenc, ctx->rounds);
+      else
+        do_vaes_dec16 (ctx->keyschdec, ctx->rounds);
+
+      asm volatile (xts_store_pair (0, "ymm0")
+                    xts_store_pair (1, "ymm1")
+                    xts_store_pair (2, "ymm2")
+                    xts_store_pair (3, "ymm3")
+                    xts_store_pair (4, "ymm4")
+                    xts_store_pair (5, "ymm5")
+                    xts_store_pair (6, "ymm6")
+                    xts_store_pair (7, "ymm7")
+                    :
+                    : [outbuf] "r" (outbuf)
+                    : "memory");
+
+      outbuf += 16*BLOCKSIZE;
+      inbuf  += 16*BLOCKSIZE;
+
+      if (nblocks < 32)
+        asm volatile ("vmovdqu %%xmm15, %[tweak]\n\t"
+                      : [tweak] "=m" (*(unsigned char (*)[16])tweak)
+                      :
+                      : "memory");
+    }
+
+  vaes_cleanup ();
+
+  if (nblocks)
+    _gcry_aes_aesni_xts_crypt (ctx, tweak, outbuf, inbuf, nblocks, encrypt);
+}
+
+#undef xts_mul_xk
+#undef xts_load_pair
+#undef xts_store_pair
+
+
+
+/* Compute the offset differences for OCB.  If the block number N is a
+   multiple of sixteen, Offset_{N+J} = Offset_N xor CTAB[J-1] for J = 1
+   to 15.  The sixteenth entry depends on N and is filled in by
+   vaes_ocb_prepare.  */
+static void
+vaes_ocb_setup_ctab (gcry_cipher_hd_t c, unsigned char *ctab)
+{
+  unsigned int j;
+
+  memset (ctab, 0, BLOCKSIZE);
+  buf_xor_1 (ctab, c->u_mode.ocb.L[0], BLOCKSIZE);
+  for (j = 2; j < 16; j++)
+    buf_xor (ctab + (j - 1) * BLOCKSIZE, ctab + (j - 2) * BLOCKSIZE,
+             c->u_mode.ocb.L[_gcry_ctz (j)], BLOCKSIZE);
+}
+
+
+/* Add both lanes of ymm10 to the checksum at SUM.  */
+static inline void
+vaes_ocb_store_sum (unsigned char *sum)
+{
+  asm volatile ("vextracti128 $1, %%ymm10, %%xmm11\n\t"
+                "vpxor %%xmm11, %%xmm10, %%xmm10\n\t"
+                "vpxor %[sum], %%xmm10, %%xmm10\n\t"
+                "vmovdqu %%xmm10, %[sum]\n\t"
+                : [sum] "+m" (*(unsigned char (*)[16])sum)
+                :
+                : "memory");
+}
+
+
+/* Set the last entry of CTAB for the sixteen blocks following the
+   multiple of sixteen N and load the offsets of those blocks, based on
+   the offset at OFFSET, into ymm9 (Offset_N for both lanes) and the
+   offset differences at CTAB.  The Offset_{N+16} is stored back to
+   OFFSET.  The checksum accumulated in ymm10 is flushed to SUM before
+   calling the external function for large block numbers.  */
+static inline void
+vaes_ocb_prepare (gcry_cipher_hd_t c, unsigned char *ctab, u64 n,
+                  unsigned char *offset, unsigned char *sum,
+                  unsigned char *l_tmp)
+{
+  unsigned int ntz = _gcry_ctz64 (n + 16);
+  const unsigned char *l;
+
+  if (ntz < OCB_L_TABLE_SIZE)
+    {
+      l = c->u_mode.ocb.L[ntz];
+    }
+  else
+    {
+      vaes_ocb_store_sum (sum);
+      l = _gcry_cipher_ocb_get_l (c, l_tmp, n + 16);
+      asm volatile ("vpxor %%ymm10, %%ymm10, %%ymm10\n\t" ::: "memory");
+    }
+
+  asm volatile ("vmovdqu 14*16(%[ctab]), %%xmm9\n\t"
+                "vpxor (%[l]), %%xmm9, %%xmm9\n\t"
+                "vmovdqu %%xmm9, 15*16(%[ctab])\n\t"
+                "vbroadcasti128 %[offset], %%ymm9\n\t"
+                "vpxor 15*16(%[ctab]), %%xmm9, %%xmm11\n\t"
+                "vmovdqu %%xmm11, %[offset]\n\t"
+                : [offset] "+m" (*(unsigned char (*)[16])offset)
+                : [ctab] "r" (ctab),
+                  [l] "r" (l)
+                : "memory");
+}
+
+
+/* Xor the offsets of block pair IDX to YMM.  */
+#define ocb_xor_offset(idx, ymm)                                        \
+                "vpxor " #idx "*32(%[ctab]), %%" ymm ", %%" ymm "\n\t"  \
+                "vpxor %%ymm9, %%" ymm ", %%" ymm "\n\t"
+
+/* Load block pair IDX from INBUF to YMM, add it to the checksum in
+   ymm10 and xor the offsets.  */
+#define ocb_load_sum_pair(idx, ymm)                                     \
+                "vmovdqu " #idx "*32(%[inbuf]), %%" ymm "\n\t"          \
+                "vpxor %%" ymm ", %%ymm10, %%ymm10\n\t"                 \
+                ocb_xor_offset (idx, ymm)
+
+/* Load block pair IDX from INBUF to YMM and xor the offsets.  */
+#define ocb_load_pair(idx, ymm)                                         \
+                "vmovdqu " #idx "*32(%[inbuf]), %%" ymm "\n\t"          \
+                ocb_xor_offset (idx, ymm)
+
+/* Xor the offsets of block pair IDX to YMM and store it to OUTBUF.  */
+#define ocb_store_pair(idx, ymm)                                        \
+                ocb_xor_offset (idx, ymm)                               \
+                "vmovdqu %%" ymm ", " #idx "*32(%[outbuf])\n\t"
+
+/* Same as ocb_store_pair but also add the block pair to the checksum
+   in ymm10.  */
+#define ocb_store_sum_pair(idx, ymm)                                    \
+                ocb_store_pair (idx, ymm)                               \
+                "vpxor %%" ymm ", %%ymm10, %%ymm10\n\t"
+
+void
+_gcry_aes_vaes_ocb_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                          const void *inbuf_arg, size_t nblocks, int encrypt)
+{
+  union { unsigned char x1[16] ATTR_ALIGNED_16; u32 x32[4]; } l_tmp;
+  unsigned char ctab[16 * BLOCKSIZE] ATTR_ALIGNED_16;
+  RIJNDAEL_context *ctx = (void *)&c->context.c;
+  unsigned char *outbuf = outbuf_arg;
+  const unsigned char *inbuf = inbuf_arg;
+  size_t head;
+
+  /* The offsets of sixteen blocks starting with a multiple of sixteen
+     follow a fixed pattern.  Blocks up to the first multiple of sixteen
+     are processed by the AES-NI code.  */
+  head = -c->u_mode.ocb.data_nblocks % 16;
+  if (nblocks < head + 16)
+    {
+      _gcry_aes_aesni_ocb_crypt (c, outbuf, inbuf, nblocks, encrypt);
+      return;
+    }
+  if (head)
+    {
+      _gcry_aes_aesni_ocb_crypt (c, outbuf, inbuf, head, encrypt);
+      outbuf += head * BLOCKSIZE;
+      inbuf  += head * BLOCKSIZE;
+      nblocks -= head;
+    }
+
+  vaes_ocb_setup_ctab (c, ctab);
+
+  asm volatile ("vpxor %%ymm10, %%ymm10, %%ymm10\n\t" ::: "memory");
+
+  for ( ;nblocks > 15 ; nblocks -= 16 )
+    {
+      vaes_ocb_prepare (c, ctab, c->u_mode.ocb.data_nblocks, c->u_iv.iv,
+                        c->u_ctr.ctr, l_tmp.x1);
+      c->u_mode.ocb.data_nblocks += 16;
+
+      if (encrypt)
+        {
+          /* Checksum_i = Checksum_{i-1} xor P_i  */
+          /* C_i = Offset_i xor ENCIPHER(K, P_i xor Offset_i)  */
+          asm volatile (ocb_load_sum_pair (0, "ymm0")
+                        ocb_load_sum_pair (1, "ymm1")
+                        ocb_load_sum_pair (2, "ymm2")
+                        ocb_load_sum_pair (3, "ymm3")
+                        ocb_load_sum_pair (4, "ymm4")
+                        ocb_load_sum_pair (5, "ymm5")
+                        ocb_load_sum_pair (6, "ymm6")
+                        ocb_load_sum_pair (7, "ymm7")
+                        :
+                        : [inbuf] "r" (inbuf),
+                          [ctab] "r" (ctab)
+                        : "memory");
+
+          do_vaes_enc16 (ctx->keyschenc, ctx->rounds);
+
+          asm volatile (ocb_store_pair (0, "ymm0")
+                        ocb_store_pair (1, "ymm1")
+                        ocb_store_pair (2, "ymm2")
+                        ocb_store_pair (3, "ymm3")
+                        ocb_store_pair (4, "ymm4")
+                        ocb_store_pair (5, "ymm5")
+                        ocb_store_pair (6, "ymm6")
+                        ocb_store_pair (7, "ymm7")
+                        :
+                        : [outbuf] "r" (outbuf),
+                          [ctab] "r" (ctab)
+                        : "memory");
+        }
+      else
+        {
+          /* P_i = Offset_i xor DECIPHER(K, C_i xor Offset_i)  */
+          /* Checksum_i = Checksum_{i-1} xor P_i  */
+          asm volatile (ocb_load_pair (0, "ymm0")
+                        ocb_load_pair (1, "ymm1")
+                        ocb_load_pair (2, "ymm2")
+                        ocb_load_pair (3, "ymm3")
+                        ocb_load_pair (4, "ymm4")
+                        ocb_load_pair (5, "ymm5")
+                        ocb_load_pair (6, "ymm6")
+                        ocb_load_pair (7, "ymm7")
+                        :
+                        : [inbuf] "r" (inbuf),
+                          [ctab] "r" (ctab)
+                        : "memory");
+
+          do_vaes_dec16 (ctx->keyschdec, ctx->rounds);
+
+          asm volatile (ocb_store_sum_pair (0, "ymm0")
+                        ocb_store_sum_pair (1, "ymm1")
+                        ocb_store_sum_pair (2, "ymm2")
+                        ocb_store_sum_pair (3, "ymm3")
+                        ocb_store_sum_pair (4, "ymm4")
+                        ocb_store_sum_pair (5, "ymm5")
+                        ocb_store_sum_pair (6, "ymm6")
+                        ocb_store_sum_pair (7, "ymm7")
+                        :
+                        : [outbuf] "r" (outbuf),
+                          [ctab] "r" (ctab)
+                        : "memory");
+        }
+
+      outbuf += 16*BLOCKSIZE;
+      inbuf  += 16*BLOCKSIZE;
+    }
+
+  vaes_ocb_store_sum (c->u_ctr.ctr);
+
+  vaes_cleanup ();
+  wipememory (ctab, sizeof (ctab));
+  wipememory (&l_tmp, sizeof (l_tmp));
+
+  if (nblocks)
+    _gcry_aes_aesni_ocb_crypt (c, outbuf, inbuf, nblocks, encrypt);
+}
+
+
+void
+_gcry_aes_vaes_ocb_auth (gcry_cipher_hd_t c, const void *abuf_arg,
+                         size_t nblocks)
+{
+  union { unsigned char x1[16] ATTR_ALIGNED_16; u32 x32[4]; } l_tmp;
+  unsigned char ctab[16 * BLOCKSIZE] ATTR_ALIGNED_16;
+  RIJNDAEL_context *ctx = (void *)&c->context.c;
+  const unsigned char *abuf = abuf_arg;
+  size_t head;
+
+  head = -c->u_mode.ocb.aad_nblocks % 16;
+  if (nblocks < head + 16)
+    {
+      _gcry_aes_aesni_ocb_auth (c, abuf, nblocks);
+      return;
+    }
+  if (head)
+    {
+      _gcry_aes_aesni_ocb_auth (c, abuf, head);
+      abuf += head * BLOCKSIZE;
+      nblocks -= head;
+    }
+
+  vaes_ocb_setup_ctab (c, ctab);
+
+  asm volatile ("vpxor %%ymm10, %%ymm10, %%ymm10\n\t" ::: "memory");
+
+  for ( ;nblocks > 15 ; nblocks -= 16 )
+    {
+      vaes_ocb_prepare (c, ctab, c->u_mode.ocb.aad_nblocks,
+                        c->u_mode.ocb.aad_offset, c->u_mode.ocb.aad_sum,
+                        l_tmp.x1);
+      c->u_mode.ocb.aad_nblocks += 16;
+
+      /* Sum_i = Sum_{i-1} xor ENCIPHER(K, A_i xor Offset_i)  */
+      asm volatile (ocb_load_pair (0, "ymm0")
+                    ocb_load_pair (1, "ymm1")
+                    ocb_load_pair (2, "ymm2")
+                    ocb_load_pair (3, "ymm3")
+                    ocb_load_pair (4, "ymm4")
+                    ocb_load_pair (5, "ymm5")
+                    ocb_load_pair (6, "ymm6")
+                    ocb_load_pair (7, "ymm7")
+                    :
+                    : [inbuf] "r" (abuf),
+                      [ctab] "r" (ctab)
+                    : "memory");
+
+      do_vaes_enc16 (ctx->keyschenc, ctx->rounds);
+
+      asm volatile ("vpxor %%ymm0, %%ymm10, %%ymm10\n\t"
+                    "vpxor %%ymm1, %%ymm10, %%ymm10\n\t"
+                    "vpxor %%ymm2, %%ymm10, %%ymm10\n\t"
+                    "vpxor %%ymm3, %%ymm10, %%ymm10\n\t"
+                    "vpxor %%ymm4, %%ymm10, %%ymm10\n\t"
+                    "vpxor %%ymm5, %%ymm10, %%ymm10\n\t"
+                    "vpxor %%ymm6, %%ymm10, %%ymm10\n\t"
+                    "vpxor %%ymm7, %%ymm10, %%ymm10\n\t"
+                    ::: "memory");
+
+      abuf += 16*BLOCKSIZE;
+    }
+
+  vaes_ocb_store_sum (c->u_mode.ocb.aad_sum);
+
+  vaes_cleanup ();
+  wipememory (ctab, sizeof (ctab));
+  wipememory (&l_tmp, sizeof (l_tmp));
+
+  if (nblocks)
+    _gcry_aes_aesni_ocb_auth (c, abuf, nblocks);
+}
+
+#undef ocb_xor_offset
+#undef ocb_load_sum_pair
+#undef ocb_load_pair
+#undef ocb_store_pair
+#undef ocb_store_sum_pair
+
+
+
+#ifdef GCM_USE_INTEL_PCLMUL
+/* Reduce the 256-bit carry-less products given by their low halves LO,
+   high halves HI and middle terms MID = a0*b1 + a1*b0 modulo the GCM
+   polynomial and store them to OUT.  Same algorithm as
+   gfmul_pclmul_aggr4 in cipher-gcm-intel-pclmul.c; works on each
+   128-bit lane of the registers.  T0 to T4 are clobbered.  */
+#define ghash_reduce(lo, hi, mid, out, t0, t1, t2, t3, t4)              \
+                "vpslldq $8, " mid ", " t0 "\n\t"                       \
+                "vpsrldq $8, " mid ", " t1 "\n\t"                       \
+                "vpxor " lo ", " t0 ", " t0 "\n\t"                      \
+                "vpxor " hi ", " t1 ", " t1 "\n\t"                      \
+                /* shift <t1:t0> by one bit position to the left to     \
+                   cope for the fact that bits are reversed */          \
+                "vpsrld $31, " t0 ", " t2 "\n\t"                        \
+                "vpsrld $31, " t1 ", " t3 "\n\t"                        \
+                "vpslld $1, " t0 ", " t0 "\n\t"                         \
+                "vpslld $1, " t1 ", " t1 "\n\t"                         \
+                "vpsrldq $12, " t2 ", " t4 "\n\t"                       \
+                "vpslldq $4, " t3 ", " t3 "\n\t"                        \
+                "vpslldq $4, " t2 ", " t2 "\n\t"                        \
+                "vpor " t2 ", " t0 ", " t0 "\n\t"                       \
+                "vpor " t3 ", " t1 ", " t1 "\n\t"                       \
+                "vpor " t4 ", " t1 ", " t1 "\n\t"                       \
+                /* first phase of the reduction */                      \
+                "vpslld $31, " t0 ", " t2 "\n\t"                        \
+                "vpslld $30, " t0 ", " t3 "\n\t"                        \
+                "vpslld $25, " t0 ", " t4 "\n\t"                        \
+                "vpxor " t3 ", " t2 ", " t2 "\n\t"                      \
+                "vpxor " t4 ", " t2 ", " t2 "\n\t"                      \
+                "vpsrldq $4, " t2 ", " t3 "\n\t"                        \
+                "vpslldq $12, " t2 ", " t2 "\n\t"                       \
+                "vpxor " t2 ", " t0 ", " t0 "\n\t"                      \
+                /* second phase of the reduction */                     \
+                "vpsrld $1, " t0 ", " t2 "\n\t"                         \
+                "vpsrld $2, " t0 ", " t4 "\n\t"                         \
+                "vpxor " t4 ", " t2 ", " t2 "\n\t"                      \
+                "vpsrld $7, " t0 ", " t4 "\n\t"                         \
+                "vpxor " t4 ", " t2 ", " t2 "\n\t"                      \
+                "vpxor " t3 ", " t2 ", " t2 "\n\t"                      \
+                "vpxor " t2 ", " t0 ", " t0 "\n\t"                      \
+                "vpxor " t0 ", " t1 ", " out "\n\t"
+
+/* Multiply the lanes of A and B and store the unreduced products to
+   LO, HI and MID.  T is clobbered.  */
+#define ghash_mul(a, b, lo, hi, mid, t)                                 \
+                "vpclmulqdq $0x00, " a ", " b ", " lo "\n\t"            \
+                "vpclmulqdq $0x11, " a ", " b ", " hi "\n\t"            \
+                "vpclmulqdq $0x01, " a ", " b ", " mid "\n\t"           \
+                "vpclmulqdq $0x10, " a ", " b ", " t "\n\t"             \
+                "vpxor " t ", " mid ", " mid "\n\t"
+
+/* Compute the table of H¹⁶ to H¹ for vaes_ghash_step.  Block pair J of
+   HTAB holds H^(16-2J) in the low and H^(15-2J) in the high lane.  */
+static void
+vaes_gcm_setup_htab (gcry_cipher_hd_t c, unsigned char *htab)
+{
+  asm volatile ("vmovdqu 6*16(%[h_n]), %%xmm0\n\t"             /* H⁸ */
+                "vinserti128 $1, 5*16(%[h_n]), %%ymm0, %%ymm0\n\t" /* H⁷ */
+                "vmovdqu %%ymm0, 4*32(%[htab])\n\t"
+                "vmovdqu 4*16(%[h_n]), %%xmm1\n\t"             /* H⁶ */
+                "vinserti128 $1, 3*16(%[h_n]), %%ymm1, %%ymm1\n\t" /* H⁵ */
+                "vmovdqu %%ymm1, 5*32(%[htab])\n\t"
+                "vmovdqu 2*16(%[h_n]), %%xmm2\n\t"             /* H⁴ */
+                "vinserti128 $1, 1*16(%[h_n]), %%ymm2, %%ymm2\n\t" /* H³ */
+                "vmovdqu %%ymm2, 6*32(%[htab])\n\t"
+                "vmovdqu 0*16(%[h_n]), %%xmm3\n\t"             /* H² */
+                "vinserti128 $1, (%[h_1]), %%ymm3, %%ymm3\n\t" /* H¹ */
+                "vmovdqu %%ymm3, 7*32(%[htab])\n\t"
+                "vbroadcasti128 6*16(%[h_n]), %%ymm15\n\t"     /* H⁸ */
+
+                ghash_mul ("%%ymm15", "%%ymm0",
+                           "%%ymm10", "%%ymm11", "%%ymm12", "%%ymm13")
+                ghash_reduce ("%%ymm10", "%%ymm11", "%%ymm12", "%%ymm9",
+                              "%%ymm4", "%%ymm5", "%%ymm6", "%%ymm7",
+                              "%%ymm8")
+                "vmovdqu %%ymm9, 0*32(%[htab])\n\t"            /* H¹⁶:H¹⁵ */
+                ghash_mul ("%%ymm15", "%%ymm1",
+                           "%%ymm10", "%%ymm11", "%%ymm12", "%%ymm13")
+                ghash_reduce ("%%ymm10", "%%ymm11", "%%ymm12", "%%ymm9",
+                              "%%ymm4", "%%ymm5", "%%ymm6", "%%ymm7",
+                              "%%ymm8")
+                "vmovdqu %%ymm9, 1*32(%[htab])\n\t"            /* H¹⁴:H¹³ */
+                ghash_mul ("%%ymm15", "%%ymm2",
+                           "%%ymm10", "%%ymm11", "%%ymm12", "%%ymm13")
+                ghash_reduce ("%%ymm10", "%%ymm11", "%%ymm12", "%%ymm9",
+                              "%%ymm4", "%%ymm5", "%%ymm6", "%%ymm7",
+                              "%%ymm8")
+                "vmovdqu %%ymm9, 2*32(%[htab])\n\t"            /* H¹²:H¹¹ */
+                ghash_mul ("%%ymm15", "%%ymm3",
+                           "%%ymm10", "%%ymm11", "%%ymm12", "%%ymm13")
+                ghash_reduce ("%%ymm10", "%%ymm11", "%%ymm12", "%%ymm9",
+                              "%%ymm4", "%%ymm5", "%%ymm6", "%%ymm7",
+                              "%%ymm8")
+                "vmovdqu %%ymm9, 3*32(%[htab])\n\t"            /* H¹⁰:H⁹ */
+                :
+                : [h_n] "r" (c->u_mode.gcm.gcm_table),
+                  [h_1] "r" (c->u_mode.gcm.u_ghash_key.key),
+                  [htab] "r" (htab)
+                : "memory");
+}
+
+
+/* Multiply the block pair IDX at HBUF with the powers of H in block
+   pair IDX of HTAB and add the products to the accumulators ymm10
+   (low), ymm11 (high) and ymm12 (middle).  The current hash value in
+   xmm9 is added to the first block.  */
+#define vaes_ghash_step(idx)                                            \
+                "vmovdqu " #idx "*32(%[hbuf]), %%ymm13\n\t"             \
+                "vpshufb %[be_mask], %%ymm13, %%ymm13\n\t"              \
+                vaes_ghash_add_hash_##idx                               \
+                "vmovdqu " #idx "*32(%[htab]), %%ymm14\n\t"             \
+                "vpclmulqdq $0x00, %%ymm14, %%ymm13, %%ymm15\n\t"       \
+                "vpxor %%ymm15, %%ymm10, %%ymm10\n\t"                   \
+                "vpclmulqdq $0x11, %%ymm14, %%ymm13, %%ymm15\n\t"       \
+                "vpxor %%ymm15, %%ymm11, %%ymm11\n\t"                   \
+                "vpclmulqdq $0x01, %%ymm14, %%ymm13, %%ymm15\n\t"       \
+                "vpxor %%ymm15, %%ymm12, %%ymm12\n\t"                   \
+                "vpclmulqdq $0x10, %%ymm14, %%ymm13, %%ymm15\n\t"       \
+                "vpxor %%ymm15, %%ymm12, %%ymm12\n\t"
+#define vaes_ghash_add_hash_0 "vpxor %%ymm9, %%ymm13, %%ymm13\n\t"
+#define vaes_ghash_add_hash_1
+#define vaes_ghash_add_hash_2
+#define vaes_ghash_add_hash_3
+#define vaes_ghash_add_hash_4
+#define vaes_ghash_add_hash_5
+#define vaes_ghash_add_hash_6
+#define vaes_ghash_add_hash_7
+#define vaes_ghash_init                                                 \
+                "vpxor %%ymm10, %%ymm10, %%ymm10\n\t"                   \
+                "vpxor %%ymm11, %%ymm11, %%ymm11\n\t"                   \
+                "vpxor %%ymm12, %%ymm12, %%ymm12\n\t"
+
+/* Encrypt the sixteen blocks in ymm0 to ymm7 like do_vaes_enc16 and,
+   interleaved with the AES rounds, feed the sixteen blocks at HBUF into
+   GHASH.  The unreduced result is left in ymm10 to ymm12 for
+   vaes_gcm_reduce.  */
+static inline void
+do_vaes_enc16_ghash16 (const RIJNDAEL_context *ctx, const unsigned char *htab,
+                       const unsigned char *hbuf)
+{
+  asm volatile (vaes_ghash_init
+                vaes_crypt16 ("vaesenc", "vaesenclast",
+                              vaes_ghash_step (0),
+                              vaes_ghash_step (1),
+                              vaes_ghash_step (2),
+                              vaes_ghash_step (3),
+                              vaes_ghash_step (4),
+                              vaes_ghash_step (5),
+                              vaes_ghash_step (6),
+                              vaes_ghash_step (7))
+                : /* no output */
+                : [key] "r" (ctx->keyschenc),
+                  [rounds] "r" (ctx->rounds),
+                  [hbuf] "r" (hbuf),
+                  [htab] "r" (htab),
+                  [be_mask] "m" (*be_mask)
+                : "cc", "memory");
+}
+
+
+/* Feed the sixteen blocks at HBUF into GHASH without encrypting
+   anything.  The unreduced result is left in ymm10 to ymm12.  */
+static inline void
+do_vaes_ghash16 (const unsigned char *htab, const unsigned char *hbuf)
+{
+  asm volatile (vaes_ghash_init
+                vaes_ghash_step (0)
+                vaes_ghash_step (1)
+                vaes_ghash_step (2)
+                vaes_ghash_step (3)
+                vaes_ghash_step (4)
+                vaes_ghash_step (5)
+                vaes_ghash_step (6)
+                vaes_ghash_step (7)
+                : /* no output */
+                : [hbuf] "r" (hbuf),
+                  [htab] "r" (htab),
+                  [be_mask] "m" (*be_mask)
+                : "memory");
+}
+
+#undef vaes_ghash_step
+#undef vaes_ghash_add_hash_0
+#undef vaes_ghash_add_hash_1
+#undef vaes_ghash_add_hash_2
+#undef vaes_ghash_add_hash_3
+#undef vaes_ghash_add_hash_4
+#undef vaes_ghash_add_hash_5
+#undef vaes_ghash_add_hash_6
+#undef vaes_ghash_add_hash_7
+#undef vaes_ghash_init
+
+
+/* Add up the lanes of the products left in ymm10 to ymm12, reduce the
+   sum and store the new hash value into xmm9.  ymm0 to ymm4 are
+   clobbered.  */
+static inline void
+vaes_gcm_reduce (void)
+{
+  asm volatile ("vextracti128 $1, %%ymm10, %%xmm0\n\t"
+                "vextracti128 $1, %%ymm11, %%xmm1\n\t"
+                "vextracti128 $1, %%ymm12, %%xmm2\n\t"
+                "vpxor %%xmm0, %%xmm10, %%xmm10\n\t"
+                "vpxor %%xmm1, %%xmm11, %%xmm11\n\t"
+                "vpxor %%xmm2, %%xmm12, %%xmm12\n\t"
+                ghash_reduce ("%%xmm10", "%%xmm11", "%%xmm12", "%%xmm9",
+                              "%%xmm0", "%%xmm1", "%%xmm2", "%%xmm3",
+                              "%%xmm4")
+                ::: "memory");
+}
+
+#undef ghash_reduce
+#undef ghash_mul
+
+
+/* Bulk encryption/decryption of complete blocks in GCM mode.  Sixteen
+   counter blocks are encrypted at a time while GHASH is computed over
+   sixteen ciphertext blocks in the same pass.  The remaining blocks
+   are passed on to the AES-NI code.  Returns the number of blocks not
+   processed.  */
+size_t
+_gcry_aes_vaes_gcm_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                          const void *inbuf_arg, size_t nblocks,
+                          int encrypt)
+{
+  unsigned char htab[16 * BLOCKSIZE] ATTR_ALIGNED_16;
+  RIJNDAEL_context *ctx = (void *)&c->context.c;
+  unsigned char *outbuf = outbuf_arg;
+  const unsigned char *inbuf = inbuf_arg;
+  unsigned char *ctr = c->u_ctr.ctr;
+  const unsigned char *hbuf = NULL;
+
+  /* The powers of H are only available with the PCLMUL GHASH.  Setting
+     up the table with H⁹ to H¹⁶ pays off only for longer buffers.  */
+  if (nblocks < 32 || c->u_mode.gcm.ghash_fn != _gcry_ghash_intel_pclmul)
+    return _gcry_aes_aesni_gcm_crypt (c, outbuf, inbuf, nblocks, encrypt);
+
+  vaes_gcm_setup_htab (c, htab);
+
+  /* Preload hash. */
+  asm volatile ("vmovdqu %[hash], %%xmm9\n\t"
+                "vpshufb %[be_mask], %%xmm9, %%xmm9\n\t" /* be => le */
+                : /* No output */
+                : [hash] "m" (*c->u_mode.gcm.u_tag.tag),
+                  [be_mask] "m" (*be_mask)
+                : "memory");
+
+  for ( ;nblocks > 15 && ctr16_no_carry (ctr); nblocks -= 16 )
+    {
+      /* GHASH is computed over the ciphertext.  When encrypting, the
+         output of the previous iteration is hashed.  */
+      if (!encrypt)
+        hbuf = inbuf;
+
+      do_vaes_ctr16_prepare (ctr);
+
+      if (hbuf)
+        do_vaes_enc16_ghash16 (ctx, htab, hbuf);
+      else
+        do_vaes_enc16 (ctx->keyschenc, ctx->rounds);
+
+      do_vaes_xor16 (outbuf, inbuf);
+
+      if (hbuf)
+        vaes_gcm_reduce ();
+
+      if (encrypt)
+        hbuf = outbuf;
+
+      outbuf += 16*BLOCKSIZE;
+      inbuf  += 16*BLOCKSIZE;
+    }
+
+  if (encrypt && hbuf)
+    {
+      do_vaes_ghash16 (htab, hbuf);
+      vaes_gcm_reduce ();
+    }
+
+  /* Store hash. */
+  asm volatile ("vpshufb %[be_mask], %%xmm9, %%xmm9\n\t" /* le => be */
+                "vmovdqu %%xmm9, %[hash]\n\t"
+                : [hash] "=m" (*c->u_mode.gcm.u_tag.tag)
+                : [be_mask] "m" (*be_mask)
+                : "memory");
+
+  vaes_cleanup ();
+  wipememory (htab, sizeof (htab));
+
+  return _gcry_aes_aesni_gcm_crypt (c, outbuf, inbuf, nblocks, encrypt);
+}
+#endif /*GCM_USE_INTEL_PCLMUL*/
+
+#undef vaes_round
+#undef vaes_last_round
+#undef vaes_crypt16
+
+#endif /* USE_VAES */
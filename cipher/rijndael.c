@@ -86,6 +86,12 @@ extern void _gcry_aes_aesni_cbc_enc (RIJNDAEL_context *ctx,
                                      const unsigned char *inbuf,
                                      unsigned char *iv, size_t nblocks,
                                      int cbc_mac);
+extern void _gcry_aes_aesni_cbc_enc_multi (void **contexts,
+                                           unsigned char **ivs,
+                                           unsigned char **outbufs,
+                                           const unsigned char **inbufs,
+                                           size_t nlanes, size_t nblocks,
+                                           int cbc_mac);
 extern void _gcry_aes_aesni_ctr_enc (RIJNDAEL_context *ctx,
                                      unsigned char *outbuf,
                                      const unsigned char *inbuf,
@@ -103,6 +109,35 @@ extern void _gcry_aes_aesni_ocb_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
                                        int encrypt);
 extern void _gcry_aes_aesni_ocb_auth (gcry_cipher_hd_t c, const void *abuf_arg,
                                       size_t nblocks);
+extern size_t _gcry_aes_aesni_gcm_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                                         const void *inbuf_arg, size_t nblocks,
+                                         int encrypt);
+extern void _gcry_aes_aesni_xts_crypt (RIJNDAEL_context *ctx,
+                                       unsigned char *tweak,
+                                       unsigned char *outbuf,
+                                       const unsigned char *inbuf,
+                                       size_t nblocks, int encrypt);
+#endif
+
+#ifdef USE_VAES
+/* VAES/VPCLMUL (AMD64) accelerated implementations of AES */
+extern void _gcry_aes_vaes_ctr_enc (RIJNDAEL_context *ctx,
+                                    unsigned char *outbuf,
+                                    const unsigned char *inbuf,
+                                    unsigned char *ctr, size_t nblocks);
+extern void _gcry_aes_vaes_ocb_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                                      const void *inbuf_arg, size_t nblocks,
+                                      int encrypt);
+extern void _gcry_aes_vaes_ocb_auth (gcry_cipher_hd_t c, const void *abuf_arg,
+                                     size_t nblocks);
+extern size_t _gcry_aes_vaes_gcm_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                                        const void *inbuf_arg, size_t nblocks,
+                                        int encrypt);
+extern void _gcry_aes_vaes_xts_crypt (RIJNDAEL_context *ctx,
+                                      unsigned char *tweak,
+                                      unsigned char *outbuf,
+                                      const unsigned char *inbuf,
+                                      size_t nblocks, int encrypt);
 #endif
 
 #ifdef USE_SSSE3
@@ -279,6 +314,9 @@ do_setkey (RIJNDAEL_context *ctx, const byte *key, const unsigned keylen)
 #ifdef USE_AESNI
   ctx->use_aesni = 0;
 #endif
+#ifdef USE_VAES
+  ctx->use_vaes = 0;
+#endif
 #ifdef USE_SSSE3
   ctx->use_ssse3 = 0;
 #endif
@@ -295,6 +333,11 @@ do_setkey (RIJNDAEL_context *ctx, const byte *key, const unsigned keylen)
       ctx->prefetch_enc_fn = NULL;
       ctx->prefetch_dec_fn = NULL;
       ctx->use_aesni = 1;
+#ifdef USE_VAES
+      if ((hwfeatures & HWF_INTEL_VAES) && (hwfeatures & HWF_INTEL_VPCLMUL)
+          && (hwfeatures & HWF_INTEL_AVX2))
+        ctx->use_vaes = 1;
+#endif
     }
 #endif
 #ifdef USE_PADLOCK
@@ -825,6 +868,69 @@ _gcry_aes_cbc_enc (void *context, unsigned char *iv,
 }
 
 
+/* Bulk encryption of complete blocks in CBC mode for NLANES
+   independent streams.  Stream I uses the context CONTEXTS[I] and the
+   IV at IVS[I] to encrypt NBLOCKS blocks from INBUFS[I] to OUTBUFS[I].
+   This function is only intended for the batch encryption feature of
+   cipher.c. */
+void
+_gcry_aes_cbc_enc_multi (void **contexts, unsigned char **ivs,
+                         unsigned char **outbufs,
+                         const unsigned char **inbufs,
+                         size_t nlanes, size_t nblocks, int cbc_mac)
+{
+  RIJNDAEL_context *ctx;
+  size_t i;
+#ifdef USE_AESNI
+  void *sub_contexts[8];
+  unsigned char *sub_ivs[8];
+  unsigned char *sub_outbufs[8];
+  const unsigned char *sub_inbufs[8];
+  size_t nsub;
+  int rounds;
+
+  /* The AES-NI code interleaves the rounds of the streams and thus
+     processes streams with equal key lengths together.  */
+  for (rounds = 10; rounds <= 14; rounds += 2)
+    {
+      for (nsub = i = 0; i < nlanes; i++)
+        {
+          ctx = contexts[i];
+          if (!ctx->use_aesni || ctx->rounds != rounds)
+            continue;
+
+          sub_contexts[nsub] = contexts[i];
+          sub_ivs[nsub] = ivs[i];
+          sub_outbufs[nsub] = outbufs[i];
+          sub_inbufs[nsub] = inbufs[i];
+          if (++nsub == DIM (sub_contexts))
+            {
+              _gcry_aes_aesni_cbc_enc_multi (sub_contexts, sub_ivs,
+                                             sub_outbufs, sub_inbufs,
+                                             nsub, nblocks, cbc_mac);
+              nsub = 0;
+            }
+        }
+      if (nsub)
+        _gcry_aes_aesni_cbc_enc_multi (sub_contexts, sub_ivs,
+                                       sub_outbufs, sub_inbufs,
+                                       nsub, nblocks, cbc_mac);
+    }
+#endif /*USE_AESNI*/
+
+  for (i = 0; i < nlanes; i++)
+    {
+      ctx = contexts[i];
+#ifdef USE_AESNI
+      if (ctx->use_aesni)
+        continue;
+#endif /*USE_AESNI*/
+      _gcry_aes_cbc_enc (ctx, ivs[i], outbufs[i], inbufs[i],
+                         nblocks, cbc_mac);
+    }
+}
+
+
 /* Bulk encryption of complete blocks in CTR mode.  Caller needs to
    make sure that CTR is aligned on a 16 byte boundary if AESNI; the
    minimum alignment is for an u32.  This function is only intended
@@ -846,6 +952,13 @@ _gcry_aes_ctr_enc (void *context, unsigned char *ctr,
 
   if (0)
     ;
+#ifdef USE_VAES
+  else if (ctx->use_vaes)
+    {
+      _gcry_aes_vaes_ctr_enc (ctx, outbuf, inbuf, ctr, nblocks);
+      burn_depth = 0;
+    }
+#endif /*USE_VAES*/
 #ifdef USE_AESNI
   else if (ctx->use_aesni)
     {
@@ -1224,6 +1337,13 @@ _gcry_aes_ocb_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
 
   if (0)
     ;
+#ifdef USE_VAES
+  else if (ctx->use_vaes)
+    {
+      _gcry_aes_vaes_ocb_crypt (c, outbuf, inbuf, nblocks, encrypt);
+      burn_depth = 0;
+    }
+#endif /*USE_VAES*/
 #ifdef USE_AESNI
   else if (ctx->use_aesni)
     {
@@ -1309,6 +1429,13 @@ _gcry_aes_ocb_auth (gcry_cipher_hd_t c, const void *abuf_arg, size_t nblocks)
 
   if (0)
     ;
+#ifdef USE_VAES
+  else if (ctx->use_vaes)
+    {
+      _gcry_aes_vaes_ocb_auth (c, abuf, nblocks);
+      burn_depth = 0;
+    }
+#endif /*USE_VAES*/
 #ifdef USE_AESNI
   else if (ctx->use_aesni)
     {
@@ -1353,6 +1480,123 @@ _gcry_aes_ocb_auth (gcry_cipher_hd_t c, const void *abuf_arg, size_t nblocks)
 }
 
 
+/* Bulk encryption/decryption of complete blocks in GCM mode.  This
+   covers both the CTR encryption and the GHASH of the ciphertext.
+   Returns the number of blocks not processed, which the caller needs
+   to handle the usual way.  */
+size_t
+_gcry_aes_gcm_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                     const void *inbuf_arg, size_t nblocks, int encrypt)
+{
+#ifdef USE_AESNI
+  RIJNDAEL_context *ctx = (void *)&c->context.c;
+
+#if defined(USE_VAES) && defined(GCM_USE_INTEL_PCLMUL)
+  if (ctx->use_vaes)
+    return _gcry_aes_vaes_gcm_crypt (c, outbuf_arg, inbuf_arg, nblocks,
+                                     encrypt);
+#endif
+  if (ctx->use_aesni)
+    return _gcry_aes_aesni_gcm_crypt (c, outbuf_arg, inbuf_arg, nblocks,
+                                      encrypt);
+#else
+  (void)c;
+  (void)outbuf_arg;
+  (void)inbuf_arg;
+  (void)encrypt;
+#endif /*USE_AESNI*/
+
+  return nblocks;
+}
+
+
+/* Bulk encryption/decryption of complete blocks in XTS mode. */
+void
+_gcry_aes_xts_crypt (void *context, unsigned char *tweak,
+                     void *outbuf_arg, const void *inbuf_arg,
+                     size_t nblocks, int encrypt)
+{
+  RIJNDAEL_context *ctx = context;
+  unsigned char *outbuf = outbuf_arg;
+  const unsigned char *inbuf = inbuf_arg;
+  unsigned int burn_depth = 0;
+  rijndael_cryptfn_t crypt_fn;
+  u64 tweak_lo, tweak_hi, tweak_next_lo, tweak_next_hi, tmp_lo, tmp_hi, carry;
+
+  if (encrypt)
+    {
+      if (ctx->prefetch_enc_fn)
+        ctx->prefetch_enc_fn();
+
+      crypt_fn = ctx->encrypt_fn;
+    }
+  else
+    {
+      check_decryption_preparation (ctx);
+
+      if (ctx->prefetch_dec_fn)
+        ctx->prefetch_dec_fn();
+
+      crypt_fn = ctx->decrypt_fn;
+    }
+
+  if (0)
+    ;
+#ifdef USE_VAES
+  else if (ctx->use_vaes)
+    {
+      _gcry_aes_vaes_xts_crypt (ctx, tweak, outbuf, inbuf, nblocks, encrypt);
+      burn_depth = 0;
+    }
+#endif /*USE_VAES*/
+#ifdef USE_AESNI
+  else if (ctx->use_aesni)
+    {
+      _gcry_aes_aesni_xts_crypt (ctx, tweak, outbuf, inbuf, nblocks, encrypt);
+      burn_depth = 0;
+    }
+#endif /*USE_AESNI*/
+  else
+    {
+      tweak_next_lo = buf_get_le64 (tweak + 0);
+      tweak_next_hi = buf_get_le64 (tweak + 8);
+
+      while (nblocks)
+        {
+          tweak_lo = tweak_next_lo;
+          tweak_hi = tweak_next_hi;
+
+          /* Xor-Encrypt/Decrypt-Xor block. */
+          tmp_lo = buf_get_le64 (inbuf + 0) ^ tweak_lo;
+          tmp_hi = buf_get_le64 (inbuf + 8) ^ tweak_hi;
+
+          buf_put_le64 (outbuf + 0, tmp_lo);
+          buf_put_le64 (outbuf + 8, tmp_hi);
+
+          /* Generate next tweak. */
+          carry = -(tweak_next_hi >> 63) & 0x87;
+          tweak_next_hi = (tweak_next_hi << 1) + (tweak_next_lo >> 63);
+          tweak_next_lo = (tweak_next_lo << 1) ^ carry;
+
+          burn_depth = crypt_fn (ctx, outbuf, outbuf);
+
+          buf_put_le64 (outbuf + 0, buf_get_le64 (outbuf + 0) ^ tweak_lo);
+          buf_put_le64 (outbuf + 8, buf_get_le64 (outbuf + 8) ^ tweak_hi);
+
+          outbuf += BLOCKSIZE;
+          inbuf += BLOCKSIZE;
+          nblocks--;
+        }
+
+      buf_put_le64 (tweak + 0, tweak_next_lo);
+      buf_put_le64 (tweak + 8, tweak_next_hi);
+    }
+
+  if (burn_depth)
+    _gcry_burn_stack (burn_depth + 4 * sizeof(void *));
+}
+
+
 
 /* Run the self-tests for AES 128.  Returns NULL on success. */
 static const char*
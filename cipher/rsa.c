@@ -50,6 +50,8 @@ typedef struct
   gcry_mpi_t p;	    /* prime  p. */
   gcry_mpi_t q;	    /* prime  q. */
   gcry_mpi_t u;	    /* inverse of p mod q. */
+  gcry_mpi_t dp;    /* d mod (p-1); optional. */
+  gcry_mpi_t dq;    /* d mod (q-1); optional. */
 } RSA_secret_key;
 
 
@@ -905,6 +907,51 @@ check_secret_key( RSA_secret_key *sk )
 }
 
 
+/****************
+ * Test whether the optional CRT exponents of SK are d mod (p-1) and
+ * d mod (q-1).  A wrong value would yield a signature which is only
+ * correct modulo one of the primes and thus reveal the other one.
+ * Instead of the division of d we check that 0 < dp < p-1 and
+ * dp * e = 1 mod (p-1), which only holds for d mod (p-1).
+ * Returns: true if the exponents are valid or not given.
+ */
+static int
+check_crt_exponents (RSA_secret_key *sk)
+{
+  int okay = 1;
+  gcry_mpi_t t, pm1;
+
+  if (!sk->p || !sk->q || !sk->u || (!sk->dp && !sk->dq))
+    return 1;
+
+  t = mpi_alloc_secure (mpi_get_nlimbs (sk->n) + mpi_get_nlimbs (sk->e) + 1);
+  pm1 = mpi_alloc_secure (mpi_get_nlimbs (sk->n) + 1);
+
+  if (sk->dp)
+    {
+      mpi_sub_ui (pm1, sk->p, 1);
+      mpi_mul (t, sk->dp, sk->e);
+      mpi_fdiv_r (t, t, pm1);
+      if (mpi_has_sign (sk->dp) || mpi_cmp (sk->dp, pm1) >= 0
+          || mpi_cmp_ui (t, 1))
+        okay = 0;
+    }
+  if (sk->dq && okay)
+    {
+      mpi_sub_ui (pm1, sk->q, 1);
+      mpi_mul (t, sk->dq, sk->e);
+      mpi_fdiv_r (t, t, pm1);
+      if (mpi_has_sign (sk->dq) || mpi_cmp (sk->dq, pm1) >= 0
+          || mpi_cmp_ui (t, 1))
+        okay = 0;
+    }
+
+  mpi_free (pm1);
+  mpi_free (t);
+  return okay;
+}
+
+
 
 /****************
  * Public key operation. Encrypt INPUT with PKEY and put result into OUTPUT.
@@ -1005,6 +1052,8 @@ stronger_key_check ( RSA_secret_key *skey )
  *      m = m1 + h * p
  *
  * Where m is OUTPUT, c is INPUT and d,n,p,q,u are elements of SKEY.
+ * The exponents d mod (p-1) and d mod (q-1) are taken from SKEY if
+ * available.
  */
 static void
 secret (gcry_mpi_t output, gcry_mpi_t input, RSA_secret_key *skey )
@@ -1021,15 +1070,27 @@ secret (gcry_mpi_t output, gcry_mpi_t input, RSA_secret_key *skey )
       gcry_mpi_t m1 = mpi_alloc_secure( mpi_get_nlimbs(skey->n)+1 );
       gcry_mpi_t m2 = mpi_alloc_secure( mpi_get_nlimbs(skey->n)+1 );
       gcry_mpi_t h  = mpi_alloc_secure( mpi_get_nlimbs(skey->n)+1 );
+      gcry_mpi_t dp = skey->dp;
+      gcry_mpi_t dq = skey->dq;
+
+      /* dp = d mod (p-1), dq = d mod (q-1) unless given with the key.  */
+      if (!dp)
+        {
+          dp = mpi_alloc_secure (mpi_get_nlimbs (skey->p)+1);
+          mpi_sub_ui (h, skey->p, 1);
+          mpi_fdiv_r (dp, skey->d, h);
+        }
+      if (!dq)
+        {
+          dq = mpi_alloc_secure (mpi_get_nlimbs (skey->q)+1);
+          mpi_sub_ui (h, skey->q, 1);
+          mpi_fdiv_r (dq, skey->d, h);
+        }
 
       /* m1 = c ^ (d mod (p-1)) mod p */
-      mpi_sub_ui( h, skey->p, 1  );
-      mpi_fdiv_r( h, skey->d, h );
-      mpi_powm( m1, input, h, skey->p );
+      mpi_powm (m1, input, dp, skey->p);
       /* m2 = c ^ (d mod (q-1)) mod q */
-      mpi_sub_ui( h, skey->q, 1  );
-      mpi_fdiv_r( h, skey->d, h );
-      mpi_powm( m2, input, h, skey->q );
+      mpi_powm (m2, input, dq, skey->q);
       /* h = u * ( m2 - m1 ) mod q */
       mpi_sub( h, m2, m1 );
       if ( mpi_has_sign ( h ) )
@@ -1039,6 +1100,10 @@ secret (gcry_mpi_t output, gcry_mpi_t input, RSA_secret_key *skey )
       mpi_mul ( h, h, skey->p );
       mpi_add ( output, m1, h );
 
+      if (dp != skey->dp)
+        mpi_free (dp);
+      if (dq != skey->dq)
+        mpi_free (dq);
       mpi_free ( h );
       mpi_free ( m1 );
       mpi_free ( m2 );
@@ -1163,16 +1228,16 @@ static gcry_err_code_t
 rsa_check_secret_key (gcry_sexp_t keyparms)
 {
   gcry_err_code_t rc;
-  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL};
+  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
 
   /* To check the key we need the optional parameters. */
-  rc = sexp_extract_param (keyparms, NULL, "nedpqu",
+  rc = sexp_extract_param (keyparms, NULL, "nedpqu'dp'?'dq'?",
                            &sk.n, &sk.e, &sk.d, &sk.p, &sk.q, &sk.u,
-                           NULL);
+                           &sk.dp, &sk.dq, NULL);
   if (rc)
     goto leave;
 
-  if (!check_secret_key (&sk))
+  if (!check_secret_key (&sk) || !check_crt_exponents (&sk))
     rc = GPG_ERR_BAD_SECKEY;
 
  leave:
@@ -1182,6 +1247,8 @@ rsa_check_secret_key (gcry_sexp_t keyparms)
   _gcry_mpi_release (sk.p);
   _gcry_mpi_release (sk.q);
   _gcry_mpi_release (sk.u);
+  _gcry_mpi_release (sk.dp);
+  _gcry_mpi_release (sk.dq);
   if (DBG_CIPHER)
     log_debug ("rsa_testkey    => %s\n", gpg_strerror (rc));
   return rc;
@@ -1264,7 +1331,7 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   struct pk_encoding_ctx ctx;
   gcry_sexp_t l1 = NULL;
   gcry_mpi_t data = NULL;
-  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL};
+  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
   gcry_mpi_t plain = NULL;
   gcry_mpi_t r = NULL;	   /* Random number needed for blinding.  */
   gcry_mpi_t ri = NULL;	   /* Modular multiplicative inverse of r.  */
@@ -1291,9 +1358,9 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
     }
 
   /* Extract the key.  */
-  rc = sexp_extract_param (keyparms, NULL, "nedp?q?u?",
+  rc = sexp_extract_param (keyparms, NULL, "nedp?q?u?'dp'?'dq'?",
                            &sk.n, &sk.e, &sk.d, &sk.p, &sk.q, &sk.u,
-                           NULL);
+                           &sk.dp, &sk.dq, NULL);
   if (rc)
     goto leave;
   if (DBG_CIPHER)
@@ -1309,6 +1376,12 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
         }
     }
 
+  if (!check_crt_exponents (&sk))
+    {
+      rc = GPG_ERR_BAD_SECKEY;
+      goto leave;
+    }
+
   /* Better make sure that there are no superfluous leading zeroes in
      the input and it has not been "padded" using multiples of N.
      This mitigates side-channel attacks (CVE-2013-4576).  */
@@ -1402,6 +1475,8 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   _gcry_mpi_release (sk.p);
   _gcry_mpi_release (sk.q);
   _gcry_mpi_release (sk.u);
+  _gcry_mpi_release (sk.dp);
+  _gcry_mpi_release (sk.dq);
   _gcry_mpi_release (data);
   _gcry_mpi_release (r);
   _gcry_mpi_release (ri);
@@ -1420,7 +1495,7 @@ rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   gpg_err_code_t rc;
   struct pk_encoding_ctx ctx;
   gcry_mpi_t data = NULL;
-  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL};
+  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
   RSA_public_key pk;
   gcry_mpi_t sig = NULL;
   gcry_mpi_t result = NULL;
@@ -1441,9 +1516,9 @@ rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
     }
 
   /* Extract the key.  */
-  rc = sexp_extract_param (keyparms, NULL, "nedp?q?u?",
+  rc = sexp_extract_param (keyparms, NULL, "nedp?q?u?'dp'?'dq'?",
                            &sk.n, &sk.e, &sk.d, &sk.p, &sk.q, &sk.u,
-                           NULL);
+                           &sk.dp, &sk.dq, NULL);
   if (rc)
     goto leave;
   if (DBG_CIPHER)
@@ -1459,6 +1534,12 @@ rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
         }
     }
 
+  if (!check_crt_exponents (&sk))
+    {
+      rc = GPG_ERR_BAD_SECKEY;
+      goto leave;
+    }
+
   /* Do RSA computation.  */
   sig = mpi_new (0);
   secret (sig, data, &sk);
@@ -1505,6 +1586,8 @@ rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   _gcry_mpi_release (sk.p);
   _gcry_mpi_release (sk.q);
   _gcry_mpi_release (sk.u);
+  _gcry_mpi_release (sk.dp);
+  _gcry_mpi_release (sk.dq);
   _gcry_mpi_release (data);
   _gcry_pk_util_free_encoding_ctx (&ctx);
   if (DBG_CIPHER)
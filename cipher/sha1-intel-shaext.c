@@ -0,0 +1,205 @@
+/* sha1-intel-shaext.c - SHAEXT accelerated SHA-1 transform function
+ * Copyright (C) 2016 Free Software Foundation, Inc.
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "g10lib.h"
+
+#if defined(HAVE_GCC_INLINE_ASM_SHAEXT) && \
+    defined(ENABLE_SHAEXT_SUPPORT) && __GNUC__ >= 4 && \
+    ((defined(__i386__) && SIZEOF_UNSIGNED_LONG == 4) || defined(__x86_64__))
+
+
+#if _GCRY_GCC_VERSION >= 40400 /* 4.4 */
+/* Prevent compiler from issuing SSE instructions between asm blocks. */
+#  pragma GCC target("no-sse")
+#endif
+
+
+#define ALIGNED_16 __attribute__ ((aligned (16)))
+
+
+/* Byte swap mask for loading the big-endian message block. */
+static const unsigned char be_mask[16] ALIGNED_16 =
+  { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+
+
+/* Register usage: XMM0 holds the state words ABCD, XMM1 and XMM2 take
+ * turns holding E, XMM3-XMM6 the message schedule and XMM7 the byte swap
+ * mask.  Only XMM0-XMM7 are used so that the same code works on i386. */
+#define ABCD "%%xmm0"
+#define E0   "%%xmm1"
+#define E1   "%%xmm2"
+#define MSG0 "%%xmm3"
+#define MSG1 "%%xmm4"
+#define MSG2 "%%xmm5"
+#define MSG3 "%%xmm6"
+#define MASK "%%xmm7"
+
+/* Load and byte swap message words 4*I..4*I+3 into X. */
+#define LOAD_MSG(i, x) \
+        "movdqu " #i "*16(%[data]), " x "\n\t" \
+        "pshufb " MASK ", " x "\n\t"
+
+/* Four rounds with round function F using the message words in X.  E_IN
+ * holds E for these rounds; E for the next four rounds is prepared in
+ * E_OUT.  OPS1 and OPS2 are message schedule instructions interleaved with
+ * the rounds. */
+#define ROUNDS4(f, x, e_in, e_out, ops1, ops2) \
+        "sha1nexte " x ", " e_in "\n\t" \
+        "movdqa " ABCD ", " e_out "\n\t" \
+        ops1 \
+        "sha1rnds4 $" #f ", " e_in ", " ABCD "\n\t" \
+        ops2
+
+#define SCHED_MSG2(x, n) "sha1msg2 " x ", " n "\n\t"
+#define SCHED_MSG1(x, p) "sha1msg1 " x ", " p "\n\t"
+#define SCHED_XOR(x, q)  "pxor " x ", " q "\n\t"
+
+/* Rounds 12 to 67 all update the message schedule the same way. */
+#define ROUNDS4_SCHED(f, x, e_in, e_out, n, p, q) \
+        ROUNDS4(f, x, e_in, e_out, SCHED_MSG2(x, n), \
+                SCHED_MSG1(x, p) SCHED_XOR(x, q))
+
+
+/*
+ * Transform nblks*64 bytes (nblks*16 32-bit words) at DATA.
+ */
+unsigned int
+_gcry_sha1_transform_intel_shaext (void *state, const unsigned char *data,
+                                   size_t nblks)
+{
+  u32 save[8] ALIGNED_16;
+#if defined(__x86_64__) && defined(__WIN64__)
+  char win64tmp[2 * 16];
+#endif
+
+  if (nblks == 0)
+    return 0;
+
+#if defined(__x86_64__) && defined(__WIN64__)
+  /* XMM6-XMM7 need to be restored after use. */
+  asm volatile ("movdqu %%xmm6, 0*16(%0)\n\t"
+                "movdqu %%xmm7, 1*16(%0)\n\t"
+                :
+                : "r" (win64tmp)
+                : "memory");
+#endif
+
+  /* Load the state with A in the most significant word of ABCD and E in
+   * the most significant word of E0. */
+  asm volatile ("movdqu 0*16(%[state]), " ABCD "\n\t"
+                "pxor " E0 ", " E0 "\n\t"
+                "pinsrd $3, 1*16(%[state]), " E0 "\n\t"
+                "pshufd $0x1b, " ABCD ", " ABCD "\n\t"
+                "movdqa %[mask], " MASK "\n\t"
+                :
+                : [state] "r" (state),
+                  [mask] "m" (*be_mask)
+                : "memory");
+
+  do
+    {
+      asm volatile ("movdqa " E0 ", 0*16(%[save])\n\t"
+                    "movdqa " ABCD ", 1*16(%[save])\n\t"
+
+                    /* Rounds 0-3 */
+                    LOAD_MSG(0, MSG0)
+                    "paddd " MSG0 ", " E0 "\n\t"
+                    "movdqa " ABCD ", " E1 "\n\t"
+                    "sha1rnds4 $0, " E0 ", " ABCD "\n\t"
+
+                    /* Rounds 4-15 */
+                    LOAD_MSG(1, MSG1)
+                    ROUNDS4(0, MSG1, E1, E0, "", SCHED_MSG1(MSG1, MSG0))
+                    LOAD_MSG(2, MSG2)
+                    ROUNDS4(0, MSG2, E0, E1, "",
+                            SCHED_MSG1(MSG2, MSG1) SCHED_XOR(MSG2, MSG0))
+                    LOAD_MSG(3, MSG3)
+                    ROUNDS4_SCHED(0, MSG3, E1, E0, MSG0, MSG2, MSG1)
+
+                    /* Rounds 16-67 */
+                    ROUNDS4_SCHED(0, MSG0, E0, E1, MSG1, MSG3, MSG2)
+                    ROUNDS4_SCHED(1, MSG1, E1, E0, MSG2, MSG0, MSG3)
+                    ROUNDS4_SCHED(1, MSG2, E0, E1, MSG3, MSG1, MSG0)
+                    ROUNDS4_SCHED(1, MSG3, E1, E0, MSG0, MSG2, MSG1)
+                    ROUNDS4_SCHED(1, MSG0, E0, E1, MSG1, MSG3, MSG2)
+                    ROUNDS4_SCHED(1, MSG1, E1, E0, MSG2, MSG0, MSG3)
+                    ROUNDS4_SCHED(2, MSG2, E0, E1, MSG3, MSG1, MSG0)
+                    ROUNDS4_SCHED(2, MSG3, E1, E0, MSG0, MSG2, MSG1)
+                    ROUNDS4_SCHED(2, MSG0, E0, E1, MSG1, MSG3, MSG2)
+                    ROUNDS4_SCHED(2, MSG1, E1, E0, MSG2, MSG0, MSG3)
+                    ROUNDS4_SCHED(2, MSG2, E0, E1, MSG3, MSG1, MSG0)
+                    ROUNDS4_SCHED(3, MSG3, E1, E0, MSG0, MSG2, MSG1)
+                    ROUNDS4_SCHED(3, MSG0, E0, E1, MSG1, MSG3, MSG2)
+
+                    /* Rounds 68-79 */
+                    ROUNDS4(3, MSG1, E1, E0, SCHED_MSG2(MSG1, MSG2),
+                            SCHED_XOR(MSG1, MSG3))
+                    ROUNDS4(3, MSG2, E0, E1, SCHED_MSG2(MSG2, MSG3), "")
+                    ROUNDS4(3, MSG3, E1, E0, "", "")
+
+                    /* Add the saved state. */
+                    "sha1nexte 0*16(%[save]), " E0 "\n\t"
+                    "paddd 1*16(%[save]), " ABCD "\n\t"
+                    :
+                    : [data] "r" (data),
+                      [save] "r" (save)
+                    : "memory");
+
+      data += 64;
+    }
+  while (--nblks);
+
+  /* Store the state. */
+  asm volatile ("pshufd $0x1b, " ABCD ", " ABCD "\n\t"
+                "movdqu " ABCD ", 0*16(%[state])\n\t"
+                "pextrd $3, " E0 ", 1*16(%[state])\n\t"
+                :
+                : [state] "r" (state)
+                : "memory");
+
+  /* Clear the message and state from registers and the stack. */
+  asm volatile ("pxor %%xmm0, %%xmm0\n\t"
+                "pxor %%xmm1, %%xmm1\n\t"
+                "pxor %%xmm2, %%xmm2\n\t"
+                "pxor %%xmm3, %%xmm3\n\t"
+                "pxor %%xmm4, %%xmm4\n\t"
+                "pxor %%xmm5, %%xmm5\n\t"
+                "pxor %%xmm6, %%xmm6\n\t"
+                "pxor %%xmm7, %%xmm7\n\t"
+                "movdqa %%xmm0, 0*16(%[save])\n\t"
+                "movdqa %%xmm0, 1*16(%[save])\n\t"
+                :
+                : [save] "r" (save)
+                : "memory");
+
+#if defined(__x86_64__) && defined(__WIN64__)
+  /* Clear/restore used registers. */
+  asm volatile ("movdqu 0*16(%0), %%xmm6\n\t"
+                "movdqu 1*16(%0), %%xmm7\n\t"
+                :
+                : "r" (win64tmp)
+                : "memory");
+#endif
+
+  return 0;
+}
+
+#endif /* HAVE_GCC_INLINE_ASM_SHAEXT */
@@ -68,6 +68,31 @@
 # define USE_BMI2 0
 #endif
 
+/* USE_SHAEXT indicates whether to compile with Intel SHA Extension code. */
+#undef USE_SHAEXT
+#if defined(HAVE_GCC_INLINE_ASM_SHAEXT) && \
+    defined(ENABLE_SHAEXT_SUPPORT) && __GNUC__ >= 4 && \
+    ((defined(__i386__) && SIZEOF_UNSIGNED_LONG == 4) || defined(__x86_64__))
+# define USE_SHAEXT 1
+#endif
+
+/* USE_MULTI_AVX2 indicates whether to compile with the eight lane AVX2
+ * code for hashing several messages in parallel. */
+#undef USE_MULTI_AVX2
+#if defined(__x86_64__) && defined(HAVE_GCC_INLINE_ASM_AVX2) && \
+    defined(ENABLE_AVX2_SUPPORT) && \
+    (defined(HAVE_COMPATIBLE_GCC_AMD64_PLATFORM_AS) || \
+     defined(HAVE_COMPATIBLE_GCC_WIN64_PLATFORM_AS))
+# define USE_MULTI_AVX2 1
+#endif
+
+/* USE_MULTI_AVX512 indicates whether to compile with the sixteen lane
+ * AVX512 code for hashing several messages in parallel. */
+#undef USE_MULTI_AVX512
+#if defined(USE_MULTI_AVX2) && defined(HAVE_GCC_INLINE_ASM_AVX512)
+# define USE_MULTI_AVX512 1
+#endif
+
 /* USE_NEON indicates whether to enable ARM NEON assembly code. */
 #undef USE_NEON
 #ifdef ENABLE_NEON_SUPPORT
@@ -101,6 +126,9 @@ typedef struct
 #ifdef USE_BMI2
   unsigned int use_bmi2:1;
 #endif
+#ifdef USE_SHAEXT
+  unsigned int use_shaext:1;
+#endif
 #ifdef USE_NEON
   unsigned int use_neon:1;
 #endif
@@ -141,6 +169,9 @@ sha1_init (void *context, unsigned int flags)
 #ifdef USE_BMI2
   hd->use_bmi2 = (features & HWF_INTEL_AVX) && (features & HWF_INTEL_BMI2);
 #endif
+#ifdef USE_SHAEXT
+  hd->use_shaext = (features & HWF_INTEL_SHAEXT) != 0;
+#endif
 #ifdef USE_NEON
   hd->use_neon = (features & HWF_ARM_NEON) != 0;
 #endif
@@ -295,7 +326,8 @@ transform_blk (void *ctx, const unsigned char *data)
  * stack to store XMM6-XMM15 needed on Win64. */
 #undef ASM_FUNC_ABI
 #undef ASM_EXTRA_STACK
-#if defined(USE_SSSE3) || defined(USE_AVX) || defined(USE_BMI2)
+#if defined(USE_SSSE3) || defined(USE_AVX) || defined(USE_BMI2) || \
+    defined(USE_MULTI_AVX2)
 # ifdef HAVE_COMPATIBLE_GCC_WIN64_PLATFORM_AS
 #  define ASM_FUNC_ABI __attribute__((sysv_abi))
 #  define ASM_EXTRA_STACK (10 * 16)
@@ -324,6 +356,13 @@ _gcry_sha1_transform_amd64_avx_bmi2 (void *state, const unsigned char *data,
                                      size_t nblks) ASM_FUNC_ABI;
 #endif
 
+#ifdef USE_SHAEXT
+/* Does not need ASM_FUNC_ABI; wipes its own stack. */
+unsigned int
+_gcry_sha1_transform_intel_shaext (void *state, const unsigned char *data,
+                                   size_t nblks);
+#endif
+
 
 static unsigned int
 transform (void *ctx, const unsigned char *data, size_t nblks)
@@ -331,6 +370,11 @@ transform (void *ctx, const unsigned char *data, size_t nblks)
   SHA1_CONTEXT *hd = ctx;
   unsigned int burn;
 
+#ifdef USE_SHAEXT
+  if (hd->use_shaext)
+    return _gcry_sha1_transform_intel_shaext (&hd->h0, data, nblks);
+#endif
+
 #ifdef USE_BMI2
   if (hd->use_bmi2)
     return _gcry_sha1_transform_amd64_avx_bmi2 (&hd->h0, data, nblks)
@@ -477,6 +521,151 @@ _gcry_sha1_hash_buffers (void *outbuf, const gcry_buffer_t *iov, int iovcnt)
 }
 
 
+#ifdef USE_MULTI_AVX2
+unsigned int
+_gcry_sha1_multi_avx2_blocks (u32 *state, const unsigned char **data,
+                              size_t nblks) ASM_FUNC_ABI;
+
+static unsigned int
+sha1_multi_avx2 (u32 *state, const unsigned char **data, size_t nblks)
+{
+  return _gcry_sha1_multi_avx2_blocks (state, data, nblks)
+         + 4 * sizeof(void*) + ASM_EXTRA_STACK;
+}
+#endif
+
+#ifdef USE_MULTI_AVX512
+unsigned int
+_gcry_sha1_multi_avx512_blocks (u32 *state, const unsigned char **data,
+                                size_t nblks) ASM_FUNC_ABI;
+
+static unsigned int
+sha1_multi_avx512 (u32 *state, const unsigned char **data, size_t nblks)
+{
+  return _gcry_sha1_multi_avx512_blocks (state, data, nblks)
+         + 4 * sizeof(void*) + ASM_EXTRA_STACK;
+}
+#endif
+
+#if defined(USE_MULTI_AVX2) || defined(USE_MULTI_AVX512)
+static const u32 sha1_iv[5] =
+  {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+  };
+
+/* Run the single lane transform on the five state words at STATE.  */
+static unsigned int
+sha1_state_blocks (u32 *state, const unsigned char *data, size_t nblks)
+{
+  SHA1_CONTEXT hd;
+  unsigned int burn;
+
+  sha1_init (&hd, 0);
+  memcpy (&hd.h0, state, 5 * sizeof(u32));
+  burn = transform (&hd, data, nblks);
+  memcpy (state, &hd.h0, 5 * sizeof(u32));
+  wipememory (&hd, sizeof(hd));
+
+  return burn;
+}
+#endif
+
+/****************
+ * Hash the N messages BUFFERS[I] of LENGTHS[I] bytes and store the
+ * 20 byte digests at DIGESTS[I].  Returns GPG_ERR_NOT_SUPPORTED if
+ * there is no parallel implementation faster than hashing the messages
+ * one by one.
+ */
+gcry_err_code_t
+_gcry_sha1_hash_buffer_batch (void **digests, const void **buffers,
+                              const size_t *lengths, size_t n)
+{
+#if defined(USE_MULTI_AVX2) || defined(USE_MULTI_AVX512)
+  unsigned int features = _gcry_get_hw_features ();
+  gcry_md_multi_spec_t spec;
+
+  spec.nwords = 5;
+  spec.digestlen = 20;
+  spec.iv = sha1_iv;
+  spec.blocks = sha1_state_blocks;
+
+#ifdef USE_MULTI_AVX512
+  if (features & HWF_INTEL_AVX512)
+    {
+      spec.nlanes = 16;
+      spec.multi_blocks = sha1_multi_avx512;
+      _gcry_md_block_hash_multi (&spec, digests, buffers, lengths, n);
+      return 0;
+    }
+#endif
+
+  /* The SHA Extensions are faster than eight AVX2 lanes.  */
+  if ((features & HWF_INTEL_AVX2) && !(features & HWF_INTEL_SHAEXT))
+    {
+      spec.nlanes = 8;
+      spec.multi_blocks = sha1_multi_avx2;
+      _gcry_md_block_hash_multi (&spec, digests, buffers, lengths, n);
+      return 0;
+    }
+#else
+  (void)digests;
+  (void)buffers;
+  (void)lengths;
+  (void)n;
+#endif
+
+  return GPG_ERR_NOT_SUPPORTED;
+}
+
+
+/****************
+ * Derive KEYSIZE bytes to KEYBUFFER with PBKDF2 using HMAC-SHA-1, the
+ * passphrase PASSPHRASE, the salt SALT and ITERATIONS iterations.  The
+ * arguments have already been checked by the caller.
+ */
+void
+_gcry_sha1_pbkdf2 (const void *passphrase, size_t passphraselen,
+                   const void *salt, size_t saltlen,
+                   unsigned long iterations, size_t keysize, void *keybuffer)
+{
+  SHA1_CONTEXT hd;
+  gcry_md_pbkdf2_spec_t spec;
+#if defined(USE_MULTI_AVX2) || defined(USE_MULTI_AVX512)
+  unsigned int features = _gcry_get_hw_features ();
+#endif
+
+  sha1_init (&hd, 0);
+
+  spec.nwords = 5;
+  spec.digestlen = 20;
+  spec.ctx = &hd;
+  spec.state = &hd.h0;
+  spec.bwrite = transform;
+  spec.nlanes = 0;
+  spec.multi_blocks = NULL;
+
+#ifdef USE_MULTI_AVX512
+  if (features & HWF_INTEL_AVX512)
+    {
+      spec.nlanes = 16;
+      spec.multi_blocks = sha1_multi_avx512;
+    }
+  else
+#endif
+#ifdef USE_MULTI_AVX2
+  if ((features & HWF_INTEL_AVX2) && !(features & HWF_INTEL_SHAEXT))
+    {
+      spec.nlanes = 8;
+      spec.multi_blocks = sha1_multi_avx2;
+    }
+#endif
+
+  _gcry_md_block_pbkdf2 (&spec, passphrase, passphraselen, salt, saltlen,
+                         iterations, keysize, keybuffer);
+  wipememory (&hd, sizeof(hd));
+}
+
+
 
 /*
      Self-test section.
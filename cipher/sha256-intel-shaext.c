@@ -0,0 +1,226 @@
+/* sha256-intel-shaext.c - SHAEXT accelerated SHA-256 transform function
+ * Copyright (C) 2016 Free Software Foundation, Inc.
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "g10lib.h"
+
+#if defined(HAVE_GCC_INLINE_ASM_SHAEXT) && \
+    defined(ENABLE_SHAEXT_SUPPORT) && __GNUC__ >= 4 && defined(USE_SHA256) && \
+    ((defined(__i386__) && SIZEOF_UNSIGNED_LONG == 4) || defined(__x86_64__))
+
+
+#if _GCRY_GCC_VERSION >= 40400 /* 4.4 */
+/* Prevent compiler from issuing SSE instructions between asm blocks. */
+#  pragma GCC target("no-sse")
+#endif
+
+
+#define ALIGNED_16 __attribute__ ((aligned (16)))
+
+
+static const u32 K[64] ALIGNED_16 =
+  {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+
+/* Byte swap mask for loading big-endian message words. */
+static const unsigned char be_mask[16] ALIGNED_16 =
+  { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+
+
+/* Register usage: XMM0 is the implicit message operand of SHA256RNDS2,
+ * XMM1 and XMM2 hold the state as ABEF and CDGH, XMM3-XMM6 the message
+ * schedule and XMM7 is a temporary.  Only XMM0-XMM7 are used so that the
+ * same code works on i386. */
+#define MSG    "%%xmm0"
+#define STATE0 "%%xmm1"
+#define STATE1 "%%xmm2"
+#define MSGTMP0 "%%xmm3"
+#define MSGTMP1 "%%xmm4"
+#define MSGTMP2 "%%xmm5"
+#define MSGTMP3 "%%xmm6"
+#define TMP    "%%xmm7"
+
+/* Load and byte swap message words 4*I..4*I+3 into X. */
+#define LOAD_MSG(i, x) \
+        "movdqu " #i "*16(%[data]), " x "\n\t" \
+        "pshufb %[mask], " x "\n\t"
+
+/* Four rounds using the message words in X. */
+#define ROUNDS4(i, x, extra1, extra2) \
+        "movdqa " x ", " MSG "\n\t" \
+        "paddd " #i "*16(%[k]), " MSG "\n\t" \
+        "sha256rnds2 " STATE0 ", " STATE1 "\n\t" \
+        extra1 \
+        "pshufd $0x0e, " MSG ", " MSG "\n\t" \
+        "sha256rnds2 " STATE1 ", " STATE0 "\n\t" \
+        extra2
+
+/* Finish the next schedule words in N from the current words X and the
+ * previous words P. */
+#define MSG2(x, p, n) \
+        "movdqa " x ", " TMP "\n\t" \
+        "palignr $4, " p ", " TMP "\n\t" \
+        "paddd " TMP ", " n "\n\t" \
+        "sha256msg2 " x ", " n "\n\t"
+
+/* Start the schedule words in P. */
+#define MSG1(x, p) \
+        "sha256msg1 " x ", " p "\n\t"
+
+#define ROUNDS4_SCHED(i, x, p, n) \
+        ROUNDS4(i, x, MSG2(x, p, n), MSG1(x, p))
+
+
+/*
+ * Transform nblks*64 bytes (nblks*16 32-bit words) at DATA.
+ */
+unsigned int
+_gcry_sha256_transform_intel_shaext (void *state, const unsigned char *data,
+                                     size_t nblks)
+{
+  u32 save[8] ALIGNED_16;
+#if defined(__x86_64__) && defined(__WIN64__)
+  char win64tmp[2 * 16];
+#endif
+
+  if (nblks == 0)
+    return 0;
+
+#if defined(__x86_64__) && defined(__WIN64__)
+  /* XMM6-XMM7 need to be restored after use. */
+  asm volatile ("movdqu %%xmm6, 0*16(%0)\n\t"
+                "movdqu %%xmm7, 1*16(%0)\n\t"
+                :
+                : "r" (win64tmp)
+                : "memory");
+#endif
+
+  /* Reorder the state words to ABEF and CDGH. */
+  asm volatile ("movdqu 0*16(%[state]), " STATE0 "\n\t" /* DCBA */
+                "movdqu 1*16(%[state]), " STATE1 "\n\t" /* HGFE */
+                "pshufd $0xb1, " STATE0 ", " STATE0 "\n\t" /* CDAB */
+                "pshufd $0x1b, " STATE1 ", " STATE1 "\n\t" /* EFGH */
+                "movdqa " STATE0 ", " TMP "\n\t"
+                "palignr $8, " STATE1 ", " STATE0 "\n\t" /* ABEF */
+                "pblendw $0xf0, " TMP ", " STATE1 "\n\t" /* CDGH */
+                :
+                : [state] "r" (state)
+                : "memory");
+
+  do
+    {
+      asm volatile ("movdqa " STATE0 ", 0*16(%[save])\n\t"
+                    "movdqa " STATE1 ", 1*16(%[save])\n\t"
+
+                    LOAD_MSG(0, MSGTMP0)
+                    ROUNDS4(0, MSGTMP0, "", "")
+
+                    LOAD_MSG(1, MSGTMP1)
+                    ROUNDS4(1, MSGTMP1, "", MSG1(MSGTMP1, MSGTMP0))
+
+                    LOAD_MSG(2, MSGTMP2)
+                    ROUNDS4(2, MSGTMP2, "", MSG1(MSGTMP2, MSGTMP1))
+
+                    LOAD_MSG(3, MSGTMP3)
+                    ROUNDS4_SCHED(3, MSGTMP3, MSGTMP2, MSGTMP0)
+
+                    ROUNDS4_SCHED(4, MSGTMP0, MSGTMP3, MSGTMP1)
+                    ROUNDS4_SCHED(5, MSGTMP1, MSGTMP0, MSGTMP2)
+                    ROUNDS4_SCHED(6, MSGTMP2, MSGTMP1, MSGTMP3)
+                    ROUNDS4_SCHED(7, MSGTMP3, MSGTMP2, MSGTMP0)
+                    ROUNDS4_SCHED(8, MSGTMP0, MSGTMP3, MSGTMP1)
+                    ROUNDS4_SCHED(9, MSGTMP1, MSGTMP0, MSGTMP2)
+                    ROUNDS4_SCHED(10, MSGTMP2, MSGTMP1, MSGTMP3)
+                    ROUNDS4_SCHED(11, MSGTMP3, MSGTMP2, MSGTMP0)
+                    ROUNDS4_SCHED(12, MSGTMP0, MSGTMP3, MSGTMP1)
+
+                    ROUNDS4(13, MSGTMP1, MSG2(MSGTMP1, MSGTMP0, MSGTMP2), "")
+                    ROUNDS4(14, MSGTMP2, MSG2(MSGTMP2, MSGTMP1, MSGTMP3), "")
+                    ROUNDS4(15, MSGTMP3, "", "")
+
+                    "paddd 0*16(%[save]), " STATE0 "\n\t"
+                    "paddd 1*16(%[save]), " STATE1 "\n\t"
+                    :
+                    : [data] "r" (data),
+                      [k] "r" (K),
+                      [mask] "m" (*be_mask),
+                      [save] "r" (save)
+                    : "memory");
+
+      data += 64;
+    }
+  while (--nblks);
+
+  /* Store the state in the original word order. */
+  asm volatile ("pshufd $0x1b, " STATE0 ", " STATE0 "\n\t" /* FEBA */
+                "pshufd $0xb1, " STATE1 ", " STATE1 "\n\t" /* DCHG */
+                "movdqa " STATE0 ", " TMP "\n\t"
+                "pblendw $0xf0, " STATE1 ", " STATE0 "\n\t" /* DCBA */
+                "palignr $8, " TMP ", " STATE1 "\n\t" /* HGFE */
+                "movdqu " STATE0 ", 0*16(%[state])\n\t"
+                "movdqu " STATE1 ", 1*16(%[state])\n\t"
+                :
+                : [state] "r" (state)
+                : "memory");
+
+  /* Clear the message and state from registers and the stack. */
+  asm volatile ("pxor %%xmm0, %%xmm0\n\t"
+                "pxor %%xmm1, %%xmm1\n\t"
+                "pxor %%xmm2, %%xmm2\n\t"
+                "pxor %%xmm3, %%xmm3\n\t"
+                "pxor %%xmm4, %%xmm4\n\t"
+                "pxor %%xmm5, %%xmm5\n\t"
+                "pxor %%xmm6, %%xmm6\n\t"
+                "pxor %%xmm7, %%xmm7\n\t"
+                "movdqa %%xmm0, 0*16(%[save])\n\t"
+                "movdqa %%xmm0, 1*16(%[save])\n\t"
+                :
+                : [save] "r" (save)
+                : "memory");
+
+#if defined(__x86_64__) && defined(__WIN64__)
+  /* Clear/restore used registers. */
+  asm volatile ("movdqu 0*16(%0), %%xmm6\n\t"
+                "movdqu 1*16(%0), %%xmm7\n\t"
+                :
+                : "r" (win64tmp)
+                : "memory");
+#endif
+
+  return 0;
+}
+
+#endif /* HAVE_GCC_INLINE_ASM_SHAEXT */
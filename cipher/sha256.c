@@ -75,6 +75,31 @@
 # define USE_AVX2 1
 #endif
 
+/* USE_SHAEXT indicates whether to compile with Intel SHA Extension code. */
+#undef USE_SHAEXT
+#if defined(HAVE_GCC_INLINE_ASM_SHAEXT) && \
+    defined(ENABLE_SHAEXT_SUPPORT) && __GNUC__ >= 4 && \
+    ((defined(__i386__) && SIZEOF_UNSIGNED_LONG == 4) || defined(__x86_64__))
+# define USE_SHAEXT 1
+#endif
+
+/* USE_MULTI_AVX2 indicates whether to compile with the eight lane AVX2
+ * code for hashing several messages in parallel. */
+#undef USE_MULTI_AVX2
+#if defined(__x86_64__) && defined(HAVE_GCC_INLINE_ASM_AVX2) && \
+    defined(ENABLE_AVX2_SUPPORT) && \
+    (defined(HAVE_COMPATIBLE_GCC_AMD64_PLATFORM_AS) || \
+     defined(HAVE_COMPATIBLE_GCC_WIN64_PLATFORM_AS))
+# define USE_MULTI_AVX2 1
+#endif
+
+/* USE_MULTI_AVX512 indicates whether to compile with the sixteen lane
+ * AVX512 code for hashing several messages in parallel. */
+#undef USE_MULTI_AVX512
+#if defined(USE_MULTI_AVX2) && defined(HAVE_GCC_INLINE_ASM_AVX512)
+# define USE_MULTI_AVX512 1
+#endif
+
 
 typedef struct {
   gcry_md_block_ctx_t bctx;
@@ -88,6 +113,9 @@ typedef struct {
 #ifdef USE_AVX2
   unsigned int use_avx2:1;
 #endif
+#ifdef USE_SHAEXT
+  unsigned int use_shaext:1;
+#endif
 } SHA256_CONTEXT;
 
 
@@ -128,6 +156,9 @@ sha256_init (void *context, unsigned int flags)
 #endif
 #ifdef USE_AVX2
   hd->use_avx2 = (features & HWF_INTEL_AVX2) && (features & HWF_INTEL_BMI2);
+#endif
+#ifdef USE_SHAEXT
+  hd->use_shaext = (features & HWF_INTEL_SHAEXT) != 0;
 #endif
   (void)features;
 }
@@ -166,6 +197,9 @@ sha224_init (void *context, unsigned int flags)
 #endif
 #ifdef USE_AVX2
   hd->use_avx2 = (features & HWF_INTEL_AVX2) && (features & HWF_INTEL_BMI2);
+#endif
+#ifdef USE_SHAEXT
+  hd->use_shaext = (features & HWF_INTEL_SHAEXT) != 0;
 #endif
   (void)features;
 }
@@ -326,7 +360,8 @@ transform_blk (void *ctx, const unsigned char *data)
  * stack to store XMM6-XMM15 needed on Win64. */
 #undef ASM_FUNC_ABI
 #undef ASM_EXTRA_STACK
-#if defined(USE_SSSE3) || defined(USE_AVX) || defined(USE_AVX2)
+#if defined(USE_SSSE3) || defined(USE_AVX) || defined(USE_AVX2) || \
+    defined(USE_MULTI_AVX2)
 # ifdef HAVE_COMPATIBLE_GCC_WIN64_PLATFORM_AS
 #  define ASM_FUNC_ABI __attribute__((sysv_abi))
 #  define ASM_EXTRA_STACK (10 * 16)
@@ -339,22 +374,29 @@ transform_blk (void *ctx, const unsigned char *data)
 
 #ifdef USE_SSSE3
 unsigned int _gcry_sha256_transform_amd64_ssse3(const void *input_data,
-                                                u32 state[8],
+                                                void *state,
                                                 size_t num_blks) ASM_FUNC_ABI;
 #endif
 
 #ifdef USE_AVX
 unsigned int _gcry_sha256_transform_amd64_avx(const void *input_data,
-                                              u32 state[8],
+                                              void *state,
                                               size_t num_blks) ASM_FUNC_ABI;
 #endif
 
 #ifdef USE_AVX2
 unsigned int _gcry_sha256_transform_amd64_avx2(const void *input_data,
-                                               u32 state[8],
+                                               void *state,
                                                size_t num_blks) ASM_FUNC_ABI;
 #endif
 
+#ifdef USE_SHAEXT
+/* Does not need ASM_FUNC_ABI; wipes its own stack. */
+unsigned int
+_gcry_sha256_transform_intel_shaext (void *state, const unsigned char *data,
+                                     size_t nblks);
+#endif
+
 
 static unsigned int
 transform (void *ctx, const unsigned char *data, size_t nblks)
@@ -362,6 +404,11 @@ transform (void *ctx, const unsigned char *data, size_t nblks)
   SHA256_CONTEXT *hd = ctx;
   unsigned int burn;
 
+#ifdef USE_SHAEXT
+  if (hd->use_shaext)
+    return _gcry_sha256_transform_intel_shaext (&hd->h0, data, nblks);
+#endif
+
 #ifdef USE_AVX2
   if (hd->use_avx2)
     return _gcry_sha256_transform_amd64_avx2 (data, &hd->h0, nblks)
@@ -475,6 +522,198 @@ sha256_read (void *context)
 }
 
 
+
+/*
+     Hashing of several messages in parallel.
+ */
+
+#ifdef USE_MULTI_AVX2
+unsigned int _gcry_sha256_multi_avx2_blocks(u32 *state,
+                                            const unsigned char **data,
+                                            size_t num_blks) ASM_FUNC_ABI;
+
+static unsigned int
+sha256_multi_avx2 (u32 *state, const unsigned char **data, size_t nblks)
+{
+  return _gcry_sha256_multi_avx2_blocks (state, data, nblks)
+         + 4 * sizeof(void*) + ASM_EXTRA_STACK;
+}
+#endif
+
+#ifdef USE_MULTI_AVX512
+unsigned int _gcry_sha256_multi_avx512_blocks(u32 *state,
+                                              const unsigned char **data,
+                                              size_t num_blks) ASM_FUNC_ABI;
+
+static unsigned int
+sha256_multi_avx512 (u32 *state, const unsigned char **data, size_t nblks)
+{
+  return _gcry_sha256_multi_avx512_blocks (state, data, nblks)
+         + 4 * sizeof(void*) + ASM_EXTRA_STACK;
+}
+#endif
+
+#if defined(USE_MULTI_AVX2) || defined(USE_MULTI_AVX512)
+static const u32 sha224_iv[8] =
+  {
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+    0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+  };
+
+static const u32 sha256_iv[8] =
+  {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+
+/* Run the single lane transform on the eight state words at STATE. */
+static unsigned int
+sha256_state_blocks (u32 *state, const unsigned char *data, size_t nblks)
+{
+  SHA256_CONTEXT hd;
+  unsigned int burn;
+
+  sha256_init (&hd, 0);
+  memcpy (&hd.h0, state, 8 * sizeof(u32));
+  burn = transform (&hd, data, nblks);
+  memcpy (state, &hd.h0, 8 * sizeof(u32));
+  wipememory (&hd, sizeof(hd));
+
+  return burn;
+}
+#endif
+
+/* Hash the N messages BUFFERS[I] of LENGTHS[I] bytes with SHA-224
+   (if IS_SHA224 is set) or SHA-256 and store the digests at
+   DIGESTS[I].  Returns GPG_ERR_NOT_SUPPORTED if there is no parallel
+   implementation faster than hashing the messages one by one.  */
+static gcry_err_code_t
+sha256_hash_buffer_batch (int is_sha224, void **digests,
+                          const void **buffers, const size_t *lengths,
+                          size_t n)
+{
+#if defined(USE_MULTI_AVX2) || defined(USE_MULTI_AVX512)
+  unsigned int features = _gcry_get_hw_features ();
+  gcry_md_multi_spec_t spec;
+
+  spec.nwords = 8;
+  spec.digestlen = is_sha224 ? 28 : 32;
+  spec.iv = is_sha224 ? sha224_iv : sha256_iv;
+  spec.blocks = sha256_state_blocks;
+
+#ifdef USE_MULTI_AVX512
+  if (features & HWF_INTEL_AVX512)
+    {
+      spec.nlanes = 16;
+      spec.multi_blocks = sha256_multi_avx512;
+      _gcry_md_block_hash_multi (&spec, digests, buffers, lengths, n);
+      return 0;
+    }
+#endif
+
+  /* The SHA Extensions are faster than eight AVX2 lanes. */
+  if ((features & HWF_INTEL_AVX2) && !(features & HWF_INTEL_SHAEXT))
+    {
+      spec.nlanes = 8;
+      spec.multi_blocks = sha256_multi_avx2;
+      _gcry_md_block_hash_multi (&spec, digests, buffers, lengths, n);
+      return 0;
+    }
+#else
+  (void)is_sha224;
+  (void)digests;
+  (void)buffers;
+  (void)lengths;
+  (void)n;
+#endif
+
+  return GPG_ERR_NOT_SUPPORTED;
+}
+
+gcry_err_code_t
+_gcry_sha224_hash_buffer_batch (void **digests, const void **buffers,
+                                const size_t *lengths, size_t n)
+{
+  return sha256_hash_buffer_batch (1, digests, buffers, lengths, n);
+}
+
+gcry_err_code_t
+_gcry_sha256_hash_buffer_batch (void **digests, const void **buffers,
+                                const size_t *lengths, size_t n)
+{
+  return sha256_hash_buffer_batch (0, digests, buffers, lengths, n);
+}
+
+
+/* Derive KEYSIZE bytes to KEYBUFFER with PBKDF2 using HMAC-SHA-224 (if
+   IS_SHA224 is set) or HMAC-SHA-256, the passphrase PASSPHRASE, the
+   salt SALT and ITERATIONS iterations.  */
+static void
+sha256_pbkdf2 (int is_sha224, const void *passphrase, size_t passphraselen,
+               const void *salt, size_t saltlen, unsigned long iterations,
+               size_t keysize, void *keybuffer)
+{
+  SHA256_CONTEXT hd;
+  gcry_md_pbkdf2_spec_t spec;
+#if defined(USE_MULTI_AVX2) || defined(USE_MULTI_AVX512)
+  unsigned int features = _gcry_get_hw_features ();
+#endif
+
+  if (is_sha224)
+    sha224_init (&hd, 0);
+  else
+    sha256_init (&hd, 0);
+
+  spec.nwords = 8;
+  spec.digestlen = is_sha224 ? 28 : 32;
+  spec.ctx = &hd;
+  spec.state = &hd.h0;
+  spec.bwrite = transform;
+  spec.nlanes = 0;
+  spec.multi_blocks = NULL;
+
+#ifdef USE_MULTI_AVX512
+  if (features & HWF_INTEL_AVX512)
+    {
+      spec.nlanes = 16;
+      spec.multi_blocks = sha256_multi_avx512;
+    }
+  else
+#endif
+#ifdef USE_MULTI_AVX2
+  if ((features & HWF_INTEL_AVX2) && !(features & HWF_INTEL_SHAEXT))
+    {
+      spec.nlanes = 8;
+      spec.multi_blocks = sha256_multi_avx2;
+    }
+#endif
+
+  _gcry_md_block_pbkdf2 (&spec, passphrase, passphraselen, salt, saltlen,
+                         iterations, keysize, keybuffer);
+  wipememory (&hd, sizeof(hd));
+}
+
+void
+_gcry_sha224_pbkdf2 (const void *passphrase, size_t passphraselen,
+                     const void *salt, size_t saltlen,
+                     unsigned long iterations, size_t keysize,
+                     void *keybuffer)
+{
+  sha256_pbkdf2 (1, passphrase, passphraselen, salt, saltlen, iterations,
+                 keysize, keybuffer);
+}
+
+void
+_gcry_sha256_pbkdf2 (const void *passphrase, size_t passphraselen,
+                     const void *salt, size_t saltlen,
+                     unsigned long iterations, size_t keysize,
+                     void *keybuffer)
+{
+  sha256_pbkdf2 (0, passphrase, passphraselen, salt, saltlen, iterations,
+                 keysize, keybuffer);
+}
+
+
 
 /*
      Self-test section.
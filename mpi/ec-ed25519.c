@@ -17,6 +17,14 @@
  * License along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
+/* Field arithmetic for p = 2^255 - 19 as used by Ed25519 and
+   Curve25519.  Field elements are kept in a fixed number of full
+   limbs (4 on 64 bit platforms) and the reduction makes use of
+   2^256 = 38 (mod p).  All functions return a fully reduced value so
+   that the results can directly be compared with mpi_cmp.  Operands
+   which are negative or do not fit into the fixed number of limbs
+   are handled by the generic code.  */
+
 #include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -27,11 +35,196 @@
 #include "g10lib.h"
 #include "context.h"
 #include "ec-context.h"
+#include "ec-internal.h"
+
+
+#define LIMB_SIZE_25519 ((256 + BITS_PER_MPI_LIMB - 1) / BITS_PER_MPI_LIMB)
+
+
+/* Return true if A can be used directly as an operand.  */
+static inline int
+is_fixed_operand (gcry_mpi_t a)
+{
+  return !a->sign && a->nlimbs <= LIMB_SIZE_25519;
+}
+
+
+/* Copy the value of A into the LIMB_SIZE_25519 limbs at R.  */
+static void
+get_operand (mpi_ptr_t r, gcry_mpi_t a)
+{
+  mpi_size_t i;
+
+  for (i = 0; i < a->nlimbs; i++)
+    r[i] = a->d[i];
+  for (; i < LIMB_SIZE_25519; i++)
+    r[i] = 0;
+}
+
+
+/* Reduce the value R + C * 2^256 with C < 2^(BITS_PER_MPI_LIMB-6)
+   modulo p and store it into W.  This does not branch on the
+   value.  */
+static void
+finish_25519 (gcry_mpi_t w, mpi_ptr_t r, mpi_limb_t c)
+{
+  mpi_limb_t tmp[LIMB_SIZE_25519];
+  const mpi_limb_t topbit = (mpi_limb_t)1 << (BITS_PER_MPI_LIMB - 1);
+  mpi_limb_t mask;
+  mpi_size_t i, n;
+
+  /* 2^256 = 38.  The second addition can't carry.  */
+  c = _gcry_mpih_add_1 (r, r, LIMB_SIZE_25519, c * 38);
+  _gcry_mpih_add_1 (r, r, LIMB_SIZE_25519, c * 38);
+
+  /* 2^255 = 19.  This leaves a value below 2p.  */
+  c = r[LIMB_SIZE_25519-1] >> (BITS_PER_MPI_LIMB - 1);
+  r[LIMB_SIZE_25519-1] &= ~topbit;
+  _gcry_mpih_add_1 (r, r, LIMB_SIZE_25519, c * 19);
+
+  /* Subtract p if R >= p, i.e. if R + 19 >= 2^255.  */
+  _gcry_mpih_add_1 (tmp, r, LIMB_SIZE_25519, 19);
+  mask = (mpi_limb_t)0 - (tmp[LIMB_SIZE_25519-1] >> (BITS_PER_MPI_LIMB - 1));
+  tmp[LIMB_SIZE_25519-1] &= ~topbit;
+  for (i = 0; i < LIMB_SIZE_25519; i++)
+    r[i] = (r[i] & ~mask) | (tmp[i] & mask);
+
+  n = LIMB_SIZE_25519;
+  RESIZE_IF_NEEDED (w, n);
+  MPN_COPY (w->d, r, n);
+  MPN_NORMALIZE (w->d, n);
+  w->nlimbs = n;
+  w->sign = 0;
+}
+
+
+/* Reduce the product at N (2 * LIMB_SIZE_25519 limbs) and store it
+   into W.  */
+static void
+reduce_product_25519 (gcry_mpi_t w, mpi_ptr_t n)
+{
+  mpi_limb_t c;
+
+  c = _gcry_mpih_addmul_1 (n, n + LIMB_SIZE_25519, LIMB_SIZE_25519, 38);
+  finish_25519 (w, n, c);
+}
+
+
+/* W = W mod p  */
+void
+_gcry_mpi_ec_ed25519_mod (gcry_mpi_t w, mpi_ec_t ctx)
+{
+  mpi_limb_t n[LIMB_SIZE_25519*2];
+  mpi_size_t i;
+
+  if (w->sign || w->nlimbs > 2*LIMB_SIZE_25519)
+    {
+      _gcry_mpi_mod (w, w, ctx->p);
+      return;
+    }
+
+  for (i = 0; i < w->nlimbs; i++)
+    n[i] = w->d[i];
+  for (; i < 2*LIMB_SIZE_25519; i++)
+    n[i] = 0;
+  reduce_product_25519 (w, n);
+}
+
+
+/* W = U + V mod p  */
+void
+_gcry_mpi_ec_ed25519_addm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v,
+                           mpi_ec_t ctx)
+{
+  mpi_limb_t up[LIMB_SIZE_25519], vp[LIMB_SIZE_25519];
+  mpi_limb_t c;
+
+  if (!is_fixed_operand (u) || !is_fixed_operand (v))
+    {
+      mpi_add (w, u, v);
+      _gcry_mpi_ec_ed25519_mod (w, ctx);
+      return;
+    }
+
+  get_operand (up, u);
+  get_operand (vp, v);
+  c = _gcry_mpih_add_n (up, up, vp, LIMB_SIZE_25519);
+  finish_25519 (w, up, c);
+}
+
+
+/* W = U - V mod p  */
+void
+_gcry_mpi_ec_ed25519_subm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v,
+                           mpi_ec_t ctx)
+{
+  mpi_limb_t up[LIMB_SIZE_25519], vp[LIMB_SIZE_25519];
+  mpi_limb_t borrow;
+
+  if (!is_fixed_operand (u) || !is_fixed_operand (v))
+    {
+      mpi_sub (w, u, v);
+      _gcry_mpi_ec_ed25519_mod (w, ctx);
+      return;
+    }
+
+  get_operand (up, u);
+  get_operand (vp, v);
+
+  /* A borrow means that we need to subtract 2^256 = 38.  The second
+     subtraction can't borrow.  */
+  borrow = _gcry_mpih_sub_n (up, up, vp, LIMB_SIZE_25519);
+  borrow = _gcry_mpih_sub_1 (up, up, LIMB_SIZE_25519, borrow * 38);
+  _gcry_mpih_sub_1 (up, up, LIMB_SIZE_25519, borrow * 38);
+  finish_25519 (w, up, 0);
+}
 
 
+/* W = U * V mod p  */
 void
-_gcry_mpi_ec_ed25519_mod (gcry_mpi_t a)
+_gcry_mpi_ec_ed25519_mulm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v,
+                           mpi_ec_t ctx)
 {
-  (void)a;
+  mpi_limb_t up[LIMB_SIZE_25519], vp[LIMB_SIZE_25519];
+  mpi_limb_t n[LIMB_SIZE_25519*2];
+
+  if (!is_fixed_operand (u) || !is_fixed_operand (v))
+    {
+      mpi_mul (w, u, v);
+      _gcry_mpi_ec_ed25519_mod (w, ctx);
+      return;
+    }
+
+  get_operand (up, u);
+  get_operand (vp, v);
+  _gcry_mpih_mul_n (n, up, vp, LIMB_SIZE_25519);
+  reduce_product_25519 (w, n);
+}
+
+
+/* W = 2 * U mod p  */
+void
+_gcry_mpi_ec_ed25519_mul2 (gcry_mpi_t w, gcry_mpi_t u, mpi_ec_t ctx)
+{
+  _gcry_mpi_ec_ed25519_addm (w, u, u, ctx);
+}
+
+
+/* W = B^2 mod p  */
+void
+_gcry_mpi_ec_ed25519_pow2 (gcry_mpi_t w, const gcry_mpi_t b, mpi_ec_t ctx)
+{
+  mpi_limb_t bp[LIMB_SIZE_25519];
+  mpi_limb_t n[LIMB_SIZE_25519*2];
+
+  if (!is_fixed_operand (b))
+    {
+      mpi_mul (w, b, b);
+      _gcry_mpi_ec_ed25519_mod (w, ctx);
+      return;
+    }
 
+  get_operand (bp, b);
+  _gcry_mpih_sqr_n_basecase (n, bp, LIMB_SIZE_25519);
+  reduce_product_25519 (w, n);
 }
@@ -20,6 +20,23 @@
 #ifndef GCRY_EC_INTERNAL_H
 #define GCRY_EC_INTERNAL_H
 
-void _gcry_mpi_ec_ed25519_mod (gcry_mpi_t a);
+/*-- ec-ed25519.c --*/
+void _gcry_mpi_ec_ed25519_mod (gcry_mpi_t w, mpi_ec_t ctx);
+void _gcry_mpi_ec_ed25519_addm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v,
+                                mpi_ec_t ctx);
+void _gcry_mpi_ec_ed25519_subm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v,
+                                mpi_ec_t ctx);
+void _gcry_mpi_ec_ed25519_mulm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v,
+                                mpi_ec_t ctx);
+void _gcry_mpi_ec_ed25519_mul2 (gcry_mpi_t w, gcry_mpi_t u, mpi_ec_t ctx);
+void _gcry_mpi_ec_ed25519_pow2 (gcry_mpi_t w, const gcry_mpi_t b,
+                                mpi_ec_t ctx);
+
+/*-- ec-nist.c --*/
+void _gcry_mpi_ec_nist192_mod (gcry_mpi_t w, mpi_ec_t ctx);
+void _gcry_mpi_ec_nist224_mod (gcry_mpi_t w, mpi_ec_t ctx);
+void _gcry_mpi_ec_nist256_mod (gcry_mpi_t w, mpi_ec_t ctx);
+void _gcry_mpi_ec_nist384_mod (gcry_mpi_t w, mpi_ec_t ctx);
+void _gcry_mpi_ec_nist521_mod (gcry_mpi_t w, mpi_ec_t ctx);
 
 #endif /*GCRY_EC_INTERNAL_H*/
@@ -0,0 +1,341 @@
+/* ec-nist.c -  NIST optimized elliptic curve functions
+ * Copyright (C) 2016 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The fast reduction for the generalized Mersenne primes used by the
+   NIST curves is described in FIPS 186-4, Appendix D.2.  We operate
+   on 32 bit words so that the very same code can be used regardless
+   of the limb size.  The reduction itself does not branch on the
+   value of the input; only its sign and its size are looked at.  */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "mpi-internal.h"
+#include "longlong.h"
+#include "g10lib.h"
+#include "context.h"
+#include "ec-context.h"
+#include "ec-internal.h"
+
+
+/* The largest prime we handle is P-521 which needs 17 words.  One
+   extra word is required for intermediate results.  */
+#define MAX_WORDS 17
+#define MAX_LIMBS ((MAX_WORDS + 1) * 32 / BITS_PER_MPI_LIMB)
+
+/* Store the NWORDS least significant 32 bit words of the absolute
+   value of W at R.  */
+static void
+get_words (u32 *r, unsigned int nwords, gcry_mpi_t w)
+{
+  mpi_size_t n = w->nlimbs;
+  unsigned int i;
+
+#if BITS_PER_MPI_LIMB == 64
+  for (i = 0; i < nwords/2 && i < n; i++)
+    {
+      r[2*i] = (u32)w->d[i];
+      r[2*i+1] = (u32)(w->d[i] >> 32);
+    }
+  if ((nwords & 1) && i < n)
+    {
+      r[2*i] = (u32)w->d[i];
+      i = 2*i + 1;
+    }
+  else
+    i = 2*i;
+  for (; i < nwords; i++)
+    r[i] = 0;
+#elif BITS_PER_MPI_LIMB == 32
+  for (i = 0; i < nwords && i < n; i++)
+    r[i] = w->d[i];
+  for (; i < nwords; i++)
+    r[i] = 0;
+#else
+# error please implement for this limb size.
+#endif
+}
+
+
+/* Convert the NWORDS 32 bit words at A into limbs at R.  Returns the
+   number of limbs.  */
+static mpi_size_t
+words_to_limbs (mpi_ptr_t r, const u32 *a, unsigned int nwords)
+{
+#if BITS_PER_MPI_LIMB == 64
+  mpi_size_t i, n = (nwords + 1) / 2;
+
+  for (i = 0; i < n; i++)
+    r[i] = (mpi_limb_t)a[2*i]
+      | ((2*i+1 < nwords)? ((mpi_limb_t)a[2*i+1] << 32) : 0);
+  return n;
+#else
+  mpi_size_t i;
+
+  for (i = 0; i < nwords; i++)
+    r[i] = a[i];
+  return nwords;
+#endif
+}
+
+
+/* Subtract the N limbs prime P from the N limbs at R if R >= P.  TOP
+   is an additional limb of R with a value of 0 or 1.  This is done in
+   constant time.  */
+static void
+sub_p_cond (mpi_ptr_t r, mpi_ptr_t p, mpi_size_t n, mpi_limb_t top)
+{
+  mpi_limb_t tmp[MAX_LIMBS];
+  mpi_limb_t mask;
+  mpi_size_t i;
+
+  mask = (mpi_limb_t)0 - ((top | (_gcry_mpih_sub_n (tmp, r, p, n) ^ 1)) & 1);
+  for (i = 0; i < n; i++)
+    r[i] = (r[i] & ~mask) | (tmp[i] & mask);
+}
+
+
+/* Store the N limbs at R into W.  */
+static void
+set_result (gcry_mpi_t w, mpi_ptr_t r, mpi_size_t n)
+{
+  RESIZE_IF_NEEDED (w, n);
+  MPN_COPY (w->d, r, n);
+  MPN_NORMALIZE (w->d, n);
+  w->nlimbs = n;
+  w->sign = 0;
+}
+
+
+/* Load the input W into the 2*NWORDS words at A.  Returns false if
+   W is too large for the Solinas formulas; in this case W has already
+   been reduced by the generic code.  */
+static int
+get_input (u32 *a, unsigned int nwords, gcry_mpi_t w, mpi_ec_t ctx)
+{
+  if (w->nlimbs > (2 * 32 * nwords) / BITS_PER_MPI_LIMB)
+    {
+      /* This may only happen if the caller passes unreduced
+         operands.  */
+      _gcry_mpi_mod (w, w, ctx->p);
+      return 0;
+    }
+
+  get_words (a, 2*nwords, w);
+  return 1;
+}
+
+
+/* Finish a Solinas reduction.  S are the NWORDS signed sums of the
+   terms for each word.  BIAS is a small multiple of the prime which
+   is added to the sum to make sure that it is not negative.  */
+static void
+solinas_finish (gcry_mpi_t w, mpi_ec_t ctx, const long long *s,
+                unsigned int nwords, unsigned int bias)
+{
+  u32 p[MAX_WORDS];
+  u32 r[MAX_WORDS+1];
+  mpi_limb_t rl[MAX_LIMBS];
+  mpi_ptr_t pl = ctx->p->d;
+  mpi_size_t plimbs = ctx->p->nlimbs;
+  mpi_limb_t borrow, top;
+  long long acc, carry, neg;
+  unsigned int j;
+
+  get_words (p, nwords, ctx->p);
+
+  /* R = BIAS * P + S with S negated for a negative input.  */
+  neg = -(long long)(w->sign != 0);
+  carry = 0;
+  for (j = 0; j < nwords; j++)
+    {
+      acc = carry + ((s[j] ^ neg) - neg) + bias * (long long)p[j];
+      r[j] = (u32)acc;
+      carry = (acc - (long long)r[j]) / ((long long)1 << 32);
+    }
+  r[nwords] = (u32)carry;
+
+  /* With C being the small number in the top word of R we now
+     compute R = R - C * P.  Because 2^(32*NWORDS) - P is way smaller
+     than P this yields 0 <= R < 2P.  */
+  if (words_to_limbs (rl, r, nwords+1) > plimbs)
+    {
+      borrow = _gcry_mpih_submul_1 (rl, pl, plimbs, r[nwords]);
+      top = rl[plimbs] - borrow;
+    }
+  else
+    {
+      _gcry_mpih_submul_1 (rl, pl, plimbs, r[nwords]);
+      top = 0;
+    }
+
+  sub_p_cond (rl, pl, plimbs, top);
+  set_result (w, rl, plimbs);
+}
+
+
+#define A(i) ((long long)a[(i)])
+
+/* P-192: T + S1 + S2 + S3  */
+void
+_gcry_mpi_ec_nist192_mod (gcry_mpi_t w, mpi_ec_t ctx)
+{
+  u32 a[12];
+  long long s[6];
+
+  if (!get_input (a, 6, w, ctx))
+    return;
+
+  s[0] = A(0) + A(6) + A(10);
+  s[1] = A(1) + A(7) + A(11);
+  s[2] = A(2) + A(6) + A(8) + A(10);
+  s[3] = A(3) + A(7) + A(9) + A(11);
+  s[4] = A(4) + A(8) + A(10);
+  s[5] = A(5) + A(9) + A(11);
+
+  solinas_finish (w, ctx, s, 6, 5);
+}
+
+
+/* P-224: T + S1 + S2 - D1 - D2  */
+void
+_gcry_mpi_ec_nist224_mod (gcry_mpi_t w, mpi_ec_t ctx)
+{
+  u32 a[14];
+  long long s[7];
+
+  if (!get_input (a, 7, w, ctx))
+    return;
+
+  s[0] = A(0) - A(7) - A(11);
+  s[1] = A(1) - A(8) - A(12);
+  s[2] = A(2) - A(9) - A(13);
+  s[3] = A(3) + A(7) + A(11) - A(10);
+  s[4] = A(4) + A(8) + A(12) - A(11);
+  s[5] = A(5) + A(9) + A(13) - A(12);
+  s[6] = A(6) + A(10) - A(13);
+
+  solinas_finish (w, ctx, s, 7, 4);
+}
+
+
+/* P-256: T + 2 S1 + 2 S2 + S3 + S4 - D1 - D2 - D3 - D4  */
+void
+_gcry_mpi_ec_nist256_mod (gcry_mpi_t w, mpi_ec_t ctx)
+{
+  u32 a[16];
+  long long s[8];
+
+  if (!get_input (a, 8, w, ctx))
+    return;
+
+  s[0] = A(0) + A(8) + A(9) - A(11) - A(12) - A(13) - A(14);
+  s[1] = A(1) + A(9) + A(10) - A(12) - A(13) - A(14) - A(15);
+  s[2] = A(2) + A(10) + A(11) - A(13) - A(14) - A(15);
+  s[3] = (A(3) + 2*A(11) + 2*A(12) + A(13)
+          - A(15) - A(8) - A(9));
+  s[4] = A(4) + 2*A(12) + 2*A(13) + A(14) - A(9) - A(10);
+  s[5] = A(5) + 2*A(13) + 2*A(14) + A(15) - A(10) - A(11);
+  s[6] = A(6) + 3*A(14) + 2*A(15) + A(13) - A(8) - A(9);
+  s[7] = A(7) + 3*A(15) + A(8) - A(10) - A(11) - A(12) - A(13);
+
+  solinas_finish (w, ctx, s, 8, 8);
+}
+
+
+/* P-384: T + 2 S1 + S2 + S3 + S4 + S5 + S6 - D1 - D2 - D3  */
+void
+_gcry_mpi_ec_nist384_mod (gcry_mpi_t w, mpi_ec_t ctx)
+{
+  u32 a[24];
+  long long s[12];
+
+  if (!get_input (a, 12, w, ctx))
+    return;
+
+  s[0]  = A(0) + A(12) + A(21) + A(20) - A(23);
+  s[1]  = A(1) + A(13) + A(22) + A(23) - A(12) - A(20);
+  s[2]  = A(2) + A(14) + A(23) - A(13) - A(21);
+  s[3]  = (A(3) + A(15) + A(12) + A(20) + A(21)
+           - A(14) - A(22) - A(23));
+  s[4]  = (A(4) + 2*A(21) + A(16) + A(13) + A(12) + A(20) + A(22)
+           - A(15) - 2*A(23));
+  s[5]  = (A(5) + 2*A(22) + A(17) + A(14) + A(13) + A(21) + A(23)
+           - A(16));
+  s[6]  = A(6) + 2*A(23) + A(18) + A(15) + A(14) + A(22) - A(17);
+  s[7]  = A(7) + A(19) + A(16) + A(15) + A(23) - A(18);
+  s[8]  = A(8) + A(20) + A(17) + A(16) - A(19);
+  s[9]  = A(9) + A(21) + A(18) + A(17) - A(20);
+  s[10] = A(10) + A(22) + A(19) + A(18) - A(21);
+  s[11] = A(11) + A(23) + A(20) + A(19) - A(22);
+
+  solinas_finish (w, ctx, s, 12, 6);
+}
+
+#undef A
+
+
+/* P-521 = 2^521 - 1 is a Mersenne prime and thus W mod P is computed
+   by adding the upper part of W to its lower 521 bits.  */
+void
+_gcry_mpi_ec_nist521_mod (gcry_mpi_t w, mpi_ec_t ctx)
+{
+  const mpi_size_t k = 521 / BITS_PER_MPI_LIMB;
+  const unsigned int sh = 521 % BITS_PER_MPI_LIMB;
+  const mpi_limb_t lomask = ((mpi_limb_t)1 << sh) - 1;
+  mpi_limb_t a[2*MAX_LIMBS];
+  mpi_limb_t hi[MAX_LIMBS];
+  mpi_limb_t mask;
+  mpi_size_t i;
+
+  if (w->nlimbs > 2*k + 1)
+    {
+      _gcry_mpi_mod (w, w, ctx->p);
+      return;
+    }
+
+  MPN_COPY (a, w->d, w->nlimbs);
+  MPN_ZERO (a + w->nlimbs, 2*k + 1 - w->nlimbs);
+
+  /* A = (A mod 2^521) + (A >> 521).  The upper part has at most 567
+     bits and thus the sum fits into K+1 limbs.  */
+  _gcry_mpih_rshift (hi, a + k, k + 1, sh);
+  a[k] &= lomask;
+  _gcry_mpih_add_n (a, a, hi, k + 1);
+
+  /* Fold again; this yields A < 2P.  */
+  mask = a[k] >> sh;
+  a[k] &= lomask;
+  _gcry_mpih_add_1 (a, a, k + 1, mask);
+  sub_p_cond (a, ctx->p->d, k + 1, 0);
+
+  /* For a negative input we need P - A which is the same as flipping
+     the lower 521 bits of A.  This yields P for A = 0 and thus we
+     need to subtract P again.  */
+  mask = (mpi_limb_t)0 - (w->sign != 0);
+  for (i = 0; i < k; i++)
+    a[i] ^= mask;
+  a[k] ^= mask & lomask;
+  sub_p_cond (a, ctx->p->d, k + 1, 0);
+
+  set_result (w, a, k + 1);
+}
@@ -21,6 +21,7 @@
 #include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #include "mpi-internal.h"
@@ -253,12 +254,50 @@ _gcry_mpi_point_snatch_set (mpi_point_t point,
 }
 
 
+/* Primes for which we have specialized field arithmetic.  The
+   function pointers which are NULL are implemented by the generic
+   code.  */
+static const struct
+{
+  unsigned int nbits;  /* Size of the prime; used for a quick check.  */
+  const char *p;       /* The prime in hex.  */
+  void (*mod) (gcry_mpi_t w, mpi_ec_t ctx);
+  void (*addm) (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx);
+  void (*subm) (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx);
+  void (*mulm) (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx);
+  void (*mul2) (gcry_mpi_t w, gcry_mpi_t u, mpi_ec_t ctx);
+  void (*pow2) (gcry_mpi_t w, const gcry_mpi_t b, mpi_ec_t ctx);
+} field_table[] =
+  {
+    { 192, "0xfffffffffffffffffffffffffffffffeffffffffffffffff",
+      _gcry_mpi_ec_nist192_mod },
+    { 224, "0xffffffffffffffffffffffffffffffff000000000000000000000001",
+      _gcry_mpi_ec_nist224_mod },
+    { 255, "0x7fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffed",
+      _gcry_mpi_ec_ed25519_mod,
+      _gcry_mpi_ec_ed25519_addm,
+      _gcry_mpi_ec_ed25519_subm,
+      _gcry_mpi_ec_ed25519_mulm,
+      _gcry_mpi_ec_ed25519_mul2,
+      _gcry_mpi_ec_ed25519_pow2 },
+    { 256, "0xffffffff00000001000000000000000000000000ffffffffffffffffffffffff",
+      _gcry_mpi_ec_nist256_mod },
+    { 384, "0xfffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffe"
+      "ffffffff0000000000000000ffffffff",
+      _gcry_mpi_ec_nist384_mod },
+    { 521, "0x01ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"
+      "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+      _gcry_mpi_ec_nist521_mod },
+    { 0, NULL, NULL }
+  };
+
+
 /* W = W mod P.  */
 static void
 ec_mod (gcry_mpi_t w, mpi_ec_t ec)
 {
-  if (0 && ec->dialect == ECC_DIALECT_ED25519)
-    _gcry_mpi_ec_ed25519_mod (w);
+  if (ec->t.mod)
+    ec->t.mod (w, ec);
   else if (ec->t.p_barrett)
     _gcry_mpi_mod_barrett (w, w, ec->t.p_barrett);
   else
@@ -268,6 +307,11 @@ ec_mod (gcry_mpi_t w, mpi_ec_t ec)
 static void
 ec_addm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx)
 {
+  if (ctx->t.addm)
+    {
+      ctx->t.addm (w, u, v, ctx);
+      return;
+    }
   mpi_add (w, u, v);
   ec_mod (w, ctx);
 }
@@ -275,7 +319,11 @@ ec_addm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx)
 static void
 ec_subm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ec)
 {
-  (void)ec;
+  if (ec->t.subm)
+    {
+      ec->t.subm (w, u, v, ec);
+      return;
+    }
   mpi_sub (w, u, v);
   /*ec_mod (w, ec);*/
 }
@@ -283,6 +331,11 @@ ec_subm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ec)
 static void
 ec_mulm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx)
 {
+  if (ctx->t.mulm)
+    {
+      ctx->t.mulm (w, u, v, ctx);
+      return;
+    }
   mpi_mul (w, u, v);
   ec_mod (w, ctx);
 }
@@ -291,6 +344,11 @@ ec_mulm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx)
 static void
 ec_mul2 (gcry_mpi_t w, gcry_mpi_t u, mpi_ec_t ctx)
 {
+  if (ctx->t.mul2)
+    {
+      ctx->t.mul2 (w, u, ctx);
+      return;
+    }
   mpi_lshift (w, u, 1);
   ec_mod (w, ctx);
 }
@@ -310,6 +368,11 @@ ec_powm (gcry_mpi_t w, const gcry_mpi_t b, const gcry_mpi_t e,
 static void
 ec_pow2 (gcry_mpi_t w, const gcry_mpi_t b, mpi_ec_t ctx)
 {
+  if (ctx->t.pow2)
+    {
+      ctx->t.pow2 (w, b, ctx);
+      return;
+    }
   /* Using mpi_mul is slightly faster (at least on amd64).  */
   /* mpi_powm (w, b, mpi_const (MPI_C_TWO), ctx->p); */
   ec_mulm (w, b, b, ctx);
@@ -392,6 +455,7 @@ ec_p_init (mpi_ec_t ctx, enum gcry_mpi_ec_models model,
            gcry_mpi_t p, gcry_mpi_t a, gcry_mpi_t b)
 {
   int i;
+  unsigned int nbits;
   static int use_barrett;
 
   if (!use_barrett)
@@ -423,23 +487,36 @@ ec_p_init (mpi_ec_t ctx, enum gcry_mpi_ec_models model,
   for (i=0; i< DIM(ctx->t.scratch); i++)
     ctx->t.scratch[i] = mpi_alloc_like (ctx->p);
 
-  /* Prepare for fast reduction.  */
-  /* FIXME: need a test for NIST values.  However it does not gain us
-     any real advantage, for 384 bits it is actually slower than using
-     mpi_mulm.  */
-/*   ctx->nist_nbits = mpi_get_nbits (ctx->p); */
-/*   if (ctx->nist_nbits == 192) */
-/*     { */
-/*       for (i=0; i < 4; i++) */
-/*         ctx->s[i] = mpi_new (192); */
-/*       ctx->c    = mpi_new (192*2); */
-/*     } */
-/*   else if (ctx->nist_nbits == 384) */
-/*     { */
-/*       for (i=0; i < 10; i++) */
-/*         ctx->s[i] = mpi_new (384); */
-/*       ctx->c    = mpi_new (384*2); */
-/*     } */
+  /* Prepare for fast reduction.  Note that CTX->NBITS may not be
+     the actual size of P (e.g. for Ed25519).  */
+  nbits = mpi_get_nbits (p);
+  for (i=0; field_table[i].p; i++)
+    {
+      gcry_mpi_t f_p;
+      gpg_err_code_t rc;
+
+      if (field_table[i].nbits != nbits)
+        continue;
+
+      rc = _gcry_mpi_scan (&f_p, GCRYMPI_FMT_HEX, field_table[i].p, 0, NULL);
+      if (rc)
+        log_fatal ("scanning ECC parameter failed: %s\n",
+                   gpg_strerror (rc));
+
+      if (!mpi_cmp (p, f_p))
+        {
+          ctx->t.mod  = field_table[i].mod;
+          ctx->t.addm = field_table[i].addm;
+          ctx->t.subm = field_table[i].subm;
+          ctx->t.mulm = field_table[i].mulm;
+          ctx->t.mul2 = field_table[i].mul2;
+          ctx->t.pow2 = field_table[i].pow2;
+        }
+
+      mpi_free (f_p);
+      if (ctx->t.mod)
+        break;
+    }
 }
 
 
@@ -468,19 +545,6 @@ ec_deinit (void *opaque)
 
   for (i=0; i< DIM(ctx->t.scratch); i++)
     mpi_free (ctx->t.scratch[i]);
-
-/*   if (ctx->nist_nbits == 192) */
-/*     { */
-/*       for (i=0; i < 4; i++) */
-/*         mpi_free (ctx->s[i]); */
-/*       mpi_free (ctx->c); */
-/*     } */
-/*   else if (ctx->nist_nbits == 384) */
-/*     { */
-/*       for (i=0; i < 10; i++) */
-/*         mpi_free (ctx->s[i]); */
-/*       mpi_free (ctx->c); */
-/*     } */
 }
 
 
@@ -811,10 +875,7 @@ dup_point_edwards (mpi_point_t result, mpi_point_t point, mpi_ec_t ctx)
 
   /* E = aC */
   if (ctx->dialect == ECC_DIALECT_ED25519)
-    {
-      mpi_set (E, C);
-      _gcry_mpi_neg (E, E);
-    }
+    ec_subm (E, ctx->p, C, ctx);
   else
     ec_mulm (E, ctx->a, C, ctx);
 
@@ -927,29 +988,35 @@ add_points_weierstrass (mpi_point_t result,
       int z2_is_one = !mpi_cmp_ui (z2, 1);
 
       /* l1 = x1 z2^2  */
-      /* l2 = x2 z1^2  */
+      /* l4 = y1 z2^3  */
       if (z2_is_one)
-        mpi_set (l1, x1);
+        {
+          mpi_set (l1, x1);
+          mpi_set (l4, y1);
+        }
       else
         {
-          ec_pow2 (l1, z2, ctx);
-          ec_mulm (l1, l1, x1, ctx);
+          ec_pow2 (t1, z2, ctx);
+          ec_mulm (l1, t1, x1, ctx);
+          ec_mulm (t1, t1, z2, ctx);
+          ec_mulm (l4, t1, y1, ctx);
         }
+      /* l2 = x2 z1^2  */
+      /* l5 = y2 z1^3  */
       if (z1_is_one)
-        mpi_set (l2, x2);
+        {
+          mpi_set (l2, x2);
+          mpi_set (l5, y2);
+        }
       else
         {
-          ec_pow2 (l2, z1, ctx);
-          ec_mulm (l2, l2, x2, ctx);
+          ec_pow2 (t1, z1, ctx);
+          ec_mulm (l2, t1, x2, ctx);
+          ec_mulm (t1, t1, z1, ctx);
+          ec_mulm (l5, t1, y2, ctx);
         }
       /* l3 = l1 - l2 */
       ec_subm (l3, l1, l2, ctx);
-      /* l4 = y1 z2^3  */
-      ec_powm (l4, z2, mpi_const (MPI_C_THREE), ctx);
-      ec_mulm (l4, l4, y1, ctx);
-      /* l5 = y2 z1^3  */
-      ec_powm (l5, z1, mpi_const (MPI_C_THREE), ctx);
-      ec_mulm (l5, l5, y2, ctx);
       /* l6 = l4 - l5  */
       ec_subm (l6, l4, l5, ctx);
 
@@ -974,21 +1041,22 @@ add_points_weierstrass (mpi_point_t result,
           ec_addm (l7, l1, l2, ctx);
           /* l8 = l4 + l5  */
           ec_addm (l8, l4, l5, ctx);
+          /* l4 = l3^2, l5 = l3^3  (L4 and L5 are not used anymore)  */
+          ec_pow2 (l4, l3, ctx);
+          ec_mulm (l5, l4, l3, ctx);
           /* z3 = z1 z2 l3  */
           ec_mulm (z3, z1, z2, ctx);
           ec_mulm (z3, z3, l3, ctx);
           /* x3 = l6^2 - l7 l3^2  */
           ec_pow2 (t1, l6, ctx);
-          ec_pow2 (t2, l3, ctx);
-          ec_mulm (t2, t2, l7, ctx);
+          ec_mulm (t2, l4, l7, ctx);
           ec_subm (x3, t1, t2, ctx);
           /* l9 = l7 l3^2 - 2 x3  */
           ec_mul2 (t1, x3, ctx);
           ec_subm (l9, t2, t1, ctx);
           /* y3 = (l9 l6 - l8 l3^3)/2  */
           ec_mulm (l9, l9, l6, ctx);
-          ec_powm (t1, l3, mpi_const (MPI_C_THREE), ctx); /* fixme: Use saved value*/
-          ec_mulm (t1, t1, l8, ctx);
+          ec_mulm (t1, l5, l8, ctx);
           ec_subm (y3, l9, t1, ctx);
           ec_mulm (y3, y3, ec_get_two_inv_p (ctx), ctx);
         }
@@ -1091,13 +1159,7 @@ add_points_edwards (mpi_point_t result,
 
   /* Y_3 = A · G · (D - aC) */
   if (ctx->dialect == ECC_DIALECT_ED25519)
-    {
-      /* Using ec_addm (Y3, D, C, ctx) is possible but a litte bit
-         slower because a subm does currently skip the mod step.  */
-      mpi_set (Y3, C);
-      _gcry_mpi_neg (Y3, Y3);
-      ec_subm (Y3, D, Y3, ctx);
-    }
+    ec_addm (Y3, D, C, ctx);
   else
     {
       ec_mulm (Y3, ctx->a, C, ctx);
@@ -1218,7 +1280,7 @@ sub_points_edwards (mpi_point_t result,
 {
   mpi_point_t p2i = _gcry_mpi_point_new (0);
   point_set (p2i, p2);
-  _gcry_mpi_neg (p2i->x, p2i->x);
+  ec_subm (p2i->x, ctx->p, p2i->x, ctx);
   add_points_edwards (result, p1, p2i, ctx);
   _gcry_mpi_point_release (p2i);
 }
@@ -1463,6 +1525,671 @@ _gcry_mpi_ec_mul_point (mpi_point_t result,
 }
 
 
+/* Precomputed multiples of a fixed base point G.  The scalar is
+   recoded into signed odd digits of BASE_TABLE_WBITS bits so that
+   each window requires exactly one addition of a table entry.  For
+   window I and J in 0..BASE_TABLE_NPOINTS-1 the affine coordinates
+   of (2J+1) * 2^(BASE_TABLE_WBITS*I) * G are stored.  */
+#define BASE_TABLE_WBITS   4
+#define BASE_TABLE_NPOINTS (1 << (BASE_TABLE_WBITS - 1))
+
+struct mpi_ec_base_table_s
+{
+  enum gcry_mpi_ec_models model;
+  gcry_mpi_t n;            /* The order of G.  */
+  unsigned int nwindows;   /* Number of windows.  */
+  mpi_size_t nlimbs;       /* Number of limbs of a coordinate.  */
+  mpi_ptr_t x;             /* NWINDOWS * BASE_TABLE_NPOINTS * NLIMBS  */
+  mpi_ptr_t y;             /* limbs for the x and y coordinates.  */
+};
+
+
+/* Release the table TBL.  TBL may be NULL.  */
+void
+_gcry_mpi_ec_base_table_release (mpi_ec_base_table_t tbl)
+{
+  if (!tbl)
+    return;
+  mpi_free (tbl->n);
+  xfree (tbl->x);
+  xfree (tbl->y);
+  xfree (tbl);
+}
+
+
+/* Create a table of multiples of the base point G with order N for
+   use by _gcry_mpi_ec_mul_base.  Returns NULL if the table can't be
+   created.  This is only supported for Weierstrass and Edwards
+   curves.  */
+mpi_ec_base_table_t
+_gcry_mpi_ec_base_table_new (mpi_point_t G, gcry_mpi_t n, mpi_ec_t ctx)
+{
+  mpi_ec_base_table_t tbl;
+  mpi_point_struct B, B2, P;
+  gcry_mpi_t x, y;
+  unsigned int i, j;
+  size_t nentries;
+  int err = 0;
+
+  if (ctx->model == MPI_EC_MONTGOMERY || !mpi_cmp_ui (n, 0))
+    return NULL;
+
+  tbl = xtrycalloc (1, sizeof *tbl);
+  if (!tbl)
+    return NULL;
+  tbl->model = ctx->model;
+  tbl->nlimbs = ctx->p->nlimbs;
+  tbl->nwindows = (mpi_get_nbits (n) + BASE_TABLE_WBITS) / BASE_TABLE_WBITS;
+  nentries = (size_t)tbl->nwindows * BASE_TABLE_NPOINTS * tbl->nlimbs;
+  tbl->x = xtrymalloc (nentries * sizeof (mpi_limb_t));
+  tbl->y = xtrymalloc (nentries * sizeof (mpi_limb_t));
+  if (!tbl->x || !tbl->y)
+    {
+      _gcry_mpi_ec_base_table_release (tbl);
+      return NULL;
+    }
+  tbl->n = mpi_copy (n);
+
+  point_init (&B);
+  point_init (&B2);
+  point_init (&P);
+  x = mpi_new (0);
+  y = mpi_new (0);
+
+  point_set (&B, G);
+  for (i = 0; i < tbl->nwindows && !err; i++)
+    {
+      _gcry_mpi_ec_dup_point (&B2, &B, ctx);
+      point_set (&P, &B);
+      for (j = 0; j < BASE_TABLE_NPOINTS; j++)
+        {
+          size_t off = ((size_t)i * BASE_TABLE_NPOINTS + j) * tbl->nlimbs;
+
+          if (j)
+            _gcry_mpi_ec_add_points (&P, &P, &B2, ctx);
+          if (_gcry_mpi_ec_get_affine (x, y, &P, ctx)
+              || x->nlimbs > tbl->nlimbs || y->nlimbs > tbl->nlimbs)
+            {
+              err = 1;
+              break;
+            }
+          MPN_ZERO (tbl->x + off, tbl->nlimbs);
+          MPN_COPY (tbl->x + off, x->d, x->nlimbs);
+          MPN_ZERO (tbl->y + off, tbl->nlimbs);
+          MPN_COPY (tbl->y + off, y->d, y->nlimbs);
+        }
+      for (j = 0; j < BASE_TABLE_WBITS; j++)
+        _gcry_mpi_ec_dup_point (&B, &B, ctx);
+    }
+
+  mpi_free (x);
+  mpi_free (y);
+  point_free (&B);
+  point_free (&B2);
+  point_free (&P);
+  if (err)
+    {
+      _gcry_mpi_ec_base_table_release (tbl);
+      return NULL;
+    }
+  return tbl;
+}
+
+
+/* Return the BASE_TABLE_WBITS bits of the limbs at K starting at
+   bit POS.  */
+static unsigned int
+get_window_bits (mpi_ptr_t k, mpi_size_t nlimbs, unsigned int pos)
+{
+  mpi_size_t idx = pos / BITS_PER_MPI_LIMB;
+  unsigned int sh = pos % BITS_PER_MPI_LIMB;
+  mpi_limb_t v;
+
+  v = k[idx] >> sh;
+  if (sh > BITS_PER_MPI_LIMB - BASE_TABLE_WBITS && idx + 1 < nlimbs)
+    v |= k[idx+1] << (BITS_PER_MPI_LIMB - sh);
+  return v & ((1 << BASE_TABLE_WBITS) - 1);
+}
+
+
+/* Store the table entry for the odd DIGIT of window I into POINT.
+   The table is scanned completely and the negation is done by
+   masking so that the memory access pattern does not depend on
+   DIGIT.  TMP provides space for 3 * TBL->NLIMBS limbs.  */
+static void
+base_table_lookup (mpi_point_t point, mpi_ec_base_table_t tbl,
+                   unsigned int i, int digit, mpi_ptr_t tmp, mpi_ec_t ctx)
+{
+  mpi_size_t nlimbs = tbl->nlimbs;
+  mpi_ptr_t tx = tmp;
+  mpi_ptr_t ty = tmp + nlimbs;
+  mpi_ptr_t neg = tmp + 2 * nlimbs;
+  mpi_ptr_t xs, ys, v;
+  unsigned int negative, absdigit, idx, j;
+  mpi_limb_t mask;
+  mpi_size_t l, n;
+
+  negative = (unsigned int)digit >> (sizeof (int) * 8 - 1);
+  absdigit = ((unsigned int)digit ^ (0U - negative)) + negative;
+  idx = (absdigit - 1) / 2;
+
+  xs = tbl->x + (size_t)i * BASE_TABLE_NPOINTS * nlimbs;
+  ys = tbl->y + (size_t)i * BASE_TABLE_NPOINTS * nlimbs;
+  MPN_ZERO (tx, nlimbs);
+  MPN_ZERO (ty, nlimbs);
+  for (j = 0; j < BASE_TABLE_NPOINTS; j++)
+    {
+      mask = (mpi_limb_t)0 - (mpi_limb_t)(j == idx);
+      for (l = 0; l < nlimbs; l++)
+        {
+          tx[l] |= xs[j * nlimbs + l] & mask;
+          ty[l] |= ys[j * nlimbs + l] & mask;
+        }
+    }
+
+  /* The negative of (x,y) is (x,-y) for Weierstrass and (-x,y) for
+     Edwards curves.  */
+  v = tbl->model == MPI_EC_EDWARDS? tx : ty;
+  _gcry_mpih_sub_n (neg, ctx->p->d, v, nlimbs);
+  mask = (mpi_limb_t)0 - (mpi_limb_t)negative;
+  for (l = 0; l < nlimbs; l++)
+    v[l] = (v[l] & ~mask) | (neg[l] & mask);
+
+  n = nlimbs;
+  RESIZE_IF_NEEDED (point->x, n);
+  MPN_COPY (point->x->d, tx, n);
+  MPN_NORMALIZE (point->x->d, n);
+  point->x->nlimbs = n;
+  point->x->sign = 0;
+  n = nlimbs;
+  RESIZE_IF_NEEDED (point->y, n);
+  MPN_COPY (point->y->d, ty, n);
+  MPN_NORMALIZE (point->y->d, n);
+  point->y->nlimbs = n;
+  point->y->sign = 0;
+  mpi_set_ui (point->z, 1);
+}
+
+
+/* Compute RESULT = SCALAR * G using the table TBL which has been
+   created for G by _gcry_mpi_ec_base_table_new.  The sequence of
+   operations does not depend on the value of SCALAR.  */
+void
+_gcry_mpi_ec_mul_base (mpi_point_t result, gcry_mpi_t scalar,
+                       mpi_ec_base_table_t tbl, mpi_ec_t ctx)
+{
+  gcry_mpi_t k, kn;
+  mpi_size_t nlimbs, i;
+  mpi_ptr_t tmp;
+  mpi_limb_t mask;
+  mpi_point_struct P;
+  unsigned int w;
+  int digit;
+
+  /* Use K = SCALAR mod N and add N to make it odd.  K is then below
+     2N and NWINDOWS digits are sufficient.  */
+  nlimbs = tbl->n->nlimbs + 1;
+  k = mpi_snew (nlimbs * BITS_PER_MPI_LIMB);
+  kn = mpi_snew (nlimbs * BITS_PER_MPI_LIMB);
+  mpi_mod (k, scalar, tbl->n);
+  mpi_add (kn, k, tbl->n);
+  RESIZE_IF_NEEDED (k, nlimbs);
+  RESIZE_IF_NEEDED (kn, nlimbs);
+  for (i = k->nlimbs; i < nlimbs; i++)
+    k->d[i] = 0;
+  for (i = kn->nlimbs; i < nlimbs; i++)
+    kn->d[i] = 0;
+  mask = (k->d[0] & 1) - 1;
+  for (i = 0; i < nlimbs; i++)
+    k->d[i] = (k->d[i] & ~mask) | (kn->d[i] & mask);
+
+  tmp = xmalloc (3 * tbl->nlimbs * sizeof (mpi_limb_t));
+  point_init (&P);
+
+  /* With an odd K, the digits d_i = 1 + 2 * (bits 4i+1 ... 4i+4 of K)
+     - 16 and d_(n-1) = 1 + 2 * (remaining bits of K) are all odd and
+     sum up to K.  */
+  for (i = 0; i < tbl->nwindows; i++)
+    {
+      w = get_window_bits (k->d, nlimbs, i * BASE_TABLE_WBITS + 1);
+      digit = 1 + 2 * (int)w;
+      if (i + 1 < tbl->nwindows)
+        digit -= 1 << BASE_TABLE_WBITS;
+      if (!i)
+        base_table_lookup (result, tbl, i, digit, tmp, ctx);
+      else
+        {
+          base_table_lookup (&P, tbl, i, digit, tmp, ctx);
+          _gcry_mpi_ec_add_points (result, result, &P, ctx);
+        }
+    }
+
+  wipememory (tmp, 3 * tbl->nlimbs * sizeof (mpi_limb_t));
+  xfree (tmp);
+  point_free (&P);
+  mpi_free (k);
+  mpi_free (kn);
+}
+
+
+/* Width of the windows used by _gcry_mpi_ec_mul_point_dual.  The
+   precomputed tables hold the odd multiples 1P, 3P, ..., 15P.  */
+#define WNAF_WBITS   5
+#define WNAF_NPOINTS (1 << (WNAF_WBITS - 2))
+
+/* Store the width-WNAF_WBITS NAF of the non-negative K at NAF, least
+   significant digit first, and return the number of digits.  NAF
+   must provide space for mpi_get_nbits (K) + 1 digits.  */
+static unsigned int
+compute_wnaf (signed char *naf, gcry_mpi_t k)
+{
+  mpi_size_t nlimbs = k->nlimbs + 1;
+  mpi_size_t n;
+  mpi_ptr_t kp;
+  unsigned int len = 0;
+  int d;
+
+  /* K is extended by one limb so that the additions below can't
+     overflow.  */
+  kp = xmalloc (nlimbs * sizeof (mpi_limb_t));
+  MPN_COPY (kp, k->d, k->nlimbs);
+  kp[nlimbs-1] = 0;
+
+  for (;;)
+    {
+      n = nlimbs;
+      MPN_NORMALIZE (kp, n);
+      if (!n)
+        break;
+      if ((kp[0] & 1))
+        {
+          d = kp[0] & ((1 << WNAF_WBITS) - 1);
+          if (d >= (1 << (WNAF_WBITS - 1)))
+            {
+              d -= 1 << WNAF_WBITS;
+              _gcry_mpih_add_1 (kp, kp, nlimbs, -d);
+            }
+          else
+            _gcry_mpih_sub_1 (kp, kp, nlimbs, d);
+        }
+      else
+        d = 0;
+      naf[len++] = d;
+      _gcry_mpih_rshift (kp, kp, nlimbs, 1);
+    }
+
+  xfree (kp);
+  return len;
+}
+
+
+/* Fill TBL with the odd multiples of P followed by their negatives.
+   If possible the points are converted to affine coordinates using a
+   single inversion so that the additions in the main loop are
+   cheaper.  */
+static void
+wnaf_precompute (mpi_point_t tbl, mpi_point_t P, mpi_ec_t ctx)
+{
+  mpi_point_struct P2;
+  gcry_mpi_t c[WNAF_NPOINTS];
+  gcry_mpi_t inv, zinv, zinv2;
+  int i;
+
+  point_init (&P2);
+  point_set (&tbl[0], P);
+  _gcry_mpi_ec_dup_point (&P2, P, ctx);
+  for (i = 1; i < WNAF_NPOINTS; i++)
+    _gcry_mpi_ec_add_points (&tbl[i], &tbl[i-1], &P2, ctx);
+  point_free (&P2);
+
+  /* Montgomery's trick: invert the product of all Z and recover the
+     single inverses from the partial products.  Points at infinity
+     can only show up with a point of small order; we then keep the
+     projective coordinates.  */
+  for (i = 0; i < WNAF_NPOINTS; i++)
+    if (!mpi_cmp_ui (tbl[i].z, 0))
+      break;
+  if (i == WNAF_NPOINTS)
+    {
+      inv = mpi_new (0);
+      zinv = mpi_new (0);
+      zinv2 = mpi_new (0);
+      for (i = 0; i < WNAF_NPOINTS; i++)
+        {
+          c[i] = mpi_new (0);
+          if (i)
+            ec_mulm (c[i], c[i-1], tbl[i].z, ctx);
+          else
+            mpi_set (c[i], tbl[i].z);
+        }
+      ec_invm (inv, c[WNAF_NPOINTS-1], ctx);
+      for (i = WNAF_NPOINTS - 1; i >= 0; i--)
+        {
+          if (i)
+            {
+              ec_mulm (zinv, inv, c[i-1], ctx);
+              ec_mulm (inv, inv, tbl[i].z, ctx);
+            }
+          else
+            mpi_set (zinv, inv);
+          if (ctx->model == MPI_EC_WEIERSTRASS)
+            {
+              ec_pow2 (zinv2, zinv, ctx);
+              ec_mulm (tbl[i].x, tbl[i].x, zinv2, ctx);
+              ec_mulm (zinv2, zinv2, zinv, ctx);
+              ec_mulm (tbl[i].y, tbl[i].y, zinv2, ctx);
+            }
+          else
+            {
+              ec_mulm (tbl[i].x, tbl[i].x, zinv, ctx);
+              ec_mulm (tbl[i].y, tbl[i].y, zinv, ctx);
+            }
+          mpi_set_ui (tbl[i].z, 1);
+        }
+      for (i = 0; i < WNAF_NPOINTS; i++)
+        mpi_free (c[i]);
+      mpi_free (inv);
+      mpi_free (zinv);
+      mpi_free (zinv2);
+    }
+
+  /* The negative of (x,y) is (x,-y) for Weierstrass and (-x,y) for
+     Edwards curves.  */
+  for (i = 0; i < WNAF_NPOINTS; i++)
+    {
+      point_set (&tbl[WNAF_NPOINTS + i], &tbl[i]);
+      if (ctx->model == MPI_EC_EDWARDS)
+        ec_subm (tbl[WNAF_NPOINTS + i].x, ctx->p, tbl[i].x, ctx);
+      else
+        ec_subm (tbl[WNAF_NPOINTS + i].y, ctx->p, tbl[i].y, ctx);
+    }
+}
+
+
+/* Compute RESULT = K1 * P1 + K2 * P2 using interleaved width-w NAF
+   multiplication (Shamir's trick).  All doublings are shared between
+   the two scalars.  The run time depends on the scalars and thus this
+   function must only be used with public values as in signature
+   verification.  */
+void
+_gcry_mpi_ec_mul_point_dual (mpi_point_t result,
+                             gcry_mpi_t k1, mpi_point_t p1,
+                             gcry_mpi_t k2, mpi_point_t p2,
+                             mpi_ec_t ctx)
+{
+  mpi_point_struct tbl[2][2 * WNAF_NPOINTS];
+  signed char *naf[2];
+  unsigned int len[2], i;
+  int j, d, started;
+  mpi_point_t pt;
+
+  if (ctx->model == MPI_EC_MONTGOMERY
+      || mpi_has_sign (k1) || mpi_has_sign (k2)
+      || mpi_is_secure (k1) || mpi_is_secure (k2))
+    {
+      mpi_point_struct tmppnt;
+
+      point_init (&tmppnt);
+      _gcry_mpi_ec_mul_point (result, k1, p1, ctx);
+      _gcry_mpi_ec_mul_point (&tmppnt, k2, p2, ctx);
+      _gcry_mpi_ec_add_points (result, result, &tmppnt, ctx);
+      point_free (&tmppnt);
+      return;
+    }
+
+  naf[0] = xmalloc (mpi_get_nbits (k1) + 1);
+  naf[1] = xmalloc (mpi_get_nbits (k2) + 1);
+  len[0] = compute_wnaf (naf[0], k1);
+  len[1] = compute_wnaf (naf[1], k2);
+
+  for (j = 0; j < 2; j++)
+    for (i = 0; i < 2 * WNAF_NPOINTS; i++)
+      point_init (&tbl[j][i]);
+  wnaf_precompute (tbl[0], p1, ctx);
+  wnaf_precompute (tbl[1], p2, ctx);
+
+  started = 0;
+  for (i = len[0] > len[1]? len[0] : len[1]; i-- > 0; )
+    {
+      if (started)
+        _gcry_mpi_ec_dup_point (result, result, ctx);
+      for (j = 0; j < 2; j++)
+        {
+          if (i >= len[j] || !(d = naf[j][i]))
+            continue;
+          if (d > 0)
+            pt = &tbl[j][(d - 1) / 2];
+          else
+            pt = &tbl[j][WNAF_NPOINTS + (-d - 1) / 2];
+          if (started)
+            _gcry_mpi_ec_add_points (result, result, pt, ctx);
+          else
+            {
+              point_set (result, pt);
+              started = 1;
+            }
+        }
+    }
+
+  if (!started)
+    {
+      /* Both scalars are zero.  */
+      if (ctx->model == MPI_EC_WEIERSTRASS)
+        {
+          mpi_set_ui (result->x, 1);
+          mpi_set_ui (result->y, 1);
+          mpi_set_ui (result->z, 0);
+        }
+      else
+        {
+          mpi_set_ui (result->x, 0);
+          mpi_set_ui (result->y, 1);
+          mpi_set_ui (result->z, 1);
+        }
+    }
+
+  for (j = 0; j < 2; j++)
+    for (i = 0; i < 2 * WNAF_NPOINTS; i++)
+      point_free (&tbl[j][i]);
+  xfree (naf[0]);
+  xfree (naf[1]);
+}
+
+
+/* Return the W bits of the limbs at K starting at bit POS.  Bits
+   beyond NLIMBS are zero.  */
+static unsigned int
+get_bits (mpi_ptr_t k, mpi_size_t nlimbs, unsigned int pos, unsigned int w)
+{
+  mpi_size_t idx = pos / BITS_PER_MPI_LIMB;
+  unsigned int sh = pos % BITS_PER_MPI_LIMB;
+  mpi_limb_t v;
+
+  if (idx >= nlimbs)
+    return 0;
+  v = k[idx] >> sh;
+  if (sh > BITS_PER_MPI_LIMB - w && idx + 1 < nlimbs)
+    v |= k[idx+1] << (BITS_PER_MPI_LIMB - sh);
+  return v & ((1 << w) - 1);
+}
+
+
+/* Compute RESULT = SUM SCALARS[i] * POINTS[i] for i < NPOINTS using
+   the bucket method of Pippenger.  The scalars are recoded into
+   signed digits of C bits.  For each window the points are sorted
+   into buckets by their digit and the buckets are summed up with
+   running sums, so that a window costs about NPOINTS + 2^C
+   additions.  The scalars must not be negative.  This function runs
+   in variable time and must only be used with public values.  */
+void
+_gcry_mpi_ec_mul_multi (mpi_point_t result, unsigned int npoints,
+                        gcry_mpi_t *scalars, mpi_point_t *points,
+                        mpi_ec_t ctx)
+{
+  unsigned int c, nbuckets, nwindows, nbits, i, w, b;
+  signed char *digits;
+  mpi_point_struct *negpoints, *buckets;
+  mpi_point_struct running, sum;
+  char *used;
+  int running_set, sum_set, started;
+  int d, carry;
+  mpi_point_t pt;
+
+  if (npoints < 16)
+    c = 3;
+  else if (npoints < 64)
+    c = 4;
+  else if (npoints < 256)
+    c = 5;
+  else if (npoints < 1024)
+    c = 6;
+  else
+    c = 7;
+  nbuckets = 1 << (c - 1);
+
+  nbits = 0;
+  for (i = 0; i < npoints; i++)
+    {
+      gcry_assert (!mpi_has_sign (scalars[i]));
+      if (mpi_get_nbits (scalars[i]) > nbits)
+        nbits = mpi_get_nbits (scalars[i]);
+    }
+  /* The top window needs two unused bits so that it can take the
+     carry of the signed recoding without producing another one.  */
+  nwindows = (nbits + 2 + c - 1) / c;
+
+  digits = xmalloc ((size_t)npoints * nwindows);
+  for (i = 0; i < npoints; i++)
+    {
+      carry = 0;
+      for (w = 0; w < nwindows; w++)
+        {
+          d = get_bits (scalars[i]->d, scalars[i]->nlimbs, w * c, c) + carry;
+          carry = d >= (int)nbuckets;
+          if (carry)
+            d -= 1 << c;
+          digits[(size_t)i * nwindows + w] = d;
+        }
+    }
+
+  /* The negative of (x,y) is (x,-y) for Weierstrass and (-x,y) for
+     Edwards curves.  */
+  negpoints = xmalloc ((size_t)npoints * sizeof *negpoints);
+  for (i = 0; i < npoints; i++)
+    {
+      point_init (&negpoints[i]);
+      point_set (&negpoints[i], points[i]);
+      if (ctx->model == MPI_EC_EDWARDS)
+        ec_subm (negpoints[i].x, ctx->p, points[i]->x, ctx);
+      else
+        ec_subm (negpoints[i].y, ctx->p, points[i]->y, ctx);
+    }
+
+  buckets = xmalloc (nbuckets * sizeof *buckets);
+  used = xmalloc (nbuckets);
+  for (b = 0; b < nbuckets; b++)
+    point_init (&buckets[b]);
+  point_init (&running);
+  point_init (&sum);
+
+  started = 0;
+  for (w = nwindows; w-- > 0; )
+    {
+      if (started)
+        for (i = 0; i < c; i++)
+          _gcry_mpi_ec_dup_point (result, result, ctx);
+
+      memset (used, 0, nbuckets);
+      for (i = 0; i < npoints; i++)
+        {
+          d = digits[(size_t)i * nwindows + w];
+          if (!d)
+            continue;
+          if (d > 0)
+            {
+              b = d - 1;
+              pt = points[i];
+            }
+          else
+            {
+              b = -d - 1;
+              pt = &negpoints[i];
+            }
+          if (used[b])
+            _gcry_mpi_ec_add_points (&buckets[b], &buckets[b], pt, ctx);
+          else
+            {
+              point_set (&buckets[b], pt);
+              used[b] = 1;
+            }
+        }
+
+      /* SUM = 1*B_0 + 2*B_1 + ... + NBUCKETS*B_(NBUCKETS-1).  */
+      running_set = sum_set = 0;
+      for (b = nbuckets; b-- > 0; )
+        {
+          if (used[b])
+            {
+              if (running_set)
+                _gcry_mpi_ec_add_points (&running, &running, &buckets[b],
+                                         ctx);
+              else
+                {
+                  point_set (&running, &buckets[b]);
+                  running_set = 1;
+                }
+            }
+          if (!running_set)
+            continue;
+          if (sum_set)
+            _gcry_mpi_ec_add_points (&sum, &sum, &running, ctx);
+          else
+            {
+              point_set (&sum, &running);
+              sum_set = 1;
+            }
+        }
+
+      if (!sum_set)
+        continue;
+      if (started)
+        _gcry_mpi_ec_add_points (result, result, &sum, ctx);
+      else
+        {
+          point_set (result, &sum);
+          started = 1;
+        }
+    }
+
+  if (!started)
+    {
+      if (ctx->model == MPI_EC_WEIERSTRASS)
+        {
+          mpi_set_ui (result->x, 1);
+          mpi_set_ui (result->y, 1);
+          mpi_set_ui (result->z, 0);
+        }
+      else
+        {
+          mpi_set_ui (result->x, 0);
+          mpi_set_ui (result->y, 1);
+          mpi_set_ui (result->z, 1);
+        }
+    }
+
+  point_free (&sum);
+  point_free (&running);
+  for (b = 0; b < nbuckets; b++)
+    point_free (&buckets[b]);
+  for (i = 0; i < npoints; i++)
+    point_free (&negpoints[i]);
+  xfree (used);
+  xfree (buckets);
+  xfree (negpoints);
+  xfree (digits);
+}
+
+
 /* Return true if POINT is on the curve described by CTX.  */
 int
 _gcry_mpi_ec_curve_point (gcry_mpi_point_t point, mpi_ec_t ctx)
@@ -1538,10 +2265,7 @@ _gcry_mpi_ec_curve_point (gcry_mpi_point_t point, mpi_ec_t ctx)
         ec_pow2 (x, x, ctx);
         ec_pow2 (y, y, ctx);
         if (ctx->dialect == ECC_DIALECT_ED25519)
-          {
-            mpi_set (w, x);
-            _gcry_mpi_neg (w, w);
-          }
+          ec_subm (w, ctx->p, x, ctx);
         else
           ec_mulm (w, ctx->a, x, ctx);
         ec_addm (w, w, y, ctx);
@@ -67,6 +67,12 @@
 #define KARATSUBA_THRESHOLD 2
 #endif
 
+/* The basecase squaring computes each cross product only once and
+ * thus stays faster than Karatsuba for larger sizes.  */
+#ifndef SQR_KARATSUBA_THRESHOLD
+#define SQR_KARATSUBA_THRESHOLD (2 * KARATSUBA_THRESHOLD)
+#endif
+
 
 typedef mpi_limb_t *mpi_ptr_t; /* pointer to a limb */
 typedef int mpi_size_t;        /* (must be a signed type) */
@@ -238,6 +244,37 @@ void _gcry_mpih_mul_karatsuba_case( mpi_ptr_t prodp,
 mpi_limb_t _gcry_mpih_mul_1( mpi_ptr_t res_ptr, mpi_ptr_t s1_ptr,
 			  mpi_size_t s1_size, mpi_limb_t s2_limb);
 
+/*-- amd64/mpih-mulx.S --*/
+#ifdef USE_MPIH_MULX
+extern int _gcry_mpih_use_mulx;  /* Set by _gcry_mpi_init.  */
+
+mpi_limb_t _gcry_mpih_mul_1_mulx (mpi_ptr_t res_ptr, mpi_ptr_t s1_ptr,
+                                  mpi_size_t s1_size, mpi_limb_t s2_limb);
+mpi_limb_t _gcry_mpih_addmul_1_mulx (mpi_ptr_t res_ptr, mpi_ptr_t s1_ptr,
+                                     mpi_size_t s1_size, mpi_limb_t s2_limb);
+mpi_limb_t _gcry_mpih_submul_1_mulx (mpi_ptr_t res_ptr, mpi_ptr_t s1_ptr,
+                                     mpi_size_t s1_size, mpi_limb_t s2_limb);
+mpi_limb_t _gcry_mpih_mul_n_basecase_mulx (mpi_ptr_t prodp, mpi_ptr_t up,
+                                           mpi_ptr_t vp, mpi_size_t size);
+void _gcry_mpih_sqr_n_basecase_mulx (mpi_ptr_t prodp, mpi_ptr_t up,
+                                     mpi_size_t size);
+void _gcry_mpih_redc_1_mulx (mpi_ptr_t xp, mpi_ptr_t mp, mpi_size_t msize,
+                             mpi_limb_t minv);
+
+/* Let all callers of the limb multiplication functions dispatch to
+   the MULX/ADX versions if the CPU supports them.  The parentheses
+   around the function names suppress the macro expansion.  */
+#define _gcry_mpih_mul_1(r,s,n,l)                                \
+  (_gcry_mpih_use_mulx ? _gcry_mpih_mul_1_mulx ((r),(s),(n),(l)) \
+   : (_gcry_mpih_mul_1) ((r),(s),(n),(l)))
+#define _gcry_mpih_addmul_1(r,s,n,l)                                \
+  (_gcry_mpih_use_mulx ? _gcry_mpih_addmul_1_mulx ((r),(s),(n),(l)) \
+   : (_gcry_mpih_addmul_1) ((r),(s),(n),(l)))
+#define _gcry_mpih_submul_1(r,s,n,l)                                \
+  (_gcry_mpih_use_mulx ? _gcry_mpih_submul_1_mulx ((r),(s),(n),(l)) \
+   : (_gcry_mpih_submul_1) ((r),(s),(n),(l)))
+#endif /*USE_MPIH_MULX*/
+
 /*-- mpih-div.c --*/
 mpi_limb_t _gcry_mpih_mod_1(mpi_ptr_t dividend_ptr, mpi_size_t dividend_size,
 						 mpi_limb_t divisor_limb);
@@ -346,6 +346,87 @@ _gcry_mpi_powm (gcry_mpi_t res,
     _gcry_mpi_free_limb_space( tspace, 0 );
 }
 #else
+/* Return -M^(-1) mod B for the odd limb M.  */
+static mpi_limb_t
+mont_inverse (mpi_limb_t m)
+{
+  mpi_limb_t inv;
+  int i;
+
+  /* M * M = 1 mod 8 for odd M; each Newton step doubles the number
+     of correct bits.  */
+  inv = m;
+  for (i = 3; i < BITS_PER_MPI_LIMB; i *= 2)
+    inv *= 2 - m * inv;
+
+  return -inv;
+}
+
+
+/* Montgomery reduction (REDC): Given the 2*MSIZE limb value at XP,
+ * which must be less than MP * B^MSIZE, store XP * B^(-MSIZE) mod MP
+ * at XP[0..MSIZE-1].  MINV is -MP^(-1) mod B.  The upper half of XP
+ * is clobbered.  The final subtraction is done in constant time.  */
+static void
+mont_reduce (mpi_ptr_t xp, mpi_ptr_t mp, mpi_size_t msize, mpi_limb_t minv)
+{
+  mpi_size_t i;
+  mpi_limb_t cy, borrow, mask, x;
+
+  /* Each step clears the lowest remaining limb; its carry is kept in
+     that (now zero) limb and added to the upper half in one go.  */
+#ifdef USE_MPIH_MULX
+  if (_gcry_mpih_use_mulx)
+    _gcry_mpih_redc_1_mulx (xp, mp, msize, minv);
+  else
+#endif
+  for (i = 0; i < msize; i++)
+    xp[i] = _gcry_mpih_addmul_1 (xp + i, mp, msize, xp[i] * minv);
+  cy = _gcry_mpih_add_n (xp + msize, xp + msize, xp, msize);
+
+  /* The result is less than 2*MP; subtract MP if required.  */
+  borrow = _gcry_mpih_sub_n (xp, xp + msize, mp, msize);
+  mask = ((mpi_limb_t)0) - (borrow & (cy ^ 1));
+  for (i = 0; i < msize; i++)
+    {
+      x = mask & (xp[i] ^ xp[msize + i]);
+      xp[i] ^= x;
+    }
+}
+
+
+/* Store U * B^MSIZE mod MP, i.e. U in Montgomery form, at RP and pad
+ * it to MSIZE limbs.  Return the normalized size of the result.  SEC
+ * tells whether U needs to be kept in secure memory.  */
+static mpi_size_t
+mont_convert (mpi_ptr_t rp, mpi_ptr_t up, mpi_size_t usize,
+              mpi_ptr_t mp, mpi_size_t msize, int sec)
+{
+  struct gcry_mpi m;
+  gcry_mpi_t t;
+  mpi_size_t tsize;
+
+  m.alloced = m.nlimbs = msize;
+  m.sign = 0;
+  m.flags = 0;
+  m.d = mp;
+
+  t = sec? mpi_alloc_secure (usize + msize + 1)
+         : mpi_alloc (usize + msize + 1);
+  MPN_ZERO (t->d, msize);
+  MPN_COPY (t->d + msize, up, usize);
+  t->nlimbs = usize + msize;
+  MPN_NORMALIZE (t->d, t->nlimbs);
+  mpi_tdiv_r (t, t, &m);
+
+  tsize = t->nlimbs;
+  MPN_ZERO (rp, msize);
+  MPN_COPY (rp, t->d, tsize);
+  mpi_free (t);
+  return tsize;
+}
+
+
 /**
  * Internal function to compute
  *
@@ -354,6 +435,10 @@ _gcry_mpi_powm (gcry_mpi_t res,
  * and set the size of X at the pointer XSIZE_P.
  * Use karatsuba structure at KARACTX_P.
  *
+ * If MINV is not zero, M is odd, R and S are in Montgomery form and
+ * MINV is -M^(-1) mod B as returned by mont_inverse; X is then the
+ * Montgomery product R * S * B^(-MSIZE) mod M, always MSIZE limbs.
+ *
  * Condition:
  *   RSIZE >= SSIZE
  *   Enough space for X is allocated beforehand.
@@ -365,7 +450,7 @@ static void
 mul_mod (mpi_ptr_t xp, mpi_size_t *xsize_p,
          mpi_ptr_t rp, mpi_size_t rsize,
          mpi_ptr_t sp, mpi_size_t ssize,
-         mpi_ptr_t mp, mpi_size_t msize,
+         mpi_ptr_t mp, mpi_size_t msize, mpi_limb_t minv,
          struct karatsuba_ctx *karactx_p)
 {
   if( ssize < KARATSUBA_THRESHOLD )
@@ -373,13 +458,149 @@ mul_mod (mpi_ptr_t xp, mpi_size_t *xsize_p,
   else
     _gcry_mpih_mul_karatsuba_case (xp, rp, rsize, sp, ssize, karactx_p);
 
-   if (rsize + ssize > msize)
+  if (minv)
+    {
+      mont_reduce (xp, mp, msize, minv);
+      *xsize_p = msize;
+    }
+  else if (rsize + ssize > msize)
     {
       _gcry_mpih_divrem (xp + msize, 0, xp, rsize + ssize, mp, msize);
       *xsize_p = msize;
     }
-   else
-     *xsize_p = rsize + ssize;
+  else
+    *xsize_p = rsize + ssize;
+}
+
+
+/* Store the Montgomery square of the MSIZE limbs at RP at XP, which
+ * needs space for 2*MSIZE limbs.  TSPACE must have 2*MSIZE limbs.  */
+static void
+sqr_mod (mpi_ptr_t xp, mpi_ptr_t rp,
+         mpi_ptr_t mp, mpi_size_t msize, mpi_limb_t minv,
+         mpi_ptr_t tspace)
+{
+  if (msize < SQR_KARATSUBA_THRESHOLD)
+    _gcry_mpih_sqr_n_basecase (xp, rp, msize);
+  else
+    _gcry_mpih_sqr_n (xp, rp, msize, tspace);
+  mont_reduce (xp, mp, msize, minv);
+}
+
+
+/* Copy entry IDX of the NENTS entries of MSIZE limbs at TABLE to RP
+ * without revealing IDX through the memory access pattern.  */
+static void
+mont_select (mpi_ptr_t rp, mpi_ptr_t table, int nents, mpi_size_t msize,
+             unsigned int idx)
+{
+  mpi_limb_t mask;
+  mpi_size_t i;
+  int k;
+
+  MPN_ZERO (rp, msize);
+  for (k = 0; k < nents; k++, table += msize)
+    {
+      mask = ((mpi_limb_t)0) - (k == idx);
+      for (i = 0; i < msize; i++)
+        rp[i] |= table[i] & mask;
+    }
+}
+
+
+/* Fixed window exponentiation in Montgomery form.  Compute BP^EP *
+ * B^(-MSIZE) mod MP and store it with MSIZE limbs at RP, which needs
+ * space for 2*MSIZE limbs.  BP is in Montgomery form and has MSIZE
+ * limbs, EP has ESIZE limbs with a non-zero most significant limb.
+ * W is the window size in bits and ESEC tells whether the exponent is
+ * in secure memory.
+ *
+ * Each window of the exponent is processed with W squarings and one
+ * multiplication with an entry of the table selected in constant
+ * time; a zero window multiplies by 1.  The sequence of squarings and
+ * multiplications only depends on the bit length of the exponent and
+ * thus a dedicated squaring function can be used without revealing
+ * the exponent through the code access pattern.
+ */
+static void
+mont_powm_fixed (mpi_ptr_t rp, mpi_ptr_t bp, mpi_ptr_t ep, mpi_size_t esize,
+                 mpi_ptr_t mp, mpi_size_t msize, mpi_limb_t minv,
+                 int W, int esec)
+{
+  mpi_ptr_t res_p = rp;
+  mpi_ptr_t table, xp, xp_marker, up, tspace, tp;
+  mpi_size_t xsize, table_size;
+  unsigned int nents, nbits, ebit, bitidx, limbidx, idx;
+  mpi_limb_t one = 1;
+  int cnt;
+  struct karatsuba_ctx karactx;
+
+  memset (&karactx, 0, sizeof karactx);
+  nents = 1 << W;
+  table_size = nents * msize;
+  table = mpi_alloc_limb_space (table_size, esec);
+  xp = xp_marker = mpi_alloc_limb_space (2 * msize, esec);
+  up = mpi_alloc_limb_space (msize, esec);
+  tspace = mpi_alloc_limb_space (2 * msize, esec);
+
+  /* TABLE[I] = BASE^I in Montgomery form.  */
+  mont_convert (table, &one, 1, mp, msize, 0);
+  MPN_COPY (table + msize, bp, msize);
+  for (idx = 2; idx < nents; idx++)
+    {
+      mul_mod (xp, &xsize, table + (idx - 1) * msize, msize, bp, msize,
+               mp, msize, minv, &karactx);
+      MPN_COPY (table + idx * msize, xp, msize);
+    }
+
+  count_leading_zeros (cnt, ep[esize - 1]);
+  nbits = esize * BITS_PER_MPI_LIMB - cnt;
+
+  /* Process the windows from the most significant one.  The windows
+     are aligned to the least significant bit; the first one may be
+     shorter.  */
+  ebit = ((nbits - 1) / W) * W;
+  for (;;)
+    {
+      limbidx = ebit / BITS_PER_MPI_LIMB;
+      bitidx = ebit % BITS_PER_MPI_LIMB;
+      idx = ep[limbidx] >> bitidx;
+      if (bitidx + W > BITS_PER_MPI_LIMB && limbidx + 1 < esize)
+        idx |= ep[limbidx + 1] << (BITS_PER_MPI_LIMB - bitidx);
+      idx &= nents - 1;
+
+      mont_select (up, table, nents, msize, idx);
+      if (ebit == ((nbits - 1) / W) * W)
+        MPN_COPY (rp, up, msize);
+      else
+        {
+          mul_mod (xp, &xsize, rp, msize, up, msize, mp, msize, minv,
+                   &karactx);
+          MPN_COPY (rp, xp, msize);
+        }
+
+      if (!ebit)
+        break;
+      ebit -= W;
+
+      for (cnt = 0; cnt < W; cnt++)
+        {
+          sqr_mod (xp, rp, mp, msize, minv, tspace);
+          tp = rp; rp = xp; xp = tp;
+        }
+    }
+
+  /* Convert the result back from Montgomery form.  */
+  MPN_ZERO (rp + msize, msize);
+  mont_reduce (rp, mp, msize, minv);
+  if (rp != res_p)
+    MPN_COPY (res_p, rp, msize);
+
+  _gcry_mpih_release_karatsuba_ctx (&karactx);
+  _gcry_mpi_free_limb_space (tspace, 2 * msize);
+  _gcry_mpi_free_limb_space (up, esec? msize : 0);
+  _gcry_mpi_free_limb_space (xp_marker, esec? 2 * msize : 0);
+  _gcry_mpi_free_limb_space (table, esec? table_size : 0);
 }
 
 #define SIZE_PRECOMP ((1 << (5 - 1)))
@@ -389,11 +610,19 @@ mul_mod (mpi_ptr_t xp, mpi_size_t *xsize_p,
  *
  * To mitigate the Yarom/Falkner flush+reload cache side-channel
  * attack on the RSA secret exponent, we don't use the square
- * routine but multiplication.
+ * routine but multiplication in the sliding window method.  The
+ * fixed window method used for odd moduli has an exponent
+ * independent sequence of squarings and multiplications and thus
+ * uses the square routine.
+ *
+ * For an odd MOD all products are computed in Montgomery form which
+ * replaces the division after each multiplication by a cheaper
+ * Montgomery reduction.
  *
  * Reference:
  *   Handbook of Applied Cryptography
  *       Algorithm 14.83: Modified left-to-right k-ary exponentiation
+ *       Algorithm 14.32: Montgomery reduction
  */
 void
 _gcry_mpi_powm (gcry_mpi_t res,
@@ -424,6 +653,7 @@ _gcry_mpi_powm (gcry_mpi_t res,
   mpi_ptr_t base_u;
   mpi_size_t base_u_size;
   mpi_size_t max_u_size;
+  mpi_limb_t minv;
 
   esize = expo->nlimbs;
   msize = mod->nlimbs;
@@ -471,10 +701,15 @@ _gcry_mpi_powm (gcry_mpi_t res,
   /* Normalize MOD (i.e. make its most significant bit set) as
      required by mpn_divrem.  This will make the intermediate values
      in the calculation slightly larger, but the correct result is
-     obtained after a final reduction using the original MOD value. */
+     obtained after a final reduction using the original MOD value.
+     An odd MOD is used as is for Montgomery multiplication.  */
   mp_nlimbs = msec? msize:0;
   mp = mp_marker = mpi_alloc_limb_space(msize, msec);
-  count_leading_zeros (mod_shift_cnt, mod->d[msize-1]);
+  minv = (mod->d[0] & 1)? mont_inverse (mod->d[0]) : 0;
+  if (minv)
+    mod_shift_cnt = 0;
+  else
+    count_leading_zeros (mod_shift_cnt, mod->d[msize-1]);
   if (mod_shift_cnt)
     _gcry_mpih_lshift (mp, mod->d, msize, mod_shift_cnt);
   else
@@ -482,7 +717,16 @@ _gcry_mpi_powm (gcry_mpi_t res,
 
   bsize = base->nlimbs;
   bsign = base->sign;
-  if (bsize > msize)
+  if (minv)
+    {
+      /* Convert the base into Montgomery form: BASE * B^MSIZE mod MOD.
+         The result always has MSIZE limbs so that all operands of
+         the main loop have the same size.  */
+      bp_nlimbs = bsec ? msize:0;
+      bp = bp_marker = mpi_alloc_limb_space (msize, bsec);
+      bsize = mont_convert (bp, base->d, bsize, mp, msize, bsec)? msize : 0;
+    }
+  else if (bsize > msize)
     {
       /* The base is larger than the module.  Reduce it.
 
@@ -512,7 +756,7 @@ _gcry_mpi_powm (gcry_mpi_t res,
 
   /* Make BASE, EXPO not overlap with RES.  We don't need to check MOD
      because that has already been copied to the MP var.  */
-  if ( rp == bp )
+  if ( rp == bp && !bp_marker )
     {
       /* RES and BASE are identical.  Allocate temp. space for BASE.  */
       gcry_assert (!bp_marker);
@@ -535,6 +779,19 @@ _gcry_mpi_powm (gcry_mpi_t res,
       rp = res->d;
     }
 
+  /* For odd moduli and exponents of more than one limb use the fixed
+     window method which allows squaring without revealing the
+     exponent.  */
+  if (minv && esize > 1)
+    {
+      negative_result = (ep[0] & 1) && bsign;
+      rsign = 0;
+      mont_powm_fixed (rp, bp, ep, esize, mp, msize, minv, W, esec);
+      rsize = msize;
+      MPN_NORMALIZE (rp, rsize);
+      goto fixup;
+    }
+
   /* Main processing.  */
   {
     mpi_size_t i, j, k;
@@ -554,7 +811,7 @@ _gcry_mpi_powm (gcry_mpi_t res,
 
     /* Precompute PRECOMP[], BASE^(2 * i + 1), BASE^1, ^3, ^5, ... */
     if (W > 1)                  /* X := BASE^2 */
-      mul_mod (xp, &xsize, bp, bsize, bp, bsize, mp, msize, &karactx);
+      mul_mod (xp, &xsize, bp, bsize, bp, bsize, mp, msize, minv, &karactx);
     base_u = precomp[0] = mpi_alloc_limb_space (bsize, esec);
     base_u_size = max_u_size = precomp_size[0] = bsize;
     MPN_COPY (precomp[0], bp, bsize);
@@ -562,10 +819,10 @@ _gcry_mpi_powm (gcry_mpi_t res,
       {                         /* PRECOMP[i] = BASE^(2 * i + 1) */
         if (xsize >= base_u_size)
           mul_mod (rp, &rsize, xp, xsize, base_u, base_u_size,
-                   mp, msize, &karactx);
+                   mp, msize, minv, &karactx);
         else
           mul_mod (rp, &rsize, base_u, base_u_size, xp, xsize,
-                   mp, msize, &karactx);
+                   mp, msize, minv, &karactx);
         base_u = precomp[i] = mpi_alloc_limb_space (rsize, esec);
         base_u_size = precomp_size[i] = rsize;
         if (max_u_size < base_u_size)
@@ -656,7 +913,7 @@ _gcry_mpi_powm (gcry_mpi_t res,
 
           for (j += W - c0; j; j--)
             {
-              mul_mod (xp, &xsize, rp, rsize, rp, rsize, mp, msize, &karactx);
+              mul_mod (xp, &xsize, rp, rsize, rp, rsize, mp, msize, minv, &karactx);
               tp = rp; rp = xp; xp = tp;
               rsize = xsize;
             }
@@ -681,7 +938,7 @@ _gcry_mpi_powm (gcry_mpi_t res,
             }
 
           mul_mod (xp, &xsize, rp, rsize, base_u, base_u_size,
-                   mp, msize, &karactx);
+                   mp, msize, minv, &karactx);
           tp = rp; rp = xp; xp = tp;
           rsize = xsize;
 
@@ -698,7 +955,7 @@ _gcry_mpi_powm (gcry_mpi_t res,
 
     while (j--)
       {
-        mul_mod (xp, &xsize, rp, rsize, rp, rsize, mp, msize, &karactx);
+        mul_mod (xp, &xsize, rp, rsize, rp, rsize, mp, msize, minv, &karactx);
         tp = rp; rp = xp; xp = tp;
         rsize = xsize;
       }
@@ -725,13 +982,13 @@ _gcry_mpi_powm (gcry_mpi_t res,
           }
 
         mul_mod (xp, &xsize, rp, rsize, base_u, base_u_size,
-                 mp, msize, &karactx);
+                 mp, msize, minv, &karactx);
         tp = rp; rp = xp; xp = tp;
         rsize = xsize;
 
         for (; c; c--)
           {
-            mul_mod (xp, &xsize, rp, rsize, rp, rsize, mp, msize, &karactx);
+            mul_mod (xp, &xsize, rp, rsize, rp, rsize, mp, msize, minv, &karactx);
             tp = rp; rp = xp; xp = tp;
             rsize = xsize;
           }
@@ -739,11 +996,21 @@ _gcry_mpi_powm (gcry_mpi_t res,
 
     /* We shifted MOD, the modulo reduction argument, left
        MOD_SHIFT_CNT steps.  Adjust the result by reducing it with the
-       original MOD.
+       original MOD.  A result in Montgomery form is converted back by
+       a Montgomery reduction.
 
        Also make sure the result is put in RES->d (where it already
        might be, see above).  */
-    if ( mod_shift_cnt )
+    if (minv)
+      {
+        MPN_COPY (xp, rp, rsize);
+        MPN_ZERO (xp + rsize, 2 * msize - rsize);
+        mont_reduce (xp, mp, msize, minv);
+        MPN_COPY (res->d, xp, msize);
+        rp = res->d;
+        rsize = msize;
+      }
+    else if ( mod_shift_cnt )
       {
         carry_limb = _gcry_mpih_lshift( res->d, rp, rsize, mod_shift_cnt);
         rp = res->d;
@@ -759,7 +1026,7 @@ _gcry_mpi_powm (gcry_mpi_t res,
         rp = res->d;
       }
 
-    if ( rsize >= msize )
+    if ( rsize >= msize && !minv )
       {
         _gcry_mpih_divrem(rp + msize, 0, rp, rsize, mp, msize);
         rsize = msize;
@@ -776,6 +1043,7 @@ _gcry_mpi_powm (gcry_mpi_t res,
     _gcry_mpi_free_limb_space (base_u, esec ? max_u_size : 0);
   }
 
+ fixup:
   /* Fixup for negative results.  */
   if ( negative_result && rsize )
     {
@@ -43,7 +43,7 @@
 
 #define MPN_SQR_N_RECURSE(prodp, up, size, tspace) \
     do {					    \
-	if ((size) < KARATSUBA_THRESHOLD)	    \
+	if ((size) < SQR_KARATSUBA_THRESHOLD)	    \
 	    _gcry_mpih_sqr_n_basecase (prodp, up, size);	 \
 	else					    \
 	    _gcry_mpih_sqr_n (prodp, up, size, tspace);	 \
@@ -77,6 +77,11 @@ mul_n_basecase( mpi_ptr_t prodp, mpi_ptr_t up,
     mpi_limb_t cy;
     mpi_limb_t v_limb;
 
+#ifdef USE_MPIH_MULX
+    if( _gcry_mpih_use_mulx )
+	return _gcry_mpih_mul_n_basecase_mulx( prodp, up, vp, size );
+#endif
+
     /* Multiply by the first limb in V separately, as the result can be
      * stored (not added) to PROD.  We also avoid a loop for zeroing.  */
     v_limb = vp[0];
@@ -227,38 +232,44 @@ _gcry_mpih_sqr_n_basecase( mpi_ptr_t prodp, mpi_ptr_t up, mpi_size_t size )
 {
     mpi_size_t i;
     mpi_limb_t cy_limb;
-    mpi_limb_t v_limb;
 
-    /* Multiply by the first limb in V separately, as the result can be
-     * stored (not added) to PROD.  We also avoid a loop for zeroing.  */
-    v_limb = up[0];
-    if( v_limb <= 1 ) {
-	if( v_limb == 1 )
-	    MPN_COPY( prodp, up, size );
-	else
-	    MPN_ZERO(prodp, size);
-	cy_limb = 0;
+#ifdef USE_MPIH_MULX
+    if( _gcry_mpih_use_mulx ) {
+	_gcry_mpih_sqr_n_basecase_mulx( prodp, up, size );
+	return;
     }
-    else
-	cy_limb = _gcry_mpih_mul_1( prodp, up, size, v_limb );
-
-    prodp[size] = cy_limb;
-    prodp++;
+#endif
 
-    /* For each iteration in the outer loop, multiply one limb from
-     * U with one limb from V, and add it to PROD.  */
-    for( i=1; i < size; i++) {
-	v_limb = up[i];
-	if( v_limb <= 1 ) {
-	    cy_limb = 0;
-	    if( v_limb == 1 )
-		cy_limb = _gcry_mpih_add_n(prodp, prodp, up, size);
-	}
-	else
-	    cy_limb = _gcry_mpih_addmul_1(prodp, up, size, v_limb);
+    if( size == 1 ) {
+	umul_ppmm( prodp[1], prodp[0], up[0], up[0] );
+	return;
+    }
 
-	prodp[size] = cy_limb;
-	prodp++;
+    /* Compute the sum of the products U[i]*U[j] with i < j, i.e. the
+     * triangle above the diagonal, at PRODP + 1.  Each product is only
+     * computed once instead of twice as with a general multiplication.  */
+    prodp[0] = 0;
+    prodp[size] = _gcry_mpih_mul_1( prodp + 1, up + 1, size - 1, up[0] );
+    for( i=1; i < size - 1; i++ )
+	prodp[size + i] = _gcry_mpih_addmul_1( prodp + 2 * i + 1, up + i + 1,
+					       size - i - 1, up[i] );
+    prodp[2 * size - 1] = 0;
+
+    /* Double the triangle and add the squares of the diagonal.  */
+    _gcry_mpih_lshift( prodp, prodp, 2 * size, 1 );
+    cy_limb = 0;
+    for( i=0; i < size; i++ ) {
+	mpi_limb_t hi, lo, s0, s1;
+
+	umul_ppmm( hi, lo, up[i], up[i] );
+	s0 = prodp[2 * i] + lo;
+	hi += s0 < lo;
+	s0 += cy_limb;
+	hi += s0 < cy_limb;
+	s1 = prodp[2 * i + 1] + hi;
+	cy_limb = s1 < hi;
+	prodp[2 * i] = s0;
+	prodp[2 * i + 1] = s1;
     }
 }
 
@@ -349,7 +360,7 @@ _gcry_mpih_mul_n( mpi_ptr_t prodp,
     int secure;
 
     if( up == vp ) {
-	if( size < KARATSUBA_THRESHOLD )
+	if( size < SQR_KARATSUBA_THRESHOLD )
 	    _gcry_mpih_sqr_n_basecase( prodp, up, size );
 	else {
 	    mpi_ptr_t tspace;
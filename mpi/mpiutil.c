@@ -40,6 +40,12 @@ _gcry_mpi_get_hw_config (void)
 }
 
 
+#ifdef USE_MPIH_MULX
+/* True if the MULX/ADX versions of the mpih functions shall be used.  */
+int _gcry_mpih_use_mulx;
+#endif
+
+
 /* Initialize the MPI subsystem.  This is called early and allows to
    do some initialization without taking care of threading issues.  */
 gcry_err_code_t
@@ -48,6 +54,12 @@ _gcry_mpi_init (void)
   int idx;
   unsigned long value;
 
+#ifdef USE_MPIH_MULX
+  _gcry_mpih_use_mulx = ((_gcry_get_hw_features ()
+                          & (HWF_INTEL_BMI2 | HWF_INTEL_ADX))
+                         == (HWF_INTEL_BMI2 | HWF_INTEL_ADX));
+#endif
+
   for (idx=0; idx < MPI_NUMBER_OF_CONSTANTS; idx++)
     {
       switch (idx)
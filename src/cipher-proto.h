@@ -76,6 +76,13 @@ typedef gcry_err_code_t (*gcry_pk_verify_t) (gcry_sexp_t s_sig,
                                              gcry_sexp_t s_data,
                                              gcry_sexp_t keyparms);
 
+/* Type for the pk_verify_batch function.  */
+typedef gcry_err_code_t (*gcry_pk_verify_batch_t) (gcry_sexp_t *s_sigs,
+                                                   gcry_sexp_t *s_data,
+                                                   gcry_sexp_t *keyparms,
+                                                   size_t n,
+                                                   gcry_err_code_t *r_rc);
+
 /* Type for the pk_get_nbits function.  */
 typedef unsigned (*gcry_pk_get_nbits_t) (gcry_sexp_t keyparms);
 
@@ -119,6 +126,7 @@ typedef struct gcry_pk_spec
   pk_comp_keygrip_t comp_keygrip;
   pk_get_curve_t get_curve;
   pk_get_curve_param_t get_curve_param;
+  gcry_pk_verify_batch_t verify_batch;  /* Optional.  */
 } gcry_pk_spec_t;
 
 
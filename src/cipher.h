@@ -103,6 +103,9 @@ gcry_err_code_t _gcry_cipher_open_internal (gcry_cipher_hd_t *handle,
 /*-- cipher-cmac.c --*/
 gcry_err_code_t _gcry_cipher_cmac_authenticate
 /*           */ (gcry_cipher_hd_t c, const unsigned char *abuf, size_t abuflen);
+void _gcry_cipher_cmac_authenticate_multi
+/*           */ (gcry_cipher_hd_t *hds, const unsigned char **abufs,
+                 const size_t *abuflens, size_t n, gcry_err_code_t *rcs);
 gcry_err_code_t _gcry_cipher_cmac_get_tag
 /*           */ (gcry_cipher_hd_t c,
                  unsigned char *outtag, size_t taglen);
@@ -120,6 +123,40 @@ void _gcry_sha1_hash_buffer (void *outbuf,
                              const void *buffer, size_t length);
 void _gcry_sha1_hash_buffers (void *outbuf,
                               const gcry_buffer_t *iov, int iovcnt);
+gcry_err_code_t _gcry_sha1_hash_buffer_batch (void **digests,
+                                              const void **buffers,
+                                              const size_t *lengths,
+                                              size_t n);
+void _gcry_sha1_pbkdf2 (const void *passphrase, size_t passphraselen,
+                        const void *salt, size_t saltlen,
+                        unsigned long iterations,
+                        size_t keysize, void *keybuffer);
+
+/*-- sha256.c --*/
+gcry_err_code_t _gcry_sha224_hash_buffer_batch (void **digests,
+                                                const void **buffers,
+                                                const size_t *lengths,
+                                                size_t n);
+gcry_err_code_t _gcry_sha256_hash_buffer_batch (void **digests,
+                                                const void **buffers,
+                                                const size_t *lengths,
+                                                size_t n);
+void _gcry_sha224_pbkdf2 (const void *passphrase, size_t passphraselen,
+                          const void *salt, size_t saltlen,
+                          unsigned long iterations,
+                          size_t keysize, void *keybuffer);
+void _gcry_sha256_pbkdf2 (const void *passphrase, size_t passphraselen,
+                          const void *salt, size_t saltlen,
+                          unsigned long iterations,
+                          size_t keysize, void *keybuffer);
+
+/*-- keccak.c --*/
+gcry_err_code_t _gcry_sha3_hash_buffer_batch (int algo, void **digests,
+                                              const void **buffers,
+                                              const size_t *lengths,
+                                              size_t n);
+gcry_err_code_t _gcry_shake_extract_batch (void **contexts, void **outbufs,
+                                           size_t outlen, size_t n);
 
 /*-- rijndael.c --*/
 void _gcry_aes_cfb_enc (void *context, unsigned char *iv,
@@ -141,6 +178,20 @@ size_t _gcry_aes_ocb_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
 			    const void *inbuf_arg, size_t nblocks, int encrypt);
 size_t _gcry_aes_ocb_auth (gcry_cipher_hd_t c, const void *abuf_arg,
 			   size_t nblocks);
+size_t _gcry_aes_gcm_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+			    const void *inbuf_arg, size_t nblocks, int encrypt);
+void _gcry_aes_xts_crypt (void *context, unsigned char *tweak,
+			  void *outbuf_arg, const void *inbuf_arg,
+			  size_t nblocks, int encrypt);
+void _gcry_aes_cbc_enc_multi (void **contexts, unsigned char **ivs,
+                              unsigned char **outbufs,
+                              const unsigned char **inbufs,
+                              size_t nlanes, size_t nblocks, int cbc_mac);
+
+/*-- chacha20.c --*/
+int _gcry_chacha20_poly1305_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                                   const void *inbuf_arg, size_t length,
+                                   int encrypt);
 
 /*-- blowfish.c --*/
 void _gcry_blowfish_cfb_dec (void *context, unsigned char *iv,
@@ -241,6 +292,9 @@ void _gcry_register_pk_elg_progress (gcry_handler_progress_t cb,
 void _gcry_register_pk_ecc_progress (gcry_handler_progress_t cbc,
                                      void *cb_data);
 
+/*-- ecc-curves.c --*/
+void _gcry_ecc_flush_cache (void);
+
 
 /*-- primegen.c --*/
 void _gcry_register_primegen_progress (gcry_handler_progress_t cb,
@@ -45,6 +45,9 @@ struct mpi_ec_ctx_s
   gcry_mpi_t d;         /* Private key.  */
 
 
+  /* The owning item of the curve cache or NULL.  */
+  struct ecc_curve_cache_item_s *cache_item;
+
   /* This structure is private to mpi/ec.c! */
   struct {
     struct {
@@ -58,13 +61,18 @@ struct mpi_ec_ctx_s
 
     mpi_barrett_t p_barrett;
 
+    /* Specialized reduction function for well known primes or NULL.  */
+    void (*mod) (gcry_mpi_t w, mpi_ec_t ctx);
+
+    /* Specialized field arithmetic for well known primes or NULL.  */
+    void (*addm) (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx);
+    void (*subm) (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx);
+    void (*mulm) (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx);
+    void (*mul2) (gcry_mpi_t w, gcry_mpi_t u, mpi_ec_t ctx);
+    void (*pow2) (gcry_mpi_t w, const gcry_mpi_t b, mpi_ec_t ctx);
+
     /* Scratch variables.  */
     gcry_mpi_t scratch[11];
-
-    /* Helper for fast reduction.  */
-    /*   int nist_nbits; /\* If this is a NIST curve, the # of bits.  *\/ */
-    /*   gcry_mpi_t s[10]; */
-    /*   gcry_mpi_t c; */
   } t;
 };
 
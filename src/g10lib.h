@@ -212,6 +212,12 @@ char **_gcry_strtokenize (const char *string, const char *delim);
 
 #define HWF_ARM_NEON        (1 << 14)
 
+#define HWF_INTEL_ADX       (1 << 15)
+#define HWF_INTEL_VAES      (1 << 16)
+#define HWF_INTEL_VPCLMUL   (1 << 17)
+#define HWF_INTEL_AVX512    (1 << 18)
+#define HWF_INTEL_SHAEXT    (1 << 19)
+
 
 gpg_err_code_t _gcry_disable_hw_feature (const char *name);
 void _gcry_detect_hw_features (void);
@@ -73,15 +73,33 @@ int _gcry_cipher_mode_from_oid (const char *string) _GCRY_GCC_ATTR_PURE;
 gpg_err_code_t _gcry_cipher_encrypt (gcry_cipher_hd_t h,
                                      void *out, size_t outsize,
                                      const void *in, size_t inlen);
+gpg_err_code_t _gcry_cipher_encrypt_batch (gcry_cipher_hd_t *hds,
+                                           void **out, const size_t *outsize,
+                                           const void **in,
+                                           const size_t *inlen,
+                                           size_t n, gcry_error_t *r_results);
 gpg_err_code_t _gcry_cipher_decrypt (gcry_cipher_hd_t h,
                                      void *out, size_t outsize,
                                      const void *in, size_t inlen);
+gpg_err_code_t _gcry_cipher_encrypt_buffers (gcry_cipher_hd_t h,
+                                             const gcry_buffer_t *out,
+                                             int outcnt,
+                                             const gcry_buffer_t *in,
+                                             int incnt);
+gpg_err_code_t _gcry_cipher_decrypt_buffers (gcry_cipher_hd_t h,
+                                             const gcry_buffer_t *out,
+                                             int outcnt,
+                                             const gcry_buffer_t *in,
+                                             int incnt);
 gcry_err_code_t _gcry_cipher_setkey (gcry_cipher_hd_t hd,
                                      const void *key, size_t keylen);
 gcry_err_code_t _gcry_cipher_setiv (gcry_cipher_hd_t hd,
                                     const void *iv, size_t ivlen);
 gpg_err_code_t _gcry_cipher_authenticate (gcry_cipher_hd_t hd, const void *abuf,
                                           size_t abuflen);
+gpg_err_code_t _gcry_cipher_authenticate_buffers (gcry_cipher_hd_t hd,
+                                                  const gcry_buffer_t *iov,
+                                                  int iovcnt);
 gpg_err_code_t _gcry_cipher_gettag (gcry_cipher_hd_t hd, void *outtag,
                                     size_t taglen);
 gpg_err_code_t _gcry_cipher_checktag (gcry_cipher_hd_t hd, const void *intag,
@@ -104,6 +122,9 @@ gpg_err_code_t _gcry_pk_sign (gcry_sexp_t *result,
                               gcry_sexp_t data, gcry_sexp_t skey);
 gpg_err_code_t _gcry_pk_verify (gcry_sexp_t sigval,
                                 gcry_sexp_t data, gcry_sexp_t pkey);
+gpg_err_code_t _gcry_pk_verify_batch (gcry_sexp_t *sigvals,
+                                      gcry_sexp_t *data, gcry_sexp_t *pkeys,
+                                      size_t n, gcry_error_t *r_results);
 gpg_err_code_t _gcry_pk_testkey (gcry_sexp_t key);
 gpg_err_code_t _gcry_pk_genkey (gcry_sexp_t *r_key, gcry_sexp_t s_parms);
 gpg_err_code_t _gcry_pk_ctl (int cmd, void *buffer, size_t buflen);
@@ -131,11 +152,17 @@ void _gcry_md_write (gcry_md_hd_t hd, const void *buffer, size_t length);
 unsigned char *_gcry_md_read (gcry_md_hd_t hd, int algo);
 gpg_error_t _gcry_md_extract (gcry_md_hd_t hd, int algo, void *buffer,
                               size_t length);
+gpg_err_code_t _gcry_md_extract_batch (gcry_md_hd_t *hds, int algo,
+                                       void **outbufs, size_t length,
+                                       size_t n);
 void _gcry_md_hash_buffer (int algo, void *digest,
                            const void *buffer, size_t length);
 gpg_err_code_t _gcry_md_hash_buffers (int algo, unsigned int flags,
                                       void *digest,
                                       const gcry_buffer_t *iov, int iovcnt);
+gpg_err_code_t _gcry_md_hash_buffer_batch (int algo, void **digests,
+                                           const void **buffers,
+                                           const size_t *lengths, size_t n);
 int _gcry_md_get_algo (gcry_md_hd_t hd);
 unsigned int _gcry_md_get_algo_dlen (int algo);
 int _gcry_md_is_enabled (gcry_md_hd_t a, int algo);
@@ -148,6 +175,7 @@ const char *_gcry_md_algo_name (int algo) _GCRY_GCC_ATTR_PURE;
 int _gcry_md_map_name (const char* name) _GCRY_GCC_ATTR_PURE;
 gpg_err_code_t _gcry_md_setkey (gcry_md_hd_t hd,
                                 const void *key, size_t keylen);
+gpg_err_code_t _gcry_md_setkey_from (gcry_md_hd_t hd, gcry_md_hd_t keyhd);
 void _gcry_md_debug (gcry_md_hd_t hd, const char *suffix);
 
 #define _gcry_md_test_algo(a) \
@@ -179,6 +207,9 @@ gpg_err_code_t _gcry_mac_setiv (gcry_mac_hd_t hd, const void *iv,
                              size_t ivlen);
 gpg_err_code_t _gcry_mac_write (gcry_mac_hd_t hd, const void *buffer,
                              size_t length);
+gpg_err_code_t _gcry_mac_write_batch (gcry_mac_hd_t *hds, const void **buffers,
+                                      const size_t *lengths, size_t n,
+                                      gcry_error_t *r_results);
 gpg_err_code_t _gcry_mac_read (gcry_mac_hd_t hd, void *buffer, size_t *buflen);
 gpg_err_code_t _gcry_mac_verify (gcry_mac_hd_t hd, const void *buffer,
                                  size_t buflen);
@@ -171,13 +171,15 @@ static unsigned int
 detect_x86_gnuc (void)
 {
   char vendor_id[12+1];
-  unsigned int features;
+  unsigned int features, features2;
   unsigned int os_supports_avx_avx2_registers = 0;
+  unsigned int os_supports_avx512_registers = 0;
   unsigned int max_cpuid_level;
   unsigned int fms, family, model;
   unsigned int result = 0;
 
   (void)os_supports_avx_avx2_registers;
+  (void)os_supports_avx512_registers;
 
   if (!is_cpuid_available())
     return 0;
@@ -290,8 +292,15 @@ detect_x86_gnuc (void)
   if (features & 0x08000000)
     {
       /* Check that OS has enabled both XMM and YMM state support.  */
-      if ((get_xgetbv() & 0x6) == 0x6)
+      unsigned int xcr0 = get_xgetbv();
+
+      if ((xcr0 & 0x6) == 0x6)
         os_supports_avx_avx2_registers = 1;
+
+      /* Check that OS has also enabled the opmask, upper ZMM0-15 and
+         ZMM16-31 state.  */
+      if ((xcr0 & 0xe6) == 0xe6)
+        os_supports_avx512_registers = 1;
     }
 #endif
 #ifdef ENABLE_AVX_SUPPORT
@@ -313,18 +322,44 @@ detect_x86_gnuc (void)
   if (max_cpuid_level >= 7 && (features & 0x00000001))
     {
       /* Get CPUID:7 contains further Intel feature flags. */
-      get_cpuid(7, NULL, &features, NULL, NULL);
+      get_cpuid(7, NULL, &features, &features2, NULL);
 
       /* Test bit 8 for BMI2.  */
       if (features & 0x00000100)
           result |= HWF_INTEL_BMI2;
 
+      /* Test bit 19 for ADX.  */
+      if (features & 0x00080000)
+          result |= HWF_INTEL_ADX;
+
 #ifdef ENABLE_AVX2_SUPPORT
       /* Test bit 5 for AVX2.  */
       if (features & 0x00000020)
         if (os_supports_avx_avx2_registers)
           result |= HWF_INTEL_AVX2;
+
+      /* Test bit 9 for VAES and bit 10 for VPCLMULQDQ.  We only use
+         their VEX encoded forms on the YMM registers.  */
+      if (features2 & 0x00000200)
+        if (os_supports_avx_avx2_registers)
+          result |= HWF_INTEL_VAES;
+      if (features2 & 0x00000400)
+        if (os_supports_avx_avx2_registers)
+          result |= HWF_INTEL_VPCLMUL;
+
+      /* Test bit 16 for AVX512F.  */
+      if (features & 0x00010000)
+        if (os_supports_avx512_registers)
+          result |= HWF_INTEL_AVX512;
 #endif /*ENABLE_AVX_SUPPORT*/
+
+#ifdef ENABLE_SHAEXT_SUPPORT
+      /* Test bit 29 for SHA Extensions.  The implementations also need
+         SSE4.1 (PBLENDW, PINSRD, PEXTRD).  */
+      if (features & (1 << 29))
+        if (result & HWF_INTEL_SSE4_1)
+          result |= HWF_INTEL_SHAEXT;
+#endif /*ENABLE_SHAEXT_SUPPORT*/
     }
 
   return result;
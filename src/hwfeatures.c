@@ -56,7 +56,12 @@ static struct
     { HWF_INTEL_RDRAND,    "intel-rdrand" },
     { HWF_INTEL_AVX,       "intel-avx" },
     { HWF_INTEL_AVX2,      "intel-avx2" },
-    { HWF_ARM_NEON,        "arm-neon" }
+    { HWF_ARM_NEON,        "arm-neon" },
+    { HWF_INTEL_ADX,       "intel-adx" },
+    { HWF_INTEL_VAES,      "intel-vaes" },
+    { HWF_INTEL_VPCLMUL,   "intel-vpclmul" },
+    { HWF_INTEL_AVX512,    "intel-avx512" },
+    { HWF_INTEL_SHAEXT,    "intel-shaext" }
   };
 
 /* A bit vector with the hardware features which shall not be used.
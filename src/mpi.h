@@ -295,6 +295,24 @@ void _gcry_mpi_ec_sub_points (mpi_point_t result,
 void _gcry_mpi_ec_mul_point (mpi_point_t result,
                              gcry_mpi_t scalar, mpi_point_t point,
                              mpi_ec_t ctx);
+void _gcry_mpi_ec_mul_point_dual (mpi_point_t result,
+                                  gcry_mpi_t k1, mpi_point_t p1,
+                                  gcry_mpi_t k2, mpi_point_t p2,
+                                  mpi_ec_t ctx);
+void _gcry_mpi_ec_mul_multi (mpi_point_t result, unsigned int npoints,
+                             gcry_mpi_t *scalars, mpi_point_t *points,
+                             mpi_ec_t ctx);
+
+/* Precomputed multiples of a fixed base point.  */
+struct mpi_ec_base_table_s;
+typedef struct mpi_ec_base_table_s *mpi_ec_base_table_t;
+
+mpi_ec_base_table_t _gcry_mpi_ec_base_table_new (mpi_point_t G, gcry_mpi_t n,
+                                                 mpi_ec_t ctx);
+void _gcry_mpi_ec_base_table_release (mpi_ec_base_table_t tbl);
+void _gcry_mpi_ec_mul_base (mpi_point_t result, gcry_mpi_t scalar,
+                            mpi_ec_base_table_t tbl, mpi_ec_t ctx);
+
 int  _gcry_mpi_ec_curve_point (gcry_mpi_point_t point, mpi_ec_t ctx);
 
 gcry_mpi_t _gcry_mpi_ec_ec2os (gcry_mpi_point_t point, mpi_ec_t ectx);
@@ -751,6 +751,16 @@ gcry_cipher_authenticate (gcry_cipher_hd_t hd, const void *abuf, size_t abuflen)
   return gpg_error (_gcry_cipher_authenticate (hd, abuf, abuflen));
 }
 
+gcry_error_t
+gcry_cipher_authenticate_buffers (gcry_cipher_hd_t hd,
+                                  const gcry_buffer_t *iov, int iovcnt)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+
+  return gpg_error (_gcry_cipher_authenticate_buffers (hd, iov, iovcnt));
+}
+
 gcry_error_t
 gcry_cipher_gettag (gcry_cipher_hd_t hd, void *outtag, size_t taglen)
 {
@@ -828,6 +838,31 @@ gcry_cipher_encrypt (gcry_cipher_hd_t h,
   return gpg_error (_gcry_cipher_encrypt (h, out, outsize, in, inlen));
 }
 
+gcry_error_t
+gcry_cipher_encrypt_batch (gcry_cipher_hd_t *hds,
+                           void **out, const size_t *outsize,
+                           const void **in, const size_t *inlen,
+                           size_t n, gcry_error_t *r_results)
+{
+  size_t i;
+
+  if (!fips_is_operational ())
+    {
+      /* Make sure that the plaintext will never make it to OUT. */
+      for (i = 0; i < n; i++)
+        {
+          if (out[i])
+            memset (out[i], 0x42, outsize[i]);
+          if (r_results)
+            r_results[i] = gpg_error (fips_not_operational ());
+        }
+      return gpg_error (fips_not_operational ());
+    }
+
+  return gpg_error (_gcry_cipher_encrypt_batch (hds, out, outsize, in, inlen,
+                                                n, r_results));
+}
+
 gcry_error_t
 gcry_cipher_decrypt (gcry_cipher_hd_t h,
                      void *out, size_t outsize,
@@ -839,6 +874,34 @@ gcry_cipher_decrypt (gcry_cipher_hd_t h,
   return gpg_error (_gcry_cipher_decrypt (h, out, outsize, in, inlen));
 }
 
+gcry_error_t
+gcry_cipher_encrypt_buffers (gcry_cipher_hd_t h,
+                             const gcry_buffer_t *out, int outcnt,
+                             const gcry_buffer_t *in, int incnt)
+{
+  if (!fips_is_operational ())
+    {
+      /* Make sure that the plaintext will never make it to OUT. */
+      for (; outcnt > 0; out++, outcnt--)
+        if (out->data)
+          memset ((char *)out->data + out->off, 0x42, out->len);
+      return gpg_error (fips_not_operational ());
+    }
+
+  return gpg_error (_gcry_cipher_encrypt_buffers (h, out, outcnt, in, incnt));
+}
+
+gcry_error_t
+gcry_cipher_decrypt_buffers (gcry_cipher_hd_t h,
+                             const gcry_buffer_t *out, int outcnt,
+                             const gcry_buffer_t *in, int incnt)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+
+  return gpg_error (_gcry_cipher_decrypt_buffers (h, out, outcnt, in, incnt));
+}
+
 size_t
 gcry_cipher_get_algo_keylen (int algo)
 {
@@ -936,6 +999,17 @@ gcry_mac_write (gcry_mac_hd_t hd, const void *buf, size_t buflen)
   return gpg_error (_gcry_mac_write (hd, buf, buflen));
 }
 
+gcry_error_t
+gcry_mac_write_batch (gcry_mac_hd_t *hds, const void **bufs,
+                      const size_t *buflens, size_t n,
+                      gcry_error_t *r_results)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+
+  return gpg_error (_gcry_mac_write_batch (hds, bufs, buflens, n, r_results));
+}
+
 gcry_error_t
 gcry_mac_read (gcry_mac_hd_t hd, void *outbuf, size_t *outlen)
 {
@@ -1004,6 +1078,16 @@ gcry_pk_verify (gcry_sexp_t sigval, gcry_sexp_t data, gcry_sexp_t pkey)
   return gpg_error (_gcry_pk_verify (sigval, data, pkey));
 }
 
+gcry_error_t
+gcry_pk_verify_batch (gcry_sexp_t *sigvals, gcry_sexp_t *data,
+                      gcry_sexp_t *pkeys, size_t n, gcry_error_t *r_results)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+  return gpg_error (_gcry_pk_verify_batch (sigvals, data, pkeys,
+                                           n, r_results));
+}
+
 gcry_error_t
 gcry_pk_testkey (gcry_sexp_t key)
 {
@@ -1180,6 +1264,13 @@ gcry_md_extract (gcry_md_hd_t hd, int algo, void *buffer, size_t length)
   return _gcry_md_extract(hd, algo, buffer, length);
 }
 
+gcry_error_t
+gcry_md_extract_batch (gcry_md_hd_t *hds, int algo, void **outbufs,
+                       size_t length, size_t n)
+{
+  return gpg_error (_gcry_md_extract_batch (hds, algo, outbufs, length, n));
+}
+
 void
 gcry_md_hash_buffer (int algo, void *digest,
                      const void *buffer, size_t length)
@@ -1204,6 +1295,17 @@ gcry_md_hash_buffers (int algo, unsigned int flags, void *digest,
   return gpg_error (_gcry_md_hash_buffers (algo, flags, digest, iov, iovcnt));
 }
 
+gcry_error_t
+gcry_md_hash_buffer_batch (int algo, void **digests, const void **buffers,
+                           const size_t *lengths, size_t n)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+
+  return gpg_error (_gcry_md_hash_buffer_batch (algo, digests, buffers,
+                                                lengths, n));
+}
+
 int
 gcry_md_get_algo (gcry_md_hd_t hd)
 {
@@ -1275,6 +1377,14 @@ gcry_md_setkey (gcry_md_hd_t hd, const void *key, size_t keylen)
   return gpg_error (_gcry_md_setkey (hd, key, keylen));
 }
 
+gcry_error_t
+gcry_md_setkey_from (gcry_md_hd_t hd, gcry_md_hd_t keyhd)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+  return gpg_error (_gcry_md_setkey_from (hd, keyhd));
+}
+
 void
 gcry_md_debug (gcry_md_hd_t hd, const char *suffix)
 {
@@ -104,6 +104,7 @@ MARK_VISIBLEX (gcry_md_get_algo)
 MARK_VISIBLEX (gcry_md_get_algo_dlen)
 MARK_VISIBLEX (gcry_md_hash_buffer)
 MARK_VISIBLEX (gcry_md_hash_buffers)
+MARK_VISIBLEX (gcry_md_hash_buffer_batch)
 MARK_VISIBLEX (gcry_md_info)
 MARK_VISIBLEX (gcry_md_is_enabled)
 MARK_VISIBLEX (gcry_md_is_secure)
@@ -111,8 +112,10 @@ MARK_VISIBLEX (gcry_md_map_name)
 MARK_VISIBLEX (gcry_md_open)
 MARK_VISIBLEX (gcry_md_read)
 MARK_VISIBLEX (gcry_md_extract)
+MARK_VISIBLEX (gcry_md_extract_batch)
 MARK_VISIBLEX (gcry_md_reset)
 MARK_VISIBLEX (gcry_md_setkey)
+MARK_VISIBLEX (gcry_md_setkey_from)
 MARK_VISIBLEX (gcry_md_write)
 MARK_VISIBLEX (gcry_md_debug)
 
@@ -123,11 +126,15 @@ MARK_VISIBLEX (gcry_cipher_setkey)
 MARK_VISIBLEX (gcry_cipher_setiv)
 MARK_VISIBLEX (gcry_cipher_setctr)
 MARK_VISIBLEX (gcry_cipher_authenticate)
+MARK_VISIBLEX (gcry_cipher_authenticate_buffers)
 MARK_VISIBLEX (gcry_cipher_checktag)
 MARK_VISIBLEX (gcry_cipher_gettag)
 MARK_VISIBLEX (gcry_cipher_ctl)
 MARK_VISIBLEX (gcry_cipher_decrypt)
+MARK_VISIBLEX (gcry_cipher_decrypt_buffers)
 MARK_VISIBLEX (gcry_cipher_encrypt)
+MARK_VISIBLEX (gcry_cipher_encrypt_batch)
+MARK_VISIBLEX (gcry_cipher_encrypt_buffers)
 MARK_VISIBLEX (gcry_cipher_get_algo_blklen)
 MARK_VISIBLEX (gcry_cipher_get_algo_keylen)
 MARK_VISIBLEX (gcry_cipher_info)
@@ -146,6 +153,7 @@ MARK_VISIBLEX (gcry_mac_close)
 MARK_VISIBLEX (gcry_mac_setkey)
 MARK_VISIBLEX (gcry_mac_setiv)
 MARK_VISIBLEX (gcry_mac_write)
+MARK_VISIBLEX (gcry_mac_write_batch)
 MARK_VISIBLEX (gcry_mac_read)
 MARK_VISIBLEX (gcry_mac_verify)
 MARK_VISIBLEX (gcry_mac_ctl)
@@ -164,6 +172,7 @@ MARK_VISIBLEX (gcry_pk_map_name)
 MARK_VISIBLEX (gcry_pk_sign)
 MARK_VISIBLEX (gcry_pk_testkey)
 MARK_VISIBLEX (gcry_pk_verify)
+MARK_VISIBLEX (gcry_pk_verify_batch)
 MARK_VISIBLEX (gcry_pubkey_get_sexp)
 
 MARK_VISIBLEX (gcry_kdf_derive)
@@ -332,11 +341,15 @@ MARK_VISIBLEX (_gcry_mpi_get_const)
 #define gcry_cipher_algo_info       _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_cipher_algo_name       _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_cipher_authenticate    _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_cipher_authenticate_buffers _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_cipher_checktag        _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_cipher_gettag          _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_cipher_ctl             _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_cipher_decrypt         _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_cipher_decrypt_buffers _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_cipher_encrypt         _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_cipher_encrypt_batch   _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_cipher_encrypt_buffers _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_cipher_get_algo_blklen _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_cipher_get_algo_keylen _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_cipher_info            _gcry_USE_THE_UNDERSCORED_FUNCTION
@@ -357,6 +370,7 @@ MARK_VISIBLEX (_gcry_mpi_get_const)
 #define gcry_pk_sign                _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_pk_testkey             _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_pk_verify              _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_verify_batch        _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_pubkey_get_sexp        _gcry_USE_THE_UNDERSCORED_FUNCTION
 
 #define gcry_md_algo_info           _gcry_USE_THE_UNDERSCORED_FUNCTION
@@ -370,6 +384,7 @@ MARK_VISIBLEX (_gcry_mpi_get_const)
 #define gcry_md_get_algo_dlen       _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_hash_buffer         _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_hash_buffers        _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_md_hash_buffer_batch   _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_info                _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_is_enabled          _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_is_secure           _gcry_USE_THE_UNDERSCORED_FUNCTION
@@ -377,8 +392,10 @@ MARK_VISIBLEX (_gcry_mpi_get_const)
 #define gcry_md_open                _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_read                _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_extract             _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_md_extract_batch       _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_reset               _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_setkey              _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_md_setkey_from         _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_write               _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_debug               _gcry_USE_THE_UNDERSCORED_FUNCTION
 
@@ -393,6 +410,7 @@ MARK_VISIBLEX (_gcry_mpi_get_const)
 #define gcry_mac_setkey             _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_mac_setiv              _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_mac_write              _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_mac_write_batch        _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_mac_read               _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_mac_verify             _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_mac_ctl                _gcry_USE_THE_UNDERSCORED_FUNCTION
@@ -1676,6 +1676,140 @@ _check_gcm_cipher (unsigned int step)
 }
 
 
+/* Check GCM with more than 32 blocks of AAD and plaintext so that the
+   bulk GHASH code paths are used.  The expected values were computed
+   with an independent implementation; the ciphertext is compared by
+   its SHA-256 digest.  */
+static void
+check_gcm_cipher_large (void)
+{
+  static const struct
+  {
+    int algo;
+    int keylen;
+    const char *ctdigest;
+    const char *tag;
+  } tv[] =
+    {
+      { GCRY_CIPHER_AES, 16,
+        "\x0c\x7e\xab\x3f\xc7\x11\x57\x1b\x73\x84\x1f\xb0\x4f\xf9\x4f\xd0"
+        "\x3c\xb9\x65\x9e\xb7\x36\xf9\x96\x9e\xdd\x7c\xcf\xcd\xcd\xfc\x0e",
+        "\xc9\xed\xe7\xdb\x0c\xf9\x44\xd1\xea\x35\xdc\xa9\x53\xaf\xe9\x5e" },
+      { GCRY_CIPHER_AES256, 32,
+        "\x85\x81\x7f\xee\x3a\x80\xd9\x0d\xc2\xf7\x88\xd7\x08\x4e\x5b\xe8"
+        "\x3c\x55\xd5\xa7\x53\x60\x0e\xe1\x31\x7d\x32\x96\x68\x6a\xd4\x37",
+        "\x13\x9d\x34\xa4\x66\xd2\x98\x8f\xd9\x86\x88\x87\x54\x52\x6a\x87" }
+    };
+  static const size_t steps[] = { 649, 16 * 33, 16, 17, 1 };
+  const size_t aadlen = 597;    /* 37 blocks + 5 bytes.  */
+  const size_t inlen = 649;     /* 40 blocks + 9 bytes.  */
+  unsigned char key[32], iv[12], tag[16], digest[32];
+  unsigned char *aad, *plain, *out;
+  gcry_cipher_hd_t hd;
+  gcry_error_t err;
+  size_t pos, len;
+  int i, j, k;
+
+  if (verbose)
+    fprintf (stderr, "  Starting large GCM checks.\n");
+
+  aad = gcry_xmalloc (aadlen);
+  plain = gcry_xmalloc (inlen);
+  out = gcry_xmalloc (inlen);
+  for (pos = 0; pos < aadlen; pos++)
+    aad[pos] = pos * 3 + 1;
+  for (pos = 0; pos < inlen; pos++)
+    plain[pos] = pos * 7 + (pos >> 8);
+  for (i = 0; i < sizeof key; i++)
+    key[i] = 0x10 + i;
+  for (i = 0; i < sizeof iv; i++)
+    iv[i] = 0x40 + i;
+
+  for (i = 0; i < DIM (tv); i++)
+    {
+      if (gcry_cipher_test_algo (tv[i].algo) && in_fips_mode)
+        continue;
+
+      err = gcry_cipher_open (&hd, tv[i].algo, GCRY_CIPHER_MODE_GCM, 0);
+      if (!err)
+        err = gcry_cipher_setkey (hd, key, tv[i].keylen);
+      if (err)
+        {
+          fail ("aes-gcm-large, gcry_cipher_open failed: %s\n",
+                gpg_strerror (err));
+          goto leave;
+        }
+
+      for (j = 0; j < DIM (steps); j++)
+        {
+          /* K = 0 encrypts, K = 1 decrypts in place.  */
+          for (k = 0; k < 2; k++)
+            {
+              err = gcry_cipher_setiv (hd, iv, sizeof iv);
+              for (pos = 0; !err && pos < aadlen; pos += len)
+                {
+                  len = aadlen - pos < steps[j]? aadlen - pos : steps[j];
+                  err = gcry_cipher_authenticate (hd, aad + pos, len);
+                }
+              if (!k)
+                memcpy (out, plain, inlen);
+              for (pos = 0; !err && pos < inlen; pos += len)
+                {
+                  len = inlen - pos < steps[j]? inlen - pos : steps[j];
+                  if (!k)
+                    err = gcry_cipher_encrypt (hd, out + pos, len, NULL, 0);
+                  else
+                    err = gcry_cipher_decrypt (hd, out + pos, len, NULL, 0);
+                }
+              if (err)
+                {
+                  fail ("aes-gcm-large, algo %d, step %d, %s failed: %s\n",
+                        tv[i].algo, (int)steps[j], k? "decrypt":"encrypt",
+                        gpg_strerror (err));
+                  break;
+                }
+
+              if (!k)
+                {
+                  gcry_md_hash_buffer (GCRY_MD_SHA256, digest, out, inlen);
+                  if (memcmp (digest, tv[i].ctdigest, sizeof digest))
+                    fail ("aes-gcm-large, algo %d, step %d, encrypt mismatch\n",
+                          tv[i].algo, (int)steps[j]);
+                  err = gcry_cipher_gettag (hd, tag, sizeof tag);
+                  if (err)
+                    fail ("aes-gcm-large, algo %d, step %d, gettag failed:"
+                          " %s\n", tv[i].algo, (int)steps[j],
+                          gpg_strerror (err));
+                  else if (memcmp (tag, tv[i].tag, sizeof tag))
+                    fail ("aes-gcm-large, algo %d, step %d, tag mismatch\n",
+                          tv[i].algo, (int)steps[j]);
+                }
+              else
+                {
+                  if (memcmp (out, plain, inlen))
+                    fail ("aes-gcm-large, algo %d, step %d, decrypt mismatch\n",
+                          tv[i].algo, (int)steps[j]);
+                  err = gcry_cipher_checktag (hd, tv[i].tag, 16);
+                  if (err)
+                    fail ("aes-gcm-large, algo %d, step %d, checktag failed:"
+                          " %s\n", tv[i].algo, (int)steps[j],
+                          gpg_strerror (err));
+                }
+              gcry_cipher_reset (hd);
+            }
+        }
+      gcry_cipher_close (hd);
+    }
+
+  if (verbose)
+    fprintf (stderr, "  Completed large GCM checks.\n");
+ leave:
+  gcry_free (aad);
+  gcry_free (plain);
+  gcry_free (out);
+}
+
+
 static void
 check_gcm_cipher (void)
 {
@@ -1687,6 +1821,8 @@ check_gcm_cipher (void)
   _check_gcm_cipher(7);
   /* Split input to 16 byte buffers. */
   _check_gcm_cipher(16);
+  /* More than 32 blocks.  */
+  check_gcm_cipher_large ();
 }
 
 
@@ -2022,6 +2158,171 @@ _check_poly1305_cipher (unsigned int step)
 }
 
 
+/* Check ChaCha20-Poly1305 with input longer than 4 KiB, passed in one
+   call and split over several calls, against ChaCha20 in stream mode
+   and the Poly1305 MAC as described by RFC-7539.  */
+static void
+check_poly1305_cipher_large (void)
+{
+  static const size_t splits[][4] =
+    {
+      { 13295 },
+      { 4096 },
+      { 4097 },
+      { 1, 63, 4096, 8191 },
+      { 1000, 3100, 65, 16 * 257 },
+      { 5, 8191, 7, 4099 }
+    };
+  static const unsigned char zeros[64];
+  const size_t datalen = 13295;
+  const size_t aadlen = 37;
+  unsigned char key[32], iv[12], aad[37], tag[16], reftag[16];
+  unsigned char polykey[64], lenbuf[16];
+  unsigned char *plain, *ref, *out;
+  gcry_cipher_hd_t hd;
+  gcry_mac_hd_t mac;
+  gpg_error_t err;
+  size_t pos, len, taglen;
+  int i, j, k;
+
+  if (verbose)
+    fprintf (stderr, "  Starting large POLY1305 checks.\n");
+
+  plain = gcry_xmalloc (datalen);
+  ref = gcry_xmalloc (datalen);
+  out = gcry_xmalloc (datalen);
+  for (pos = 0; pos < datalen; pos++)
+    plain[pos] = pos * 7 + (pos >> 8);
+  for (i = 0; i < sizeof key; i++)
+    key[i] = 0x80 + i;
+  for (i = 0; i < sizeof iv; i++)
+    iv[i] = 0x40 + i;
+  for (i = 0; i < sizeof aad; i++)
+    aad[i] = 0x20 + i;
+
+  /* The reference: the first block of the key stream is the Poly1305
+     key, the following blocks encrypt the data.  */
+  err = gcry_cipher_open (&hd, GCRY_CIPHER_CHACHA20,
+                          GCRY_CIPHER_MODE_STREAM, 0);
+  if (!err)
+    err = gcry_cipher_setkey (hd, key, sizeof key);
+  if (!err)
+    err = gcry_cipher_setiv (hd, iv, sizeof iv);
+  if (!err)
+    err = gcry_cipher_encrypt (hd, polykey, sizeof polykey,
+                               zeros, sizeof zeros);
+  if (!err)
+    err = gcry_cipher_encrypt (hd, ref, datalen, plain, datalen);
+  gcry_cipher_close (hd);
+  if (err)
+    {
+      fail ("poly1305-large, reference encryption failed: %s\n",
+            gpg_strerror (err));
+      goto leave;
+    }
+
+  for (i = 0; i < 8; i++)
+    {
+      lenbuf[i] = (aadlen >> (8 * i)) & 0xff;
+      lenbuf[i + 8] = (datalen >> (8 * i)) & 0xff;
+    }
+  err = gcry_mac_open (&mac, GCRY_MAC_POLY1305, 0, NULL);
+  if (!err)
+    err = gcry_mac_setkey (mac, polykey, 32);
+  if (!err)
+    err = gcry_mac_write (mac, aad, aadlen);
+  if (!err)
+    err = gcry_mac_write (mac, zeros, (16 - aadlen % 16) % 16);
+  if (!err)
+    err = gcry_mac_write (mac, ref, datalen);
+  if (!err)
+    err = gcry_mac_write (mac, zeros, (16 - datalen % 16) % 16);
+  if (!err)
+    err = gcry_mac_write (mac, lenbuf, sizeof lenbuf);
+  taglen = sizeof reftag;
+  if (!err)
+    err = gcry_mac_read (mac, reftag, &taglen);
+  gcry_mac_close (mac);
+  if (err)
+    {
+      fail ("poly1305-large, reference MAC failed: %s\n", gpg_strerror (err));
+      goto leave;
+    }
+
+  for (i = 0; i < DIM (splits); i++)
+    {
+      err = gcry_cipher_open (&hd, GCRY_CIPHER_CHACHA20,
+                              GCRY_CIPHER_MODE_POLY1305, 0);
+      if (!err)
+        err = gcry_cipher_setkey (hd, key, sizeof key);
+      if (err)
+        {
+          fail ("poly1305-large, gcry_cipher_open failed: %s\n",
+                gpg_strerror (err));
+          goto leave;
+        }
+
+      for (k = 0; k < 2; k++)
+        {
+          err = gcry_cipher_setiv (hd, iv, sizeof iv);
+          if (!err)
+            err = gcry_cipher_authenticate (hd, aad, aadlen);
+          if (!k)
+            memcpy (out, plain, datalen);
+          for (pos = 0, j = 0; !err && pos < datalen; pos += len, j++)
+            {
+              if (j == DIM (splits[i]) || !splits[i][j])
+                j = 0;
+              len = splits[i][j];
+              if (len > datalen - pos)
+                len = datalen - pos;
+              /* Encrypt and decrypt in place.  */
+              if (!k)
+                err = gcry_cipher_encrypt (hd, out + pos, len, NULL, 0);
+              else
+                err = gcry_cipher_decrypt (hd, out + pos, len, NULL, 0);
+            }
+          if (err)
+            {
+              fail ("poly1305-large, split %d, %s failed: %s\n", i,
+                    k? "decrypt":"encrypt", gpg_strerror (err));
+              break;
+            }
+
+          if (!k)
+            {
+              if (memcmp (out, ref, datalen))
+                fail ("poly1305-large, split %d, encrypt mismatch\n", i);
+              err = gcry_cipher_gettag (hd, tag, sizeof tag);
+              if (err)
+                fail ("poly1305-large, split %d, gcry_cipher_gettag failed:"
+                      " %s\n", i, gpg_strerror (err));
+              else if (memcmp (tag, reftag, sizeof tag))
+                fail ("poly1305-large, split %d, tag mismatch\n", i);
+            }
+          else
+            {
+              if (memcmp (out, plain, datalen))
+                fail ("poly1305-large, split %d, decrypt mismatch\n", i);
+              err = gcry_cipher_checktag (hd, reftag, sizeof reftag);
+              if (err)
+                fail ("poly1305-large, split %d, gcry_cipher_checktag failed:"
+                      " %s\n", i, gpg_strerror (err));
+            }
+          gcry_cipher_reset (hd);
+        }
+      gcry_cipher_close (hd);
+    }
+
+  if (verbose)
+    fprintf (stderr, "  Completed large POLY1305 checks.\n");
+ leave:
+  gcry_free (plain);
+  gcry_free (ref);
+  gcry_free (out);
+}
+
+
 static void
 check_poly1305_cipher (void)
 {
@@ -2033,6 +2334,8 @@ check_poly1305_cipher (void)
   _check_poly1305_cipher(7);
   /* Split input to 16 byte buffers. */
   _check_poly1305_cipher(16);
+  /* Input longer than 4 KiB.  */
+  check_poly1305_cipher_large ();
 }
 
 
@@ -3381,58 +3684,880 @@ out_free:
 
 
 static void
-check_ocb_cipher_largebuf (int algo, int keylen, const char *tagexpect)
+check_ocb_cipher_largebuf (int algo, int keylen, const char *tagexpect)
+{
+  unsigned int split;
+
+  for (split = 0; split < 32 * 16; split = split * 2 + 16)
+    {
+      check_ocb_cipher_largebuf_split(algo, keylen, tagexpect, split);
+    }
+}
+
+
+static void
+check_ocb_cipher (void)
+{
+  /* Check OCB cipher with separate destination and source buffers for
+   * encryption/decryption. */
+  do_check_ocb_cipher(0);
+
+  /* Check OCB cipher with inplace encrypt/decrypt. */
+  do_check_ocb_cipher(1);
+
+  /* Check large buffer encryption/decryption. */
+  check_ocb_cipher_largebuf(GCRY_CIPHER_AES, 16,
+			    "\xf5\xf3\x12\x7d\x58\x2d\x96\xe8"
+			    "\x33\xfd\x7a\x4f\x42\x60\x5d\x20");
+  check_ocb_cipher_largebuf(GCRY_CIPHER_AES256, 32,
+			    "\xfa\x26\xa5\xbf\xf6\x7d\x3a\x8d"
+			    "\xfe\x96\x67\xc9\xc8\x41\x03\x51");
+  check_ocb_cipher_largebuf(GCRY_CIPHER_CAMELLIA128, 16,
+			    "\x28\x23\x38\x45\x2b\xfd\x42\x45"
+			    "\x43\x64\x7e\x67\x7f\xf4\x8b\xcd");
+  check_ocb_cipher_largebuf(GCRY_CIPHER_CAMELLIA192, 24,
+			    "\xee\xca\xe5\x39\x27\x2d\x33\xe7"
+			    "\x79\x74\xb0\x1d\x37\x12\xd5\x6c");
+  check_ocb_cipher_largebuf(GCRY_CIPHER_CAMELLIA256, 32,
+			    "\x39\x39\xd0\x2d\x05\x68\x74\xee"
+			    "\x18\x6b\xea\x3d\x0b\xd3\x58\xae");
+  check_ocb_cipher_largebuf(GCRY_CIPHER_TWOFISH, 16,
+			    "\x63\xe3\x0e\xb9\x11\x6f\x14\xba"
+			    "\x79\xe4\xa7\x9e\xad\x3c\x02\x0c");
+  check_ocb_cipher_largebuf(GCRY_CIPHER_TWOFISH, 32,
+			    "\xf6\xd4\xfe\x4e\x50\x85\x13\x59"
+			    "\x69\x0e\x4c\x67\x3e\xdd\x47\x90");
+  check_ocb_cipher_largebuf(GCRY_CIPHER_SERPENT128, 16,
+			    "\x3c\xfb\x66\x14\x3c\xc8\x6c\x67"
+			    "\x26\xb8\x23\xeb\xaf\x43\x98\x69");
+  check_ocb_cipher_largebuf(GCRY_CIPHER_SERPENT192, 24,
+			    "\x5e\x62\x27\xc5\x32\xc3\x1d\xe6"
+			    "\x2e\x65\xe7\xd6\xfb\x05\xd7\xb2");
+  check_ocb_cipher_largebuf(GCRY_CIPHER_SERPENT256, 32,
+			    "\xe7\x8b\xe6\xd4\x2f\x7a\x36\x4c"
+			    "\xba\xee\x20\xe2\x68\xf4\xcb\xcc");
+}
+
+
+static void
+do_check_xts_cipher (int inplace)
+{
+  /* Note that we use hex strings and not binary strings in TV.  That
+     makes it easier to maintain the test vectors.  */
+  static const struct
+  {
+    int algo;
+    const char *key;    /* Data key followed by tweak key.  */
+    const char *iv;     /* Little endian data unit sequence number.  */
+    const char *plain;
+    const char *ciph;
+  } tv[] = {
+    /* The IEEE Std 1619-2007 test vectors.  */
+    /* Vector 1 */
+    { GCRY_CIPHER_AES,
+      "0000000000000000000000000000000000000000000000000000000000000000",
+      "00000000000000000000000000000000",
+      "0000000000000000000000000000000000000000000000000000000000000000",
+      "917CF69EBD68B2EC9B9FE9A3EADDA692CD43D2F59598ED858C02C2652FBF922E"
+    },
+    /* Vector 2 */
+    { GCRY_CIPHER_AES,
+      "1111111111111111111111111111111122222222222222222222222222222222",
+      "33333333330000000000000000000000",
+      "4444444444444444444444444444444444444444444444444444444444444444",
+      "C454185E6A16936E39334038ACEF838BFB186FFF7480ADC4289382ECD6D394F0"
+    },
+    /* Vector 3 */
+    { GCRY_CIPHER_AES,
+      "FFFEFDFCFBFAF9F8F7F6F5F4F3F2F1F022222222222222222222222222222222",
+      "33333333330000000000000000000000",
+      "4444444444444444444444444444444444444444444444444444444444444444",
+      "AF85336B597AFC1A900B2EB21EC949D292DF4C047E0B21532186A5971A227A89"
+    },
+    /* Vector 4 */
+    { GCRY_CIPHER_AES,
+      "2718281828459045235360287471352631415926535897932384626433832795",
+      "00000000000000000000000000000000",
+      "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+      "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+      "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+      "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+      "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+      "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+      "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+      "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF"
+      "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+      "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+      "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+      "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+      "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+      "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+      "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+      "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF",
+      "27A7479BEFA1D476489F308CD4CFA6E2A96E4BBE3208FF25287DD3819616E89C"
+      "C78CF7F5E543445F8333D8FA7F56000005279FA5D8B5E4AD40E736DDB4D35412"
+      "328063FD2AAB53E5EA1E0A9F332500A5DF9487D07A5C92CC512C8866C7E860CE"
+      "93FDF166A24912B422976146AE20CE846BB7DC9BA94A767AAEF20C0D61AD0265"
+      "5EA92DC4C4E41A8952C651D33174BE51A10C421110E6D81588EDE82103A252D8"
+      "A750E8768DEFFFED9122810AAEB99F9172AF82B604DC4B8E51BCB08235A6F434"
+      "1332E4CA60482A4BA1A03B3E65008FC5DA76B70BF1690DB4EAE29C5F1BADD03C"
+      "5CCF2A55D705DDCD86D449511CEB7EC30BF12B1FA35B913F9F747A8AFD1B130E"
+      "94BFF94EFFD01A91735CA1726ACD0B197C4E5B03393697E126826FB6BBDE8ECC"
+      "1E08298516E2C9ED03FF3C1B7860F6DE76D4CECD94C8119855EF5297CA67E9F3"
+      "E7FF72B1E99785CA0A7E7720C5B36DC6D72CAC9574C8CBBC2F801E23E56FD344"
+      "B07F22154BEBA0F08CE8891E643ED995C94D9A69C9F1B5F499027A78572AEEBD"
+      "74D20CC39881C213EE770B1010E4BEA718846977AE119F7A023AB58CCA0AD752"
+      "AFE656BB3C17256A9F6E9BF19FDD5A38FC82BBE872C5539EDB609EF4F79C203E"
+      "BB140F2E583CB2AD15B4AA5B655016A8449277DBD477EF2C8D6C017DB738B18D"
+      "EB4A427D1923CE3FF262735779A418F20A282DF920147BEABE421EE5319D0568"
+    },
+    /* Vector 10 */
+    { GCRY_CIPHER_AES256,
+      "2718281828459045235360287471352662497757247093699959574966967627"
+      "3141592653589793238462643383279502884197169399375105820974944592",
+      "FF000000000000000000000000000000",
+      "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+      "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+      "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+      "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+      "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+      "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+      "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+      "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF"
+      "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+      "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+      "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+      "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+      "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+      "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+      "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+      "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF",
+      "1C3B3A102F770386E4836C99E370CF9BEA00803F5E482357A4AE12D414A3E63B"
+      "5D31E276F8FE4A8D66B317F9AC683F44680A86AC35ADFC3345BEFECB4BB188FD"
+      "5776926C49A3095EB108FD1098BAEC70AAA66999A72A82F27D848B21D4A741B0"
+      "C5CD4D5FFF9DAC89AEBA122961D03A757123E9870F8ACF1000020887891429CA"
+      "2A3E7A7D7DF7B10355165C8B9A6D0A7DE8B062C4500DC4CD120C0F7418DAE3D0"
+      "B5781C34803FA75421C790DFE1DE1834F280D7667B327F6C8CD7557E12AC3A0F"
+      "93EC05C52E0493EF31A12D3D9260F79A289D6A379BC70C50841473D1A8CC81EC"
+      "583E9645E07B8D9670655BA5BBCFECC6DC3966380AD8FECB17B6BA02469A020A"
+      "84E18E8F84252070C13E9F1F289BE54FBC481457778F616015E1327A02B140F1"
+      "505EB309326D68378F8374595C849D84F4C333EC4423885143CB47BD71C5EDAE"
+      "9BE69A2FFECEB1BEC9DE244FBE15992B11B77C040F12BD8F6A975A44A0F90C29"
+      "A9ABC3D4D893927284C58754CCE294529F8614DCD2ABA991925FEDC4AE74FFAC"
+      "6E333B93EB4AFF0479DA9A410E4450E0DD7AE4C6E2910900575DA401FC07059F"
+      "645E8B7E9BFDEF33943054FF84011493C27B3429EAEDB4ED5376441A77ED4385"
+      "1AD77F16F541DFD269D50D6A5F14FB0AAB1CBB4C1550BE97F7AB4066193C4CAA"
+      "773DAD38014BD2092FA755C824BB5E54C4F36FFDA9FCEA70B9C6E693E148C151"
+    },
+    /* Vector 15 */
+    { GCRY_CIPHER_AES,
+      "FFFEFDFCFBFAF9F8F7F6F5F4F3F2F1F0BFBEBDBCBBBAB9B8B7B6B5B4B3B2B1B0",
+      "9A785634120000000000000000000000",
+      "000102030405060708090A0B0C0D0E0F10",
+      "6C1625DB4671522D3D7599601DE7CA09ED"
+    },
+    /* Vector 16 */
+    { GCRY_CIPHER_AES,
+      "FFFEFDFCFBFAF9F8F7F6F5F4F3F2F1F0BFBEBDBCBBBAB9B8B7B6B5B4B3B2B1B0",
+      "9A785634120000000000000000000000",
+      "000102030405060708090A0B0C0D0E0F1011",
+      "D069444B7A7E0CAB09E24447D24DEB1FEDBF"
+    },
+    /* Vector 18 */
+    { GCRY_CIPHER_AES,
+      "FFFEFDFCFBFAF9F8F7F6F5F4F3F2F1F0BFBEBDBCBBBAB9B8B7B6B5B4B3B2B1B0",
+      "9A785634120000000000000000000000",
+      "000102030405060708090A0B0C0D0E0F10111213",
+      "9D84C813F719AA2C7BE3F66171C7C5C2EDBF9DAC"
+    },
+  };
+  gpg_error_t err = 0;
+  gcry_cipher_hd_t hde, hdd;
+  unsigned char out[512];
+  int tidx;
+
+  if (verbose)
+    fprintf (stderr, "  Starting XTS checks.\n");
+
+  for (tidx = 0; tidx < DIM (tv); tidx++)
+    {
+      char *key, *iv, *ciph, *plain;
+      size_t keylen, ivlen, ciphlen, plainlen;
+
+      if (verbose)
+        fprintf (stderr, "    checking XTS mode for %s [%i] (tv %d)\n",
+                 gcry_cipher_algo_name (tv[tidx].algo), tv[tidx].algo, tidx);
+
+      /* Convert to hex strings to binary.  */
+      key   = hex2buffer (tv[tidx].key, &keylen);
+      iv    = hex2buffer (tv[tidx].iv, &ivlen);
+      plain = hex2buffer (tv[tidx].plain, &plainlen);
+      ciph  = hex2buffer (tv[tidx].ciph, &ciphlen);
+
+      /* Check that our test vectors are sane.  */
+      assert (plainlen <= sizeof out);
+      assert (plainlen == ciphlen);
+
+      err = gcry_cipher_open (&hde, tv[tidx].algo, GCRY_CIPHER_MODE_XTS, 0);
+      if (!err)
+        err = gcry_cipher_open (&hdd, tv[tidx].algo, GCRY_CIPHER_MODE_XTS, 0);
+      if (err)
+        {
+          fail ("cipher-xts, gcry_cipher_open failed (tv %d): %s\n",
+                tidx, gpg_strerror (err));
+          return;
+        }
+
+      err = gcry_cipher_setkey (hde, key, keylen);
+      if (!err)
+        err = gcry_cipher_setkey (hdd, key, keylen);
+      if (in_fips_mode && gpg_err_code (err) == GPG_ERR_WEAK_KEY
+          && !memcmp (key, key + keylen / 2, keylen / 2))
+        {
+          /* Equal data and tweak keys are rejected in FIPS mode.  */
+          gcry_cipher_close (hde);
+          gcry_cipher_close (hdd);
+          goto next;
+        }
+      if (err)
+        {
+          fail ("cipher-xts, gcry_cipher_setkey failed (tv %d): %s\n",
+                tidx, gpg_strerror (err));
+          gcry_cipher_close (hde);
+          gcry_cipher_close (hdd);
+          return;
+        }
+
+      err = gcry_cipher_setiv (hde, iv, ivlen);
+      if (!err)
+        err = gcry_cipher_setiv (hdd, iv, ivlen);
+      if (err)
+        {
+          fail ("cipher-xts, gcry_cipher_setiv failed (tv %d): %s\n",
+                tidx, gpg_strerror (err));
+          gcry_cipher_close (hde);
+          gcry_cipher_close (hdd);
+          return;
+        }
+
+      if (inplace)
+        {
+          memcpy (out, plain, plainlen);
+          err = gcry_cipher_encrypt (hde, out, plainlen, NULL, 0);
+        }
+      else
+        err = gcry_cipher_encrypt (hde, out, plainlen, plain, plainlen);
+      if (err)
+        {
+          fail ("cipher-xts, gcry_cipher_encrypt failed (tv %d): %s\n",
+                tidx, gpg_strerror (err));
+          gcry_cipher_close (hde);
+          gcry_cipher_close (hdd);
+          return;
+        }
+      if (memcmp (ciph, out, ciphlen))
+        {
+          mismatch (ciph, ciphlen, out, ciphlen);
+          fail ("cipher-xts, encrypt data mismatch (tv %d)\n", tidx);
+        }
+
+      if (inplace)
+        err = gcry_cipher_decrypt (hdd, out, ciphlen, NULL, 0);
+      else
+        err = gcry_cipher_decrypt (hdd, out, ciphlen, ciph, ciphlen);
+      if (err)
+        {
+          fail ("cipher-xts, gcry_cipher_decrypt failed (tv %d): %s\n",
+                tidx, gpg_strerror (err));
+          gcry_cipher_close (hde);
+          gcry_cipher_close (hdd);
+          return;
+        }
+      if (memcmp (plain, out, plainlen))
+        {
+          mismatch (plain, plainlen, out, plainlen);
+          fail ("cipher-xts, decrypt data mismatch (tv %d)\n", tidx);
+        }
+
+      gcry_cipher_close (hde);
+      gcry_cipher_close (hdd);
+
+    next:
+      xfree (key);
+      xfree (iv);
+      xfree (plain);
+      xfree (ciph);
+    }
+
+  if (verbose)
+    fprintf (stderr, "  Completed XTS checks.\n");
+}
+
+
+/* Check XTS mode of ALGO against a reference implementation built on
+   top of ECB mode.  This covers the bulk code paths, ciphertext
+   stealing and the automatic increment of the data unit sequence
+   number for lengths up to several kilobytes.  */
+static void
+check_xts_cipher_ecb_ref (int algo)
+{
+  static const size_t lengths[] = { 16, 17, 31, 32, 48, 63, 64, 127, 128,
+                                    129, 143, 255, 256, 515, 1024, 1039,
+                                    2048, 4096 };
+  const size_t maxlen = 4096;
+  gcry_cipher_hd_t hd, hd_data, hd_tweak;
+  unsigned char key[64];
+  unsigned char seqno[16];
+  unsigned char tweak[16];
+  unsigned char *plain, *ciph, *ref, *out;
+  unsigned char *p;
+  size_t keylen, len, nblocks, rest, i, j, k;
+  gpg_error_t err;
+  unsigned int carry;
+
+  keylen = gcry_cipher_get_algo_keylen (algo);
+  assert (2 * keylen <= sizeof key);
+
+  for (i = 0; i < 2 * keylen; i++)
+    key[i] = 0x5a ^ (i * 7);
+  memset (seqno, 0, sizeof seqno);
+  seqno[0] = 0xfe;
+  seqno[1] = 0xff;
+
+  plain = xmalloc (4 * maxlen);
+  ciph = plain + maxlen;
+  ref = ciph + maxlen;
+  out = ref + maxlen;
+  for (i = 0; i < maxlen; i++)
+    plain[i] = i * 131 + (i >> 8);
+
+  err = gcry_cipher_open (&hd, algo, GCRY_CIPHER_MODE_XTS, 0);
+  if (!err)
+    err = gcry_cipher_open (&hd_data, algo, GCRY_CIPHER_MODE_ECB, 0);
+  if (!err)
+    err = gcry_cipher_open (&hd_tweak, algo, GCRY_CIPHER_MODE_ECB, 0);
+  if (err)
+    {
+      fail ("cipher-xts, gcry_cipher_open failed (algo %d): %s\n",
+            algo, gpg_strerror (err));
+      xfree (plain);
+      return;
+    }
+
+  err = gcry_cipher_setkey (hd, key, 2 * keylen);
+  if (!err)
+    err = gcry_cipher_setkey (hd_data, key, keylen);
+  if (!err)
+    err = gcry_cipher_setkey (hd_tweak, key + keylen, keylen);
+  if (!err)
+    err = gcry_cipher_setiv (hd, seqno, sizeof seqno);
+  if (err)
+    {
+      fail ("cipher-xts, gcry_cipher_setkey failed (algo %d): %s\n",
+            algo, gpg_strerror (err));
+      goto leave;
+    }
+
+  /* All data units are encrypted with consecutive sequence numbers
+     without setting a new IV.  */
+  for (j = 0; j < DIM (lengths); j++)
+    {
+      len = lengths[j];
+      nblocks = len / 16;
+      rest = len % 16;
+
+      /* Reference: tweak = E_K2(seqno), then xor-encrypt-xor with
+         multiplication of the tweak by alpha after each block.  */
+      err = gcry_cipher_encrypt (hd_tweak, tweak, 16, seqno, 16);
+      for (i = 0; !err && i < nblocks; i++)
+        {
+          p = ref + i * 16;
+          for (k = 0; k < 16; k++)
+            p[k] = plain[i * 16 + k] ^ tweak[k];
+          err = gcry_cipher_encrypt (hd_data, p, 16, NULL, 0);
+          for (k = 0; k < 16; k++)
+            p[k] ^= tweak[k];
+
+          carry = (tweak[15] >> 7) ? 0x87 : 0;
+          for (p = tweak + 15; p > tweak; p--)
+            *p = (*p << 1) | (p[-1] >> 7);
+          tweak[0] = (tweak[0] << 1) ^ carry;
+        }
+      if (!err && rest)
+        {
+          /* Ciphertext stealing.  */
+          p = ref + (nblocks - 1) * 16;
+          memcpy (p + 16, p, rest);
+          memcpy (p, plain + nblocks * 16, rest);
+          for (k = 0; k < 16; k++)
+            p[k] ^= tweak[k];
+          err = gcry_cipher_encrypt (hd_data, p, 16, NULL, 0);
+          for (k = 0; k < 16; k++)
+            p[k] ^= tweak[k];
+        }
+      if (err)
+        {
+          fail ("cipher-xts, ECB reference failed (algo %d): %s\n",
+                algo, gpg_strerror (err));
+          goto leave;
+        }
+
+      err = gcry_cipher_encrypt (hd, ciph, len, plain, len);
+      if (err)
+        {
+          fail ("cipher-xts, gcry_cipher_encrypt failed (algo %d, len %d): "
+                "%s\n", algo, (int)len, gpg_strerror (err));
+          goto leave;
+        }
+      if (memcmp (ciph, ref, len))
+        fail ("cipher-xts, encrypt mismatch (algo %d, len %d)\n",
+              algo, (int)len);
+
+      /* Decrypt in place with the same sequence number.  */
+      err = gcry_cipher_setiv (hd, seqno, sizeof seqno);
+      if (!err)
+        {
+          memcpy (out, ciph, len);
+          err = gcry_cipher_decrypt (hd, out, len, NULL, 0);
+        }
+      if (err)
+        {
+          fail ("cipher-xts, gcry_cipher_decrypt failed (algo %d, len %d): "
+                "%s\n", algo, (int)len, gpg_strerror (err));
+          goto leave;
+        }
+      if (memcmp (out, plain, len))
+        fail ("cipher-xts, decrypt mismatch (algo %d, len %d)\n",
+              algo, (int)len);
+
+      /* Advance to the next data unit like the handle did after the
+         decryption.  */
+      for (i = 0; i < 16 && !++seqno[i]; i++)
+        ;
+    }
+
+  /* Data units shorter than one block and keys of odd length are
+     rejected.  */
+  if (gpg_err_code (gcry_cipher_encrypt (hd, out, 15, plain, 15))
+      != GPG_ERR_BUFFER_TOO_SHORT)
+    fail ("cipher-xts, short data unit not rejected (algo %d)\n", algo);
+  if (gpg_err_code (gcry_cipher_setkey (hd, key, 2 * keylen - 1))
+      != GPG_ERR_INV_KEYLEN)
+    fail ("cipher-xts, odd key length not rejected (algo %d)\n", algo);
+
+ leave:
+  gcry_cipher_close (hd);
+  gcry_cipher_close (hd_data);
+  gcry_cipher_close (hd_tweak);
+  xfree (plain);
+}
+
+
+static void
+check_xts_cipher (void)
+{
+  /* Check XTS cipher with separate destination and source buffers for
+   * encryption/decryption. */
+  do_check_xts_cipher (0);
+
+  /* Check XTS cipher with inplace encrypt/decrypt. */
+  do_check_xts_cipher (1);
+
+  /* Check other key lengths and 128 bit block ciphers against ECB.  */
+  check_xts_cipher_ecb_ref (GCRY_CIPHER_AES);
+  check_xts_cipher_ecb_ref (GCRY_CIPHER_AES192);
+  check_xts_cipher_ecb_ref (GCRY_CIPHER_AES256);
+#if USE_CAMELLIA
+  check_xts_cipher_ecb_ref (GCRY_CIPHER_CAMELLIA128);
+  check_xts_cipher_ecb_ref (GCRY_CIPHER_CAMELLIA256);
+#endif
+#if USE_TWOFISH
+  check_xts_cipher_ecb_ref (GCRY_CIPHER_TWOFISH);
+#endif
+#if USE_SERPENT
+  check_xts_cipher_ecb_ref (GCRY_CIPHER_SERPENT128);
+  check_xts_cipher_ecb_ref (GCRY_CIPHER_SERPENT256);
+#endif
+}
+
+
+/* Check gcry_cipher_encrypt_batch against gcry_cipher_encrypt on
+   individual handles.  */
+static void
+check_cipher_encrypt_batch (void)
+{
+#define BATCH_N      21
+#define BATCH_MAXLEN (24 * 16)
+  static const int algos[] = { GCRY_CIPHER_AES, GCRY_CIPHER_AES256,
+                               GCRY_CIPHER_AES, GCRY_CIPHER_AES192 };
+  gcry_cipher_hd_t hds[BATCH_N], refs[BATCH_N], dups[3];
+  void *out[BATCH_N];
+  const void *in[BATCH_N];
+  size_t outsize[BATCH_N], inlen[BATCH_N];
+  gcry_error_t results[BATCH_N], experr[BATCH_N];
+  unsigned char key[32], iv[16];
+  unsigned char *plain, *ciph, *ref;
+  unsigned int flags;
+  size_t i, j, len, keylen;
+  gcry_error_t err;
+
+  if (verbose)
+    fprintf (stderr, "  Starting batch encryption checks.\n");
+
+  plain = xmalloc (3 * BATCH_N * BATCH_MAXLEN);
+  ciph = plain + BATCH_N * BATCH_MAXLEN;
+  ref = ciph + BATCH_N * BATCH_MAXLEN;
+  for (i = 0; i < BATCH_N * BATCH_MAXLEN; i++)
+    plain[i] = i * 17 + (i >> 8);
+
+  for (i = 0; i < BATCH_N; i++)
+    {
+      /* Mix key lengths, CBC-MAC and CBC-CTS handles, lengths which
+         need to be rejected and in-place encryption.  */
+      flags = 0;
+      if (i % 6 == 5)
+        flags = GCRY_CIPHER_CBC_MAC;
+      else if (i == 4)
+        flags = GCRY_CIPHER_CBC_CTS;
+      len = 16 * (1 + (i * 7) % 23);
+      if (i == 4)
+        len += 5;
+      if (i == 9)
+        len += 3;
+
+      keylen = gcry_cipher_get_algo_keylen (algos[i % DIM (algos)]);
+      err = gcry_cipher_open (&hds[i], algos[i % DIM (algos)],
+                              GCRY_CIPHER_MODE_CBC, flags);
+      if (!err)
+        err = gcry_cipher_open (&refs[i], algos[i % DIM (algos)],
+                                GCRY_CIPHER_MODE_CBC, flags);
+      for (j = 0; j < sizeof key; j++)
+        key[j] = i * 29 + j * 3;
+      for (j = 0; j < sizeof iv; j++)
+        iv[j] = i + j * 11;
+      if (!err)
+        err = gcry_cipher_setkey (hds[i], key, keylen);
+      if (!err)
+        err = gcry_cipher_setkey (refs[i], key, keylen);
+      if (!err)
+        err = gcry_cipher_setiv (hds[i], iv, sizeof iv);
+      if (!err)
+        err = gcry_cipher_setiv (refs[i], iv, sizeof iv);
+      if (err)
+        {
+          fail ("cipher-batch, handle setup failed: %s\n", gpg_strerror (err));
+          xfree (plain);
+          return;
+        }
+
+      out[i] = ciph + i * BATCH_MAXLEN;
+      outsize[i] = (flags & GCRY_CIPHER_CBC_MAC)? 16 : len;
+      inlen[i] = len;
+      if (i % 4 == 1 && !(flags & GCRY_CIPHER_CBC_MAC))
+        {
+          memcpy (out[i], plain + i * BATCH_MAXLEN, len);
+          in[i] = NULL;
+        }
+      else
+        in[i] = plain + i * BATCH_MAXLEN;
+
+      experr[i] = gcry_cipher_encrypt (refs[i], ref + i * BATCH_MAXLEN,
+                                       outsize[i], plain + i * BATCH_MAXLEN,
+                                       len);
+    }
+
+  err = gcry_cipher_encrypt_batch (hds, out, outsize, in, inlen, BATCH_N,
+                                   results);
+  if (gpg_err_code (err) != GPG_ERR_INV_LENGTH)
+    fail ("cipher-batch, unexpected return value: %s\n", gpg_strerror (err));
+
+  for (i = 0; i < BATCH_N; i++)
+    {
+      if (gpg_err_code (results[i]) != gpg_err_code (experr[i]))
+        fail ("cipher-batch, buffer %d: unexpected result: %s\n",
+              (int)i, gpg_strerror (results[i]));
+      else if (!experr[i]
+               && memcmp (out[i], ref + i * BATCH_MAXLEN, outsize[i]))
+        fail ("cipher-batch, buffer %d: encryption mismatch\n", (int)i);
+
+      /* The handles need to continue with the updated IV.  */
+      len = 48;
+      outsize[i] = (i % 6 == 5)? 16 : len;
+      err = gcry_cipher_encrypt (hds[i], ciph + i * BATCH_MAXLEN, outsize[i],
+                                 plain, len);
+      if (!err)
+        err = gcry_cipher_encrypt (refs[i], ref + i * BATCH_MAXLEN,
+                                   outsize[i], plain, len);
+      if (err)
+        fail ("cipher-batch, buffer %d: encrypt failed: %s\n",
+              (int)i, gpg_strerror (err));
+      else if (memcmp (ciph + i * BATCH_MAXLEN, ref + i * BATCH_MAXLEN,
+                       outsize[i]))
+        fail ("cipher-batch, buffer %d: IV not updated\n", (int)i);
+    }
+
+  /* A handle used twice is processed in order.  */
+  dups[0] = dups[1] = hds[0];
+  dups[2] = hds[2];
+  for (i = 0; i < 3; i++)
+    {
+      out[i] = ciph + i * BATCH_MAXLEN;
+      outsize[i] = 64;
+      in[i] = plain + i * BATCH_MAXLEN;
+      inlen[i] = 64;
+    }
+  err = gcry_cipher_encrypt_batch (dups, out, outsize, in, inlen, 3, NULL);
+  if (!err)
+    err = gcry_cipher_encrypt (refs[0], ref, 64, plain, 64);
+  if (!err)
+    err = gcry_cipher_encrypt (refs[0], ref + BATCH_MAXLEN, 64,
+                               plain + BATCH_MAXLEN, 64);
+  if (!err)
+    err = gcry_cipher_encrypt (refs[2], ref + 2 * BATCH_MAXLEN, 64,
+                               plain + 2 * BATCH_MAXLEN, 64);
+  if (err)
+    fail ("cipher-batch, duplicate handles: encrypt failed: %s\n",
+          gpg_strerror (err));
+  else
+    for (i = 0; i < 3; i++)
+      if (memcmp (ciph + i * BATCH_MAXLEN, ref + i * BATCH_MAXLEN, 64))
+        fail ("cipher-batch, duplicate handles: buffer %d mismatch\n",
+              (int)i);
+
+  for (i = 0; i < BATCH_N; i++)
+    {
+      gcry_cipher_close (hds[i]);
+      gcry_cipher_close (refs[i]);
+    }
+  xfree (plain);
+
+  if (verbose)
+    fprintf (stderr, "  Completed batch encryption checks.\n");
+#undef BATCH_N
+#undef BATCH_MAXLEN
+}
+
+/* Split the LEN bytes at BUF into buffer descriptions of the sizes
+   SIZES; the last one takes the rest.  Returns the number of items
+   stored at IOV, which must have room for NSIZES + 2 items.  */
+static int
+split_buffers (gcry_buffer_t *iov, unsigned char *buf, size_t len,
+               const size_t *sizes, int nsizes)
+{
+  size_t off = 0;
+  int i, n = 0;
+
+  for (i = 0; i < nsizes && off + sizes[i] < len; i++)
+    {
+      iov[n].size = 0;
+      iov[n].data = buf;
+      iov[n].off = off;
+      iov[n].len = sizes[i];
+      off += sizes[i];
+      n++;
+      if (i == 1)
+        {
+          /* Empty items are skipped.  */
+          iov[n].size = 0;
+          iov[n].data = NULL;
+          iov[n].off = 0;
+          iov[n].len = 0;
+          n++;
+        }
+    }
+  iov[n].size = 0;
+  iov[n].data = buf + off;
+  iov[n].off = 0;
+  iov[n].len = len - off;
+  return n + 1;
+}
+
+
+/* Check gcry_cipher_encrypt_buffers, gcry_cipher_decrypt_buffers and
+   gcry_cipher_authenticate_buffers against the functions taking a
+   single buffer.  */
+static void
+check_cipher_buffers (void)
 {
-  unsigned int split;
+  static const struct
+  {
+    int algo;
+    int mode;
+    unsigned int flags;
+    size_t len;
+    size_t ivlen;
+    int aead;
+  } tv[] =
+    {
+      { GCRY_CIPHER_AES, GCRY_CIPHER_MODE_ECB, 0, 16 * 40, 0 },
+      { GCRY_CIPHER_AES, GCRY_CIPHER_MODE_CBC, 0, 16 * 37, 16 },
+      { GCRY_CIPHER_AES, GCRY_CIPHER_MODE_CBC, GCRY_CIPHER_CBC_CTS,
+        16 * 37 + 5, 16 },
+      { GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_CFB, 0, 999, 16 },
+      { GCRY_CIPHER_AES, GCRY_CIPHER_MODE_OFB, 0, 777, 16 },
+      { GCRY_CIPHER_AES192, GCRY_CIPHER_MODE_CTR, 0, 1003, 16 },
+      { GCRY_CIPHER_AES, GCRY_CIPHER_MODE_XTS, 0, 16 * 33 + 7, 16 },
+      { GCRY_CIPHER_AES, GCRY_CIPHER_MODE_GCM, 0, 1001, 12, 1 },
+      { GCRY_CIPHER_AES, GCRY_CIPHER_MODE_OCB, 0, 1001, 12, 1 },
+      { GCRY_CIPHER_CHACHA20, GCRY_CIPHER_MODE_STREAM, 0, 1001, 12 },
+      { GCRY_CIPHER_CHACHA20, GCRY_CIPHER_MODE_POLY1305, 0, 1001, 12, 1 }
+    };
+  static const size_t insizes[] = { 1, 15, 17, 100, 3, 256 };
+  static const size_t outsizes[] = { 40, 7, 5 * 64, 1 };
+  static const size_t aadsizes[] = { 3, 13, 17 };
+  gcry_buffer_t iniov[DIM (insizes) + 2], outiov[DIM (outsizes) + 2];
+  gcry_buffer_t aadiov[DIM (aadsizes) + 2];
+  int incnt, outcnt, aadcnt;
+  gcry_cipher_hd_t hd, ref;
+  unsigned char key[64], iv[16], tag[16], reftag[16];
+  unsigned char aad[45];
+  unsigned char *plain, *ciph, *refciph;
+  size_t keylen, len;
+  gcry_error_t err;
+  int i, j;
 
-  for (split = 0; split < 32 * 16; split = split * 2 + 16)
+  if (verbose)
+    fprintf (stderr, "  Starting scatter/gather cipher checks.\n");
+
+  plain = xmalloc (3 * 2048);
+  ciph = plain + 2048;
+  refciph = ciph + 2048;
+  for (j = 0; j < 2048; j++)
+    plain[j] = j * 13 + (j >> 8);
+  for (j = 0; j < sizeof key; j++)
+    key[j] = j * 7 + 1;
+  for (j = 0; j < sizeof iv; j++)
+    iv[j] = j * 3 + 5;
+  for (j = 0; j < sizeof aad; j++)
+    aad[j] = j + 0x80;
+
+  for (i = 0; i < DIM (tv); i++)
     {
-      check_ocb_cipher_largebuf_split(algo, keylen, tagexpect, split);
-    }
-}
+      if (gcry_cipher_test_algo (tv[i].algo))
+        continue;
+      if (verbose)
+        fprintf (stderr, "    checking %s mode %d\n",
+                 gcry_cipher_algo_name (tv[i].algo), tv[i].mode);
 
+      len = tv[i].len;
+      keylen = gcry_cipher_get_algo_keylen (tv[i].algo);
+      if (tv[i].mode == GCRY_CIPHER_MODE_XTS)
+        keylen *= 2;
 
-static void
-check_ocb_cipher (void)
-{
-  /* Check OCB cipher with separate destination and source buffers for
-   * encryption/decryption. */
-  do_check_ocb_cipher(0);
+      err = gcry_cipher_open (&hd, tv[i].algo, tv[i].mode, tv[i].flags);
+      if (!err)
+        err = gcry_cipher_open (&ref, tv[i].algo, tv[i].mode, tv[i].flags);
+      if (err)
+        {
+          fail ("cipher-buffers, algo %d, mode %d, open failed: %s\n",
+                tv[i].algo, tv[i].mode, gpg_strerror (err));
+          continue;
+        }
 
-  /* Check OCB cipher with inplace encrypt/decrypt. */
-  do_check_ocb_cipher(1);
+      err = gcry_cipher_setkey (hd, key, keylen);
+      if (!err)
+        err = gcry_cipher_setkey (ref, key, keylen);
+      if (!err && tv[i].ivlen)
+        err = gcry_cipher_setiv (hd, iv, tv[i].ivlen);
+      if (!err && tv[i].ivlen)
+        err = gcry_cipher_setiv (ref, iv, tv[i].ivlen);
+      if (err)
+        {
+          fail ("cipher-buffers, algo %d, mode %d, setup failed: %s\n",
+                tv[i].algo, tv[i].mode, gpg_strerror (err));
+          goto next;
+        }
 
-  /* Check large buffer encryption/decryption. */
-  check_ocb_cipher_largebuf(GCRY_CIPHER_AES, 16,
-			    "\xf5\xf3\x12\x7d\x58\x2d\x96\xe8"
-			    "\x33\xfd\x7a\x4f\x42\x60\x5d\x20");
-  check_ocb_cipher_largebuf(GCRY_CIPHER_AES256, 32,
-			    "\xfa\x26\xa5\xbf\xf6\x7d\x3a\x8d"
-			    "\xfe\x96\x67\xc9\xc8\x41\x03\x51");
-  check_ocb_cipher_largebuf(GCRY_CIPHER_CAMELLIA128, 16,
-			    "\x28\x23\x38\x45\x2b\xfd\x42\x45"
-			    "\x43\x64\x7e\x67\x7f\xf4\x8b\xcd");
-  check_ocb_cipher_largebuf(GCRY_CIPHER_CAMELLIA192, 24,
-			    "\xee\xca\xe5\x39\x27\x2d\x33\xe7"
-			    "\x79\x74\xb0\x1d\x37\x12\xd5\x6c");
-  check_ocb_cipher_largebuf(GCRY_CIPHER_CAMELLIA256, 32,
-			    "\x39\x39\xd0\x2d\x05\x68\x74\xee"
-			    "\x18\x6b\xea\x3d\x0b\xd3\x58\xae");
-  check_ocb_cipher_largebuf(GCRY_CIPHER_TWOFISH, 16,
-			    "\x63\xe3\x0e\xb9\x11\x6f\x14\xba"
-			    "\x79\xe4\xa7\x9e\xad\x3c\x02\x0c");
-  check_ocb_cipher_largebuf(GCRY_CIPHER_TWOFISH, 32,
-			    "\xf6\xd4\xfe\x4e\x50\x85\x13\x59"
-			    "\x69\x0e\x4c\x67\x3e\xdd\x47\x90");
-  check_ocb_cipher_largebuf(GCRY_CIPHER_SERPENT128, 16,
-			    "\x3c\xfb\x66\x14\x3c\xc8\x6c\x67"
-			    "\x26\xb8\x23\xeb\xaf\x43\x98\x69");
-  check_ocb_cipher_largebuf(GCRY_CIPHER_SERPENT192, 24,
-			    "\x5e\x62\x27\xc5\x32\xc3\x1d\xe6"
-			    "\x2e\x65\xe7\xd6\xfb\x05\xd7\xb2");
-  check_ocb_cipher_largebuf(GCRY_CIPHER_SERPENT256, 32,
-			    "\xe7\x8b\xe6\xd4\x2f\x7a\x36\x4c"
-			    "\xba\xee\x20\xe2\x68\xf4\xcb\xcc");
+      /* Reference: contiguous buffers.  */
+      if (tv[i].aead)
+        err = gcry_cipher_authenticate (ref, aad, sizeof aad);
+      if (!err && tv[i].mode == GCRY_CIPHER_MODE_OCB)
+        err = gcry_cipher_final (ref);
+      if (!err)
+        err = gcry_cipher_encrypt (ref, refciph, len, plain, len);
+      if (!err && tv[i].aead)
+        err = gcry_cipher_gettag (ref, reftag, sizeof reftag);
+      if (err)
+        {
+          fail ("cipher-buffers, algo %d, mode %d, encrypt failed: %s\n",
+                tv[i].algo, tv[i].mode, gpg_strerror (err));
+          goto next;
+        }
+
+      /* Input and output split at different offsets.  */
+      incnt = split_buffers (iniov, plain, len, insizes, DIM (insizes));
+      outcnt = split_buffers (outiov, ciph, len, outsizes, DIM (outsizes));
+      aadcnt = split_buffers (aadiov, aad, sizeof aad,
+                              aadsizes, DIM (aadsizes));
+      memset (ciph, 0, len);
+      if (tv[i].aead)
+        err = gcry_cipher_authenticate_buffers (hd, aadiov, aadcnt);
+      if (!err && tv[i].mode == GCRY_CIPHER_MODE_OCB)
+        err = gcry_cipher_final (hd);
+      if (!err)
+        err = gcry_cipher_encrypt_buffers (hd, outiov, outcnt, iniov, incnt);
+      if (!err && tv[i].aead)
+        err = gcry_cipher_gettag (hd, tag, sizeof tag);
+      if (err)
+        {
+          fail ("cipher-buffers, algo %d, mode %d, "
+                "gcry_cipher_encrypt_buffers failed: %s\n",
+                tv[i].algo, tv[i].mode, gpg_strerror (err));
+          goto next;
+        }
+      if (memcmp (ciph, refciph, len))
+        fail ("cipher-buffers, algo %d, mode %d, encrypt mismatch\n",
+              tv[i].algo, tv[i].mode);
+      if (tv[i].aead && memcmp (tag, reftag, sizeof tag))
+        fail ("cipher-buffers, algo %d, mode %d, tag mismatch\n",
+              tv[i].algo, tv[i].mode);
+
+      /* In-place decryption.  */
+      err = gcry_cipher_reset (hd);
+      if (!err && tv[i].ivlen)
+        err = gcry_cipher_setiv (hd, iv, tv[i].ivlen);
+      if (!err && tv[i].aead)
+        err = gcry_cipher_authenticate_buffers (hd, aadiov, aadcnt);
+      if (!err && tv[i].mode == GCRY_CIPHER_MODE_OCB)
+        err = gcry_cipher_final (hd);
+      if (!err)
+        err = gcry_cipher_decrypt_buffers (hd, outiov, outcnt, NULL, 0);
+      if (!err && tv[i].aead)
+        err = gcry_cipher_checktag (hd, reftag, sizeof reftag);
+      if (err)
+        fail ("cipher-buffers, algo %d, mode %d, "
+              "gcry_cipher_decrypt_buffers failed: %s\n",
+              tv[i].algo, tv[i].mode, gpg_strerror (err));
+      else if (memcmp (ciph, plain, len))
+        fail ("cipher-buffers, algo %d, mode %d, decrypt mismatch\n",
+              tv[i].algo, tv[i].mode);
+
+    next:
+      gcry_cipher_close (hd);
+      gcry_cipher_close (ref);
+    }
+
+  /* The output must be at least as long as the input.  */
+  err = gcry_cipher_open (&hd, GCRY_CIPHER_AES, GCRY_CIPHER_MODE_CTR, 0);
+  if (!err)
+    err = gcry_cipher_setkey (hd, key, 16);
+  if (!err)
+    {
+      incnt = split_buffers (iniov, plain, 64, insizes, DIM (insizes));
+      outcnt = split_buffers (outiov, ciph, 63, outsizes, DIM (outsizes));
+      err = gcry_cipher_encrypt_buffers (hd, outiov, outcnt, iniov, incnt);
+      if (gpg_err_code (err) != GPG_ERR_BUFFER_TOO_SHORT)
+        fail ("cipher-buffers, short output not detected: %s\n",
+              gpg_strerror (err));
+      gcry_cipher_close (hd);
+    }
+  else
+    fail ("cipher-buffers, CTR setup failed: %s\n", gpg_strerror (err));
+
+  xfree (plain);
+
+  if (verbose)
+    fprintf (stderr, "  Completed scatter/gather cipher checks.\n");
 }
 
 
@@ -5311,6 +6436,9 @@ check_cipher_modes(void)
   check_gcm_cipher ();
   check_poly1305_cipher ();
   check_ocb_cipher ();
+  check_xts_cipher ();
+  check_cipher_encrypt_batch ();
+  check_cipher_buffers ();
   check_stream_cipher ();
   check_stream_cipher_large_block ();
 
@@ -5657,6 +6785,164 @@ check_one_md_multi (int algo, const char *data, int len, const char *expect)
 }
 
 
+/* Check gcry_md_hash_buffer_batch against gcry_md_hash_buffer.  */
+static void
+check_md_hash_buffer_batch (void)
+{
+#define HBATCH_N 37
+  static const int algos[] = { GCRY_MD_SHA1, GCRY_MD_SHA224,
+                               GCRY_MD_SHA256, GCRY_MD_SHA512,
+                               GCRY_MD_SHA3_256, GCRY_MD_SHA3_512 };
+  static const size_t lengths[] = { 0, 1, 55, 56, 63, 64, 65, 71, 72,
+                                    119, 120, 128, 135, 136, 1000, 4096,
+                                    70000 };
+  const void *bufs[HBATCH_N];
+  size_t buflens[HBATCH_N];
+  void *digests[HBATCH_N];
+  unsigned char *out;
+  unsigned char *data;
+  unsigned char expect[64];
+  size_t i, j, n, mdlen;
+  int algo;
+  gcry_error_t err;
+
+  if (verbose)
+    fprintf (stderr, "  checking batch hashing\n");
+
+  data = xmalloc (70000 + HBATCH_N);
+  for (i = 0; i < 70000 + HBATCH_N; i++)
+    data[i] = i * 7 + (i >> 8);
+  out = xmalloc (HBATCH_N * 64);
+
+  for (j = 0; j < DIM (algos); j++)
+    {
+      algo = algos[j];
+      if (gcry_md_test_algo (algo))
+        continue;
+      mdlen = gcry_md_get_algo_dlen (algo);
+
+      /* Different numbers of messages exercise partly filled lanes.  */
+      for (n = 1; n <= HBATCH_N; n += 9)
+        {
+          for (i = 0; i < n; i++)
+            {
+              buflens[i] = lengths[(i * 5 + n) % DIM (lengths)];
+              bufs[i] = data + i;
+              digests[i] = out + i * 64;
+            }
+
+          err = gcry_md_hash_buffer_batch (algo, digests, bufs, buflens, n);
+          if (err)
+            {
+              fail ("md-batch, algo %d: hashing failed: %s\n",
+                    algo, gpg_strerror (err));
+              continue;
+            }
+
+          for (i = 0; i < n; i++)
+            {
+              gcry_md_hash_buffer (algo, expect, bufs[i], buflens[i]);
+              if (memcmp (digests[i], expect, mdlen))
+                fail ("md-batch, algo %d, n %d, buffer %d: digest mismatch\n",
+                      algo, (int)n, (int)i);
+            }
+        }
+    }
+
+  err = gcry_md_hash_buffer_batch (GCRY_MD_SHAKE128, digests, bufs,
+                                   buflens, 1);
+  if (gpg_err_code (err) != GPG_ERR_DIGEST_ALGO)
+    fail ("md-batch, XOF: unexpected result: %s\n", gpg_strerror (err));
+
+  xfree (out);
+  xfree (data);
+#undef HBATCH_N
+}
+
+
+/* Check gcry_md_extract_batch against gcry_md_extract.  */
+static void
+check_md_extract_batch (void)
+{
+#define XBATCH_N 6
+  static const int algos[] = { GCRY_MD_SHAKE128, GCRY_MD_SHAKE256 };
+  static const size_t outlens[] = { 1, 135, 168, 500 };
+  gcry_md_hd_t hds[XBATCH_N];
+  gcry_md_hd_t ref[XBATCH_N];
+  void *outbufs[XBATCH_N];
+  unsigned char *out;
+  unsigned char expect[500];
+  unsigned char data[300];
+  size_t i, j, k, n;
+  int algo;
+  gcry_error_t err;
+
+  if (verbose)
+    fprintf (stderr, "  checking batch extraction\n");
+
+  for (i = 0; i < sizeof data; i++)
+    data[i] = i * 13 + 5;
+  out = xmalloc (XBATCH_N * 500);
+
+  for (j = 0; j < DIM (algos); j++)
+    {
+      algo = algos[j];
+      if (gcry_md_test_algo (algo))
+        continue;
+
+      for (n = 1; n <= XBATCH_N; n++)
+        {
+          for (i = 0; i < n; i++)
+            {
+              err = gcry_md_open (&hds[i], algo, 0);
+              if (!err)
+                err = gcry_md_open (&ref[i], algo, 0);
+              if (err)
+                {
+                  fail ("md-xbatch, algo %d: gcry_md_open failed: %s\n",
+                        algo, gpg_strerror (err));
+                  goto leave;
+                }
+              gcry_md_write (hds[i], data, i * 50 + n);
+              gcry_md_write (ref[i], data, i * 50 + n);
+              outbufs[i] = out + i * 500;
+            }
+
+          /* Successive calls continue the output streams.  */
+          for (k = 0; k < DIM (outlens); k++)
+            {
+              err = gcry_md_extract_batch (hds, algo, outbufs, outlens[k], n);
+              if (err)
+                {
+                  fail ("md-xbatch, algo %d: extraction failed: %s\n",
+                        algo, gpg_strerror (err));
+                  break;
+                }
+
+              for (i = 0; i < n; i++)
+                {
+                  gcry_md_extract (ref[i], algo, expect, outlens[k]);
+                  if (memcmp (outbufs[i], expect, outlens[k]))
+                    fail ("md-xbatch, algo %d, n %d, handle %d, step %d: "
+                          "output mismatch\n",
+                          algo, (int)n, (int)i, (int)k);
+                }
+            }
+
+          for (i = 0; i < n; i++)
+            {
+              gcry_md_close (hds[i]);
+              gcry_md_close (ref[i]);
+            }
+        }
+    }
+
+ leave:
+  xfree (out);
+#undef XBATCH_N
+}
+
+
 static void
 check_digests (void)
 {
@@ -6527,6 +7813,9 @@ check_digests (void)
       gcry_md_close (hd);
     }
 
+  check_md_hash_buffer_batch ();
+  check_md_extract_batch ();
+
  leave:
   if (verbose)
     fprintf (stderr, "Completed hash checks.\n");
@@ -6536,7 +7825,7 @@ static void
 check_one_hmac (int algo, const char *data, int datalen,
 		const char *key, int keylen, const char *expect)
 {
-  gcry_md_hd_t hd, hd2;
+  gcry_md_hd_t hd, hd2, hd3;
   unsigned char *p;
   int mdlen;
   int i;
@@ -6566,6 +7855,23 @@ check_one_hmac (int algo, const char *data, int datalen,
       fail ("algo %d, gcry_md_copy failed: %s\n", algo, gpg_strerror (err));
     }
 
+  /* Take the key from HD; the data already written to HD must not be
+     carried over.  */
+  err = gcry_md_open (&hd3, algo, GCRY_MD_FLAG_HMAC);
+  if (!err)
+    err = gcry_md_setkey_from (hd3, hd);
+  if (err)
+    fail ("algo %d, gcry_md_setkey_from failed: %s\n",
+          algo, gpg_strerror (err));
+  else
+    {
+      gcry_md_write (hd3, data, datalen);
+      p = gcry_md_read (hd3, algo);
+      if (!p || memcmp (p, expect, mdlen))
+        fail ("algo %d, digest mismatch with gcry_md_setkey_from\n", algo);
+    }
+  gcry_md_close (hd3);
+
   gcry_md_close (hd);
 
   p = gcry_md_read (hd2, algo);
@@ -6903,6 +8209,63 @@ check_hmac (void)
 		      algos[i].expect);
     }
 
+  /* A key can only be taken from an HMAC handle of the same algorithm.  */
+  if (!gcry_md_test_algo (GCRY_MD_SHA256) && !gcry_md_test_algo (GCRY_MD_SHA1))
+    {
+      gcry_md_hd_t hd, keyhd;
+      gcry_error_t err;
+
+      err = gcry_md_open (&hd, GCRY_MD_SHA256, GCRY_MD_FLAG_HMAC);
+      if (!err)
+        err = gcry_md_open (&keyhd, GCRY_MD_SHA1, GCRY_MD_FLAG_HMAC);
+      if (err)
+        {
+          fail ("hmac-setkey-from: gcry_md_open failed: %s\n",
+                gpg_strerror (err));
+          gcry_md_close (hd);
+        }
+      else
+        {
+          gcry_md_setkey (keyhd, "key", 3);
+          err = gcry_md_setkey_from (hd, keyhd);
+          if (gpg_err_code (err) != GPG_ERR_DIGEST_ALGO)
+            fail ("hmac-setkey-from: algo mismatch not detected: %s\n",
+                  gpg_strerror (err));
+          gcry_md_close (keyhd);
+          gcry_md_close (hd);
+        }
+    }
+
+  /* The key handle must exist and must have a key set.  */
+  if (!gcry_md_test_algo (GCRY_MD_SHA256))
+    {
+      gcry_md_hd_t hd, keyhd;
+      gcry_error_t err;
+
+      err = gcry_md_open (&hd, GCRY_MD_SHA256, GCRY_MD_FLAG_HMAC);
+      if (!err)
+        err = gcry_md_open (&keyhd, GCRY_MD_SHA256, GCRY_MD_FLAG_HMAC);
+      if (err)
+        {
+          fail ("hmac-setkey-from: gcry_md_open failed: %s\n",
+                gpg_strerror (err));
+          gcry_md_close (hd);
+        }
+      else
+        {
+          err = gcry_md_setkey_from (hd, NULL);
+          if (gpg_err_code (err) != GPG_ERR_INV_ARG)
+            fail ("hmac-setkey-from: NULL key handle not detected: %s\n",
+                  gpg_strerror (err));
+          err = gcry_md_setkey_from (hd, keyhd);
+          if (gpg_err_code (err) != GPG_ERR_MISSING_KEY)
+            fail ("hmac-setkey-from: unkeyed key handle not detected: %s\n",
+                  gpg_strerror (err));
+          gcry_md_close (keyhd);
+          gcry_md_close (hd);
+        }
+    }
+
   if (verbose)
     fprintf (stderr, "Completed hashed MAC checks.\n");
 }
@@ -7017,6 +8380,133 @@ out:
   gcry_mac_close (hd);
 }
 
+/* Check gcry_mac_write_batch against gcry_mac_write on individual
+   handles.  */
+static void
+check_mac_write_batch (void)
+{
+#define MBATCH_N 23
+  static const int algos[] = { GCRY_MAC_CMAC_AES, GCRY_MAC_CMAC_AES,
+                               GCRY_MAC_CMAC_3DES, GCRY_MAC_CMAC_AES,
+                               GCRY_MAC_HMAC_SHA256 };
+  static const size_t keylens[] = { 16, 24, 32 };
+  static const size_t lengths[] = { 0, 1, 15, 16, 17, 31, 32, 33, 100,
+                                    128, 129, 1000, 4096 };
+  gcry_mac_hd_t hds[MBATCH_N], refs[MBATCH_N], dups[3];
+  const void *bufs[MBATCH_N];
+  size_t buflens[MBATCH_N];
+  gcry_error_t results[MBATCH_N];
+  unsigned char key[32];
+  unsigned char tag[32], reftag[32];
+  unsigned char *data;
+  size_t i, j, keylen, taglen, reftaglen;
+  int algo;
+  gcry_error_t err;
+
+  if (verbose)
+    fprintf (stderr, "  checking MAC batch writes\n");
+
+  data = xmalloc (MBATCH_N * 4096);
+  for (i = 0; i < MBATCH_N * 4096; i++)
+    data[i] = i * 13 + (i >> 9);
+
+  for (i = 0; i < MBATCH_N; i++)
+    {
+      algo = algos[i % DIM (algos)];
+      if (gcry_mac_test_algo (algo))
+        algo = GCRY_MAC_CMAC_AES;
+      keylen = gcry_mac_get_algo_keylen (algo);
+      if (algo == GCRY_MAC_CMAC_AES)
+        keylen = keylens[i % DIM (keylens)];
+      for (j = 0; j < keylen; j++)
+        key[j] = i * 31 + j;
+
+      err = gcry_mac_open (&hds[i], algo, 0, NULL);
+      if (!err)
+        err = gcry_mac_open (&refs[i], algo, 0, NULL);
+      if (!err)
+        err = gcry_mac_setkey (hds[i], key, keylen);
+      if (!err)
+        err = gcry_mac_setkey (refs[i], key, keylen);
+      /* Leave partial blocks in some of the handles.  */
+      if (!err && i % 3)
+        err = gcry_mac_write (hds[i], data + i, i % 19);
+      if (!err && i % 3)
+        err = gcry_mac_write (refs[i], data + i, i % 19);
+      if (err)
+        {
+          fail ("mac-batch, handle setup failed: %s\n", gpg_strerror (err));
+          xfree (data);
+          return;
+        }
+
+      bufs[i] = data + i * 4096;
+      buflens[i] = lengths[i % DIM (lengths)];
+    }
+
+  /* Some messages need more than one call.  */
+  for (j = 0; j < 2; j++)
+    {
+      err = gcry_mac_write_batch (hds, bufs, buflens, MBATCH_N, results);
+      if (err)
+        fail ("mac-batch, write failed: %s\n", gpg_strerror (err));
+      for (i = 0; i < MBATCH_N; i++)
+        {
+          if (results[i])
+            fail ("mac-batch, buffer %d: write failed: %s\n",
+                  (int)i, gpg_strerror (results[i]));
+          err = gcry_mac_write (refs[i], bufs[i], buflens[i]);
+          if (err)
+            fail ("mac-batch, buffer %d: reference write failed: %s\n",
+                  (int)i, gpg_strerror (err));
+        }
+    }
+
+  /* A handle used twice is processed in order.  */
+  dups[0] = dups[1] = hds[1];
+  dups[2] = hds[3];
+  err = gcry_mac_write_batch (dups, bufs, buflens, 3, NULL);
+  if (!err)
+    err = gcry_mac_write (refs[1], bufs[0], buflens[0]);
+  if (!err)
+    err = gcry_mac_write (refs[1], bufs[1], buflens[1]);
+  if (!err)
+    err = gcry_mac_write (refs[3], bufs[2], buflens[2]);
+  if (err)
+    fail ("mac-batch, duplicate handles: write failed: %s\n",
+          gpg_strerror (err));
+
+  for (i = 0; i < MBATCH_N; i++)
+    {
+      taglen = sizeof tag;
+      reftaglen = sizeof reftag;
+      err = gcry_mac_read (hds[i], tag, &taglen);
+      if (!err)
+        err = gcry_mac_read (refs[i], reftag, &reftaglen);
+      if (err)
+        fail ("mac-batch, buffer %d: read failed: %s\n",
+              (int)i, gpg_strerror (err));
+      else if (taglen != reftaglen || memcmp (tag, reftag, taglen))
+        fail ("mac-batch, buffer %d: MAC mismatch\n", (int)i);
+    }
+
+  /* CMAC handles can't be written to after the tag has been read.  */
+  err = gcry_mac_write_batch (hds, bufs, buflens, MBATCH_N, results);
+  if (gpg_err_code (err) != GPG_ERR_INV_STATE
+      || gpg_err_code (results[0]) != GPG_ERR_INV_STATE)
+    fail ("mac-batch, write after read: unexpected result: %s\n",
+          gpg_strerror (err));
+
+  for (i = 0; i < MBATCH_N; i++)
+    {
+      gcry_mac_close (hds[i]);
+      gcry_mac_close (refs[i]);
+    }
+  xfree (data);
+#undef MBATCH_N
+}
+
+
 static void
 check_mac (void)
 {
@@ -7885,6 +9375,8 @@ check_mac (void)
 		     algos[i].expect, 1);
     }
 
+  check_mac_write_batch ();
+
   if (verbose)
     fprintf (stderr, "Completed MAC checks.\n");
 }
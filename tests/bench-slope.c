@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 #include <assert.h>
 #include <time.h>
 
@@ -48,6 +49,9 @@ static int num_measurement_repetitions;
    results.  */
 static double cpu_ghz = -1;
 
+/* Whether we are to detect the CPU Ghz value (--cpu-mhz auto).  */
+static int auto_ghz;
+
 /* Whether we are running as part of the regression test suite.  */
 static int in_regression_test;
 
@@ -658,6 +662,8 @@ bench_encrypt_init (struct bench_obj *obj)
     }
 
   keylen = gcry_cipher_get_algo_keylen (mode->algo);
+  if (mode->mode == GCRY_CIPHER_MODE_XTS)
+    keylen *= 2;  /* XTS uses a data key and a tweak key.  */
   if (keylen)
     {
       char key[keylen];
@@ -1165,6 +1171,8 @@ static struct bench_cipher_mode cipher_modes[] = {
   {GCRY_CIPHER_MODE_OFB, "OFB dec", &decrypt_ops},
   {GCRY_CIPHER_MODE_CTR, "CTR enc", &encrypt_ops},
   {GCRY_CIPHER_MODE_CTR, "CTR dec", &decrypt_ops},
+  {GCRY_CIPHER_MODE_XTS, "XTS enc", &encrypt_ops},
+  {GCRY_CIPHER_MODE_XTS, "XTS dec", &decrypt_ops},
   {GCRY_CIPHER_MODE_CCM, "CCM enc", &ccm_encrypt_ops},
   {GCRY_CIPHER_MODE_CCM, "CCM dec", &ccm_decrypt_ops},
   {GCRY_CIPHER_MODE_CCM, "CCM auth", &ccm_authenticate_ops},
@@ -1222,6 +1230,10 @@ cipher_bench_one (int algo, struct bench_cipher_mode *pmode)
   if (mode.mode == GCRY_CIPHER_MODE_OCB && blklen != 16)
     return;
 
+  /* XTS has restrictions for block-size */
+  if (mode.mode == GCRY_CIPHER_MODE_XTS && blklen != GCRY_XTS_BLOCK_LEN)
+    return;
+
   bench_print_mode (14, mode.name);
 
   obj.ops = mode.ops;
@@ -1342,6 +1354,76 @@ static struct bench_hash_mode hash_modes[] = {
 };
 
 
+/* Number of messages passed to gcry_md_hash_buffer_batch at once.  The
+   buffer is split evenly between them.  */
+#define HASH_BATCH_N 32
+
+struct bench_hash_batch
+{
+  int algo;
+  unsigned char digests[HASH_BATCH_N][64];
+};
+
+static int
+bench_hash_batch_init (struct bench_obj *obj)
+{
+  struct bench_hash_mode *mode = obj->priv;
+  struct bench_hash_batch *batch;
+
+  /* Scale the buffer so that each message spans the usual range.  */
+  obj->min_bufsize = BUF_START_SIZE * HASH_BATCH_N;
+  obj->max_bufsize = BUF_END_SIZE * HASH_BATCH_N;
+  obj->step_size = BUF_STEP_SIZE * HASH_BATCH_N;
+  obj->num_measure_repetitions = num_measurement_repetitions;
+
+  batch = calloc (1, sizeof *batch);
+  if (!batch)
+    {
+      fprintf (stderr, PGM ": couldn't allocate digest buffers\n");
+      exit (1);
+    }
+  batch->algo = mode->algo;
+
+  obj->priv = batch;
+  return 0;
+}
+
+static void
+bench_hash_batch_free (struct bench_obj *obj)
+{
+  free (obj->priv);
+}
+
+static void
+bench_hash_batch_do_bench (struct bench_obj *obj, void *buf, size_t buflen)
+{
+  struct bench_hash_batch *batch = obj->priv;
+  const void *bufs[HASH_BATCH_N];
+  size_t buflens[HASH_BATCH_N];
+  void *digests[HASH_BATCH_N];
+  size_t msglen;
+  int i;
+
+  msglen = buflen / HASH_BATCH_N;
+  for (i = 0; i < HASH_BATCH_N; i++)
+    {
+      bufs[i] = (char *)buf + i * msglen;
+      buflens[i] = msglen;
+      digests[i] = batch->digests[i];
+    }
+  buflens[HASH_BATCH_N - 1] += buflen % HASH_BATCH_N;
+
+  gcry_md_hash_buffer_batch (batch->algo, digests, bufs, buflens,
+                             HASH_BATCH_N);
+}
+
+static struct bench_ops hash_batch_ops = {
+  &bench_hash_batch_init,
+  &bench_hash_batch_free,
+  &bench_hash_batch_do_bench
+};
+
+
 static void
 hash_bench_one (int algo, struct bench_hash_mode *pmode)
 {
@@ -1373,6 +1455,21 @@ _hash_bench (int algo)
     hash_bench_one (algo, &hash_modes[i]);
 }
 
+static void
+_hash_batch_bench (int algo)
+{
+  struct bench_hash_mode mode = { "", &hash_batch_ops };
+
+  /* Only SHA-1, SHA-2/256 and SHA-3 hash several messages in parallel.  */
+  if (algo != GCRY_MD_SHA1 && algo != GCRY_MD_SHA224
+      && algo != GCRY_MD_SHA256 && algo != GCRY_MD_SHA3_224
+      && algo != GCRY_MD_SHA3_256 && algo != GCRY_MD_SHA3_384
+      && algo != GCRY_MD_SHA3_512)
+    return;
+
+  hash_bench_one (algo, &mode);
+}
+
 void
 hash_bench (char **argv, int argc)
 {
@@ -1398,6 +1495,27 @@ hash_bench (char **argv, int argc)
     }
 
   bench_print_footer (14);
+
+  bench_print_section ("hash_batch", "Hash batch");
+  bench_print_header (14, "");
+
+  if (argv && argc)
+    {
+      for (i = 0; i < argc; i++)
+	{
+	  algo = gcry_md_map_name (argv[i]);
+	  if (algo)
+	    _hash_batch_bench (algo);
+	}
+    }
+  else
+    {
+      for (i = 1; i < 400; i++)
+	if (!gcry_md_test_algo (i))
+	  _hash_batch_bench (i);
+    }
+
+  bench_print_footer (14);
 }
 
 
@@ -1508,6 +1626,107 @@ static struct bench_mac_mode mac_modes[] = {
 };
 
 
+/* Number of messages passed to gcry_mac_write_batch at once.  The
+   buffer is split evenly between them.  */
+#define MAC_BATCH_N 32
+
+static int
+bench_mac_batch_init (struct bench_obj *obj)
+{
+  struct bench_mac_mode *mode = obj->priv;
+  gcry_mac_hd_t *hds;
+  int err;
+  unsigned int keylen;
+  unsigned char key[64];
+  int i;
+
+  obj->min_bufsize = BUF_START_SIZE;
+  obj->max_bufsize = BUF_END_SIZE;
+  obj->step_size = BUF_STEP_SIZE;
+  obj->num_measure_repetitions = num_measurement_repetitions;
+
+  keylen = gcry_mac_get_algo_keylen (mode->algo);
+  if (keylen == 0 || keylen > sizeof key)
+    keylen = 32;
+
+  hds = calloc (MAC_BATCH_N, sizeof *hds);
+  if (!hds)
+    {
+      fprintf (stderr, PGM ": couldn't allocate %d handles\n", MAC_BATCH_N);
+      exit (1);
+    }
+
+  for (i = 0; i < MAC_BATCH_N; i++)
+    {
+      err = gcry_mac_open (&hds[i], mode->algo, 0, NULL);
+      if (err)
+        {
+          fprintf (stderr, PGM ": error opening mac `%s'\n",
+                   gcry_mac_algo_name (mode->algo));
+          exit (1);
+        }
+
+      /* Every message has its own key.  */
+      memset (key, 42 + i, keylen);
+      err = gcry_mac_setkey (hds[i], key, keylen);
+      if (err)
+        {
+          fprintf (stderr, PGM ": error setting key for mac `%s'\n",
+                   gcry_mac_algo_name (mode->algo));
+          exit (1);
+        }
+    }
+
+  obj->priv = hds;
+  return 0;
+}
+
+static void
+bench_mac_batch_free (struct bench_obj *obj)
+{
+  gcry_mac_hd_t *hds = obj->priv;
+  int i;
+
+  for (i = 0; i < MAC_BATCH_N; i++)
+    gcry_mac_close (hds[i]);
+  free (hds);
+}
+
+static void
+bench_mac_batch_do_bench (struct bench_obj *obj, void *buf, size_t buflen)
+{
+  gcry_mac_hd_t *hds = obj->priv;
+  const void *bufs[MAC_BATCH_N];
+  size_t buflens[MAC_BATCH_N];
+  size_t bs, msglen;
+  char b;
+  int i;
+
+  msglen = buflen / MAC_BATCH_N;
+  for (i = 0; i < MAC_BATCH_N; i++)
+    {
+      gcry_mac_reset (hds[i]);
+      bufs[i] = (char *)buf + i * msglen;
+      buflens[i] = msglen;
+    }
+  buflens[MAC_BATCH_N - 1] += buflen % MAC_BATCH_N;
+
+  gcry_mac_write_batch (hds, bufs, buflens, MAC_BATCH_N, NULL);
+
+  for (i = 0; i < MAC_BATCH_N; i++)
+    {
+      bs = sizeof(b);
+      gcry_mac_read (hds[i], &b, &bs);
+    }
+}
+
+static struct bench_ops mac_batch_ops = {
+  &bench_mac_batch_init,
+  &bench_mac_batch_free,
+  &bench_mac_batch_do_bench
+};
+
+
 static void
 mac_bench_one (int algo, struct bench_mac_mode *pmode)
 {
@@ -1539,6 +1758,18 @@ _mac_bench (int algo)
     mac_bench_one (algo, &mac_modes[i]);
 }
 
+static void
+_mac_batch_bench (int algo)
+{
+  struct bench_mac_mode mode = { "", &mac_batch_ops };
+
+  /* Only CMAC processes several messages side by side.  */
+  if (strncmp (gcry_mac_algo_name (algo), "CMAC_", 5))
+    return;
+
+  mac_bench_one (algo, &mode);
+}
+
 void
 mac_bench (char **argv, int argc)
 {
@@ -1564,6 +1795,27 @@ mac_bench (char **argv, int argc)
     }
 
   bench_print_footer (18);
+
+  bench_print_section ("mac_batch", "MAC batch");
+  bench_print_header (18, "");
+
+  if (argv && argc)
+    {
+      for (i = 0; i < argc; i++)
+	{
+	  algo = gcry_mac_map_name (argv[i]);
+	  if (algo)
+	    _mac_batch_bench (algo);
+	}
+    }
+  else
+    {
+      for (i = 1; i < 600; i++)
+	if (!gcry_mac_test_algo (i))
+	  _mac_batch_bench (i);
+    }
+
+  bench_print_footer (18);
 }
 
 
@@ -1746,9 +1998,11 @@ print_help (void)
     "",
     " options:",
     "   --cpu-mhz <mhz>           Set CPU speed for calculating cycles",
-    "                             per bytes results.",
+    "                             per bytes results.  Use \"auto\" to",
+    "                             estimate the speed at startup.",
     "   --disable-hwf <features>  Disable hardware acceleration feature(s)",
-    "                             for benchmarking.",
+    "                             for benchmarking.  May be given several",
+    "                             times to compare the implementations.",
     "   --repetitions <n>         Use N repetitions (default "
                                      STR2(NUM_MEASUREMENT_REPETITIONS) ")",
     "   --csv                     Use CSV output format",
@@ -1776,6 +2030,106 @@ warm_up_cpu (void)
 }
 
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/* Run LOOPS iterations of 16 dependent additions.  Each addition has
+   a latency of one cycle on all x86 CPUs.  */
+static void
+auto_ghz_bench (unsigned int loops)
+{
+  unsigned int x = 0;
+
+  while (loops--)
+    {
+#define ADD4 "addl %1, %0\n\t" "addl %1, %0\n\t" \
+             "addl %1, %0\n\t" "addl %1, %0\n\t"
+      asm volatile (ADD4 ADD4 ADD4 ADD4 : "+r" (x) : "r" (loops));
+#undef ADD4
+    }
+}
+
+/* Estimate the CPU speed in Ghz.  The fastest of several runs is used
+   to filter out interrupts and frequency changes.  */
+static double
+get_auto_ghz (void)
+{
+  const unsigned int loops = 16 * 1024;
+  struct nsec_time start, end;
+  double nsecs, min_nsecs = 0.0;
+  int rep;
+
+  for (rep = 0; rep < 64; rep++)
+    {
+      get_nsec_time (&start);
+      auto_ghz_bench (loops);
+      get_nsec_time (&end);
+
+      nsecs = get_time_nsec_diff (&start, &end);
+      if (rep == 0 || nsecs < min_nsecs)
+        min_nsecs = nsecs;
+    }
+
+  return (loops * 16.0) / min_nsecs;
+}
+#else
+static double
+get_auto_ghz (void)
+{
+  fprintf (stderr, PGM ": --cpu-mhz auto not supported on this platform\n");
+  return -1;
+}
+#endif
+
+
+/* Print the hardware features used by Libgcrypt, so that the results
+   of runs with different --disable-hwf options can be told apart.
+   Only done with --verbose.  */
+static void
+print_hw_features (void)
+{
+  char line[512];
+  char *p;
+  FILE *fp;
+
+  fp = tmpfile ();
+  if (!fp)
+    return;
+
+  gcry_control (GCRYCTL_PRINT_CONFIG, fp);
+  rewind (fp);
+  while (fgets (line, sizeof line, fp))
+    {
+      if (strncmp (line, "hwflist:", 8))
+        continue;
+
+      for (p = line + 8; *p; p++)
+        if (*p == ':' || *p == '\n')
+          *p = ' ';
+      while (p > line + 8 && p[-1] == ' ')
+        *--p = 0;
+      printf ("Hardware features: %s\n", line + 8);
+      break;
+    }
+
+  fclose (fp);
+}
+
+
+/* Warm up CPU and, if requested, detect its speed.  */
+static void
+prepare_cpu (void)
+{
+  warm_up_cpu ();
+
+  if (auto_ghz)
+    {
+      cpu_ghz = get_auto_ghz ();
+      if (verbose && cpu_ghz > 0.0)
+        fprintf (stderr, PGM ": detected CPU speed %.0f Mhz\n",
+                 cpu_ghz * 1000);
+    }
+}
+
+
 int
 main (int argc, char **argv)
 {
@@ -1856,8 +2210,13 @@ main (int argc, char **argv)
 	  argv++;
 	  if (argc)
 	    {
-	      cpu_ghz = atof (*argv);
-	      cpu_ghz /= 1000;	/* Mhz => Ghz */
+	      if (!strcmp (*argv, "auto"))
+		auto_ghz = 1;
+	      else
+		{
+		  cpu_ghz = atof (*argv);
+		  cpu_ghz /= 1000;	/* Mhz => Ghz */
+		}
 
 	      argc--;
 	      argv++;
@@ -1903,9 +2262,12 @@ main (int argc, char **argv)
   if (in_regression_test)
     fputs ("Note: " PGM " running in quick regression test mode.\n", stdout);
 
+  if (verbose && !csv_mode)
+    print_hw_features ();
+
   if (!argc)
     {
-      warm_up_cpu ();
+      prepare_cpu ();
       hash_bench (NULL, 0);
       mac_bench (NULL, 0);
       cipher_bench (NULL, 0);
@@ -1916,7 +2278,7 @@ main (int argc, char **argv)
       argc--;
       argv++;
 
-      warm_up_cpu ();
+      prepare_cpu ();
       hash_bench ((argc == 0) ? NULL : argv, argc);
     }
   else if (!strcmp (*argv, "mac"))
@@ -1924,7 +2286,7 @@ main (int argc, char **argv)
       argc--;
       argv++;
 
-      warm_up_cpu ();
+      prepare_cpu ();
       mac_bench ((argc == 0) ? NULL : argv, argc);
     }
   else if (!strcmp (*argv, "cipher"))
@@ -1932,7 +2294,7 @@ main (int argc, char **argv)
       argc--;
       argv++;
 
-      warm_up_cpu ();
+      prepare_cpu ();
       cipher_bench ((argc == 0) ? NULL : argv, argc);
     }
   else if (!strcmp (*argv, "kdf"))
@@ -1940,7 +2302,7 @@ main (int argc, char **argv)
       argc--;
       argv++;
 
-      warm_up_cpu ();
+      prepare_cpu ();
       kdf_bench ((argc == 0) ? NULL : argv, argc);
     }
   else
@@ -1588,6 +1588,36 @@ do_powm ( const char *n_str, const char *e_str, const char *m_str)
 }
 
 
+/* Time exponentiations with an exponent of the size of the modulus
+   as used with secret exponents.  The modulus is made odd.  */
+static void
+do_powm_sec ( const char *n_str, const char *m_str)
+{
+  gcry_mpi_t n, msg, cip;
+  gcry_error_t err;
+  int i;
+
+  err = gcry_mpi_scan (&n, GCRYMPI_FMT_HEX, n_str, 0, 0);
+  if (err) BUG ();
+  err = gcry_mpi_scan (&msg, GCRYMPI_FMT_HEX, m_str, 0, 0);
+  if (err) BUG ();
+  gcry_mpi_set_bit (n, 0);
+  gcry_mpi_mod (msg, msg, n);
+
+  cip = gcry_mpi_new (0);
+
+  start_timer ();
+  for (i=0; i < 100; i++)
+    gcry_mpi_powm (cip, msg, msg, n);
+  stop_timer ();
+  printf (" %s", elapsed_time (1)); fflush (stdout);
+
+  gcry_mpi_release (cip);
+  gcry_mpi_release (msg);
+  gcry_mpi_release (n);
+}
+
+
 static void
 mpi_bench (void)
 {
@@ -1611,7 +1641,21 @@ mpi_bench (void)
 
   putchar ('\n');
 
-
+  /* The exponentiation with a secret exponent as used for RSA.  */
+  printf ("%-10s", "powm-sec"); fflush (stdout);
+  do_powm_sec (
+"20A94417D4D5EF2B2DA99165C7DC87DADB3979B72961AF90D09D59BA24CB9A10166FDCCC9C659F2B9626EC23F3FA425F564A072BA941B03FA81767CC289E4",
+"B870187A323F1ECD5B8A0B4249507335A1C4CE8394F38FD76B08C78A42C58F6EA136ACF90DFE8603697B1694A3D81114D6117AC1811979C51C4DD013D52F8"
+               );
+  do_powm_sec (
+"20A94417D4D5EF2B2DA99165C7DC87DADB3979B72961AF90D09D59BA24CB9A10166FDCCC9C659F2B9626EC23F3FA425F564A072BA941B03FA81767CC289E41071F0246879A442658FBD18C1771571E7073EEEB2160BA0CBFB3404D627069A6CFBD53867AD2D9D40231648000787B5C84176B4336144644AE71A403CA40716",
+"B870187A323F1ECD5B8A0B4249507335A1C4CE8394F38FD76B08C78A42C58F6EA136ACF90DFE8603697B1694A3D81114D6117AC1811979C51C4DD013D52F8FC4EE4BB446B83E48ABED7DB81CBF5E81DE4759E8D68AC985846D999F96B0D8A80E5C69D272C766AB8A23B40D50A4FA889FBC2BD2624222D8EB297F4BAEF8593847"
+               );
+  do_powm_sec (
+"20A94417D4D5EF2B2DA99165C7DC87DADB3979B72961AF90D09D59BA24CB9A10166FDCCC9C659F2B9626EC23F3FA425F564A072BA941B03FA81767CC289E41071F0246879A442658FBD18C1771571E7073EEEB2160BA0CBFB3404D627069A6CFBD53867AD2D9D40231648000787B5C84176B4336144644AE71A403CA4071620A94417D4D5EF2B2DA99165C7DC87DADB3979B72961AF90D09D59BA24CB9A10166FDCCC9C659F2B9626EC23F3FA425F564A072BA941B03FA81767CC289E41071F0246879A442658FBD18C1771571E7073EEEB2160BA0CBFB3404D627069A6CFBD53867AD2D9D40231648000787B5C84176B4336144644AE71A403CA40716",
+"B870187A323F1ECD5B8A0B4249507335A1C4CE8394F38FD76B08C78A42C58F6EA136ACF90DFE8603697B1694A3D81114D6117AC1811979C51C4DD013D52F8FC4EE4BB446B83E48ABED7DB81CBF5E81DE4759E8D68AC985846D999F96B0D8A80E5C69D272C766AB8A23B40D50A4FA889FBC2BD2624222D8EB297F4BAEF8593847B870187A323F1ECD5B8A0B4249507335A1C4CE8394F38FD76B08C78A42C58F6EA136ACF90DFE8603697B1694A3D81114D6117AC1811979C51C4DD013D52F8FC4EE4BB446B83E48ABED7DB81CBF5E81DE4759E8D68AC985846D999F96B0D8A80E5C69D272C766AB8A23B40D50A4FA889FBC2BD2624222D8EB297F4BAEF8593847"
+               );
+  putchar ('\n');
 }
 
 
@@ -40,6 +40,7 @@
 static int verbose;
 static int debug;
 static int error_count;
+static unsigned int loops = 10;
 
 
 typedef struct context
@@ -135,11 +136,14 @@ read_file (const char *fname, size_t *r_length)
 
 
 
-static void
-benchmark (work_t worker, context_t context)
+/* Run WORKER LOOPS times and store the average time per run in
+   milliseconds at R_MS.  Returns false if the operation is not
+   supported.  */
+static int
+run_worker (work_t worker, context_t context, double *r_ms)
 {
   clock_t timer_start, timer_stop;
-  unsigned int loop = 10;
+  unsigned int loop = loops;
   unsigned int i = 0;
   struct tms timer;
   int ret = 0;
@@ -163,10 +167,18 @@ benchmark (work_t worker, context_t context)
   timer_stop = timer.tms_utime;
 #endif
 
-  if (ret)
-    printf ("%.0f ms\n",
-	    (((double) ((timer_stop - timer_start) / loop)) / CLOCKS_PER_SEC)
-	    * 10000000);
+  *r_ms = (((double) (timer_stop - timer_start) / loop) / CLOCKS_PER_SEC)
+          * 10000000;
+  return ret;
+}
+
+static void
+benchmark (work_t worker, context_t context)
+{
+  double ms;
+
+  if (run_worker (worker, context, &ms))
+    printf ("%.0f ms\n", ms);
   else
     printf ("[skipped]\n");
 }
@@ -378,6 +390,209 @@ process_key_pair_file (const char *key_pair_file)
 }
 
 
+/* Generate a key pair for each of the NIST curves and run the
+   benchmarks on them.  */
+static void
+process_nist_curves (void)
+{
+  static const char *curves[] =
+    { "NIST P-192", "NIST P-224", "NIST P-256", "NIST P-384", "NIST P-521",
+      NULL };
+  gcry_error_t err = GPG_ERR_NO_ERROR;
+  gcry_sexp_t key_spec = NULL;
+  gcry_sexp_t key_pair = NULL;
+  gcry_sexp_t key_secret_sexp = NULL;
+  gcry_sexp_t key_public_sexp = NULL;
+  struct context context = { NULL };
+  int i;
+
+  for (i = 0; curves[i]; i++)
+    {
+      err = gcry_sexp_build (&key_spec, NULL,
+                             "(genkey (ecc (curve %s)))", curves[i]);
+      if (err)
+        die ("sexp_build failed: %s\n", gpg_strerror (err));
+
+      err = gcry_pk_genkey (&key_pair, key_spec);
+      gcry_sexp_release (key_spec);
+      if (err)
+        {
+          printf ("Curve: %s [skipped: %s]\n\n",
+                  curves[i], gpg_strerror (err));
+          continue;
+        }
+
+      key_secret_sexp = gcry_sexp_find_token (key_pair, "private-key", 0);
+      assert (key_secret_sexp);
+      key_public_sexp = gcry_sexp_find_token (key_pair, "public-key", 0);
+      assert (key_public_sexp);
+      gcry_sexp_release (key_pair);
+
+      context_init (&context, key_secret_sexp, key_public_sexp);
+
+      printf ("Curve: %s\n", curves[i]);
+      process_key_pair (&context);
+      printf ("\n");
+
+      context_destroy (&context);
+    }
+}
+
+
+/* Signatures for work_verify_batch.  */
+#define VERIFY_BATCH_SIZE 64
+static gcry_sexp_t batch_sigs[VERIFY_BATCH_SIZE];
+static gcry_sexp_t batch_data[VERIFY_BATCH_SIZE];
+static gcry_sexp_t batch_keys[VERIFY_BATCH_SIZE];
+
+static int
+work_verify_batch (context_t context, unsigned int final)
+{
+  gcry_error_t err;
+
+  (void)context;
+  (void)final;
+  err = gcry_pk_verify_batch (batch_sigs, batch_data, batch_keys,
+                              VERIFY_BATCH_SIZE, NULL);
+  if (err)
+    {
+      fail ("pk_verify_batch failed: %s\n", gpg_strerror (err));
+      return 0;
+    }
+  return 1;
+}
+
+/* Measure gcry_pk_verify_batch with VERIFY_BATCH_SIZE signatures
+   over random messages made with the key from CONTEXT.  */
+static void
+process_verify_batch (context_t context, const char *name,
+                      const char *datafmt)
+{
+  gcry_error_t err;
+  unsigned char message[32];
+  unsigned int saved_loops = loops;
+  double ms;
+  int i;
+
+  for (i = 0; i < VERIFY_BATCH_SIZE; i++)
+    {
+      gcry_randomize (message, sizeof message, GCRY_WEAK_RANDOM);
+      err = gcry_sexp_build (&batch_data[i], NULL, datafmt,
+                             (int)sizeof message, message);
+      if (!err)
+        err = gcry_pk_sign (&batch_sigs[i], batch_data[i],
+                            context->key_secret);
+      if (err)
+        die ("signing failed: %s\n", gpg_strerror (err));
+      batch_keys[i] = context->key_public;
+    }
+
+  loops = loops / VERIFY_BATCH_SIZE;
+  if (!loops)
+    loops = 1;
+  printf ("%-14s batch%d: ", name, VERIFY_BATCH_SIZE);
+  fflush (stdout);
+  if (!run_worker (work_verify_batch, context, &ms))
+    printf ("[skipped]\n");
+  else if (ms > 0)
+    {
+      ms /= VERIFY_BATCH_SIZE;
+      printf ("%.3f ms  %8.1f ops/s\n", ms, 1000.0 / ms);
+    }
+  else
+    printf ("[too fast; increase --loops]\n");
+  loops = saved_loops;
+
+  for (i = 0; i < VERIFY_BATCH_SIZE; i++)
+    {
+      gcry_sexp_release (batch_sigs[i]);
+      gcry_sexp_release (batch_data[i]);
+    }
+}
+
+
+/* Sign a random message once for a set of curves and measure the
+   verification speed.  */
+static void
+process_verify (void)
+{
+  static const struct
+  {
+    const char *name;
+    const char *keyparms;
+    const char *datafmt;
+    int batch;
+  } curves[] =
+    {
+      { "NIST P-256", "(genkey (ecc (curve \"NIST P-256\")))",
+        "(data (flags raw) (value %b))" },
+      { "NIST P-384", "(genkey (ecc (curve \"NIST P-384\")))",
+        "(data (flags raw) (value %b))" },
+      { "NIST P-521", "(genkey (ecc (curve \"NIST P-521\")))",
+        "(data (flags raw) (value %b))" },
+      { "Ed25519", "(genkey (ecc (curve Ed25519) (flags eddsa)))",
+        "(data (flags eddsa) (hash-algo sha512) (value %b))", 1 },
+      { "GOST2001-test", "(genkey (ecc (curve GOST2001-test)))",
+        "(data (flags gost) (value %b))" },
+      { NULL }
+    };
+  gcry_error_t err = GPG_ERR_NO_ERROR;
+  gcry_sexp_t key_spec = NULL;
+  gcry_sexp_t key_pair = NULL;
+  gcry_sexp_t key_secret_sexp = NULL;
+  gcry_sexp_t key_public_sexp = NULL;
+  struct context context = { NULL };
+  unsigned char message[32];
+  double ms;
+  int i;
+
+  for (i = 0; curves[i].name; i++)
+    {
+      err = gcry_sexp_new (&key_spec, curves[i].keyparms, 0, 1);
+      if (err)
+        die ("sexp_new failed: %s\n", gpg_strerror (err));
+
+      err = gcry_pk_genkey (&key_pair, key_spec);
+      gcry_sexp_release (key_spec);
+      if (err)
+        {
+          printf ("%-14s [skipped: %s]\n", curves[i].name, gpg_strerror (err));
+          continue;
+        }
+
+      key_secret_sexp = gcry_sexp_find_token (key_pair, "private-key", 0);
+      assert (key_secret_sexp);
+      key_public_sexp = gcry_sexp_find_token (key_pair, "public-key", 0);
+      assert (key_public_sexp);
+      gcry_sexp_release (key_pair);
+
+      context_init (&context, key_secret_sexp, key_public_sexp);
+      gcry_sexp_release (context.data);
+      gcry_randomize (message, sizeof message, GCRY_WEAK_RANDOM);
+      err = gcry_sexp_build (&context.data, NULL, curves[i].datafmt,
+                             (int)sizeof message, message);
+      if (err)
+        die ("sexp_build failed: %s\n", gpg_strerror (err));
+
+      printf ("%-14s verify: ", curves[i].name);
+      fflush (stdout);
+      if (!work_sign (&context, 1)
+          || !run_worker (work_verify, &context, &ms))
+        printf ("[skipped]\n");
+      else if (ms > 0)
+        printf ("%.3f ms  %8.1f ops/s\n", ms, 1000.0 / ms);
+      else
+        printf ("[too fast; increase --loops]\n");
+      if (curves[i].batch)
+        process_verify_batch (&context, curves[i].name, curves[i].datafmt);
+
+      gcry_sexp_release (context.data_signed);
+      context.data_signed = NULL;
+      context_destroy (&context);
+    }
+}
+
+
 static void
 generate_key (const char *algorithm, const char *key_size)
 {
@@ -423,6 +638,9 @@ main (int argc, char **argv)
 {
   int last_argc = -1;
   int genkey_mode = 0;
+  int curves_mode = 0;
+  int verify_mode = 0;
+  int loops_given = 0;
   int fips_mode = 0;
 
   if (argc)
@@ -442,6 +660,10 @@ main (int argc, char **argv)
                 "Various public key tests:\n\n"
                 "  Default is to process all given key files\n\n"
                 "  --genkey ALGONAME SIZE  Generate a public key\n"
+                "  --nist-curves  benchmark the NIST curves\n"
+                "  --verify     benchmark ECC signature verification\n"
+                "  --loops N    run each operation N times (default 10,\n"
+                "               1000 with --verify)\n"
                 "\n"
                 "  --verbose    enable extra informational output\n"
                 "  --debug      enable additional debug output\n"
@@ -463,6 +685,28 @@ main (int argc, char **argv)
           genkey_mode = 1;
           argc--; argv++;
         }
+      else if (!strcmp (*argv, "--loops"))
+        {
+          argc--; argv++;
+          if (argc)
+            {
+              loops = atoi (*argv);
+              if (!loops)
+                loops = 1;
+              loops_given = 1;
+              argc--; argv++;
+            }
+        }
+      else if (!strcmp (*argv, "--nist-curves"))
+        {
+          curves_mode = 1;
+          argc--; argv++;
+        }
+      else if (!strcmp (*argv, "--verify"))
+        {
+          verify_mode = 1;
+          argc--; argv++;
+        }
       else if (!strcmp (*argv, "--fips"))
         {
           fips_mode = 1;
@@ -482,7 +726,10 @@ main (int argc, char **argv)
       exit (1);
     }
 
-  if (genkey_mode)
+  if (verify_mode && !loops_given)
+    loops = 1000;
+
+  if (genkey_mode || curves_mode || verify_mode)
     {
       /* No valuable keys are create, so we can speed up our RNG. */
       gcry_control (GCRYCTL_ENABLE_QUICK_RANDOM, 0);
@@ -496,6 +743,14 @@ main (int argc, char **argv)
     {
       generate_key (argv[0], argv[1]);
     }
+  else if (curves_mode)
+    {
+      process_nist_curves ();
+    }
+  else if (verify_mode)
+    {
+      process_verify ();
+    }
   else if (!genkey_mode && argc)
     {
       int i;
@@ -100,6 +100,59 @@ static const char sample_private_key_1_2[] =
 " )\n"
 ")\n";
 
+/* The same key as above but with the CRT exponents d mod (p-1) and
+   d mod (q-1).  */
+static const char sample_private_key_1_3[] =
+"(private-key\n"
+" (openpgp-rsa\n"
+"  (n #00e0ce96f90b6c9e02f3922beada93fe50a875eac6bcc18bb9a9cf2e84965caa"
+      "2d1ff95a7f542465c6c0c19d276e4526ce048868a7a914fd343cc3a87dd74291"
+      "ffc565506d5bbb25cbac6a0e2dd1f8bcaab0d4a29c2f37c950f363484bf269f7"
+      "891440464baf79827e03a36e70b814938eebdc63e964247be75dc58b014b7ea251#)\n"
+"  (e #010001#)\n"
+"  (d #046129F2489D71579BE0A75FE029BD6CDB574EBF57EA8A5B0FDA942CAB943B11"
+      "7D7BB95E5D28875E0F9FC5FCC06A72F6D502464DABDED78EF6B716177B83D5BD"
+      "C543DC5D3FED932E59F5897E92E6F58A0F33424106A3B6FA2CBF877510E4AC21"
+      "C3EE47851E97D12996222AC3566D4CCB0B83D164074ABF7DE655FC2446DA1781#)\n"
+"  (p #00e861b700e17e8afe6837e7512e35b6ca11d0ae47d8b85161c67baf64377213"
+      "fe52d772f2035b3ca830af41d8a4120e1c1c70d12cc22f00d28d31dd48a8d424f1#)\n"
+"  (q #00f7a7ca5367c661f8e62df34f0d05c10c88e5492348dd7bddc942c9a8f369f9"
+      "35a07785d2db805215ed786e4285df1658eed3ce84f469b81b50d358407b4ad361#)\n"
+"  (u #304559a9ead56d2309d203811a641bb1a09626bc8eb36fffa23c968ec5bd891e"
+      "ebbafc73ae666e01ba7c8990bae06cc2bbe10b75e69fcacb353a6473079d8e9b#)\n"
+"  (dp #2c179654a9748c44f75b5c1db029eaf3ee6b6d161ecde24b2e10fbd78519b527"
+      "756a81d9dfbf290434b09c4ad1dec7249854e3ab9d70b3b43fac2d7382ed35d1#)\n"
+"  (dq #08b7c45c8943a7813e8111968fcbcb0ee8e6c15b579e4c54f357c1878c0207fe"
+      "c6464ed4ac5b69085292b1b6efc579a0e9cf54eec337d17e4cab13e9392dda21#)\n"
+" )\n"
+")\n";
+
+/* The same key as above but with a wrong value for dp.  */
+static const char sample_private_key_1_4[] =
+"(private-key\n"
+" (openpgp-rsa\n"
+"  (n #00e0ce96f90b6c9e02f3922beada93fe50a875eac6bcc18bb9a9cf2e84965caa"
+      "2d1ff95a7f542465c6c0c19d276e4526ce048868a7a914fd343cc3a87dd74291"
+      "ffc565506d5bbb25cbac6a0e2dd1f8bcaab0d4a29c2f37c950f363484bf269f7"
+      "891440464baf79827e03a36e70b814938eebdc63e964247be75dc58b014b7ea251#)\n"
+"  (e #010001#)\n"
+"  (d #046129F2489D71579BE0A75FE029BD6CDB574EBF57EA8A5B0FDA942CAB943B11"
+      "7D7BB95E5D28875E0F9FC5FCC06A72F6D502464DABDED78EF6B716177B83D5BD"
+      "C543DC5D3FED932E59F5897E92E6F58A0F33424106A3B6FA2CBF877510E4AC21"
+      "C3EE47851E97D12996222AC3566D4CCB0B83D164074ABF7DE655FC2446DA1781#)\n"
+"  (p #00e861b700e17e8afe6837e7512e35b6ca11d0ae47d8b85161c67baf64377213"
+      "fe52d772f2035b3ca830af41d8a4120e1c1c70d12cc22f00d28d31dd48a8d424f1#)\n"
+"  (q #00f7a7ca5367c661f8e62df34f0d05c10c88e5492348dd7bddc942c9a8f369f9"
+      "35a07785d2db805215ed786e4285df1658eed3ce84f469b81b50d358407b4ad361#)\n"
+"  (u #304559a9ead56d2309d203811a641bb1a09626bc8eb36fffa23c968ec5bd891e"
+      "ebbafc73ae666e01ba7c8990bae06cc2bbe10b75e69fcacb353a6473079d8e9b#)\n"
+"  (dp #2c179654a9748c44f75b5c1db029eaf3ee6b6d161ecde24b2e10fbd78519b527"
+      "756a81d9dfbf290434b09c4ad1dec7249854e3ab9d70b3b43fac2d7382ed35d3#)\n"
+"  (dq #08b7c45c8943a7813e8111968fcbcb0ee8e6c15b579e4c54f357c1878c0207fe"
+      "c6464ed4ac5b69085292b1b6efc579a0e9cf54eec337d17e4cab13e9392dda21#)\n"
+" )\n"
+")\n";
+
 static const char sample_public_key_1[] =
 "(public-key\n"
 " (rsa\n"
@@ -360,6 +413,8 @@ get_keys_sample (gcry_sexp_t *pkey, gcry_sexp_t *skey, int secret_variant)
     case 0: secret = sample_private_key_1; break;
     case 1: secret = sample_private_key_1_1; break;
     case 2: secret = sample_private_key_1_2; break;
+    case 3: secret = sample_private_key_1_3; break;
+    case 4: secret = sample_private_key_1_4; break;
     default: die ("BUG\n");
     }
 
@@ -675,18 +730,24 @@ check_run (void)
   gcry_sexp_t pkey, skey;
   int variant;
 
-  for (variant=0; variant < 3; variant++)
+  for (variant=0; variant < 5; variant++)
     {
       if (verbose)
         fprintf (stderr, "Checking sample key (%d).\n", variant);
       get_keys_sample (&pkey, &skey, variant);
-      /* Check gcry_pk_testkey which requires all elements.  */
+      /* Check gcry_pk_testkey which requires all elements and
+         rejects the wrong CRT exponent of variant 4.  */
       err = gcry_pk_testkey (skey);
-      if ((variant == 0 && err)
-          || (variant > 0 && gpg_err_code (err) != GPG_ERR_NO_OBJ))
+      if (((variant == 0 || variant == 3) && err)
+          || ((variant == 1 || variant == 2)
+              && gpg_err_code (err) != GPG_ERR_NO_OBJ)
+          || (variant == 4 && gpg_err_code (err) != GPG_ERR_BAD_SECKEY))
           die ("gcry_pk_testkey failed: %s\n", gpg_strerror (err));
-      /* Run the usual check but expect an error from variant 2.  */
-      check_keys (pkey, skey, 800, variant == 2? GPG_ERR_NO_OBJ : 0);
+      /* Run the usual check but expect an error from variants 2
+         and 4.  */
+      check_keys (pkey, skey, 800,
+                  variant == 2? GPG_ERR_NO_OBJ :
+                  variant == 4? GPG_ERR_BAD_SECKEY : 0);
       gcry_sexp_release (pkey);
       gcry_sexp_release (skey);
     }
@@ -1069,6 +1130,12 @@ check_ecc_sample_key (void)
   if ((err = gcry_pk_verify (sig, hash, key)))
     die ("gcry_pk_verify failed: %s", gpg_strerror (err));
 
+  /* Verify again with a flushed curve cache.  */
+  if ((err = gcry_control (GCRYCTL_FLUSH_ECC_CACHE)))
+    die ("flushing the ECC cache failed: %s", gpg_strerror (err));
+  if ((err = gcry_pk_verify (sig, hash, key)))
+    die ("gcry_pk_verify failed: %s", gpg_strerror (err));
+
   /* Verify hash truncation */
   gcry_sexp_release (key);
   if ((err = gcry_sexp_new (&key, ecc_private_key, 0, 1)))
@@ -55,6 +55,13 @@ static int sign_with_pk;
 static int no_verify;
 static int custom_data_file;
 
+/* Signatures collected for the batch verification test.  */
+#define BATCH_SIZE 64
+static gcry_sexp_t batch_sig[BATCH_SIZE];
+static gcry_sexp_t batch_msg[BATCH_SIZE];
+static gcry_sexp_t batch_pk[BATCH_SIZE];
+static int batch_count;
+
 static void
 die (const char *format, ...)
 {
@@ -248,6 +255,267 @@ hexdowncase (char *string)
 }
 
 
+/* Verify the collected signatures with gcry_pk_verify_batch.  Then
+   swap two messages and check that exactly those two signatures are
+   reported as bad.  */
+static void
+check_batch (void)
+{
+  gpg_error_t err;
+  gpg_error_t results[BATCH_SIZE];
+  gcry_sexp_t s_tmp;
+  int i;
+
+  if (!batch_count)
+    return;
+
+  err = gcry_pk_verify_batch (batch_sig, batch_msg, batch_pk, batch_count,
+                              results);
+  if (err)
+    fail ("gcry_pk_verify_batch failed: %s", gpg_strerror (err));
+  for (i = 0; i < batch_count; i++)
+    if (results[i])
+      fail ("gcry_pk_verify_batch failed for item %d: %s",
+            i, gpg_strerror (results[i]));
+
+  if (batch_count > 2)
+    {
+      s_tmp = batch_msg[0];
+      batch_msg[0] = batch_msg[1];
+      batch_msg[1] = s_tmp;
+      err = gcry_pk_verify_batch (batch_sig, batch_msg, batch_pk, batch_count,
+                                  results);
+      if (gpg_err_code (err) != GPG_ERR_BAD_SIGNATURE)
+        fail ("gcry_pk_verify_batch did not detect a bad signature: %s",
+              gpg_strerror (err));
+      for (i = 0; i < batch_count; i++)
+        if ((i < 2) != (gpg_err_code (results[i]) == GPG_ERR_BAD_SIGNATURE))
+          fail ("gcry_pk_verify_batch returned a wrong result for item %d: %s",
+                i, gpg_strerror (results[i]));
+    }
+
+  for (i = 0; i < batch_count; i++)
+    {
+      gcry_sexp_release (batch_sig[i]);
+      gcry_sexp_release (batch_msg[i]);
+      gcry_sexp_release (batch_pk[i]);
+    }
+  batch_count = 0;
+}
+
+
+/* Store A as a 32 byte little-endian number at BUF.  */
+static void
+mpi_to_le (unsigned char *buf, gcry_mpi_t a)
+{
+  unsigned char tmp[32];
+  size_t n, i;
+
+  memset (buf, 0, 32);
+  if (gcry_mpi_print (GCRYMPI_FMT_USG, tmp, sizeof tmp, &n, a))
+    die ("gcry_mpi_print failed\n");
+  for (i = 0; i < n; i++)
+    buf[i] = tmp[n - 1 - i];
+}
+
+
+/* Store the Ed25519 encoding of the point P at BUF.  */
+static void
+encode_point (unsigned char *buf, gcry_mpi_point_t p, gcry_ctx_t ctx)
+{
+  gcry_mpi_t x = gcry_mpi_new (0);
+  gcry_mpi_t y = gcry_mpi_new (0);
+
+  if (gcry_mpi_ec_get_affine (x, y, p, ctx))
+    die ("gcry_mpi_ec_get_affine failed\n");
+  mpi_to_le (buf, y);
+  if (gcry_mpi_test_bit (x, 0))
+    buf[31] |= 0x80;
+  gcry_mpi_release (x);
+  gcry_mpi_release (y);
+}
+
+
+/* Check gcry_pk_verify_batch with signatures whose R or public key
+   has a small order component.  All signatures have s = r + H(R,A,M)a
+   for the public key A = aG or aG + T2 and R = rG or rG + T2, where T2
+   is the point of order 2.  Thus they hold for the cofactored
+   equation but only some of them hold for the equation used by
+   gcry_pk_verify.  The batch function is documented to accept the
+   former and to accept at least all signatures which gcry_pk_verify
+   accepts.  The last signature has a wrong S and must be rejected by
+   both.  */
+#define N_TORSION 24
+static void
+check_batch_torsion (void)
+{
+  gpg_error_t err;
+  gcry_ctx_t ctx;
+  gcry_mpi_t n, p, a, r, s, h, tmp, zero;
+  gcry_mpi_point_t G, T2, A, R;
+  gcry_sexp_t s_sig[N_TORSION+1], s_msg[N_TORSION+1], s_pk[N_TORSION+1];
+  gpg_error_t expected[N_TORSION+1], results[N_TORSION+1];
+  unsigned char abuf[32], rbuf[32], sbuf[32], digest[64], hbuf[64];
+  char msg[32];
+  gcry_md_hd_t md;
+  int i, j, n_good;
+
+  if (verbose)
+    show ("Checking batch verification with small order points.\n");
+
+  err = gcry_mpi_ec_new (&ctx, NULL, "Ed25519");
+  if (err)
+    die ("gcry_mpi_ec_new failed: %s\n", gpg_strerror (err));
+  G = gcry_mpi_ec_get_point ("g", ctx, 1);
+  n = gcry_mpi_ec_get_mpi ("n", ctx, 1);
+  p = gcry_mpi_ec_get_mpi ("p", ctx, 1);
+  if (!G || !n || !p)
+    die ("error getting the Ed25519 parameters\n");
+
+  /* T2 = (0, p - 1) is the point of order 2.  */
+  zero = gcry_mpi_new (0);
+  tmp = gcry_mpi_new (0);
+  gcry_mpi_sub_ui (tmp, p, 1);
+  T2 = gcry_mpi_point_set (NULL, zero, tmp, GCRYMPI_CONST_ONE);
+
+  a = gcry_mpi_set_ui (NULL, 77);
+  r = gcry_mpi_new (0);
+  s = gcry_mpi_new (0);
+  h = gcry_mpi_new (0);
+  A = gcry_mpi_point_new (0);
+  R = gcry_mpi_point_new (0);
+
+  for (i = 0; i < N_TORSION + 1; i++)
+    {
+      snprintf (msg, sizeof msg, "torsion test %d", i);
+      gcry_mpi_set_ui (r, 1000 + i);
+      gcry_mpi_ec_mul (A, a, G, ctx);
+      switch (i % 3)
+        {
+        case 0:
+          /* R = rG + T2.  This never holds.  */
+          gcry_mpi_ec_mul (R, r, G, ctx);
+          gcry_mpi_ec_add (R, R, T2, ctx);
+          break;
+
+        case 1:
+          /* r = 0 and R is the neutral element, which holds, or T2,
+             which does not hold.  The decoder rejects both points.  */
+          gcry_mpi_set_ui (r, 0);
+          gcry_mpi_point_set (R, zero, GCRYMPI_CONST_ONE, GCRYMPI_CONST_ONE);
+          if ((i & 1))
+            gcry_mpi_ec_add (R, R, T2, ctx);
+          break;
+
+        default:
+          /* A = aG + T2 and R = rG.  This holds if H(R,A,M) is
+             even.  */
+          gcry_mpi_ec_add (A, A, T2, ctx);
+          gcry_mpi_ec_mul (R, r, G, ctx);
+          break;
+        }
+      encode_point (abuf, A, ctx);
+      encode_point (rbuf, R, ctx);
+
+      err = gcry_md_open (&md, GCRY_MD_SHA512, 0);
+      if (err)
+        die ("gcry_md_open failed: %s\n", gpg_strerror (err));
+      gcry_md_write (md, rbuf, 32);
+      gcry_md_write (md, abuf, 32);
+      gcry_md_write (md, msg, strlen (msg));
+      memcpy (digest, gcry_md_read (md, 0), 64);
+      gcry_md_close (md);
+      for (j = 0; j < 64; j++)
+        hbuf[j] = digest[63 - j];
+      gcry_mpi_release (h);
+      if (gcry_mpi_scan (&h, GCRYMPI_FMT_USG, hbuf, 64, NULL))
+        die ("gcry_mpi_scan failed\n");
+      gcry_mpi_mulm (s, h, a, n);
+      gcry_mpi_addm (s, s, r, n);
+      if (i == N_TORSION)
+        gcry_mpi_add_ui (s, s, 1);
+      mpi_to_le (sbuf, s);
+
+      err = gcry_sexp_build (&s_pk[i], NULL,
+                             "(public-key(ecc(curve \"Ed25519\")(flags eddsa)"
+                             "(q %b)))", 32, abuf);
+      if (!err)
+        err = gcry_sexp_build (&s_msg[i], NULL,
+                               "(data(flags eddsa)(hash-algo sha512)"
+                               "(value %b))", (int)strlen (msg), msg);
+      if (!err)
+        err = gcry_sexp_build (&s_sig[i], NULL,
+                               "(sig-val(eddsa(r %b)(s %b)))",
+                               32, rbuf, 32, sbuf);
+      if (err)
+        die ("error building s-exp: %s\n", gpg_strerror (err));
+    }
+
+  n_good = 0;
+  for (i = 0; i < N_TORSION + 1; i++)
+    {
+      expected[i] = gcry_pk_verify (s_sig[i], s_msg[i], s_pk[i]);
+      if (!expected[i])
+        n_good++;
+    }
+  /* Make sure that the test covers both outcomes.  */
+  if (!n_good || n_good == N_TORSION)
+    fail ("torsion test: gcry_pk_verify returned %d good signatures",
+          n_good);
+
+  if (!expected[N_TORSION])
+    fail ("torsion test: gcry_pk_verify accepted a bad signature");
+  for (i = 1; i < N_TORSION; i += 3)
+    if (!expected[i] != !(i & 1))
+      fail ("torsion test: item %d: gcry_pk_verify returned '%s'",
+            i, gpg_strerror (expected[i]));
+
+  /* Signatures with an R which can't be decoded are verified by
+     gcry_pk_verify, all others hold for the cofactored equation.  */
+  err = gcry_pk_verify_batch (s_sig, s_msg, s_pk, N_TORSION, results);
+  if (gpg_err_code (err) != GPG_ERR_BAD_SIGNATURE)
+    fail ("torsion test: gcry_pk_verify_batch returned: %s",
+          gpg_strerror (err));
+  for (i = 0; i < N_TORSION; i++)
+    if (gpg_err_code (results[i])
+        != (i % 3 == 1? gpg_err_code (expected[i]) : 0))
+      fail ("torsion test: item %d: gcry_pk_verify_batch returned '%s'",
+            i, gpg_strerror (results[i]));
+
+  err = gcry_pk_verify_batch (s_sig, s_msg, s_pk, N_TORSION + 1, results);
+  if (gpg_err_code (err) != GPG_ERR_BAD_SIGNATURE)
+    fail ("torsion test: gcry_pk_verify_batch with a bad signature"
+          " returned: %s", gpg_strerror (err));
+  if (gpg_err_code (results[N_TORSION]) != GPG_ERR_BAD_SIGNATURE)
+    fail ("torsion test: gcry_pk_verify_batch accepted a bad signature");
+  for (i = 0; i < N_TORSION; i++)
+    if (!expected[i] && results[i])
+      fail ("torsion test: item %d: gcry_pk_verify_batch returned '%s'"
+            " but gcry_pk_verify returned 'Success'",
+            i, gpg_strerror (results[i]));
+
+  for (i = 0; i < N_TORSION + 1; i++)
+    {
+      gcry_sexp_release (s_sig[i]);
+      gcry_sexp_release (s_msg[i]);
+      gcry_sexp_release (s_pk[i]);
+    }
+  gcry_mpi_point_release (A);
+  gcry_mpi_point_release (R);
+  gcry_mpi_point_release (T2);
+  gcry_mpi_point_release (G);
+  gcry_mpi_release (a);
+  gcry_mpi_release (r);
+  gcry_mpi_release (s);
+  gcry_mpi_release (h);
+  gcry_mpi_release (tmp);
+  gcry_mpi_release (zero);
+  gcry_mpi_release (n);
+  gcry_mpi_release (p);
+  gcry_ctx_release (ctx);
+}
+
+
 static void
 one_test (int testno, const char *sk, const char *pk,
           const char *msg, const char *sig)
@@ -390,9 +658,20 @@ one_test (int testno, const char *sk, const char *pk,
     }
 
   if (!no_verify)
-    if ((err = gcry_pk_verify (s_sig, s_msg, s_pk)))
-      fail ("gcry_pk_verify failed for test %d: %s",
-            testno, gpg_strerror (err));
+    {
+      if ((err = gcry_pk_verify (s_sig, s_msg, s_pk)))
+        fail ("gcry_pk_verify failed for test %d: %s",
+              testno, gpg_strerror (err));
+      else
+        {
+          /* Keep the objects for check_batch.  */
+          batch_sig[batch_count] = s_sig; s_sig = NULL;
+          batch_msg[batch_count] = s_msg; s_msg = NULL;
+          batch_pk[batch_count] = s_pk; s_pk = NULL;
+          if (++batch_count == BATCH_SIZE)
+            check_batch ();
+        }
+    }
 
 
  leave:
@@ -460,6 +739,7 @@ check_ed25519 (const char *fname)
   xfree (sk);
   xfree (msg);
   xfree (sig);
+  check_batch ();
 
   if (ntests != N_TESTS && !custom_data_file)
     fail ("did %d tests but expected %d", ntests, N_TESTS);
@@ -554,6 +834,8 @@ main (int argc, char **argv)
 
   start_timer ();
   check_ed25519 (fname);
+  if (!no_verify)
+    check_batch_torsion ();
   stop_timer ();
 
   xfree (fname);
@@ -1047,11 +1047,45 @@ check_pbkdf2 (void)
       20,
       "\x43\xe0\x6c\x55\x90\xb0\x8c\x02\x25\x24"
       "\x23\x73\x12\x7e\xdf\x9c\x8e\x9c\x32\x91"
+    },
+    { /* From RFC-7914.  */
+      "passwd", 6,
+      "salt", 4,
+      GCRY_MD_SHA256,
+      1,
+      64,
+      "\x55\xac\x04\x6e\x56\xe3\x08\x9f\xec\x16\x91\xc2\x25\x44\xb6\x05"
+      "\xf9\x41\x85\x21\x6d\xde\x04\x65\xe6\x8b\x9d\x57\xc2\x0d\xac\xbc"
+      "\x49\xca\x9c\xcc\xf1\x79\xb6\x45\x99\x16\x64\xb3\x9d\x77\xef\x31"
+      "\x7c\x71\xb8\x45\xb1\xe3\x0b\xd5\x09\x11\x20\x41\xd3\xa1\x97\x83"
+    },
+    { /* From RFC-7914.  */
+      "Password", 8,
+      "NaCl", 4,
+      GCRY_MD_SHA256,
+      80000,
+      64,
+      "\x4d\xdc\xd8\xf6\x0b\x98\xbe\x21\x83\x0c\xee\x5e\xf2\x27\x01\xf9"
+      "\x64\x1a\x44\x18\xd0\x4c\x04\x14\xae\xff\x08\x87\x6b\x34\xab\x56"
+      "\xa1\xd4\x25\xa1\x22\x58\x33\x54\x9a\xdb\x84\x1b\x51\xc9\xb3\x17"
+      "\x6a\x27\x2b\xde\xbb\xa1\xd0\x78\x47\x8f\x62\xb3\x97\xf3\x3c\x8d"
+    },
+    { /* Passphrase longer than the block size, not in an RFC.  */
+      "0123456789012345678901234567890123456789"
+      "0123456789012345678901234567890123456789"
+      "01234567890123456789", 100,
+      "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36,
+      GCRY_MD_SHA256,
+      1000,
+      40,
+      "\x3b\x36\x96\x96\x87\xcf\x0f\x24\xbc\x06\xaa\xee\x94\x9e\xbe\xf6"
+      "\x80\xc5\xa7\x1b\xdb\x8d\x07\x82\x63\x02\xf2\x59\x29\x2e\x5e\xb0"
+      "\x1e\xcc\x3d\x67\xc4\x50\x24\xfb"
     }
   };
   int tvidx;
   gpg_error_t err;
-  unsigned char outbuf[40];
+  unsigned char outbuf[64];
   int i;
 
   for (tvidx=0; tvidx < DIM(tv); tvidx++)
@@ -958,6 +958,95 @@ basic_ec_math_simplified (void)
 }
 
 
+/* Check the math for the NIST curves which use a specialized
+   reduction function.  For each curve we check that (n-1)G == -G and
+   that nG is the point at infinity.  */
+static void
+nist_curve_math (void)
+{
+  static const char *names[] =
+    { "NIST P-192", "NIST P-224", "NIST P-256", "NIST P-384", "NIST P-521",
+      NULL };
+  gpg_error_t err;
+  gcry_ctx_t ctx;
+  gcry_mpi_point_t G, Q;
+  gcry_mpi_t p, n, k, x, y, gx, gy;
+  int idx, secure;
+
+  wherestr = "nist_curve_math";
+  show ("checking NIST curve math\n");
+
+  for (idx=0; names[idx]; idx++)
+    {
+      if (!idx && gcry_fips_mode_active ())
+        continue;  /* P-192 is not supported in FIPS mode.  */
+
+      err = gcry_mpi_ec_new (&ctx, NULL, names[idx]);
+      if (err)
+        die ("gcry_mpi_ec_new(%s) failed: %s\n", names[idx],
+             gpg_strerror (err));
+
+      G = gcry_mpi_ec_get_point ("g", ctx, 1);
+      if (!G)
+        die ("gcry_mpi_ec_get_point(G) failed\n");
+      p = gcry_mpi_ec_get_mpi ("p", ctx, 1);
+      n = gcry_mpi_ec_get_mpi ("n", ctx, 1);
+      Q = gcry_mpi_point_new (0);
+      x = gcry_mpi_new (0);
+      y = gcry_mpi_new (0);
+      gx = gcry_mpi_new (0);
+      gy = gcry_mpi_new (0);
+
+      if (!gcry_mpi_ec_curve_point (G, ctx))
+        fail ("%s: G is not on the curve\n", names[idx]);
+      if (gcry_mpi_ec_get_affine (gx, gy, G, ctx))
+        fail ("%s: failed to get affine coordinates of G\n", names[idx]);
+
+      /* Run the check with the plain and the constant time variant of
+         the scalar multiplication.  */
+      for (secure=0; secure < 2; secure++)
+        {
+          k = secure? gcry_mpi_snew (0) : gcry_mpi_new (0);
+          gcry_mpi_sub_ui (k, n, 1);
+          gcry_mpi_ec_mul (Q, k, G, ctx);
+          if (!gcry_mpi_ec_curve_point (Q, ctx))
+            fail ("%s: (n-1)G is not on the curve (secure=%d)\n",
+                  names[idx], secure);
+          if (gcry_mpi_ec_get_affine (x, y, Q, ctx))
+            fail ("%s: failed to get affine coordinates (secure=%d)\n",
+                  names[idx], secure);
+          gcry_mpi_sub (y, p, y);
+          if (gcry_mpi_cmp (x, gx) || gcry_mpi_cmp (y, gy))
+            {
+              fail ("%s: (n-1)G != -G (secure=%d)\n", names[idx], secure);
+              if (verbose)
+                {
+                  print_mpi ("x", x);
+                  print_mpi ("y", y);
+                }
+            }
+
+          gcry_mpi_add_ui (k, k, 1);
+          gcry_mpi_ec_mul (Q, k, G, ctx);
+          if (!gcry_mpi_ec_get_affine (x, y, Q, ctx))
+            fail ("%s: nG is not the point at infinity (secure=%d)\n",
+                  names[idx], secure);
+          gcry_mpi_release (k);
+        }
+
+      gcry_mpi_release (gy);
+      gcry_mpi_release (gx);
+      gcry_mpi_release (y);
+      gcry_mpi_release (x);
+      gcry_mpi_point_release (Q);
+      gcry_mpi_release (n);
+      gcry_mpi_release (p);
+      gcry_mpi_point_release (G);
+      gcry_ctx_release (ctx);
+    }
+}
+
+
 /* Check the math used with Twisted Edwards curves.  */
 static void
 twistededwards_math (void)
@@ -1117,6 +1206,7 @@ main (int argc, char **argv)
   context_alloc ();
   context_param ();
   basic_ec_math ();
+  nist_curve_math ();
 
   /* The tests are for P-192 and ed25519 which are not supported in
      FIPS mode.  */